@@ -0,0 +1,215 @@
+#include <obs-module.h>
+#include <graphics/matrix4.h>
+
+/* brightness/contrast/saturation/opacity and a color multiply/add, all of
+ * them linear, so the whole filter is one color matrix that libobs can
+ * merge with neighbouring color filters */
+
+#define LUMA_R 0.2126f
+#define LUMA_G 0.7152f
+#define LUMA_B 0.0722f
+
+struct color_filter {
+	obs_source_t *context;
+
+	gs_eparam_t *matrix_param;
+	gs_eparam_t *offset_param;
+
+	struct obs_filter_color_op op;
+};
+
+static const char *color_filter_get_name(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return obs_module_text("ColorFilter");
+}
+
+/* op becomes "op, then matrix/offset" */
+static void append_op(struct obs_filter_color_op *op,
+		      const struct matrix4 *matrix, const struct vec4 *offset)
+{
+	struct vec4 new_offset;
+
+	vec4_transform(&new_offset, &op->offset, matrix);
+	vec4_add(&op->offset, &new_offset, offset);
+	matrix4_mul(&op->matrix, &op->matrix, matrix);
+}
+
+static void scale_rgb(struct obs_filter_color_op *op, float r, float g,
+		      float b, float a, float add)
+{
+	struct matrix4 matrix;
+	struct vec4 offset;
+
+	matrix4_identity(&matrix);
+	matrix.x.x = r;
+	matrix.y.y = g;
+	matrix.z.z = b;
+	matrix.t.w = a;
+	vec4_set(&offset, add, add, add, 0.0f);
+
+	append_op(op, &matrix, &offset);
+}
+
+static void saturate_rgb(struct obs_filter_color_op *op, float saturation)
+{
+	const float luma[] = {LUMA_R, LUMA_G, LUMA_B};
+	struct matrix4 matrix;
+	struct vec4 offset;
+	struct vec4 *rows = &matrix.x;
+
+	matrix4_identity(&matrix);
+	for (size_t i = 0; i < 3; i++) {
+		for (size_t j = 0; j < 3; j++)
+			rows[i].ptr[j] = (1.0f - saturation) * luma[i] +
+					 (i == j ? saturation : 0.0f);
+	}
+	vec4_zero(&offset);
+
+	append_op(op, &matrix, &offset);
+}
+
+static void color_filter_update(void *data, obs_data_t *settings)
+{
+	struct color_filter *filter = data;
+	const float brightness =
+		(float)obs_data_get_double(settings, "brightness");
+	const float contrast =
+		(float)obs_data_get_double(settings, "contrast") + 1.0f;
+	const float saturation =
+		(float)obs_data_get_double(settings, "saturation") + 1.0f;
+	const float opacity =
+		(float)obs_data_get_double(settings, "opacity") / 100.0f;
+	uint32_t multiply = (uint32_t)obs_data_get_int(settings,
+						       "color_multiply");
+	uint32_t add = (uint32_t)obs_data_get_int(settings, "color_add");
+	struct vec4 mul_color, add_color;
+	struct matrix4 matrix;
+
+	/* the filter draws in linear space */
+	vec4_from_rgba_srgb(&mul_color, multiply | 0xFF000000);
+	vec4_from_rgba_srgb(&add_color, add & 0x00FFFFFF);
+
+	matrix4_identity(&filter->op.matrix);
+	vec4_zero(&filter->op.offset);
+
+	saturate_rgb(&filter->op, saturation);
+	scale_rgb(&filter->op, contrast, contrast, contrast, 1.0f,
+		  0.5f - 0.5f * contrast);
+	scale_rgb(&filter->op, 1.0f, 1.0f, 1.0f, 1.0f, brightness);
+	scale_rgb(&filter->op, mul_color.x, mul_color.y, mul_color.z, opacity,
+		  0.0f);
+
+	matrix4_identity(&matrix);
+	add_color.w = 0.0f;
+	append_op(&filter->op, &matrix, &add_color);
+}
+
+static void *color_filter_create(obs_data_t *settings, obs_source_t *context)
+{
+	struct color_filter *filter = bzalloc(sizeof(struct color_filter));
+	gs_effect_t *effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+
+	filter->context = context;
+	filter->matrix_param = gs_effect_get_param_by_name(effect,
+							   "color_matrix");
+	filter->offset_param = gs_effect_get_param_by_name(effect,
+							   "color_offset");
+
+	color_filter_update(filter, settings);
+	return filter;
+}
+
+static void color_filter_destroy(void *data)
+{
+	bfree(data);
+}
+
+static bool color_filter_get_color_op(void *data,
+				      struct obs_filter_color_op *op)
+{
+	struct color_filter *filter = data;
+	*op = filter->op;
+	return true;
+}
+
+static void color_filter_render(void *data, gs_effect_t *effect)
+{
+	struct color_filter *filter = data;
+	gs_effect_t *default_effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+
+	if (!obs_source_process_filter_begin(filter->context, GS_RGBA,
+					     OBS_ALLOW_DIRECT_RENDERING))
+		return;
+
+	gs_effect_set_matrix4(filter->matrix_param, &filter->op.matrix);
+	gs_effect_set_vec4(filter->offset_param, &filter->op.offset);
+
+	obs_source_process_filter_tech_end(filter->context, default_effect, 0,
+					   0, "DrawColorMatrix");
+
+	UNUSED_PARAMETER(effect);
+}
+
+static enum gs_color_space
+color_filter_get_color_space(void *data, size_t count,
+			     const enum gs_color_space *preferred_spaces)
+{
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(count);
+	UNUSED_PARAMETER(preferred_spaces);
+
+	/* HDR input is converted down by obs_source_process_filter_begin */
+	return GS_CS_SRGB;
+}
+
+static obs_properties_t *color_filter_properties(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+
+	obs_properties_t *props = obs_properties_create();
+
+	obs_properties_add_float_slider(props, "brightness",
+					obs_module_text("ColorFilter.Brightness"),
+					-1.0, 1.0, 0.0001);
+	obs_properties_add_float_slider(props, "contrast",
+					obs_module_text("ColorFilter.Contrast"),
+					-1.0, 1.0, 0.0001);
+	obs_properties_add_float_slider(props, "saturation",
+					obs_module_text("ColorFilter.Saturation"),
+					-1.0, 4.0, 0.0001);
+	obs_properties_add_float_slider(props, "opacity",
+					obs_module_text("ColorFilter.Opacity"),
+					0.0, 100.0, 0.1);
+	obs_properties_add_color(props, "color_multiply",
+				 obs_module_text("ColorFilter.ColorMultiply"));
+	obs_properties_add_color(props, "color_add",
+				 obs_module_text("ColorFilter.ColorAdd"));
+
+	return props;
+}
+
+static void color_filter_defaults(obs_data_t *settings)
+{
+	obs_data_set_default_double(settings, "brightness", 0.0);
+	obs_data_set_default_double(settings, "contrast", 0.0);
+	obs_data_set_default_double(settings, "saturation", 0.0);
+	obs_data_set_default_double(settings, "opacity", 100.0);
+	obs_data_set_default_int(settings, "color_multiply", 0x00FFFFFF);
+	obs_data_set_default_int(settings, "color_add", 0x00000000);
+}
+
+struct obs_source_info color_filter_info = {
+	.id = "color_adjust_filter",
+	.type = OBS_SOURCE_TYPE_FILTER,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB,
+	.create = color_filter_create,
+	.destroy = color_filter_destroy,
+	.update = color_filter_update,
+	.get_name = color_filter_get_name,
+	.get_defaults = color_filter_defaults,
+	.get_properties = color_filter_properties,
+	.video_render = color_filter_render,
+	.video_get_color_space = color_filter_get_color_space,
+	.filter_get_color_op = color_filter_get_color_op,
+};
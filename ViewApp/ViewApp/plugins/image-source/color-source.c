@@ -3,9 +3,11 @@
 struct color_source {
 	struct vec4 color;
 	struct vec4 color_srgb;
+	uint32_t rgba;
 
 	uint32_t width;
 	uint32_t height;
+	bool opaque;
 
 	obs_source_t *src;
 };
@@ -25,8 +27,10 @@ static void color_source_update(void *data, obs_data_t *settings)
 
 	vec4_from_rgba(&context->color, color);
 	vec4_from_rgba_srgb(&context->color_srgb, color);
+	context->rgba = color;
 	context->width = width;
 	context->height = height;
+	context->opaque = (color >> 24) == 0xFF;
 }
 
 static void *color_source_create(obs_data_t *settings, obs_source_t *source)
@@ -103,6 +107,22 @@ static void color_source_render(void *data, gs_effect_t *effect)
 	gs_enable_framebuffer_srgb(previous);
 }
 
+static bool color_source_is_opaque(void *data)
+{
+	struct color_source *context = data;
+	return context->opaque;
+}
+
+static bool color_source_get_sprite(void *data,
+				    struct obs_source_sprite *sprite)
+{
+	struct color_source *context = data;
+
+	sprite->texture = NULL;
+	sprite->color = context->rgba;
+	return true;
+}
+
 static uint32_t color_source_getwidth(void *data)
 {
 	struct color_source *context = data;
@@ -140,7 +160,7 @@ struct obs_source_info color_source_info_v1 = {
 	.id = "color_source",
 	.type = OBS_SOURCE_TYPE_INPUT,
 	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CUSTOM_DRAW |
-			OBS_SOURCE_CAP_OBSOLETE,
+			OBS_SOURCE_CAP_OBSOLETE | OBS_SOURCE_CACHEABLE_RENDER,
 	.create = color_source_create,
 	.destroy = color_source_destroy,
 	.update = color_source_update,
@@ -151,6 +171,8 @@ struct obs_source_info color_source_info_v1 = {
 	.video_render = color_source_render,
 	.get_properties = color_source_properties,
 	.icon_type = OBS_ICON_TYPE_COLOR,
+	.video_is_opaque = color_source_is_opaque,
+	.video_get_sprite = color_source_get_sprite,
 };
 
 struct obs_source_info color_source_info_v2 = {
@@ -158,7 +180,7 @@ struct obs_source_info color_source_info_v2 = {
 	.version = 2,
 	.type = OBS_SOURCE_TYPE_INPUT,
 	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CUSTOM_DRAW |
-			OBS_SOURCE_CAP_OBSOLETE,
+			OBS_SOURCE_CAP_OBSOLETE | OBS_SOURCE_CACHEABLE_RENDER,
 	.create = color_source_create,
 	.destroy = color_source_destroy,
 	.update = color_source_update,
@@ -169,6 +191,8 @@ struct obs_source_info color_source_info_v2 = {
 	.video_render = color_source_render,
 	.get_properties = color_source_properties,
 	.icon_type = OBS_ICON_TYPE_COLOR,
+	.video_is_opaque = color_source_is_opaque,
+	.video_get_sprite = color_source_get_sprite,
 };
 
 struct obs_source_info color_source_info_v3 = {
@@ -176,7 +200,7 @@ struct obs_source_info color_source_info_v3 = {
 	.version = 3,
 	.type = OBS_SOURCE_TYPE_INPUT,
 	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_CUSTOM_DRAW |
-			OBS_SOURCE_SRGB,
+			OBS_SOURCE_SRGB | OBS_SOURCE_CACHEABLE_RENDER,
 	.create = color_source_create,
 	.destroy = color_source_destroy,
 	.update = color_source_update,
@@ -187,4 +211,6 @@ struct obs_source_info color_source_info_v3 = {
 	.video_render = color_source_render,
 	.get_properties = color_source_properties,
 	.icon_type = OBS_ICON_TYPE_COLOR,
+	.video_is_opaque = color_source_is_opaque,
+	.video_get_sprite = color_source_get_sprite,
 };
@@ -30,6 +30,9 @@ struct image_source {
 	uint64_t last_time;
 	bool active;
 	bool restart_gif;
+	bool reload_pending;
+	bool texture_dirty;
+	bool opaque;
 
 	gs_image_file4_t if4;
 };
@@ -49,6 +52,30 @@ static const char *image_source_get_name(void *unused)
     return name;
 }
 
+/* checked before the texture is created, which frees the pixel data */
+static bool image_data_opaque(const struct gs_image_file *image)
+{
+	const uint8_t *data = image->texture_data;
+	const size_t pixels = (size_t)image->cx * image->cy;
+
+	if (!data || image->is_animated_gif)
+		return false;
+
+	switch (image->format) {
+	case GS_BGRX:
+		return true;
+	case GS_RGBA:
+	case GS_BGRA:
+		for (size_t i = 0; i < pixels; i++) {
+			if (data[i * 4 + 3] != 0xFF)
+				return false;
+		}
+		return true;
+	default:
+		return false;
+	}
+}
+
 static void image_source_load(struct image_source *context)
 {
 	char *file = context->file;
@@ -56,6 +83,7 @@ static void image_source_load(struct image_source *context)
 	obs_enter_graphics();
 	gs_image_file4_free(&context->if4);
 	obs_leave_graphics();
+	context->opaque = false;
 
 	if (file && *file) {
 		debug("loading texture '%s'", file);
@@ -65,6 +93,8 @@ static void image_source_load(struct image_source *context)
 					    ? GS_IMAGE_ALPHA_PREMULTIPLY_SRGB
 					    : GS_IMAGE_ALPHA_PREMULTIPLY);
 		context->update_time_elapsed = 0;
+		context->opaque =
+			image_data_opaque(&context->if4.image3.image2.image);
 
 		obs_enter_graphics();
 		gs_image_file4_init_texture(&context->if4);
@@ -73,6 +103,8 @@ static void image_source_load(struct image_source *context)
 		if (!context->if4.image3.image2.image.loaded)
 			warn("failed to load texture '%s'", file);
 	}
+
+	obs_source_mark_dirty(context->source);
 }
 
 static void image_source_unload(struct image_source *context)
@@ -80,6 +112,9 @@ static void image_source_unload(struct image_source *context)
 	obs_enter_graphics();
 	gs_image_file4_free(&context->if4);
 	obs_leave_graphics();
+	context->opaque = false;
+
+	obs_source_mark_dirty(context->source);
 }
 
 static void image_source_update(void *data, obs_data_t *settings)
@@ -133,11 +168,9 @@ static void restart_gif(void *data)
 		context->if4.image3.image2.image.cur_loop = 0;
 		context->if4.image3.image2.image.cur_time = 0;
 
-		obs_enter_graphics();
-		gs_image_file4_update_texture(&context->if4);
-		obs_leave_graphics();
-
+		context->texture_dirty = true;
 		context->restart_gif = false;
+		obs_source_mark_dirty(context->source);
 	}
 }
 
@@ -179,10 +212,27 @@ static uint32_t image_source_getheight(void *data)
 	return context->if4.image3.image2.image.cy;
 }
 
+/* the tick runs off the graphics thread, so it only queues graphics work */
+static void image_source_apply_tick(struct image_source *context)
+{
+	if (context->reload_pending) {
+		context->reload_pending = false;
+		context->texture_dirty = false;
+		image_source_load(context);
+	}
+
+	if (context->texture_dirty) {
+		context->texture_dirty = false;
+		gs_image_file4_update_texture(&context->if4);
+	}
+}
+
 static void image_source_render(void *data, gs_effect_t *effect)
 {
 	struct image_source *context = data;
 
+	image_source_apply_tick(context);
+
 	struct gs_image_file *const image = &context->if4.image3.image2.image;
 	gs_texture_t *const texture = image->texture;
 	if (!texture)
@@ -202,6 +252,29 @@ static void image_source_render(void *data, gs_effect_t *effect)
 	gs_enable_framebuffer_srgb(previous);
 }
 
+static bool image_source_get_sprite(void *data,
+				    struct obs_source_sprite *sprite)
+{
+	struct image_source *context = data;
+
+	image_source_apply_tick(context);
+
+	gs_texture_t *const texture = context->if4.image3.image2.image.texture;
+	if (!texture || context->if4.space != GS_CS_SRGB)
+		return false;
+
+	sprite->texture = texture;
+	sprite->color = 0xFFFFFFFF;
+	return true;
+}
+
+static bool image_source_is_opaque(void *data)
+{
+	struct image_source *context = data;
+	return context->opaque && !context->reload_pending &&
+	       context->if4.image3.image2.image.texture;
+}
+
 static void image_source_tick(void *data, float seconds)
 {
 	struct image_source *context = data;
@@ -215,7 +288,8 @@ static void image_source_tick(void *data, float seconds)
 			context->update_time_elapsed = 0.0f;
 
 			if (context->file_timestamp != t) {
-				image_source_load(context);
+				context->reload_pending = true;
+				obs_source_mark_dirty(context->source);
 			}
 		}
 	}
@@ -242,12 +316,9 @@ static void image_source_tick(void *data, float seconds)
 	if (context->last_time &&
 	    context->if4.image3.image2.image.is_animated_gif) {
 		uint64_t elapsed = frame_time - context->last_time;
-		bool updated = gs_image_file4_tick(&context->if4, elapsed);
-
-		if (updated) {
-			obs_enter_graphics();
-			gs_image_file4_update_texture(&context->if4);
-			obs_leave_graphics();
+		if (gs_image_file4_tick(&context->if4, elapsed)) {
+			context->texture_dirty = true;
+			obs_source_mark_dirty(context->source);
 		}
 	}
 
@@ -352,7 +423,8 @@ image_source_get_color_space(void *data, size_t count,
 static struct obs_source_info image_source_info = {
 	.id = "image_source",
 	.type = OBS_SOURCE_TYPE_INPUT,
-	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB,
+	.output_flags = OBS_SOURCE_VIDEO | OBS_SOURCE_SRGB |
+			OBS_SOURCE_PARALLEL_TICK | OBS_SOURCE_CACHEABLE_RENDER,
 	.get_name = image_source_get_name,
 	.create = image_source_create,
 	.destroy = image_source_destroy,
@@ -369,6 +441,8 @@ static struct obs_source_info image_source_info = {
 	.icon_type = OBS_ICON_TYPE_IMAGE,
 	.activate = image_source_activate,
 	.video_get_color_space = image_source_get_color_space,
+	.video_is_opaque = image_source_is_opaque,
+	.video_get_sprite = image_source_get_sprite,
 };
 
 OBS_DECLARE_MODULE()
@@ -382,6 +456,7 @@ extern struct obs_source_info slideshow_info;
 extern struct obs_source_info color_source_info_v1;
 extern struct obs_source_info color_source_info_v2;
 extern struct obs_source_info color_source_info_v3;
+extern struct obs_source_info color_filter_info;
 
 bool obs_module_load(void)
 {
@@ -390,5 +465,6 @@ bool obs_module_load(void)
 	obs_register_source(&color_source_info_v2);
 	obs_register_source(&color_source_info_v3);
 	obs_register_source(&slideshow_info);
+	obs_register_source(&color_filter_info);
 	return true;
 }
@@ -61,7 +61,11 @@ static bool gl_copy_fbo(struct gs_texture *dst, uint32_t dst_x, uint32_t dst_y,
 			uint32_t width, uint32_t height)
 {
 	struct fbo_info *fbo = get_fbo(src, width, height);
+	const GLenum binding = dst->gl_target == GL_TEXTURE_RECTANGLE
+				       ? GL_TEXTURE_BINDING_RECTANGLE
+				       : GL_TEXTURE_BINDING_2D;
 	GLint last_fbo;
+	GLint last_tex;
 	bool success = false;
 
 	if (!fbo)
@@ -69,6 +73,10 @@ static bool gl_copy_fbo(struct gs_texture *dst, uint32_t dst_x, uint32_t dst_y,
 
 	if (!gl_get_integer_v(GL_READ_FRAMEBUFFER_BINDING, &last_fbo))
 		return false;
+	/* dst gets bound on the active unit, which may hold a texture the
+	 * device has cached as loaded, e.g. while a batch copies sprites */
+	if (!gl_get_integer_v(binding, &last_tex))
+		return false;
 	if (!gl_bind_framebuffer(GL_READ_FRAMEBUFFER, fbo->fbo))
 		return false;
 	if (!gl_bind_texture(dst->gl_target, dst->texture))
@@ -91,7 +99,7 @@ static bool gl_copy_fbo(struct gs_texture *dst, uint32_t dst_x, uint32_t dst_y,
 	success = true;
 
 fail:
-	if (!gl_bind_texture(dst->gl_target, 0))
+	if (!gl_bind_texture(dst->gl_target, (GLuint)last_tex))
 		success = false;
 	if (!gl_bind_framebuffer(GL_READ_FRAMEBUFFER, last_fbo))
 		success = false;
@@ -0,0 +1,3313 @@
+/******************************************************************************
+    Copyright (C) 2013 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <math.h>
+#include <ctype.h>
+#include <stdarg.h>
+
+#include <graphics/math-defs.h>
+#include <graphics/srgb.h>
+#include <graphics/shader-parser.h>
+#include <util/dstr.h>
+#include "sw-subsystem.h"
+
+/*
+ * Effect program interpreter
+ *
+ *   Passes without a native kernel are compiled from the HLSL the effect
+ * parser hands to the device.  Every value lives in one flat array of floats
+ * (the frame): locals and temporaries on a stack that is unwound after each
+ * statement, then the uniforms and literals.  Functions are inlined at each
+ * call (HLSL has no recursion), control flow becomes jumps, and both sides
+ * of ?: are evaluated the way HLSL does.  Integers are kept in floats and
+ * truncated wherever HLSL would, which is exact for the texel math effects
+ * do.
+ *
+ *   ddx()/ddy() are taken the way a GPU quad takes them: the right and lower
+ * neighbours are run up to their last derivative first, and the pixel then
+ * differences against the values they recorded.
+ */
+
+#define SW_MAX_ARGS 16
+#define SW_STATIC_BIT 0x80000000u
+#define SW_SAMPLE_OFFSET (1u << 16)
+
+enum sw_op {
+	SW_OP_END,
+	SW_OP_JMP,
+	SW_OP_JZ,
+	SW_OP_JNZ,
+	SW_OP_DISCARD,
+	SW_OP_CLIP,
+
+	SW_OP_MOV,
+	SW_OP_GATHER,
+	SW_OP_SCATTER,
+
+	SW_OP_ADD,
+	SW_OP_SUB,
+	SW_OP_MUL,
+	SW_OP_DIV,
+	SW_OP_IDIV,
+	SW_OP_MOD,
+	SW_OP_IMOD,
+	SW_OP_LT,
+	SW_OP_LE,
+	SW_OP_GT,
+	SW_OP_GE,
+	SW_OP_EQ,
+	SW_OP_NE,
+	SW_OP_AND,
+	SW_OP_OR,
+	SW_OP_BITAND,
+	SW_OP_BITOR,
+	SW_OP_BITXOR,
+	SW_OP_SHL,
+	SW_OP_SHR,
+	SW_OP_POW,
+	SW_OP_MIN,
+	SW_OP_MAX,
+	SW_OP_STEP,
+	SW_OP_ATAN2,
+
+	SW_OP_NEG,
+	SW_OP_NOT,
+	SW_OP_BITNOT,
+	SW_OP_TOINT,
+	SW_OP_TOUINT,
+	SW_OP_TOBOOL,
+	SW_OP_ABS,
+	SW_OP_SIGN,
+	SW_OP_FLOOR,
+	SW_OP_CEIL,
+	SW_OP_ROUND,
+	SW_OP_TRUNC,
+	SW_OP_FRAC,
+	SW_OP_SQRT,
+	SW_OP_RSQRT,
+	SW_OP_RCP,
+	SW_OP_EXP,
+	SW_OP_EXP2,
+	SW_OP_LOG,
+	SW_OP_LOG2,
+	SW_OP_LOG10,
+	SW_OP_SIN,
+	SW_OP_COS,
+	SW_OP_TAN,
+	SW_OP_ASIN,
+	SW_OP_ACOS,
+	SW_OP_ATAN,
+	SW_OP_SINH,
+	SW_OP_COSH,
+	SW_OP_TANH,
+	SW_OP_SATURATE,
+	SW_OP_DEGREES,
+	SW_OP_RADIANS,
+	SW_OP_ISNAN,
+	SW_OP_ISINF,
+
+	SW_OP_SELECT,
+	SW_OP_CLAMP,
+	SW_OP_LERP,
+	SW_OP_SMOOTHSTEP,
+	SW_OP_MAD,
+
+	SW_OP_DOT,
+	SW_OP_ANY,
+	SW_OP_ALL,
+	SW_OP_CROSS,
+	SW_OP_VECMAT,
+	SW_OP_MATVEC,
+	SW_OP_MATMAT,
+
+	SW_OP_SAMPLE,
+	SW_OP_LOAD,
+	SW_OP_DDX,
+	SW_OP_DDY,
+};
+
+/* n components, a/b/c step by their stride (0 broadcasts a scalar) */
+struct sw_inst {
+	uint8_t op;
+	uint8_t n;
+	uint8_t sa, sb, sc;
+	uint32_t imm;
+	uint32_t dst, a, b, c;
+};
+
+enum sw_io_kind {
+	SW_IO_POSITION,
+	SW_IO_VERTEXID,
+	SW_IO_ATTRIB,
+	SW_IO_TARGET,
+};
+
+struct sw_io {
+	enum sw_io_kind kind;
+	int attrib;
+	uint32_t slot;
+	uint32_t n;
+	bool integer;
+};
+
+struct sw_uniform {
+	size_t param;
+	uint32_t index;
+	uint32_t size;
+	bool integer;
+};
+
+struct sw_program {
+	enum gs_shader_type type;
+
+	DARRAY(struct sw_inst) code;
+	DARRAY(float) statics;
+	DARRAY(struct sw_uniform) uniforms;
+	DARRAY(struct sw_io) inputs;
+	DARRAY(struct sw_io) outputs;
+
+	uint32_t stack_size;
+	uint32_t num_derivs;
+	uint32_t num_ddx;
+	uint32_t num_ddy;
+	uint32_t deriv_size;
+	uint32_t attribs;
+};
+
+enum sw_exec_mode {
+	SW_EXEC_NORMAL,
+	SW_EXEC_RECORD_X,
+	SW_EXEC_RECORD_Y,
+};
+
+/* ------------------------------------------------------------------------- */
+/* compiler state */
+
+enum sw_token_type {
+	SW_TOKEN_END,
+	SW_TOKEN_NAME,
+	SW_TOKEN_NUM,
+	SW_TOKEN_OP,
+};
+
+struct sw_token {
+	enum sw_token_type type;
+	const char *str;
+	size_t len;
+};
+
+enum sw_base {
+	SW_VOID,
+	SW_BOOL,
+	SW_INT,
+	SW_UINT,
+	SW_FLOAT,
+	SW_STRUCT,
+	SW_TEXTURE,
+	SW_SAMPLER,
+};
+
+struct sw_struct {
+	const struct shader_struct *info;
+	uint32_t size;
+};
+
+struct sw_type {
+	enum sw_base base;
+	uint8_t rows;
+	uint8_t cols;
+	const struct sw_struct *st;
+};
+
+struct sw_val {
+	struct sw_type type;
+	uint32_t slot;
+	uint8_t swz;
+	bool swizzled;
+	bool lvalue;
+	bool is_const;
+	float cval;
+};
+
+struct sw_symbol {
+	const char *name;
+	size_t len;
+	struct sw_val val;
+};
+
+struct sw_func {
+	const struct shader_func *info;
+	struct dstr source;
+	DARRAY(struct sw_token) tokens;
+	bool lexed;
+	bool active;
+};
+
+struct sw_inline {
+	struct sw_type ret;
+	uint32_t ret_slot;
+	DARRAY(size_t) returns;
+};
+
+struct sw_loop {
+	DARRAY(size_t) breaks;
+	DARRAY(size_t) continues;
+};
+
+struct sw_compiler {
+	struct sw_program *prog;
+	struct shader_parser *sp;
+
+	struct sw_struct *structs;
+	struct sw_func *funcs;
+	DARRAY(struct sw_symbol) symbols;
+	size_t num_globals;
+	size_t scope_base;
+	size_t literals_base;
+
+	const struct sw_token *tokens;
+	size_t pos;
+
+	struct sw_inline *func;
+	struct sw_loop *loop;
+
+	uint32_t top;
+	uint32_t zero;
+	bool failed;
+	struct dstr error;
+};
+
+static void compile_error(struct sw_compiler *c, const char *format, ...)
+{
+	const struct sw_token *token = c->tokens ? c->tokens + c->pos : NULL;
+	va_list args;
+
+	if (c->failed)
+		return;
+	c->failed = true;
+
+	va_start(args, format);
+	dstr_vprintf(&c->error, format, args);
+	va_end(args);
+
+	if (token && token->type != SW_TOKEN_END)
+		dstr_catf(&c->error, " (near '%.*s')", (int)token->len,
+			  token->str);
+}
+
+/* ------------------------------------------------------------------------- */
+/* tokens */
+
+static const char *multi_ops[] = {"<<=", ">>=", "++", "--", "+=", "-=",
+				  "*=",  "/=",  "%=", "&=", "|=", "^=",
+				  "==",  "!=",  "<=", ">=", "&&", "||",
+				  "<<",  ">>",  NULL};
+
+static size_t op_length(const char *p)
+{
+	for (const char **op = multi_ops; *op; op++) {
+		size_t len = strlen(*op);
+		if (strncmp(p, *op, len) == 0)
+			return len;
+	}
+	return 1;
+}
+
+static const char *skip_number(const char *p)
+{
+	if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+		p += 2;
+		while (isxdigit((unsigned char)*p))
+			p++;
+	} else {
+		while (isdigit((unsigned char)*p) || *p == '.')
+			p++;
+		if (*p == 'e' || *p == 'E') {
+			p++;
+			if (*p == '+' || *p == '-')
+				p++;
+			while (isdigit((unsigned char)*p))
+				p++;
+		}
+	}
+
+	while (*p && strchr("fFhHuUlL", *p))
+		p++;
+	return p;
+}
+
+static void lex_func(struct sw_func *func)
+{
+	const char *p = func->source.array;
+	struct sw_token end = {SW_TOKEN_END, "", 0};
+
+	while (p && *p) {
+		struct sw_token token;
+
+		if (isspace((unsigned char)*p)) {
+			p++;
+			continue;
+		}
+		if (p[0] == '/' && p[1] == '/') {
+			while (*p && *p != '\n')
+				p++;
+			continue;
+		}
+		if (p[0] == '/' && p[1] == '*') {
+			const char *close = strstr(p + 2, "*/");
+			p = close ? close + 2 : p + strlen(p);
+			continue;
+		}
+
+		token.str = p;
+		if (isalpha((unsigned char)*p) || *p == '_') {
+			token.type = SW_TOKEN_NAME;
+			while (isalnum((unsigned char)*p) || *p == '_')
+				p++;
+		} else if (isdigit((unsigned char)*p) ||
+			   (*p == '.' && isdigit((unsigned char)p[1]))) {
+			token.type = SW_TOKEN_NUM;
+			p = skip_number(p);
+		} else {
+			token.type = SW_TOKEN_OP;
+			p += op_length(p);
+		}
+		token.len = p - token.str;
+		da_push_back(func->tokens, &token);
+	}
+
+	da_push_back(func->tokens, &end);
+	func->lexed = true;
+}
+
+static inline bool tok_is(const struct sw_token *token, const char *str)
+{
+	size_t len = strlen(str);
+	return token->len == len && memcmp(token->str, str, len) == 0;
+}
+
+static inline bool name_is(const char *name, size_t len, const char *str)
+{
+	return strlen(str) == len && memcmp(name, str, len) == 0;
+}
+
+static inline const struct sw_token *cur(struct sw_compiler *c)
+{
+	return c->tokens + c->pos;
+}
+
+static inline const struct sw_token *peek(struct sw_compiler *c, size_t n)
+{
+	for (size_t i = 0; i < n; i++) {
+		if (c->tokens[c->pos + i].type == SW_TOKEN_END)
+			return c->tokens + c->pos + i;
+	}
+	return c->tokens + c->pos + n;
+}
+
+static inline void advance(struct sw_compiler *c)
+{
+	if (cur(c)->type != SW_TOKEN_END)
+		c->pos++;
+}
+
+static inline bool accept(struct sw_compiler *c, const char *str)
+{
+	if (!tok_is(cur(c), str))
+		return false;
+	advance(c);
+	return true;
+}
+
+static void expect(struct sw_compiler *c, const char *str)
+{
+	if (!accept(c, str))
+		compile_error(c, "expected '%s'", str);
+}
+
+static const struct sw_token *expect_name(struct sw_compiler *c)
+{
+	const struct sw_token *token = cur(c);
+	if (token->type != SW_TOKEN_NAME) {
+		compile_error(c, "expected a name");
+		return NULL;
+	}
+	advance(c);
+	return token;
+}
+
+/* ------------------------------------------------------------------------- */
+/* types */
+
+static bool builtin_type(const char *name, size_t len, struct sw_type *type)
+{
+	static const struct {
+		const char *prefix;
+		enum sw_base base;
+	} scalars[] = {
+		{"float", SW_FLOAT},     {"half", SW_FLOAT},
+		{"double", SW_FLOAT},    {"min16float", SW_FLOAT},
+		{"min10float", SW_FLOAT}, {"int", SW_INT},
+		{"min16int", SW_INT},    {"uint", SW_UINT},
+		{"dword", SW_UINT},      {"min16uint", SW_UINT},
+		{"bool", SW_BOOL},
+	};
+	static const char *textures[] = {"texture2d",    "texture3d",
+					 "texture_cube", "texture_rect",
+					 "Texture2D",    "Texture3D",
+					 "TextureCube",  NULL};
+	static const char *samplers[] = {"sampler", "sampler_state",
+					 "SamplerState", "sampler2D", NULL};
+
+	memset(type, 0, sizeof(*type));
+
+	for (size_t i = 0; i < sizeof(scalars) / sizeof(scalars[0]); i++) {
+		size_t plen = strlen(scalars[i].prefix);
+		const char *rest = name + plen;
+
+		if (len < plen || memcmp(name, scalars[i].prefix, plen) != 0)
+			continue;
+
+		type->base = scalars[i].base;
+		if (len == plen) {
+			type->rows = type->cols = 1;
+			return true;
+		}
+		if (len == plen + 1 && rest[0] >= '1' && rest[0] <= '4') {
+			type->rows = 1;
+			type->cols = rest[0] - '0';
+			return true;
+		}
+		if (len == plen + 3 && rest[0] >= '1' && rest[0] <= '4' &&
+		    rest[1] == 'x' && rest[2] >= '1' && rest[2] <= '4') {
+			type->rows = rest[0] - '0';
+			type->cols = rest[2] - '0';
+			return true;
+		}
+	}
+
+	for (const char **tex = textures; *tex; tex++) {
+		if (name_is(name, len, *tex)) {
+			type->base = SW_TEXTURE;
+			return true;
+		}
+	}
+	for (const char **ss = samplers; *ss; ss++) {
+		if (name_is(name, len, *ss)) {
+			type->base = SW_SAMPLER;
+			return true;
+		}
+	}
+	if (name_is(name, len, "void")) {
+		type->base = SW_VOID;
+		return true;
+	}
+
+	return false;
+}
+
+static bool lookup_type(struct sw_compiler *c, const char *name, size_t len,
+			struct sw_type *type)
+{
+	if (builtin_type(name, len, type))
+		return true;
+
+	for (size_t i = 0; i < c->sp->structs.num; i++) {
+		const struct sw_struct *st = c->structs + i;
+		if (name_is(name, len, st->info->name)) {
+			memset(type, 0, sizeof(*type));
+			type->base = SW_STRUCT;
+			type->rows = type->cols = 1;
+			type->st = st;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static inline bool lookup_type_str(struct sw_compiler *c, const char *name,
+				   struct sw_type *type)
+{
+	return name && lookup_type(c, name, strlen(name), type);
+}
+
+static inline bool is_numeric(const struct sw_type *type)
+{
+	return type->base >= SW_BOOL && type->base <= SW_FLOAT;
+}
+
+static inline bool is_integer(enum sw_base base)
+{
+	return base == SW_INT || base == SW_UINT;
+}
+
+static inline uint32_t type_comps(const struct sw_type *type)
+{
+	return is_numeric(type) ? (uint32_t)type->rows * type->cols : 0;
+}
+
+static inline uint32_t type_size(const struct sw_type *type)
+{
+	if (type->base == SW_STRUCT)
+		return type->st->size;
+	return type_comps(type);
+}
+
+static inline struct sw_type vec_type(enum sw_base base, uint32_t n)
+{
+	struct sw_type type = {base, 1, (uint8_t)n, NULL};
+	return type;
+}
+
+static inline enum sw_base promote(enum sw_base a, enum sw_base b)
+{
+	if (a == SW_FLOAT || b == SW_FLOAT)
+		return SW_FLOAT;
+	if (a == SW_UINT || b == SW_UINT)
+		return SW_UINT;
+	return SW_INT;
+}
+
+static bool size_structs(struct sw_compiler *c)
+{
+	for (size_t i = 0; i < c->sp->structs.num; i++) {
+		struct sw_struct *st = c->structs + i;
+		st->info = c->sp->structs.array + i;
+	}
+
+	/* structs only nest ones declared before them */
+	for (size_t i = 0; i < c->sp->structs.num; i++) {
+		struct sw_struct *st = c->structs + i;
+
+		for (size_t j = 0; j < st->info->vars.num; j++) {
+			const struct shader_var *var = st->info->vars.array + j;
+			struct sw_type type;
+
+			if (!lookup_type_str(c, var->type, &type) ||
+			    var->array_count ||
+			    (!is_numeric(&type) && type.base != SW_STRUCT)) {
+				compile_error(c, "unsupported member '%s' in '%s'",
+					      var->name, st->info->name);
+				return false;
+			}
+			st->size += type_size(&type);
+		}
+	}
+
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* code and slots */
+
+static inline struct sw_inst *emit(struct sw_compiler *c, enum sw_op op,
+				   uint32_t n, uint32_t dst)
+{
+	struct sw_inst *inst = da_push_back_new(c->prog->code);
+	inst->op = (uint8_t)op;
+	inst->n = (uint8_t)n;
+	inst->dst = dst;
+	return inst;
+}
+
+static inline size_t emit_jump(struct sw_compiler *c, enum sw_op op,
+			       uint32_t cond)
+{
+	struct sw_inst *inst = emit(c, op, 1, 0);
+	inst->a = cond;
+	return c->prog->code.num - 1;
+}
+
+static inline void patch(struct sw_compiler *c, size_t idx, size_t target)
+{
+	c->prog->code.array[idx].imm = (uint32_t)target;
+}
+
+static inline uint32_t alloc_slots(struct sw_compiler *c, uint32_t n)
+{
+	uint32_t slot = c->top;
+	c->top += n;
+	if (c->top > c->prog->stack_size)
+		c->prog->stack_size = c->top;
+	return slot;
+}
+
+static uint32_t literal_slot(struct sw_compiler *c, float val)
+{
+	struct sw_program *prog = c->prog;
+
+	for (size_t i = c->literals_base; i < prog->statics.num; i++) {
+		if (memcmp(prog->statics.array + i, &val, sizeof(val)) == 0)
+			return SW_STATIC_BIT | (uint32_t)i;
+	}
+
+	da_push_back(prog->statics, &val);
+	return SW_STATIC_BIT | (uint32_t)(prog->statics.num - 1);
+}
+
+static inline struct sw_val make_val(struct sw_type type, uint32_t slot,
+				     bool lvalue)
+{
+	struct sw_val val = {0};
+	val.type = type;
+	val.slot = slot;
+	val.lvalue = lvalue;
+	return val;
+}
+
+static inline struct sw_val bad_val(void)
+{
+	struct sw_val val = {0};
+	return val;
+}
+
+static inline struct sw_val temp_val(struct sw_compiler *c,
+				     struct sw_type type)
+{
+	return make_val(type, alloc_slots(c, type_size(&type)), false);
+}
+
+static struct sw_val const_val(struct sw_compiler *c, enum sw_base base,
+			       float val)
+{
+	struct sw_val out = make_val(vec_type(base, 1), literal_slot(c, val),
+				     false);
+	out.is_const = true;
+	out.cval = val;
+	return out;
+}
+
+static inline uint32_t val_slot(const struct sw_val *val, uint32_t k)
+{
+	return val->swizzled ? val->slot + ((val->swz >> (2 * k)) & 3)
+			     : val->slot + k;
+}
+
+static inline uint8_t stride(const struct sw_val *val)
+{
+	return type_size(&val->type) == 1 ? 0 : 1;
+}
+
+static struct sw_val rvalue(struct sw_compiler *c, struct sw_val val)
+{
+	struct sw_inst *inst;
+	struct sw_val out;
+
+	if (!val.swizzled) {
+		val.lvalue = false;
+		return val;
+	}
+
+	out = temp_val(c, val.type);
+	inst = emit(c, SW_OP_GATHER, type_comps(&val.type), out.slot);
+	inst->a = val.slot;
+	inst->imm = val.swz;
+	return out;
+}
+
+static struct sw_val convert_base(struct sw_compiler *c, struct sw_val val,
+				  enum sw_base base)
+{
+	struct sw_inst *inst;
+	struct sw_val out;
+	enum sw_op op;
+
+	if (val.type.base == base)
+		return val;
+
+	if (base == SW_FLOAT ||
+	    (is_integer(base) && val.type.base == SW_BOOL) ||
+	    (base == SW_INT && val.type.base == SW_UINT)) {
+		val = rvalue(c, val);
+		val.type.base = base;
+		return val;
+	}
+
+	op = base == SW_BOOL   ? SW_OP_TOBOOL
+	     : base == SW_UINT ? SW_OP_TOUINT
+			       : SW_OP_TOINT;
+
+	val = rvalue(c, val);
+	out = val;
+	out.type.base = base;
+	out = temp_val(c, out.type);
+	inst = emit(c, op, type_comps(&val.type), out.slot);
+	inst->a = val.slot;
+	inst->sa = 1;
+	return out;
+}
+
+/* implicit conversion: scalars broadcast, longer vectors are truncated */
+static struct sw_val cast_val(struct sw_compiler *c, struct sw_val val,
+			      const struct sw_type *type)
+{
+	uint32_t n, vn;
+
+	if (c->failed)
+		return bad_val();
+
+	if (type->base == SW_STRUCT || val.type.base == SW_STRUCT) {
+		if (type->st == val.type.st)
+			return val;
+		compile_error(c, "cannot convert between struct types");
+		return bad_val();
+	}
+	if (!is_numeric(type) || !is_numeric(&val.type)) {
+		compile_error(c, "cannot convert value");
+		return bad_val();
+	}
+
+	n = type_comps(type);
+	vn = type_comps(&val.type);
+	val = convert_base(c, val, type->base);
+
+	if (vn == n) {
+		val.type = *type;
+		return val;
+	}
+	if (vn == 1) {
+		struct sw_val out = temp_val(c, *type);
+		struct sw_inst *inst = emit(c, SW_OP_MOV, n, out.slot);
+		inst->a = val_slot(&val, 0);
+		return out;
+	}
+	if (vn > n && type->rows == 1 && val.type.rows == 1) {
+		val.type = *type;
+		val.lvalue = false;
+		return val;
+	}
+
+	compile_error(c, "cannot convert %u components to %u", vn, n);
+	return bad_val();
+}
+
+static void store(struct sw_compiler *c, struct sw_val dst, struct sw_val src)
+{
+	struct sw_inst *inst;
+	uint32_t n;
+
+	if (c->failed)
+		return;
+	if (!dst.lvalue) {
+		compile_error(c, "value cannot be assigned to");
+		return;
+	}
+
+	if (dst.type.base == SW_STRUCT) {
+		src = cast_val(c, src, &dst.type);
+		if (c->failed)
+			return;
+		inst = emit(c, SW_OP_MOV, dst.type.st->size, dst.slot);
+		inst->a = src.slot;
+		inst->sa = 1;
+		return;
+	}
+
+	n = type_comps(&dst.type);
+	if (type_comps(&src.type) == 1 && n > 1 && !dst.swizzled) {
+		src = rvalue(c, convert_base(c, src, dst.type.base));
+		if (c->failed)
+			return;
+		inst = emit(c, SW_OP_MOV, n, dst.slot);
+		inst->a = src.slot;
+		return;
+	}
+
+	src = rvalue(c, cast_val(c, src, &dst.type));
+	if (c->failed)
+		return;
+
+	inst = emit(c, dst.swizzled ? SW_OP_SCATTER : SW_OP_MOV, n, dst.slot);
+	inst->a = src.slot;
+	inst->sa = 1;
+	inst->imm = dst.swz;
+}
+
+/* ------------------------------------------------------------------------- */
+/* operators */
+
+static struct sw_val component_op(struct sw_compiler *c, enum sw_op op,
+				  struct sw_val *args, size_t argc,
+				  enum sw_base base, enum sw_base result)
+{
+	struct sw_type type = vec_type(result, 1);
+	struct sw_inst *inst;
+	struct sw_val out;
+	uint32_t n = 1;
+
+	if (c->failed)
+		return bad_val();
+
+	for (size_t i = 0; i < argc; i++) {
+		uint32_t an = type_comps(&args[i].type);
+		if (!an) {
+			compile_error(c, "invalid operand");
+			return bad_val();
+		}
+		if (an > 1)
+			n = n == 1 ? an : (an < n ? an : n);
+	}
+
+	for (size_t i = 0; i < argc; i++) {
+		if (type_comps(&args[i].type) == n && n > 1) {
+			type = args[i].type;
+			break;
+		}
+	}
+	if (type_comps(&type) != n)
+		type = vec_type(result, n);
+	type.base = result;
+
+	for (size_t i = 0; i < argc; i++)
+		args[i] = rvalue(c, convert_base(c, args[i], base));
+
+	out = temp_val(c, type);
+	inst = emit(c, op, n, out.slot);
+	inst->a = args[0].slot;
+	inst->sa = stride(&args[0]);
+	if (argc > 1) {
+		inst->b = args[1].slot;
+		inst->sb = stride(&args[1]);
+	}
+	if (argc > 2) {
+		inst->c = args[2].slot;
+		inst->sc = stride(&args[2]);
+	}
+	return out;
+}
+
+static struct sw_val binary_op(struct sw_compiler *c, enum sw_op op,
+			       struct sw_val a, struct sw_val b)
+{
+	struct sw_val args[2] = {a, b};
+	enum sw_base base = promote(a.type.base, b.type.base);
+
+	if (c->failed)
+		return bad_val();
+	if (!is_numeric(&a.type) || !is_numeric(&b.type)) {
+		compile_error(c, "invalid operands");
+		return bad_val();
+	}
+
+	switch (op) {
+	case SW_OP_LT:
+	case SW_OP_LE:
+	case SW_OP_GT:
+	case SW_OP_GE:
+	case SW_OP_EQ:
+	case SW_OP_NE:
+		return component_op(c, op, args, 2, base, SW_BOOL);
+	case SW_OP_AND:
+	case SW_OP_OR:
+		return component_op(c, op, args, 2, SW_BOOL, SW_BOOL);
+	case SW_OP_BITAND:
+	case SW_OP_BITOR:
+	case SW_OP_BITXOR:
+	case SW_OP_SHL:
+	case SW_OP_SHR:
+		if (base == SW_FLOAT) {
+			compile_error(c, "bitwise operator on a float");
+			return bad_val();
+		}
+		break;
+	case SW_OP_DIV:
+		if (base != SW_FLOAT)
+			op = SW_OP_IDIV;
+		break;
+	case SW_OP_MOD:
+		if (base != SW_FLOAT)
+			op = SW_OP_IMOD;
+		break;
+	default:
+		break;
+	}
+
+	return component_op(c, op, args, 2, base, base);
+}
+
+static struct sw_val unary_op(struct sw_compiler *c, enum sw_op op,
+			      struct sw_val a)
+{
+	enum sw_base base = a.type.base == SW_BOOL ? SW_INT : a.type.base;
+
+	if (op == SW_OP_NOT)
+		return component_op(c, op, &a, 1, SW_BOOL, SW_BOOL);
+	if (op == SW_OP_BITNOT && base == SW_FLOAT) {
+		compile_error(c, "bitwise operator on a float");
+		return bad_val();
+	}
+	return component_op(c, op, &a, 1, base, base);
+}
+
+static struct sw_val select_op(struct sw_compiler *c, struct sw_val cond,
+			       struct sw_val a, struct sw_val b)
+{
+	struct sw_val args[3] = {cond, a, b};
+	enum sw_base base = promote(a.type.base, b.type.base);
+
+	if (a.type.base == SW_BOOL && b.type.base == SW_BOOL)
+		base = SW_BOOL;
+	if (!is_numeric(&a.type) || !is_numeric(&b.type)) {
+		compile_error(c, "unsupported ?: operands");
+		return bad_val();
+	}
+
+	args[0] = rvalue(c, convert_base(c, cond, SW_BOOL));
+	args[0].type.base = base;
+	return component_op(c, SW_OP_SELECT, args, 3, base, base);
+}
+
+static struct sw_val increment(struct sw_compiler *c, struct sw_val val,
+			       bool decrement, bool postfix)
+{
+	struct sw_val one = const_val(c, SW_INT, 1.0f);
+	struct sw_val old = bad_val();
+
+	if (postfix) {
+		struct sw_val cur_val = rvalue(c, val);
+		struct sw_inst *inst;
+
+		old = temp_val(c, val.type);
+		inst = emit(c, SW_OP_MOV, type_comps(&val.type), old.slot);
+		inst->a = cur_val.slot;
+		inst->sa = 1;
+	}
+
+	store(c, val,
+	      binary_op(c, decrement ? SW_OP_SUB : SW_OP_ADD, val, one));
+	if (postfix)
+		return old;
+
+	val.lvalue = false;
+	return val;
+}
+
+static struct sw_val swizzle(struct sw_compiler *c, struct sw_val val,
+			     const struct sw_token *name)
+{
+	uint32_t n = type_comps(&val.type);
+	uint8_t swz = 0;
+	bool identity = true;
+	bool unique = true;
+	uint8_t used = 0;
+
+	if (val.type.rows != 1 || !n || name->len > 4) {
+		compile_error(c, "invalid swizzle");
+		return bad_val();
+	}
+
+	for (size_t i = 0; i < name->len; i++) {
+		uint32_t k, off;
+
+		switch (name->str[i]) {
+		case 'x':
+		case 'r':
+			k = 0;
+			break;
+		case 'y':
+		case 'g':
+			k = 1;
+			break;
+		case 'z':
+		case 'b':
+			k = 2;
+			break;
+		case 'w':
+		case 'a':
+			k = 3;
+			break;
+		default:
+			k = 4;
+		}
+		if (k >= n) {
+			compile_error(c, "invalid swizzle");
+			return bad_val();
+		}
+
+		off = val.swizzled ? (val.swz >> (2 * k)) & 3 : k;
+		if (used & (1 << off))
+			unique = false;
+		used |= 1 << off;
+		if (off != i)
+			identity = false;
+		swz |= off << (2 * i);
+	}
+
+	val.type = vec_type(val.type.base, (uint32_t)name->len);
+	val.swz = swz;
+	val.swizzled = !identity;
+	val.lvalue = val.lvalue && unique;
+	val.is_const = false;
+	return val;
+}
+
+static struct sw_val member(struct sw_compiler *c, struct sw_val val,
+			    const struct sw_token *name)
+{
+	const struct shader_struct *info = val.type.st->info;
+	uint32_t offset = 0;
+
+	for (size_t i = 0; i < info->vars.num; i++) {
+		const struct shader_var *var = info->vars.array + i;
+		struct sw_type type;
+
+		lookup_type_str(c, var->type, &type);
+		if (name_is(name->str, name->len, var->name)) {
+			val.type = type;
+			val.slot += offset;
+			return val;
+		}
+		offset += type_size(&type);
+	}
+
+	compile_error(c, "no member '%.*s' in '%s'", (int)name->len, name->str,
+		      info->name);
+	return bad_val();
+}
+
+static struct sw_val construct(struct sw_compiler *c,
+			       const struct sw_type *type, struct sw_val *args,
+			       size_t argc)
+{
+	uint32_t n = type_comps(type);
+	uint32_t offset = 0;
+	struct sw_val out;
+
+	if (argc == 1 && (type_comps(&args[0].type) == 1 ||
+			  type_comps(&args[0].type) == n))
+		return cast_val(c, args[0], type);
+
+	out = temp_val(c, *type);
+	for (size_t i = 0; i < argc && !c->failed; i++) {
+		struct sw_val arg = args[i];
+		uint32_t an = type_comps(&arg.type);
+		struct sw_inst *inst;
+
+		if (!an || offset + an > n) {
+			compile_error(c, "invalid constructor arguments");
+			break;
+		}
+
+		arg = rvalue(c, convert_base(c, arg, type->base));
+		inst = emit(c, SW_OP_MOV, an, out.slot + offset);
+		inst->a = arg.slot;
+		inst->sa = 1;
+		offset += an;
+	}
+
+	if (!c->failed && offset != n)
+		compile_error(c, "constructor needs %u components", n);
+	return out;
+}
+
+/* ------------------------------------------------------------------------- */
+/* intrinsics */
+
+enum sw_intrinsic_kind {
+	SW_FLOAT_OP,  /* componentwise, float result */
+	SW_KEEP_OP,   /* componentwise, keeps the operand type */
+	SW_BOOL_OP,   /* componentwise, bool result */
+	SW_SPECIAL_OP,
+};
+
+struct sw_intrinsic {
+	const char *name;
+	enum sw_op op;
+	size_t argc;
+	enum sw_intrinsic_kind kind;
+};
+
+static const struct sw_intrinsic intrinsics[] = {
+	{"abs", SW_OP_ABS, 1, SW_KEEP_OP},
+	{"sign", SW_OP_SIGN, 1, SW_KEEP_OP},
+	{"floor", SW_OP_FLOOR, 1, SW_FLOAT_OP},
+	{"ceil", SW_OP_CEIL, 1, SW_FLOAT_OP},
+	{"round", SW_OP_ROUND, 1, SW_FLOAT_OP},
+	{"trunc", SW_OP_TRUNC, 1, SW_FLOAT_OP},
+	{"frac", SW_OP_FRAC, 1, SW_FLOAT_OP},
+	{"sqrt", SW_OP_SQRT, 1, SW_FLOAT_OP},
+	{"rsqrt", SW_OP_RSQRT, 1, SW_FLOAT_OP},
+	{"rcp", SW_OP_RCP, 1, SW_FLOAT_OP},
+	{"exp", SW_OP_EXP, 1, SW_FLOAT_OP},
+	{"exp2", SW_OP_EXP2, 1, SW_FLOAT_OP},
+	{"log", SW_OP_LOG, 1, SW_FLOAT_OP},
+	{"log2", SW_OP_LOG2, 1, SW_FLOAT_OP},
+	{"log10", SW_OP_LOG10, 1, SW_FLOAT_OP},
+	{"sin", SW_OP_SIN, 1, SW_FLOAT_OP},
+	{"cos", SW_OP_COS, 1, SW_FLOAT_OP},
+	{"tan", SW_OP_TAN, 1, SW_FLOAT_OP},
+	{"asin", SW_OP_ASIN, 1, SW_FLOAT_OP},
+	{"acos", SW_OP_ACOS, 1, SW_FLOAT_OP},
+	{"atan", SW_OP_ATAN, 1, SW_FLOAT_OP},
+	{"sinh", SW_OP_SINH, 1, SW_FLOAT_OP},
+	{"cosh", SW_OP_COSH, 1, SW_FLOAT_OP},
+	{"tanh", SW_OP_TANH, 1, SW_FLOAT_OP},
+	{"saturate", SW_OP_SATURATE, 1, SW_FLOAT_OP},
+	{"degrees", SW_OP_DEGREES, 1, SW_FLOAT_OP},
+	{"radians", SW_OP_RADIANS, 1, SW_FLOAT_OP},
+	{"isnan", SW_OP_ISNAN, 1, SW_BOOL_OP},
+	{"isinf", SW_OP_ISINF, 1, SW_BOOL_OP},
+	{"pow", SW_OP_POW, 2, SW_FLOAT_OP},
+	{"fmod", SW_OP_MOD, 2, SW_FLOAT_OP},
+	{"atan2", SW_OP_ATAN2, 2, SW_FLOAT_OP},
+	{"step", SW_OP_STEP, 2, SW_FLOAT_OP},
+	{"min", SW_OP_MIN, 2, SW_KEEP_OP},
+	{"max", SW_OP_MAX, 2, SW_KEEP_OP},
+	{"clamp", SW_OP_CLAMP, 3, SW_KEEP_OP},
+	{"mad", SW_OP_MAD, 3, SW_KEEP_OP},
+	{"lerp", SW_OP_LERP, 3, SW_FLOAT_OP},
+	{"smoothstep", SW_OP_SMOOTHSTEP, 3, SW_FLOAT_OP},
+	{"dot", SW_OP_DOT, 2, SW_SPECIAL_OP},
+	{"cross", SW_OP_CROSS, 2, SW_SPECIAL_OP},
+	{"length", SW_OP_DOT, 1, SW_SPECIAL_OP},
+	{"distance", SW_OP_DOT, 2, SW_SPECIAL_OP},
+	{"normalize", SW_OP_DOT, 1, SW_SPECIAL_OP},
+	{"any", SW_OP_ANY, 1, SW_SPECIAL_OP},
+	{"all", SW_OP_ALL, 1, SW_SPECIAL_OP},
+	{"mul", SW_OP_VECMAT, 2, SW_SPECIAL_OP},
+	{"ddx", SW_OP_DDX, 1, SW_SPECIAL_OP},
+	{"ddx_coarse", SW_OP_DDX, 1, SW_SPECIAL_OP},
+	{"ddx_fine", SW_OP_DDX, 1, SW_SPECIAL_OP},
+	{"ddy", SW_OP_DDY, 1, SW_SPECIAL_OP},
+	{"ddy_coarse", SW_OP_DDY, 1, SW_SPECIAL_OP},
+	{"ddy_fine", SW_OP_DDY, 1, SW_SPECIAL_OP},
+	{"fwidth", SW_OP_DDX, 1, SW_SPECIAL_OP},
+	{"clip", SW_OP_CLIP, 1, SW_SPECIAL_OP},
+	{NULL, SW_OP_END, 0, SW_FLOAT_OP},
+};
+
+static const struct sw_intrinsic *find_intrinsic(const struct sw_token *name)
+{
+	for (const struct sw_intrinsic *in = intrinsics; in->name; in++) {
+		if (tok_is(name, in->name))
+			return in;
+	}
+	return NULL;
+}
+
+static struct sw_val dot_op(struct sw_compiler *c, struct sw_val a,
+			    struct sw_val b)
+{
+	uint32_t na = type_comps(&a.type), nb = type_comps(&b.type);
+	struct sw_inst *inst;
+	struct sw_val out;
+
+	if (!na || !nb) {
+		compile_error(c, "invalid operands");
+		return bad_val();
+	}
+
+	a = rvalue(c, a);
+	b = rvalue(c, b);
+	out = temp_val(c, vec_type(SW_FLOAT, 1));
+	inst = emit(c, SW_OP_DOT, 1, out.slot);
+	inst->a = a.slot;
+	inst->b = b.slot;
+	inst->imm = na < nb ? na : nb;
+	return out;
+}
+
+static struct sw_val derivative(struct sw_compiler *c, enum sw_op op,
+				struct sw_val val)
+{
+	struct sw_program *prog = c->prog;
+	uint32_t n = type_comps(&val.type);
+	struct sw_inst *inst;
+	struct sw_val out;
+
+	if (!n) {
+		compile_error(c, "invalid operand");
+		return bad_val();
+	}
+
+	val = rvalue(c, convert_base(c, val, SW_FLOAT));
+	out = temp_val(c, vec_type(SW_FLOAT, n));
+	inst = emit(c, op, n, out.slot);
+	inst->a = val.slot;
+	inst->sa = 1;
+	inst->imm = prog->num_derivs << 16 | prog->deriv_size;
+
+	prog->num_derivs++;
+	prog->deriv_size += n;
+	if (op == SW_OP_DDX)
+		prog->num_ddx++;
+	else
+		prog->num_ddy++;
+	return out;
+}
+
+static struct sw_val mul_op(struct sw_compiler *c, struct sw_val a,
+			    struct sw_val b)
+{
+	uint32_t na = type_comps(&a.type), nb = type_comps(&b.type);
+	bool a_mat = a.type.rows > 1, b_mat = b.type.rows > 1;
+	struct sw_inst *inst;
+	struct sw_val out;
+
+	if (!na || !nb) {
+		compile_error(c, "invalid operands");
+		return bad_val();
+	}
+	if (na == 1 || nb == 1)
+		return binary_op(c, SW_OP_MUL, a, b);
+
+	a = rvalue(c, convert_base(c, a, SW_FLOAT));
+	b = rvalue(c, convert_base(c, b, SW_FLOAT));
+
+	if (!a_mat && !b_mat)
+		return dot_op(c, a, b);
+
+	if (!a_mat) {
+		if (na != b.type.rows) {
+			compile_error(c, "mul: size mismatch");
+			return bad_val();
+		}
+		out = temp_val(c, vec_type(SW_FLOAT, b.type.cols));
+		inst = emit(c, SW_OP_VECMAT, b.type.cols, out.slot);
+		inst->imm = b.type.rows | b.type.cols << 8;
+	} else if (!b_mat) {
+		if (nb != a.type.cols) {
+			compile_error(c, "mul: size mismatch");
+			return bad_val();
+		}
+		out = temp_val(c, vec_type(SW_FLOAT, a.type.rows));
+		inst = emit(c, SW_OP_MATVEC, a.type.rows, out.slot);
+		inst->imm = a.type.rows | a.type.cols << 8;
+	} else {
+		struct sw_type type = {SW_FLOAT, a.type.rows, b.type.cols, NULL};
+
+		if (a.type.cols != b.type.rows) {
+			compile_error(c, "mul: size mismatch");
+			return bad_val();
+		}
+		out = temp_val(c, type);
+		inst = emit(c, SW_OP_MATMAT, type_comps(&type), out.slot);
+		inst->imm = a.type.rows | a.type.cols << 8 | b.type.cols << 16;
+	}
+
+	inst->a = a.slot;
+	inst->b = b.slot;
+	return out;
+}
+
+static struct sw_val special_intrinsic(struct sw_compiler *c,
+				       const struct sw_intrinsic *in,
+				       struct sw_val *args)
+{
+	const char *name = in->name;
+	struct sw_inst *inst;
+	struct sw_val out, tmp;
+
+	if (strcmp(name, "dot") == 0)
+		return dot_op(c, args[0], args[1]);
+
+	if (strcmp(name, "length") == 0) {
+		tmp = dot_op(c, args[0], args[0]);
+		return component_op(c, SW_OP_SQRT, &tmp, 1, SW_FLOAT, SW_FLOAT);
+	}
+
+	if (strcmp(name, "distance") == 0) {
+		tmp = binary_op(c, SW_OP_SUB, args[0], args[1]);
+		tmp = dot_op(c, tmp, tmp);
+		return component_op(c, SW_OP_SQRT, &tmp, 1, SW_FLOAT, SW_FLOAT);
+	}
+
+	if (strcmp(name, "normalize") == 0) {
+		tmp = dot_op(c, args[0], args[0]);
+		tmp = component_op(c, SW_OP_RSQRT, &tmp, 1, SW_FLOAT, SW_FLOAT);
+		return binary_op(c, SW_OP_MUL, args[0], tmp);
+	}
+
+	if (strcmp(name, "cross") == 0) {
+		struct sw_type type = vec_type(SW_FLOAT, 3);
+		args[0] = rvalue(c, cast_val(c, args[0], &type));
+		args[1] = rvalue(c, cast_val(c, args[1], &type));
+		out = temp_val(c, type);
+		inst = emit(c, SW_OP_CROSS, 3, out.slot);
+		inst->a = args[0].slot;
+		inst->b = args[1].slot;
+		return out;
+	}
+
+	if (in->op == SW_OP_ANY || in->op == SW_OP_ALL) {
+		tmp = rvalue(c, args[0]);
+		out = temp_val(c, vec_type(SW_BOOL, 1));
+		inst = emit(c, in->op, 1, out.slot);
+		inst->a = tmp.slot;
+		inst->imm = type_comps(&tmp.type);
+		return out;
+	}
+
+	if (strcmp(name, "mul") == 0)
+		return mul_op(c, args[0], args[1]);
+
+	if (strcmp(name, "fwidth") == 0) {
+		struct sw_val dx = derivative(c, SW_OP_DDX, args[0]);
+		struct sw_val dy = derivative(c, SW_OP_DDY, args[0]);
+		dx = component_op(c, SW_OP_ABS, &dx, 1, SW_FLOAT, SW_FLOAT);
+		dy = component_op(c, SW_OP_ABS, &dy, 1, SW_FLOAT, SW_FLOAT);
+		return binary_op(c, SW_OP_ADD, dx, dy);
+	}
+
+	if (in->op == SW_OP_DDX || in->op == SW_OP_DDY)
+		return derivative(c, in->op, args[0]);
+
+	if (in->op == SW_OP_CLIP) {
+		tmp = rvalue(c, convert_base(c, args[0], SW_FLOAT));
+		inst = emit(c, SW_OP_CLIP, type_comps(&tmp.type), 0);
+		inst->a = tmp.slot;
+		inst->sa = 1;
+		return make_val(vec_type(SW_VOID, 0), 0, false);
+	}
+
+	compile_error(c, "unsupported intrinsic '%s'", name);
+	return bad_val();
+}
+
+static struct sw_val call_intrinsic(struct sw_compiler *c,
+				    const struct sw_intrinsic *in,
+				    struct sw_val *args, size_t argc)
+{
+	enum sw_base base = SW_FLOAT;
+
+	if (argc != in->argc) {
+		compile_error(c, "'%s' takes %d arguments", in->name,
+			      (int)in->argc);
+		return bad_val();
+	}
+	for (size_t i = 0; i < argc; i++) {
+		if (!is_numeric(&args[i].type)) {
+			compile_error(c, "invalid argument to '%s'", in->name);
+			return bad_val();
+		}
+	}
+
+	switch (in->kind) {
+	case SW_FLOAT_OP:
+		return component_op(c, in->op, args, argc, SW_FLOAT, SW_FLOAT);
+	case SW_BOOL_OP:
+		return component_op(c, in->op, args, argc, SW_FLOAT, SW_BOOL);
+	case SW_KEEP_OP:
+		base = args[0].type.base == SW_BOOL ? SW_INT
+						    : args[0].type.base;
+		for (size_t i = 1; i < argc; i++)
+			base = promote(base, args[i].type.base);
+		return component_op(c, in->op, args, argc, base, base);
+	case SW_SPECIAL_OP:
+		return special_intrinsic(c, in, args);
+	}
+
+	return bad_val();
+}
+
+/* ------------------------------------------------------------------------- */
+/* textures */
+
+static struct sw_val texture_method(struct sw_compiler *c, struct sw_val tex,
+				    const struct sw_token *name,
+				    struct sw_val *args, size_t argc)
+{
+	struct sw_type uv_type = vec_type(SW_FLOAT, 2);
+	struct sw_type offset_type = vec_type(SW_INT, 2);
+	struct sw_val uv, offset = bad_val(), out;
+	struct sw_inst *inst;
+	size_t offset_arg;
+	bool load = tok_is(name, "Load");
+
+	if (load) {
+		offset_arg = 1;
+	} else if (tok_is(name, "Sample")) {
+		offset_arg = 2;
+	} else if (tok_is(name, "SampleLevel") || tok_is(name, "SampleBias")) {
+		offset_arg = 3;
+	} else if (tok_is(name, "SampleGrad")) {
+		offset_arg = 4;
+	} else {
+		compile_error(c, "unsupported texture method");
+		return bad_val();
+	}
+
+	if (argc < offset_arg || argc > offset_arg + 1 ||
+	    (!load && args[0].type.base != SW_SAMPLER)) {
+		compile_error(c, "invalid texture method arguments");
+		return bad_val();
+	}
+
+	if (load) {
+		uv = args[0];
+		if (type_comps(&uv.type) < 2) {
+			compile_error(c, "Load needs at least two coordinates");
+			return bad_val();
+		}
+		uv = rvalue(c, convert_base(c, uv, SW_INT));
+	} else {
+		uv = rvalue(c, cast_val(c, args[1], &uv_type));
+	}
+	if (argc > offset_arg)
+		offset = rvalue(c, cast_val(c, args[offset_arg], &offset_type));
+	if (c->failed)
+		return bad_val();
+
+	out = temp_val(c, vec_type(SW_FLOAT, 4));
+	inst = emit(c, load ? SW_OP_LOAD : SW_OP_SAMPLE, 4, out.slot);
+	inst->a = uv.slot;
+	inst->b = offset.slot;
+	inst->imm = tex.slot;
+	if (!load)
+		inst->imm |= args[0].slot << 8;
+	if (argc > offset_arg)
+		inst->imm |= SW_SAMPLE_OFFSET;
+	return out;
+}
+
+/* ------------------------------------------------------------------------- */
+/* expressions */
+
+static struct sw_val parse_expr(struct sw_compiler *c);
+static struct sw_val parse_assign(struct sw_compiler *c);
+static struct sw_val parse_unary(struct sw_compiler *c);
+static void parse_block(struct sw_compiler *c);
+
+static struct sw_symbol *find_symbol(struct sw_compiler *c, const char *name,
+				     size_t len)
+{
+	for (size_t i = c->symbols.num; i > c->scope_base; i--) {
+		struct sw_symbol *sym = c->symbols.array + i - 1;
+		if (sym->len == len && memcmp(sym->name, name, len) == 0)
+			return sym;
+	}
+	for (size_t i = c->num_globals; i > 0; i--) {
+		struct sw_symbol *sym = c->symbols.array + i - 1;
+		if (sym->len == len && memcmp(sym->name, name, len) == 0)
+			return sym;
+	}
+	return NULL;
+}
+
+static void push_symbol(struct sw_compiler *c, const char *name, size_t len,
+			struct sw_val val)
+{
+	struct sw_symbol *sym = da_push_back_new(c->symbols);
+	sym->name = name;
+	sym->len = len;
+	sym->val = val;
+}
+
+static size_t parse_args(struct sw_compiler *c, struct sw_val *args)
+{
+	size_t argc = 0;
+
+	expect(c, "(");
+	if (accept(c, ")"))
+		return 0;
+
+	do {
+		if (argc == SW_MAX_ARGS) {
+			compile_error(c, "too many arguments");
+			return 0;
+		}
+		args[argc++] = parse_assign(c);
+	} while (!c->failed && accept(c, ","));
+
+	expect(c, ")");
+	return argc;
+}
+
+static struct sw_func *find_func(struct sw_compiler *c,
+				 const struct sw_token *name,
+				 const struct sw_val *args, size_t argc)
+{
+	struct sw_func *best = NULL;
+	int best_score = -1;
+
+	for (size_t i = 0; i < c->sp->funcs.num; i++) {
+		struct sw_func *func = c->funcs + i;
+		const struct shader_func *info = func->info;
+		int score = 0;
+
+		if (!tok_is(name, info->name) || info->params.num != argc)
+			continue;
+
+		for (size_t j = 0; j < argc; j++) {
+			struct sw_type type;
+			if (!lookup_type_str(c, info->params.array[j].type,
+					     &type))
+				continue;
+			if (type.base == args[j].type.base)
+				score++;
+			if (type_size(&type) == type_size(&args[j].type))
+				score += 2;
+		}
+
+		if (score > best_score) {
+			best = func;
+			best_score = score;
+		}
+	}
+
+	return best;
+}
+
+static struct sw_val call_func(struct sw_compiler *c, struct sw_func *func,
+			       struct sw_val *args, size_t argc,
+			       uint32_t args_base)
+{
+	const struct shader_func *info = func->info;
+	struct sw_val params[SW_MAX_ARGS];
+	struct sw_inline inl = {0};
+	struct sw_inline *saved_func = c->func;
+	struct sw_loop *saved_loop = c->loop;
+	const struct sw_token *saved_tokens = c->tokens;
+	size_t saved_pos = c->pos;
+	size_t saved_base = c->scope_base;
+	size_t num_symbols = c->symbols.num;
+	struct sw_val result;
+	uint32_t size;
+
+	if (func->active) {
+		compile_error(c, "recursive call to '%s'", info->name);
+		return bad_val();
+	}
+	if (!lookup_type_str(c, info->return_type, &inl.ret)) {
+		compile_error(c, "unknown return type '%s'", info->return_type);
+		return bad_val();
+	}
+	if (!func->lexed)
+		lex_func(func);
+
+	size = type_size(&inl.ret);
+	inl.ret_slot = alloc_slots(c, size);
+
+	for (size_t i = 0; i < argc && !c->failed; i++) {
+		const struct shader_var *var = info->params.array + i;
+		struct sw_type type;
+
+		if (!lookup_type_str(c, var->type, &type) || var->array_count) {
+			compile_error(c, "unsupported parameter '%s'",
+				      var->name);
+			break;
+		}
+
+		if (type.base == SW_TEXTURE || type.base == SW_SAMPLER) {
+			if (args[i].type.base != type.base)
+				compile_error(c, "invalid argument '%s'",
+					      var->name);
+			params[i] = args[i];
+			continue;
+		}
+
+		params[i] = make_val(type, alloc_slots(c, type_size(&type)),
+				     true);
+		if (var->var_type == SHADER_VAR_OUT ||
+		    var->var_type == SHADER_VAR_INOUT) {
+			if (!args[i].lvalue)
+				compile_error(c, "'%s' needs a variable",
+					      var->name);
+		}
+		if (var->var_type == SHADER_VAR_OUT) {
+			struct sw_inst *inst = emit(c, SW_OP_MOV,
+						    type_size(&type),
+						    params[i].slot);
+			inst->a = c->zero;
+		} else {
+			store(c, params[i], args[i]);
+		}
+	}
+	if (c->failed)
+		return bad_val();
+
+	c->scope_base = c->symbols.num;
+	for (size_t i = 0; i < argc; i++) {
+		const char *name = info->params.array[i].name;
+		push_symbol(c, name, strlen(name), params[i]);
+	}
+
+	c->tokens = func->tokens.array;
+	c->pos = 0;
+	c->func = &inl;
+	c->loop = NULL;
+	func->active = true;
+
+	parse_block(c);
+
+	func->active = false;
+	for (size_t i = 0; i < inl.returns.num; i++)
+		patch(c, inl.returns.array[i], c->prog->code.num);
+	da_free(inl.returns);
+
+	c->tokens = saved_tokens;
+	c->pos = saved_pos;
+	c->func = saved_func;
+	c->loop = saved_loop;
+	c->symbols.num = num_symbols;
+	c->scope_base = saved_base;
+
+	for (size_t i = 0; i < argc; i++) {
+		enum shader_var_type vt = info->params.array[i].var_type;
+		if (vt == SHADER_VAR_OUT || vt == SHADER_VAR_INOUT)
+			store(c, args[i], params[i]);
+	}
+
+	/* move the result down so everything above it can be reused */
+	result = make_val(inl.ret, args_base, false);
+	if (size && inl.ret_slot != args_base) {
+		struct sw_inst *inst = emit(c, SW_OP_MOV, size, args_base);
+		inst->a = inl.ret_slot;
+		inst->sa = 1;
+	}
+	c->top = args_base + size;
+	return result;
+}
+
+static struct sw_val parse_number(struct sw_compiler *c,
+				  const struct sw_token *token)
+{
+	char buf[64];
+	enum sw_base base = SW_INT;
+	double value;
+	size_t len = token->len < sizeof(buf) - 1 ? token->len
+						  : sizeof(buf) - 1;
+
+	memcpy(buf, token->str, len);
+	buf[len] = 0;
+
+	if (buf[0] == '0' && (buf[1] == 'x' || buf[1] == 'X')) {
+		value = (double)strtoull(buf, NULL, 16);
+		if (strpbrk(buf, "uU"))
+			base = SW_UINT;
+	} else {
+		value = strtod(buf, NULL);
+		if (strpbrk(buf, ".eEfFhH"))
+			base = SW_FLOAT;
+		else if (strpbrk(buf, "uU"))
+			base = SW_UINT;
+	}
+
+	return const_val(c, base, (float)value);
+}
+
+static struct sw_val parse_primary(struct sw_compiler *c)
+{
+	const struct sw_token *token = cur(c);
+	struct sw_val args[SW_MAX_ARGS];
+	struct sw_symbol *sym;
+	struct sw_type type;
+
+	if (token->type == SW_TOKEN_NUM) {
+		advance(c);
+		return parse_number(c, token);
+	}
+
+	if (accept(c, "(")) {
+		struct sw_val val = parse_expr(c);
+		expect(c, ")");
+		return val;
+	}
+
+	if (token->type != SW_TOKEN_NAME) {
+		compile_error(c, "expected an expression");
+		return bad_val();
+	}
+	advance(c);
+
+	if (tok_is(token, "true") || tok_is(token, "false"))
+		return const_val(c, SW_BOOL, tok_is(token, "true") ? 1.0f : 0.0f);
+
+	if (tok_is(cur(c), "(")) {
+		const struct sw_intrinsic *in;
+		uint32_t args_base = c->top;
+		struct sw_func *func;
+		size_t argc;
+
+		argc = parse_args(c, args);
+		if (c->failed)
+			return bad_val();
+
+		if (builtin_type(token->str, token->len, &type) &&
+		    is_numeric(&type))
+			return construct(c, &type, args, argc);
+
+		func = find_func(c, token, args, argc);
+		if (func)
+			return call_func(c, func, args, argc, args_base);
+
+		in = find_intrinsic(token);
+		if (in)
+			return call_intrinsic(c, in, args, argc);
+
+		compile_error(c, "unknown function '%.*s'", (int)token->len,
+			      token->str);
+		return bad_val();
+	}
+
+	sym = find_symbol(c, token->str, token->len);
+	if (!sym) {
+		compile_error(c, "unknown identifier '%.*s'", (int)token->len,
+			      token->str);
+		return bad_val();
+	}
+	if (sym->val.type.base == SW_VOID) {
+		compile_error(c, "'%.*s' has an unsupported type",
+			      (int)token->len, token->str);
+		return bad_val();
+	}
+	return sym->val;
+}
+
+static struct sw_val parse_postfix(struct sw_compiler *c, struct sw_val val)
+{
+	while (!c->failed) {
+		if (accept(c, ".")) {
+			const struct sw_token *name = expect_name(c);
+			if (!name)
+				break;
+
+			if (val.type.base == SW_TEXTURE &&
+			    tok_is(cur(c), "(")) {
+				struct sw_val args[SW_MAX_ARGS];
+				size_t argc = parse_args(c, args);
+				val = texture_method(c, val, name, args, argc);
+			} else if (val.type.base == SW_STRUCT) {
+				val = member(c, val, name);
+			} else {
+				val = swizzle(c, val, name);
+			}
+
+		} else if (accept(c, "[")) {
+			struct sw_val idx = parse_expr(c);
+			int k;
+
+			expect(c, "]");
+			if (!idx.is_const) {
+				compile_error(c, "only constant indices are supported");
+				break;
+			}
+
+			k = (int)idx.cval;
+			if (val.type.rows > 1 && k >= 0 && k < val.type.rows) {
+				val.slot += k * val.type.cols;
+				val.type = vec_type(val.type.base,
+						    val.type.cols);
+			} else if (val.type.rows == 1 && k >= 0 &&
+				   k < val.type.cols) {
+				static const char *comps[] = {"x", "y", "z",
+							      "w"};
+				struct sw_token name = {SW_TOKEN_NAME, comps[k],
+							1};
+				val = swizzle(c, val, &name);
+			} else {
+				compile_error(c, "invalid index");
+			}
+
+		} else if (tok_is(cur(c), "++") || tok_is(cur(c), "--")) {
+			bool decrement = tok_is(cur(c), "--");
+			advance(c);
+			val = increment(c, val, decrement, true);
+
+		} else {
+			break;
+		}
+	}
+
+	return val;
+}
+
+static bool is_cast(struct sw_compiler *c, struct sw_type *type)
+{
+	const struct sw_token *name = peek(c, 1);
+
+	return tok_is(cur(c), "(") && name->type == SW_TOKEN_NAME &&
+	       tok_is(peek(c, 2), ")") &&
+	       lookup_type(c, name->str, name->len, type) &&
+	       (is_numeric(type) || type->base == SW_STRUCT);
+}
+
+static struct sw_val parse_unary(struct sw_compiler *c)
+{
+	struct sw_type type;
+
+	if (accept(c, "-"))
+		return unary_op(c, SW_OP_NEG, parse_unary(c));
+	if (accept(c, "+"))
+		return parse_unary(c);
+	if (accept(c, "!"))
+		return unary_op(c, SW_OP_NOT, parse_unary(c));
+	if (accept(c, "~"))
+		return unary_op(c, SW_OP_BITNOT, parse_unary(c));
+	if (accept(c, "++"))
+		return increment(c, parse_unary(c), false, false);
+	if (accept(c, "--"))
+		return increment(c, parse_unary(c), true, false);
+
+	if (is_cast(c, &type)) {
+		struct sw_val val;
+
+		c->pos += 3;
+		val = parse_unary(c);
+		if (c->failed)
+			return bad_val();
+
+		/* (Struct)0 zero-fills the struct */
+		if (type.base == SW_STRUCT && is_numeric(&val.type) &&
+		    type_comps(&val.type) == 1) {
+			struct sw_val out = temp_val(c, type);
+			struct sw_inst *inst = emit(c, SW_OP_MOV, type_size(&type),
+						    out.slot);
+			inst->a = rvalue(c, convert_base(c, val, SW_FLOAT)).slot;
+			return out;
+		}
+		return cast_val(c, val, &type);
+	}
+
+	return parse_postfix(c, parse_primary(c));
+}
+
+static int binary_prec(const struct sw_token *token, enum sw_op *op)
+{
+	static const struct {
+		const char *str;
+		enum sw_op op;
+		int prec;
+	} ops[] = {
+		{"||", SW_OP_OR, 1},     {"&&", SW_OP_AND, 2},
+		{"|", SW_OP_BITOR, 3},   {"^", SW_OP_BITXOR, 4},
+		{"&", SW_OP_BITAND, 5},  {"==", SW_OP_EQ, 6},
+		{"!=", SW_OP_NE, 6},     {"<", SW_OP_LT, 7},
+		{">", SW_OP_GT, 7},      {"<=", SW_OP_LE, 7},
+		{">=", SW_OP_GE, 7},     {"<<", SW_OP_SHL, 8},
+		{">>", SW_OP_SHR, 8},    {"+", SW_OP_ADD, 9},
+		{"-", SW_OP_SUB, 9},     {"*", SW_OP_MUL, 10},
+		{"/", SW_OP_DIV, 10},    {"%", SW_OP_MOD, 10},
+	};
+
+	if (token->type != SW_TOKEN_OP)
+		return 0;
+
+	for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+		if (tok_is(token, ops[i].str)) {
+			*op = ops[i].op;
+			return ops[i].prec;
+		}
+	}
+	return 0;
+}
+
+static struct sw_val parse_binary(struct sw_compiler *c, int min_prec)
+{
+	struct sw_val lhs = parse_unary(c);
+
+	while (!c->failed) {
+		enum sw_op op;
+		int prec = binary_prec(cur(c), &op);
+		struct sw_val rhs;
+
+		if (!prec || prec < min_prec)
+			break;
+
+		advance(c);
+		rhs = parse_binary(c, prec + 1);
+		lhs = binary_op(c, op, lhs, rhs);
+	}
+
+	return lhs;
+}
+
+static struct sw_val parse_ternary(struct sw_compiler *c)
+{
+	struct sw_val cond = parse_binary(c, 1);
+	struct sw_val a, b;
+
+	if (!accept(c, "?"))
+		return cond;
+
+	a = parse_assign(c);
+	expect(c, ":");
+	b = parse_ternary(c);
+	return select_op(c, cond, a, b);
+}
+
+static struct sw_val parse_assign(struct sw_compiler *c)
+{
+	static const struct {
+		const char *str;
+		enum sw_op op;
+	} ops[] = {
+		{"=", SW_OP_END},       {"+=", SW_OP_ADD},
+		{"-=", SW_OP_SUB},      {"*=", SW_OP_MUL},
+		{"/=", SW_OP_DIV},      {"%=", SW_OP_MOD},
+		{"&=", SW_OP_BITAND},   {"|=", SW_OP_BITOR},
+		{"^=", SW_OP_BITXOR},   {"<<=", SW_OP_SHL},
+		{">>=", SW_OP_SHR},
+	};
+	struct sw_val lhs = parse_ternary(c);
+	const struct sw_token *token = cur(c);
+
+	for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+		struct sw_val rhs;
+
+		if (!tok_is(token, ops[i].str))
+			continue;
+
+		advance(c);
+		rhs = parse_assign(c);
+		if (ops[i].op != SW_OP_END)
+			rhs = binary_op(c, ops[i].op, lhs, rhs);
+		store(c, lhs, rhs);
+
+		lhs.lvalue = false;
+		return lhs;
+	}
+
+	return lhs;
+}
+
+static struct sw_val parse_expr(struct sw_compiler *c)
+{
+	struct sw_val val = parse_assign(c);
+	while (!c->failed && accept(c, ","))
+		val = parse_assign(c);
+	return val;
+}
+
+/* ------------------------------------------------------------------------- */
+/* statements */
+
+static const char *qualifiers[] = {"const",     "static",   "uniform",
+				   "precise",   "volatile", "row_major",
+				   "column_major", "nointerpolation",
+				   "linear",    "centroid", "noperspective",
+				   "in",        "out",      "inout",
+				   NULL};
+
+static bool is_qualifier(const struct sw_token *token)
+{
+	for (const char **q = qualifiers; *q; q++) {
+		if (tok_is(token, *q))
+			return true;
+	}
+	return false;
+}
+
+static bool is_declaration(struct sw_compiler *c)
+{
+	const struct sw_token *token = cur(c);
+	struct sw_type type;
+
+	if (token->type != SW_TOKEN_NAME)
+		return false;
+	if (is_qualifier(token))
+		return true;
+	return lookup_type(c, token->str, token->len, &type) &&
+	       peek(c, 1)->type == SW_TOKEN_NAME;
+}
+
+static void parse_declaration(struct sw_compiler *c)
+{
+	const struct sw_token *token;
+	struct sw_type type;
+
+	while (is_qualifier(cur(c)))
+		advance(c);
+
+	token = expect_name(c);
+	if (!token)
+		return;
+	if (!lookup_type(c, token->str, token->len, &type) ||
+	    (!is_numeric(&type) && type.base != SW_STRUCT)) {
+		compile_error(c, "unsupported type '%.*s'", (int)token->len,
+			      token->str);
+		return;
+	}
+
+	do {
+		const struct sw_token *name = expect_name(c);
+		uint32_t size = type_size(&type);
+		uint32_t top = c->top;
+		struct sw_val var;
+
+		if (!name)
+			return;
+		if (tok_is(cur(c), "[")) {
+			compile_error(c, "arrays are not supported");
+			return;
+		}
+		if (accept(c, ":"))
+			expect_name(c);
+
+		var = make_val(type, alloc_slots(c, size), true);
+		top = c->top;
+
+		if (accept(c, "=")) {
+			if (accept(c, "{")) {
+				struct sw_val args[SW_MAX_ARGS];
+				size_t argc = 0;
+
+				do {
+					if (argc == SW_MAX_ARGS) {
+						compile_error(c, "initializer too long");
+						return;
+					}
+					args[argc++] = parse_assign(c);
+				} while (!c->failed && accept(c, ","));
+				expect(c, "}");
+				if (type.base == SW_STRUCT) {
+					compile_error(c, "struct initializers are not supported");
+					return;
+				}
+				store(c, var, construct(c, &type, args, argc));
+			} else {
+				store(c, var, parse_assign(c));
+			}
+		} else {
+			struct sw_inst *inst = emit(c, SW_OP_MOV, size,
+						    var.slot);
+			inst->a = c->zero;
+		}
+
+		c->top = top;
+		push_symbol(c, name->str, name->len, var);
+	} while (!c->failed && accept(c, ","));
+
+	expect(c, ";");
+}
+
+static void parse_statement(struct sw_compiler *c);
+
+static void parse_scoped_statement(struct sw_compiler *c)
+{
+	size_t num_symbols = c->symbols.num;
+	uint32_t top = c->top;
+
+	parse_statement(c);
+	c->symbols.num = num_symbols;
+	c->top = top;
+}
+
+static uint32_t parse_condition(struct sw_compiler *c)
+{
+	struct sw_val cond;
+
+	expect(c, "(");
+	cond = parse_expr(c);
+	expect(c, ")");
+	if (c->failed)
+		return 0;
+	if (!is_numeric(&cond.type)) {
+		compile_error(c, "invalid condition");
+		return 0;
+	}
+	return val_slot(&cond, 0);
+}
+
+static void begin_loop(struct sw_compiler *c, struct sw_loop *loop,
+		       struct sw_loop **saved)
+{
+	memset(loop, 0, sizeof(*loop));
+	*saved = c->loop;
+	c->loop = loop;
+}
+
+static void end_loop(struct sw_compiler *c, struct sw_loop *loop,
+		     struct sw_loop *saved, size_t continue_pc)
+{
+	for (size_t i = 0; i < loop->continues.num; i++)
+		patch(c, loop->continues.array[i], continue_pc);
+	for (size_t i = 0; i < loop->breaks.num; i++)
+		patch(c, loop->breaks.array[i], c->prog->code.num);
+	da_free(loop->continues);
+	da_free(loop->breaks);
+	c->loop = saved;
+}
+
+static void parse_if(struct sw_compiler *c)
+{
+	uint32_t top = c->top;
+	uint32_t cond = parse_condition(c);
+	size_t jz = emit_jump(c, SW_OP_JZ, cond);
+
+	c->top = top;
+	parse_scoped_statement(c);
+
+	if (accept(c, "else")) {
+		size_t jmp = emit_jump(c, SW_OP_JMP, 0);
+		patch(c, jz, c->prog->code.num);
+		parse_scoped_statement(c);
+		patch(c, jmp, c->prog->code.num);
+	} else {
+		patch(c, jz, c->prog->code.num);
+	}
+}
+
+static void parse_while(struct sw_compiler *c)
+{
+	size_t start = c->prog->code.num;
+	uint32_t top = c->top;
+	struct sw_loop loop, *saved;
+	size_t jz = emit_jump(c, SW_OP_JZ, parse_condition(c));
+
+	c->top = top;
+	begin_loop(c, &loop, &saved);
+	parse_scoped_statement(c);
+	emit_jump(c, SW_OP_JMP, 0);
+	patch(c, c->prog->code.num - 1, start);
+	patch(c, jz, c->prog->code.num);
+	end_loop(c, &loop, saved, start);
+}
+
+static void parse_do(struct sw_compiler *c)
+{
+	size_t start = c->prog->code.num;
+	uint32_t top = c->top;
+	struct sw_loop loop, *saved;
+	size_t cond_pc, jnz;
+
+	begin_loop(c, &loop, &saved);
+	parse_scoped_statement(c);
+	expect(c, "while");
+
+	cond_pc = c->prog->code.num;
+	jnz = emit_jump(c, SW_OP_JNZ, parse_condition(c));
+	patch(c, jnz, start);
+	expect(c, ";");
+	c->top = top;
+	end_loop(c, &loop, saved, cond_pc);
+}
+
+static void parse_for(struct sw_compiler *c)
+{
+	size_t num_symbols = c->symbols.num;
+	uint32_t top = c->top;
+	struct sw_loop loop, *saved;
+	size_t cond_pc, step_pos, end_pos, step_pc, jz = SIZE_MAX;
+	int depth = 0;
+
+	expect(c, "(");
+	if (is_declaration(c)) {
+		parse_declaration(c);
+	} else {
+		if (!tok_is(cur(c), ";"))
+			parse_expr(c);
+		expect(c, ";");
+	}
+	top = c->top;
+
+	cond_pc = c->prog->code.num;
+	if (!tok_is(cur(c), ";")) {
+		struct sw_val cond = parse_expr(c);
+		jz = emit_jump(c, SW_OP_JZ, val_slot(&cond, 0));
+	}
+	expect(c, ";");
+	c->top = top;
+
+	/* the step is compiled after the body */
+	step_pos = c->pos;
+	while (cur(c)->type != SW_TOKEN_END &&
+	       (depth || !tok_is(cur(c), ")"))) {
+		if (tok_is(cur(c), "("))
+			depth++;
+		else if (tok_is(cur(c), ")"))
+			depth--;
+		advance(c);
+	}
+	expect(c, ")");
+
+	begin_loop(c, &loop, &saved);
+	parse_scoped_statement(c);
+
+	end_pos = c->pos;
+	step_pc = c->prog->code.num;
+	c->pos = step_pos;
+	if (!tok_is(cur(c), ")"))
+		parse_expr(c);
+	c->pos = end_pos;
+	c->top = top;
+
+	emit_jump(c, SW_OP_JMP, 0);
+	patch(c, c->prog->code.num - 1, cond_pc);
+	if (jz != SIZE_MAX)
+		patch(c, jz, c->prog->code.num);
+	end_loop(c, &loop, saved, step_pc);
+
+	c->symbols.num = num_symbols;
+}
+
+static void parse_return(struct sw_compiler *c)
+{
+	size_t jmp;
+
+	if (!c->func) {
+		compile_error(c, "return outside of a function");
+		return;
+	}
+
+	if (!tok_is(cur(c), ";")) {
+		struct sw_val val = parse_expr(c);
+		if (c->func->ret.base != SW_VOID)
+			store(c, make_val(c->func->ret, c->func->ret_slot, true),
+			      val);
+	}
+	expect(c, ";");
+
+	jmp = emit_jump(c, SW_OP_JMP, 0);
+	da_push_back(c->func->returns, &jmp);
+}
+
+static void parse_statement(struct sw_compiler *c)
+{
+	const struct sw_token *token = cur(c);
+	uint32_t top = c->top;
+
+	if (c->failed)
+		return;
+
+	if (tok_is(token, "{")) {
+		parse_block(c);
+	} else if (accept(c, ";")) {
+	} else if (tok_is(token, "[")) {
+		/* [unroll], [branch], ... */
+		while (cur(c)->type != SW_TOKEN_END && !accept(c, "]"))
+			advance(c);
+	} else if (accept(c, "if")) {
+		parse_if(c);
+	} else if (accept(c, "while")) {
+		parse_while(c);
+	} else if (accept(c, "do")) {
+		parse_do(c);
+	} else if (accept(c, "for")) {
+		parse_for(c);
+	} else if (accept(c, "return")) {
+		parse_return(c);
+	} else if (tok_is(token, "break") || tok_is(token, "continue")) {
+		size_t jmp;
+
+		advance(c);
+		expect(c, ";");
+		if (!c->loop) {
+			compile_error(c, "break or continue outside of a loop");
+			return;
+		}
+		jmp = emit_jump(c, SW_OP_JMP, 0);
+		if (tok_is(token, "break"))
+			da_push_back(c->loop->breaks, &jmp);
+		else
+			da_push_back(c->loop->continues, &jmp);
+	} else if (accept(c, "discard")) {
+		expect(c, ";");
+		emit(c, SW_OP_DISCARD, 0, 0);
+	} else if (is_declaration(c)) {
+		parse_declaration(c);
+		return;
+	} else {
+		parse_expr(c);
+		expect(c, ";");
+	}
+
+	c->top = top;
+}
+
+static void parse_block(struct sw_compiler *c)
+{
+	size_t num_symbols = c->symbols.num;
+	uint32_t top = c->top;
+
+	expect(c, "{");
+	while (!c->failed && !tok_is(cur(c), "}")) {
+		if (cur(c)->type == SW_TOKEN_END) {
+			compile_error(c, "unexpected end of function");
+			break;
+		}
+		parse_statement(c);
+	}
+	expect(c, "}");
+
+	c->symbols.num = num_symbols;
+	c->top = top;
+}
+
+/* ------------------------------------------------------------------------- */
+/* program inputs and outputs */
+
+static bool parse_semantic(const char *semantic, enum sw_io_kind *kind,
+			   int *attrib)
+{
+	if (!semantic)
+		return false;
+	if (astrcmpi_n(semantic, "SV_", 3) == 0)
+		semantic += 3;
+
+	*attrib = 0;
+	if (astrcmpi(semantic, "POSITION") == 0 ||
+	    astrcmpi(semantic, "POSITION0") == 0) {
+		*kind = SW_IO_POSITION;
+	} else if (astrcmpi(semantic, "VERTEXID") == 0) {
+		*kind = SW_IO_VERTEXID;
+	} else if (astrcmpi(semantic, "TARGET") == 0 ||
+		   astrcmpi(semantic, "TARGET0") == 0) {
+		*kind = SW_IO_TARGET;
+	} else if (astrcmpi_n(semantic, "TEXCOORD", 8) == 0) {
+		int idx = semantic[8] ? atoi(semantic + 8) : 0;
+		if (idx < 0 || idx >= SW_MAX_TEXCOORDS)
+			return false;
+		*kind = SW_IO_ATTRIB;
+		*attrib = SW_ATTRIB_TEXCOORD0 + idx;
+	} else if (astrcmpi(semantic, "COLOR") == 0 ||
+		   astrcmpi(semantic, "COLOR0") == 0) {
+		*kind = SW_IO_ATTRIB;
+		*attrib = SW_ATTRIB_COLOR;
+	} else if (astrcmpi(semantic, "COLOR1") == 0) {
+		*kind = SW_IO_ATTRIB;
+		*attrib = SW_ATTRIB_COLOR1;
+	} else if (astrcmpi(semantic, "NORMAL") == 0 ||
+		   astrcmpi(semantic, "NORMAL0") == 0) {
+		*kind = SW_IO_ATTRIB;
+		*attrib = SW_ATTRIB_NORMAL;
+	} else if (astrcmpi(semantic, "TANGENT") == 0 ||
+		   astrcmpi(semantic, "TANGENT0") == 0) {
+		*kind = SW_IO_ATTRIB;
+		*attrib = SW_ATTRIB_TANGENT;
+	} else {
+		return false;
+	}
+
+	return true;
+}
+
+static void add_io(struct sw_compiler *c, bool output,
+		   const struct sw_type *type, uint32_t slot,
+		   const char *mapping)
+{
+	struct sw_program *prog = c->prog;
+	struct sw_io io = {0};
+
+	if (c->failed)
+		return;
+
+	if (type->base == SW_STRUCT) {
+		const struct shader_struct *info = type->st->info;
+
+		for (size_t i = 0; i < info->vars.num; i++) {
+			const struct shader_var *var = info->vars.array + i;
+			struct sw_type member_type;
+
+			lookup_type_str(c, var->type, &member_type);
+			add_io(c, output, &member_type, slot, var->mapping);
+			slot += type_size(&member_type);
+		}
+		return;
+	}
+
+	if (!is_numeric(type) || type_comps(type) > 4 ||
+	    !parse_semantic(mapping, &io.kind, &io.attrib)) {
+		compile_error(c, "unsupported %s semantic '%s'",
+			      output ? "output" : "input",
+			      mapping ? mapping : "");
+		return;
+	}
+
+	io.slot = slot;
+	io.n = type_comps(type);
+	io.integer = type->base != SW_FLOAT;
+
+	if (io.kind == SW_IO_ATTRIB &&
+	    (output == (prog->type == GS_SHADER_VERTEX)))
+		prog->attribs |= 1u << io.attrib;
+
+	if (output)
+		da_push_back(prog->outputs, &io);
+	else
+		da_push_back(prog->inputs, &io);
+}
+
+static void add_globals(struct sw_compiler *c)
+{
+	struct shader_parser *sp = c->sp;
+	struct sw_program *prog = c->prog;
+	uint32_t texture_id = 0;
+	struct sw_val val;
+
+	for (size_t i = 0; i < sp->params.num; i++) {
+		const struct shader_var *var = sp->params.array + i;
+		struct sw_type type;
+
+		val = bad_val();
+
+		if (get_shader_param_type(var->type) ==
+		    GS_SHADER_PARAM_TEXTURE) {
+			val = make_val(vec_type(SW_TEXTURE, 0), texture_id++,
+				       false);
+		} else if (lookup_type_str(c, var->type, &type) &&
+			   is_numeric(&type) && !var->array_count) {
+			struct sw_uniform uniform = {i,
+						     (uint32_t)prog->statics.num,
+						     type_comps(&type),
+						     type.base != SW_FLOAT};
+
+			val = make_val(type, SW_STATIC_BIT | uniform.index,
+				       false);
+			for (uint32_t j = 0; j < uniform.size; j++)
+				da_push_back(prog->statics, &(float){0.0f});
+			da_push_back(prog->uniforms, &uniform);
+		}
+
+		push_symbol(c, var->name, strlen(var->name), val);
+	}
+
+	for (size_t i = 0; i < sp->samplers.num; i++) {
+		const char *name = sp->samplers.array[i].name;
+		val = make_val(vec_type(SW_SAMPLER, 0), (uint32_t)i, false);
+		push_symbol(c, name, strlen(name), val);
+	}
+
+	c->literals_base = prog->statics.num;
+	c->zero = literal_slot(c, 0.0f);
+
+	/* effects branch on this for GLSL, it's always false here */
+	val = const_val(c, SW_BOOL, 0.0f);
+	push_symbol(c, "obs_glsl_compile", strlen("obs_glsl_compile"), val);
+
+	c->num_globals = c->symbols.num;
+	c->scope_base = c->num_globals;
+}
+
+static void compile_main(struct sw_compiler *c)
+{
+	struct sw_val args[SW_MAX_ARGS];
+	struct sw_func *main_func = NULL;
+	const struct shader_func *info;
+	struct sw_val result;
+	uint32_t args_base;
+
+	for (size_t i = 0; i < c->sp->funcs.num; i++) {
+		if (strcmp(c->sp->funcs.array[i].name, "main") == 0)
+			main_func = c->funcs + i;
+	}
+	if (!main_func) {
+		compile_error(c, "no main function");
+		return;
+	}
+
+	info = main_func->info;
+	if (info->params.num > SW_MAX_ARGS) {
+		compile_error(c, "too many inputs");
+		return;
+	}
+
+	for (size_t i = 0; i < info->params.num && !c->failed; i++) {
+		const struct shader_var *var = info->params.array + i;
+		struct sw_type type;
+
+		if (!lookup_type_str(c, var->type, &type) ||
+		    var->var_type == SHADER_VAR_OUT ||
+		    var->var_type == SHADER_VAR_INOUT) {
+			compile_error(c, "unsupported input '%s'", var->name);
+			return;
+		}
+
+		args[i] = make_val(type, alloc_slots(c, type_size(&type)),
+				   true);
+		add_io(c, false, &type, args[i].slot, var->mapping);
+	}
+	if (c->failed)
+		return;
+
+	args_base = c->top;
+	result = call_func(c, main_func, args, info->params.num, args_base);
+	emit(c, SW_OP_END, 0, 0);
+	if (c->failed)
+		return;
+
+	if (c->prog->type == GS_SHADER_PIXEL && is_numeric(&result.type)) {
+		struct sw_io io = {SW_IO_TARGET, 0, result.slot,
+				   type_comps(&result.type), false};
+		if (io.n > 4) {
+			compile_error(c, "invalid pixel shader result");
+			return;
+		}
+		da_push_back(c->prog->outputs, &io);
+	} else {
+		add_io(c, true, &result.type, result.slot, info->mapping);
+	}
+}
+
+static inline uint32_t relocate(const struct sw_program *prog, uint32_t slot)
+{
+	return (slot & SW_STATIC_BIT) ? prog->stack_size + (slot & ~SW_STATIC_BIT)
+				      : slot;
+}
+
+static bool check_outputs(struct sw_compiler *c)
+{
+	struct sw_program *prog = c->prog;
+	bool has_target = false;
+
+	for (size_t i = 0; i < prog->outputs.num; i++) {
+		if (prog->outputs.array[i].kind == SW_IO_TARGET)
+			has_target = true;
+	}
+
+	if (prog->type == GS_SHADER_PIXEL && !has_target) {
+		compile_error(c, "pixel program has no target output");
+		return false;
+	}
+	return true;
+}
+
+static void finish_program(struct sw_program *prog)
+{
+	for (size_t i = 0; i < prog->code.num; i++) {
+		struct sw_inst *inst = prog->code.array + i;
+		inst->dst = relocate(prog, inst->dst);
+		inst->a = relocate(prog, inst->a);
+		inst->b = relocate(prog, inst->b);
+		inst->c = relocate(prog, inst->c);
+	}
+	for (size_t i = 0; i < prog->inputs.num; i++)
+		prog->inputs.array[i].slot =
+			relocate(prog, prog->inputs.array[i].slot);
+	for (size_t i = 0; i < prog->outputs.num; i++)
+		prog->outputs.array[i].slot =
+			relocate(prog, prog->outputs.array[i].slot);
+}
+
+struct sw_program *sw_program_create(enum gs_shader_type type,
+				     struct shader_parser *sp, char **error)
+{
+	struct sw_program *prog = bzalloc(sizeof(struct sw_program));
+	struct sw_compiler c = {0};
+
+	prog->type = type;
+	c.prog = prog;
+	c.sp = sp;
+	c.structs = bzalloc(sizeof(struct sw_struct) * (sp->structs.num + 1));
+	c.funcs = bzalloc(sizeof(struct sw_func) * (sp->funcs.num + 1));
+
+	for (size_t i = 0; i < sp->funcs.num; i++) {
+		const struct shader_func *info = sp->funcs.array + i;
+		struct sw_func *func = c.funcs + i;
+
+		func->info = info;
+		for (const struct cf_token *token = info->start;
+		     token && token != info->end &&
+		     token->type != CFTOKEN_NONE;
+		     token++) {
+			dstr_ncat(&func->source, token->str.array,
+				  token->str.len);
+		}
+	}
+
+	if (size_structs(&c)) {
+		add_globals(&c);
+		compile_main(&c);
+		check_outputs(&c);
+	}
+
+	for (size_t i = 0; i < sp->funcs.num; i++) {
+		dstr_free(&c.funcs[i].source);
+		da_free(c.funcs[i].tokens);
+	}
+	bfree(c.funcs);
+	bfree(c.structs);
+	da_free(c.symbols);
+
+	if (c.failed) {
+		if (error)
+			*error = bstrdup(c.error.array);
+		dstr_free(&c.error);
+		sw_program_destroy(prog);
+		return NULL;
+	}
+
+	finish_program(prog);
+	return prog;
+}
+
+void sw_program_destroy(struct sw_program *prog)
+{
+	if (!prog)
+		return;
+
+	da_free(prog->code);
+	da_free(prog->statics);
+	da_free(prog->uniforms);
+	da_free(prog->inputs);
+	da_free(prog->outputs);
+	bfree(prog);
+}
+
+uint32_t sw_program_attribs(const struct sw_program *prog)
+{
+	return prog->attribs;
+}
+
+bool sw_program_uses_derivatives(const struct sw_program *prog)
+{
+	return prog->num_derivs > 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* per draw state */
+
+void sw_binding_init(struct sw_binding *binding, gs_shader_t *shader)
+{
+	const struct sw_program *prog = shader->program;
+	gs_device_t *device = shader->device;
+	uint32_t texture_id = 0;
+
+	memset(binding, 0, sizeof(*binding));
+	binding->program = prog;
+	binding->statics = bmalloc(sizeof(float) * (prog->statics.num + 1));
+	memcpy(binding->statics, prog->statics.array,
+	       sizeof(float) * prog->statics.num);
+
+	for (size_t i = 0; i < prog->uniforms.num; i++) {
+		const struct sw_uniform *uniform = prog->uniforms.array + i;
+		const struct gs_shader_param *param =
+			shader->params.array + uniform->param;
+		float *out = binding->statics + uniform->index;
+		size_t count = param->cur_value.num / sizeof(float);
+
+		if (count > uniform->size)
+			count = uniform->size;
+
+		if (uniform->integer) {
+			const int *vals = (const int *)param->cur_value.array;
+			for (size_t j = 0; j < count; j++)
+				out[j] = (float)vals[j];
+		} else {
+			memcpy(out, param->cur_value.array,
+			       count * sizeof(float));
+		}
+	}
+
+	for (size_t i = 0; i < GS_MAX_TEXTURES; i++)
+		binding->samplers[i] = device->cur_samplers[i]
+					       ? device->cur_samplers[i]
+					       : device->default_sampler;
+
+	for (size_t i = 0; i < shader->params.num; i++) {
+		struct gs_shader_param *param = shader->params.array + i;
+		struct gs_texture *tex;
+		uint32_t k;
+
+		if (param->type != GS_SHADER_PARAM_TEXTURE)
+			continue;
+
+		k = texture_id++;
+		if (k >= GS_MAX_TEXTURES)
+			continue;
+
+		tex = param->texture;
+		if (tex && tex->type == GS_TEXTURE_2D) {
+			binding->textures[k] = (struct gs_texture_2d *)tex;
+			binding->srgb[k] = param->srgb &&
+					   gs_is_srgb_format(tex->format);
+		}
+		if (param->next_sampler) {
+			binding->samplers[k] = param->next_sampler;
+			param->next_sampler = NULL;
+		}
+	}
+}
+
+void sw_binding_free(struct sw_binding *binding)
+{
+	bfree(binding->statics);
+	binding->statics = NULL;
+}
+
+void sw_exec_init(struct sw_exec *exec, const struct sw_binding *binding)
+{
+	const struct sw_program *prog = binding->program;
+
+	memset(exec, 0, sizeof(*exec));
+	exec->binding = binding;
+	exec->frame = bzalloc(sizeof(float) *
+			      (prog->stack_size + prog->statics.num + 1));
+	memcpy(exec->frame + prog->stack_size, binding->statics,
+	       sizeof(float) * prog->statics.num);
+
+	if (prog->num_derivs) {
+		exec->derivs = bzalloc(sizeof(float) * prog->deriv_size * 2);
+		exec->recorded = bzalloc(prog->num_derivs);
+	}
+}
+
+void sw_exec_free(struct sw_exec *exec)
+{
+	bfree(exec->frame);
+	bfree(exec->derivs);
+	bfree(exec->recorded);
+	memset(exec, 0, sizeof(*exec));
+}
+
+/* ------------------------------------------------------------------------- */
+/* execution */
+
+static inline float saturate_f(float x)
+{
+	return x > 0.0f ? (x < 1.0f ? x : 1.0f) : 0.0f;
+}
+
+static inline float to_int(float x)
+{
+	return isnan(x) ? 0.0f : truncf(x);
+}
+
+static inline float to_uint(float x)
+{
+	x = to_int(x);
+	return x < 0.0f ? (float)(uint32_t)(int32_t)x : x;
+}
+
+static void exec_sample(const struct sw_exec *exec, const struct sw_inst *inst,
+			const float *uv, const float *offset, float *out)
+{
+	const struct sw_binding *binding = exec->binding;
+	uint32_t unit = inst->imm & 0xFF;
+	uint32_t ss = (inst->imm >> 8) & 0xFF;
+	const struct gs_texture_2d *tex =
+		unit < GS_MAX_TEXTURES ? binding->textures[unit] : NULL;
+	struct vec4 texel;
+	float u = uv[0], v = uv[1];
+
+	if (!tex) {
+		memset(out, 0, sizeof(float) * 4);
+		return;
+	}
+
+	if (inst->imm & SW_SAMPLE_OFFSET) {
+		u += offset[0] / (float)tex->width;
+		v += offset[1] / (float)tex->height;
+	}
+
+	sw_texture_sample(tex,
+			  binding->samplers[ss < GS_MAX_TEXTURES ? ss : 0],
+			  binding->srgb[unit], u, v, &texel);
+	memcpy(out, texel.ptr, sizeof(float) * 4);
+}
+
+static void exec_load(const struct sw_exec *exec, const struct sw_inst *inst,
+		      const float *coords, const float *offset, float *out)
+{
+	const struct sw_binding *binding = exec->binding;
+	uint32_t unit = inst->imm & 0xFF;
+	const struct gs_texture_2d *tex =
+		unit < GS_MAX_TEXTURES ? binding->textures[unit] : NULL;
+	int64_t x = (int64_t)coords[0], y = (int64_t)coords[1];
+	struct vec4 texel;
+
+	if (inst->imm & SW_SAMPLE_OFFSET) {
+		x += (int64_t)offset[0];
+		y += (int64_t)offset[1];
+	}
+
+	/* out of range loads return zero like D3D does */
+	if (!tex || x < 0 || y < 0 || x >= tex->width || y >= tex->height) {
+		memset(out, 0, sizeof(float) * 4);
+		return;
+	}
+
+	sw_texture_load(tex, (uint32_t)x, (uint32_t)y, binding->srgb[unit],
+			&texel);
+	memcpy(out, texel.ptr, sizeof(float) * 4);
+}
+
+/* returns true when the run stopped early with every derivative recorded */
+static bool exec_derivative(struct sw_exec *exec, const struct sw_inst *inst,
+			    const float *a, float *d)
+{
+	const struct sw_program *prog = exec->binding->program;
+	uint32_t k = inst->imm >> 16;
+	uint32_t offset = inst->imm & 0xFFFF;
+	uint8_t bit = inst->op == SW_OP_DDX ? 1 : 2;
+	float *rec = exec->derivs + offset;
+
+	if (bit == 2)
+		rec += prog->deriv_size;
+
+	if (exec->mode != SW_EXEC_NORMAL) {
+		memset(d, 0, sizeof(float) * inst->n);
+
+		if ((exec->mode == SW_EXEC_RECORD_X) != (bit == 1) ||
+		    (exec->recorded[k] & bit))
+			return false;
+
+		memcpy(rec, a, sizeof(float) * inst->n);
+		exec->recorded[k] |= bit;
+		return --exec->pending == 0;
+	}
+
+	if (exec->recorded[k] & bit) {
+		for (uint32_t i = 0; i < inst->n; i++)
+			d[i] = rec[i] - a[i];
+	} else {
+		memset(d, 0, sizeof(float) * inst->n);
+	}
+	return false;
+}
+
+#define UNARY(expr)                                     \
+	for (uint32_t i = 0; i < n; i++) {              \
+		const float x = a[i * inst->sa];        \
+		d[i] = (expr);                          \
+	}                                               \
+	break
+
+#define BINARY(expr)                                    \
+	for (uint32_t i = 0; i < n; i++) {              \
+		const float x = a[i * inst->sa];        \
+		const float y = b[i * inst->sb];        \
+		d[i] = (expr);                          \
+	}                                               \
+	break
+
+#define TERNARY(expr)                                   \
+	for (uint32_t i = 0; i < n; i++) {              \
+		const float x = a[i * inst->sa];        \
+		const float y = b[i * inst->sb];        \
+		const float z = cc[i * inst->sc];       \
+		d[i] = (expr);                          \
+	}                                               \
+	break
+
+static void run_program(struct sw_exec *exec)
+{
+	const struct sw_program *prog = exec->binding->program;
+	const struct sw_inst *code = prog->code.array;
+	float *frame = exec->frame;
+	size_t pc = 0;
+
+	exec->discarded = false;
+
+	for (;;) {
+		const struct sw_inst *inst = code + pc++;
+		const uint32_t n = inst->n;
+		float *d = frame + inst->dst;
+		const float *a = frame + inst->a;
+		const float *b = frame + inst->b;
+		const float *cc = frame + inst->c;
+
+		switch ((enum sw_op)inst->op) {
+		case SW_OP_END:
+			return;
+		case SW_OP_JMP:
+			pc = inst->imm;
+			break;
+		case SW_OP_JZ:
+			if (a[0] == 0.0f)
+				pc = inst->imm;
+			break;
+		case SW_OP_JNZ:
+			if (a[0] != 0.0f)
+				pc = inst->imm;
+			break;
+		case SW_OP_DISCARD:
+			exec->discarded = true;
+			return;
+		case SW_OP_CLIP:
+			for (uint32_t i = 0; i < n; i++) {
+				if (a[i] < 0.0f) {
+					exec->discarded = true;
+					return;
+				}
+			}
+			break;
+
+		case SW_OP_MOV:
+			UNARY(x);
+		case SW_OP_GATHER:
+			for (uint32_t i = 0; i < n; i++)
+				d[i] = a[(inst->imm >> (2 * i)) & 3];
+			break;
+		case SW_OP_SCATTER:
+			for (uint32_t i = 0; i < n; i++)
+				d[(inst->imm >> (2 * i)) & 3] = a[i];
+			break;
+
+		case SW_OP_ADD:
+			BINARY(x + y);
+		case SW_OP_SUB:
+			BINARY(x - y);
+		case SW_OP_MUL:
+			BINARY(x * y);
+		case SW_OP_DIV:
+			BINARY(x / y);
+		case SW_OP_IDIV:
+			BINARY(y != 0.0f ? (float)((int64_t)x / (int64_t)y)
+					 : 0.0f);
+		case SW_OP_MOD:
+			BINARY(fmodf(x, y));
+		case SW_OP_IMOD:
+			BINARY(y != 0.0f ? (float)((int64_t)x % (int64_t)y)
+					 : 0.0f);
+		case SW_OP_LT:
+			BINARY(x < y ? 1.0f : 0.0f);
+		case SW_OP_LE:
+			BINARY(x <= y ? 1.0f : 0.0f);
+		case SW_OP_GT:
+			BINARY(x > y ? 1.0f : 0.0f);
+		case SW_OP_GE:
+			BINARY(x >= y ? 1.0f : 0.0f);
+		case SW_OP_EQ:
+			BINARY(x == y ? 1.0f : 0.0f);
+		case SW_OP_NE:
+			BINARY(x != y ? 1.0f : 0.0f);
+		case SW_OP_AND:
+			BINARY((x != 0.0f && y != 0.0f) ? 1.0f : 0.0f);
+		case SW_OP_OR:
+			BINARY((x != 0.0f || y != 0.0f) ? 1.0f : 0.0f);
+		case SW_OP_BITAND:
+			BINARY((float)((int64_t)x & (int64_t)y));
+		case SW_OP_BITOR:
+			BINARY((float)((int64_t)x | (int64_t)y));
+		case SW_OP_BITXOR:
+			BINARY((float)((int64_t)x ^ (int64_t)y));
+		case SW_OP_SHL:
+			BINARY((float)(int32_t)((uint32_t)(int64_t)x
+						<< ((int64_t)y & 31)));
+		case SW_OP_SHR:
+			BINARY((float)((int64_t)x >> ((int64_t)y & 31)));
+		case SW_OP_POW:
+			BINARY(powf(x, y));
+		case SW_OP_MIN:
+			BINARY(fminf(x, y));
+		case SW_OP_MAX:
+			BINARY(fmaxf(x, y));
+		case SW_OP_STEP:
+			BINARY(y >= x ? 1.0f : 0.0f);
+		case SW_OP_ATAN2:
+			BINARY(atan2f(x, y));
+
+		case SW_OP_NEG:
+			UNARY(-x);
+		case SW_OP_NOT:
+			UNARY(x == 0.0f ? 1.0f : 0.0f);
+		case SW_OP_BITNOT:
+			UNARY((float)~(int64_t)x);
+		case SW_OP_TOINT:
+			UNARY(to_int(x));
+		case SW_OP_TOUINT:
+			UNARY(to_uint(x));
+		case SW_OP_TOBOOL:
+			UNARY(x != 0.0f ? 1.0f : 0.0f);
+		case SW_OP_ABS:
+			UNARY(fabsf(x));
+		case SW_OP_SIGN:
+			UNARY((float)((x > 0.0f) - (x < 0.0f)));
+		case SW_OP_FLOOR:
+			UNARY(floorf(x));
+		case SW_OP_CEIL:
+			UNARY(ceilf(x));
+		case SW_OP_ROUND:
+			UNARY(roundf(x));
+		case SW_OP_TRUNC:
+			UNARY(truncf(x));
+		case SW_OP_FRAC:
+			UNARY(x - floorf(x));
+		case SW_OP_SQRT:
+			UNARY(sqrtf(x));
+		case SW_OP_RSQRT:
+			UNARY(1.0f / sqrtf(x));
+		case SW_OP_RCP:
+			UNARY(1.0f / x);
+		case SW_OP_EXP:
+			UNARY(expf(x));
+		case SW_OP_EXP2:
+			UNARY(exp2f(x));
+		case SW_OP_LOG:
+			UNARY(logf(x));
+		case SW_OP_LOG2:
+			UNARY(log2f(x));
+		case SW_OP_LOG10:
+			UNARY(log10f(x));
+		case SW_OP_SIN:
+			UNARY(sinf(x));
+		case SW_OP_COS:
+			UNARY(cosf(x));
+		case SW_OP_TAN:
+			UNARY(tanf(x));
+		case SW_OP_ASIN:
+			UNARY(asinf(x));
+		case SW_OP_ACOS:
+			UNARY(acosf(x));
+		case SW_OP_ATAN:
+			UNARY(atanf(x));
+		case SW_OP_SINH:
+			UNARY(sinhf(x));
+		case SW_OP_COSH:
+			UNARY(coshf(x));
+		case SW_OP_TANH:
+			UNARY(tanhf(x));
+		case SW_OP_SATURATE:
+			UNARY(saturate_f(x));
+		case SW_OP_DEGREES:
+			UNARY(x * (180.0f / (float)M_PI));
+		case SW_OP_RADIANS:
+			UNARY(x * ((float)M_PI / 180.0f));
+		case SW_OP_ISNAN:
+			UNARY(isnan(x) ? 1.0f : 0.0f);
+		case SW_OP_ISINF:
+			UNARY(isinf(x) ? 1.0f : 0.0f);
+
+		case SW_OP_SELECT:
+			TERNARY(x != 0.0f ? y : z);
+		case SW_OP_CLAMP:
+			TERNARY(fminf(fmaxf(x, y), z));
+		case SW_OP_LERP:
+			TERNARY(x + (y - x) * z);
+		case SW_OP_SMOOTHSTEP:
+			for (uint32_t i = 0; i < n; i++) {
+				const float e0 = a[i * inst->sa];
+				const float e1 = b[i * inst->sb];
+				const float t = saturate_f(
+					(cc[i * inst->sc] - e0) / (e1 - e0));
+				d[i] = t * t * (3.0f - 2.0f * t);
+			}
+			break;
+		case SW_OP_MAD:
+			TERNARY(x * y + z);
+
+		case SW_OP_DOT: {
+			float sum = 0.0f;
+			for (uint32_t i = 0; i < inst->imm; i++)
+				sum += a[i] * b[i];
+			d[0] = sum;
+			break;
+		}
+		case SW_OP_ANY:
+		case SW_OP_ALL: {
+			bool any = false, all = true;
+			for (uint32_t i = 0; i < inst->imm; i++) {
+				any = any || a[i] != 0.0f;
+				all = all && a[i] != 0.0f;
+			}
+			d[0] = (inst->op == SW_OP_ANY ? any : all) ? 1.0f
+								    : 0.0f;
+			break;
+		}
+		case SW_OP_CROSS:
+			d[0] = a[1] * b[2] - a[2] * b[1];
+			d[1] = a[2] * b[0] - a[0] * b[2];
+			d[2] = a[0] * b[1] - a[1] * b[0];
+			break;
+		case SW_OP_VECMAT: {
+			const uint32_t rows = inst->imm & 0xFF;
+			const uint32_t cols = (inst->imm >> 8) & 0xFF;
+			for (uint32_t j = 0; j < cols; j++) {
+				float sum = 0.0f;
+				for (uint32_t i = 0; i < rows; i++)
+					sum += a[i] * b[i * cols + j];
+				d[j] = sum;
+			}
+			break;
+		}
+		case SW_OP_MATVEC: {
+			const uint32_t rows = inst->imm & 0xFF;
+			const uint32_t cols = (inst->imm >> 8) & 0xFF;
+			for (uint32_t i = 0; i < rows; i++) {
+				float sum = 0.0f;
+				for (uint32_t j = 0; j < cols; j++)
+					sum += a[i * cols + j] * b[j];
+				d[i] = sum;
+			}
+			break;
+		}
+		case SW_OP_MATMAT: {
+			const uint32_t rows = inst->imm & 0xFF;
+			const uint32_t inner = (inst->imm >> 8) & 0xFF;
+			const uint32_t cols = (inst->imm >> 16) & 0xFF;
+			for (uint32_t i = 0; i < rows; i++) {
+				for (uint32_t j = 0; j < cols; j++) {
+					float sum = 0.0f;
+					for (uint32_t k = 0; k < inner; k++)
+						sum += a[i * inner + k] *
+						       b[k * cols + j];
+					d[i * cols + j] = sum;
+				}
+			}
+			break;
+		}
+
+		case SW_OP_SAMPLE:
+			exec_sample(exec, inst, a, b, d);
+			break;
+		case SW_OP_LOAD:
+			exec_load(exec, inst, a, b, d);
+			break;
+		case SW_OP_DDX:
+		case SW_OP_DDY:
+			if (exec_derivative(exec, inst, a, d))
+				return;
+			break;
+		}
+	}
+}
+
+#undef UNARY
+#undef BINARY
+#undef TERNARY
+
+static inline void set_input(float *frame, const struct sw_io *io,
+			     const float *vals)
+{
+	float *out = frame + io->slot;
+
+	for (uint32_t i = 0; i < io->n; i++)
+		out[i] = io->integer ? to_int(vals[i]) : vals[i];
+}
+
+static void fetch_attrib(const struct gs_vb_data *data, int attrib,
+			 uint32_t id, float *out)
+{
+	if (!data || id >= data->num)
+		return;
+
+	if (attrib <= SW_ATTRIB_TEXCOORD5) {
+		const struct gs_tvertarray *tv;
+		size_t width;
+
+		if ((size_t)attrib >= data->num_tex || !data->tvarray)
+			return;
+		tv = data->tvarray + attrib;
+		width = tv->width < 4 ? tv->width : 4;
+		if (tv->array)
+			memcpy(out, (const float *)tv->array + id * tv->width,
+			       width * sizeof(float));
+
+	} else if (attrib == SW_ATTRIB_COLOR) {
+		if (data->colors)
+			gs_u8x4_to_float4(out,
+					  (const uint8_t *)(data->colors + id));
+
+	} else if (attrib == SW_ATTRIB_NORMAL) {
+		if (data->normals)
+			memcpy(out, data->normals[id].ptr, sizeof(float) * 3);
+
+	} else if (attrib == SW_ATTRIB_TANGENT) {
+		if (data->tangents)
+			memcpy(out, data->tangents[id].ptr, sizeof(float) * 3);
+	}
+}
+
+void sw_program_run_vertex(struct sw_exec *exec, const struct gs_vb_data *data,
+			   uint32_t id, struct sw_vertex *out)
+{
+	const struct sw_program *prog = exec->binding->program;
+
+	for (size_t i = 0; i < prog->inputs.num; i++) {
+		const struct sw_io *io = prog->inputs.array + i;
+		float vals[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+
+		if (io->kind == SW_IO_POSITION) {
+			if (data && data->points && id < data->num)
+				memcpy(vals, data->points[id].ptr,
+				       sizeof(float) * 3);
+		} else if (io->kind == SW_IO_VERTEXID) {
+			vals[0] = (float)id;
+		} else {
+			fetch_attrib(data, io->attrib, id, vals);
+		}
+
+		set_input(exec->frame, io, vals);
+	}
+
+	exec->mode = SW_EXEC_NORMAL;
+	run_program(exec);
+
+	vec4_set(&out->pos, 0.0f, 0.0f, 0.0f, 1.0f);
+	for (size_t i = 0; i < SW_MAX_ATTRIBS; i++)
+		vec4_zero(&out->attribs[i]);
+	vec4_set(&out->attribs[SW_ATTRIB_COLOR], 1.0f, 1.0f, 1.0f, 1.0f);
+
+	for (size_t i = 0; i < prog->outputs.num; i++) {
+		const struct sw_io *io = prog->outputs.array + i;
+		struct vec4 *dst = io->kind == SW_IO_POSITION
+					   ? &out->pos
+					   : &out->attribs[io->attrib];
+
+		if (io->kind != SW_IO_POSITION && io->kind != SW_IO_ATTRIB)
+			continue;
+		if (io->kind == SW_IO_ATTRIB)
+			vec4_zero(dst);
+		memcpy(dst->ptr, exec->frame + io->slot,
+		       sizeof(float) * io->n);
+	}
+}
+
+static void load_pixel_inputs(struct sw_exec *exec, int x, int y,
+			      const struct vec4 *attribs)
+{
+	const struct sw_program *prog = exec->binding->program;
+
+	for (size_t i = 0; i < prog->inputs.num; i++) {
+		const struct sw_io *io = prog->inputs.array + i;
+		float vals[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+
+		if (io->kind == SW_IO_POSITION) {
+			vals[0] = (float)x + 0.5f;
+			vals[1] = (float)y + 0.5f;
+		} else if (io->kind == SW_IO_ATTRIB) {
+			memcpy(vals, attribs[io->attrib].ptr, sizeof(vals));
+		}
+
+		set_input(exec->frame, io, vals);
+	}
+}
+
+bool sw_program_run_pixel(struct sw_exec *exec, const struct sw_frag *frag,
+			  struct vec4 *out)
+{
+	const struct sw_program *prog = exec->binding->program;
+	const struct sw_io *target = NULL;
+
+	if (prog->num_derivs) {
+		memset(exec->recorded, 0, prog->num_derivs);
+
+		if (prog->num_ddx && frag->attribs_dx) {
+			load_pixel_inputs(exec, frag->x + 1, frag->y,
+					  frag->attribs_dx);
+			exec->mode = SW_EXEC_RECORD_X;
+			exec->pending = prog->num_ddx;
+			run_program(exec);
+		}
+		if (prog->num_ddy && frag->attribs_dy) {
+			load_pixel_inputs(exec, frag->x, frag->y + 1,
+					  frag->attribs_dy);
+			exec->mode = SW_EXEC_RECORD_Y;
+			exec->pending = prog->num_ddy;
+			run_program(exec);
+		}
+	}
+
+	load_pixel_inputs(exec, frag->x, frag->y, frag->attribs);
+	exec->mode = SW_EXEC_NORMAL;
+	run_program(exec);
+	if (exec->discarded)
+		return false;
+
+	for (size_t i = 0; i < prog->outputs.num; i++) {
+		if (prog->outputs.array[i].kind == SW_IO_TARGET)
+			target = prog->outputs.array + i;
+	}
+
+	/* float, float2 and float3 results fill the rest like the GPU */
+	vec4_set(out, 0.0f, 0.0f, 0.0f, 1.0f);
+	memcpy(out->ptr, exec->frame + target->slot,
+	       sizeof(float) * target->n);
+	return true;
+}
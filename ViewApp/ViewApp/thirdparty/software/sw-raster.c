@@ -0,0 +1,1216 @@
+/******************************************************************************
+    Copyright (C) 2013 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+#include <graphics/half.h>
+#include <graphics/srgb.h>
+#include "sw-subsystem.h"
+
+/* vertex positions are snapped to 1/256th of a pixel so that edge tests are
+ * exact and triangles sharing an edge never both cover a pixel */
+#define SUBPIXEL_BITS 8
+#define SUBPIXEL_ONE (1 << SUBPIXEL_BITS)
+#define MAX_SCREEN_COORD 1000000.0f
+
+static inline float half_to_float(uint16_t h)
+{
+	uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+	uint32_t exp = (h >> 10) & 0x1F;
+	uint32_t mant = h & 0x3FF;
+	uint32_t bits;
+	float f;
+
+	if (exp == 0) {
+		if (!mant) {
+			bits = sign;
+		} else {
+			/* denormal: renormalize */
+			exp = 127 - 15 + 1;
+			while (!(mant & 0x400)) {
+				mant <<= 1;
+				exp--;
+			}
+			mant &= 0x3FF;
+			bits = sign | (exp << 23) | (mant << 13);
+		}
+	} else if (exp == 0x1F) {
+		bits = sign | 0x7F800000 | (mant << 13);
+	} else {
+		bits = sign | ((exp + 127 - 15) << 23) | (mant << 13);
+	}
+
+	memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+static inline float saturate(float f)
+{
+	return f < 0.0f ? 0.0f : (f > 1.0f ? 1.0f : f);
+}
+
+static inline float clampf(float f, float lo, float hi)
+{
+	return f < lo ? lo : (f > hi ? hi : f);
+}
+
+static inline uint16_t float_to_u16(float f)
+{
+	return (uint16_t)(saturate(f) * 65535.0f + 0.5f);
+}
+
+static inline uint8_t float_to_u8(float f)
+{
+	return gs_float_to_u8(saturate(f));
+}
+
+/* ------------------------------------------------------------------------- */
+
+static inline void decode_texel(enum gs_color_format format,
+				const uint8_t *p, struct vec4 *out)
+{
+	const uint16_t *p16 = (const uint16_t *)p;
+	const float *p32 = (const float *)p;
+
+	switch (format) {
+	case GS_A8:
+		vec4_set(out, 0.0f, 0.0f, 0.0f, gs_u8_to_float(p[0]));
+		break;
+	case GS_R8:
+		vec4_set(out, gs_u8_to_float(p[0]), 0.0f, 0.0f, 1.0f);
+		break;
+	case GS_R8G8:
+		vec4_set(out, gs_u8_to_float(p[0]), gs_u8_to_float(p[1]), 0.0f,
+			 1.0f);
+		break;
+	case GS_RGBA:
+	case GS_RGBA_UNORM:
+		gs_u8x4_to_float4(out->ptr, p);
+		break;
+	case GS_BGRX:
+	case GS_BGRX_UNORM:
+		vec4_set(out, gs_u8_to_float(p[2]), gs_u8_to_float(p[1]),
+			 gs_u8_to_float(p[0]), 1.0f);
+		break;
+	case GS_BGRA:
+	case GS_BGRA_UNORM:
+		vec4_set(out, gs_u8_to_float(p[2]), gs_u8_to_float(p[1]),
+			 gs_u8_to_float(p[0]), gs_u8_to_float(p[3]));
+		break;
+	case GS_R10G10B10A2: {
+		uint32_t v;
+		memcpy(&v, p, sizeof(v));
+		vec4_set(out, (float)(v & 0x3FF) / 1023.0f,
+			 (float)((v >> 10) & 0x3FF) / 1023.0f,
+			 (float)((v >> 20) & 0x3FF) / 1023.0f,
+			 (float)(v >> 30) / 3.0f);
+		break;
+	}
+	case GS_RGBA16:
+		vec4_set(out, (float)p16[0] / 65535.0f,
+			 (float)p16[1] / 65535.0f, (float)p16[2] / 65535.0f,
+			 (float)p16[3] / 65535.0f);
+		break;
+	case GS_R16:
+		vec4_set(out, (float)p16[0] / 65535.0f, 0.0f, 0.0f, 1.0f);
+		break;
+	case GS_RG16:
+		vec4_set(out, (float)p16[0] / 65535.0f,
+			 (float)p16[1] / 65535.0f, 0.0f, 1.0f);
+		break;
+	case GS_RGBA16F:
+		vec4_set(out, half_to_float(p16[0]), half_to_float(p16[1]),
+			 half_to_float(p16[2]), half_to_float(p16[3]));
+		break;
+	case GS_RG16F:
+		vec4_set(out, half_to_float(p16[0]), half_to_float(p16[1]),
+			 0.0f, 1.0f);
+		break;
+	case GS_R16F:
+		vec4_set(out, half_to_float(p16[0]), 0.0f, 0.0f, 1.0f);
+		break;
+	case GS_RGBA32F:
+		vec4_set(out, p32[0], p32[1], p32[2], p32[3]);
+		break;
+	case GS_RG32F:
+		vec4_set(out, p32[0], p32[1], 0.0f, 1.0f);
+		break;
+	case GS_R32F:
+		vec4_set(out, p32[0], 0.0f, 0.0f, 1.0f);
+		break;
+	default:
+		vec4_zero(out);
+	}
+}
+
+static inline void encode_texel(enum gs_color_format format, uint8_t *p,
+				const struct vec4 *c)
+{
+	uint16_t *p16 = (uint16_t *)p;
+	float *p32 = (float *)p;
+
+	switch (format) {
+	case GS_A8:
+		p[0] = float_to_u8(c->w);
+		break;
+	case GS_R8:
+		p[0] = float_to_u8(c->x);
+		break;
+	case GS_R8G8:
+		p[0] = float_to_u8(c->x);
+		p[1] = float_to_u8(c->y);
+		break;
+	case GS_RGBA:
+	case GS_RGBA_UNORM:
+		p[0] = float_to_u8(c->x);
+		p[1] = float_to_u8(c->y);
+		p[2] = float_to_u8(c->z);
+		p[3] = float_to_u8(c->w);
+		break;
+	case GS_BGRX:
+	case GS_BGRX_UNORM:
+		p[0] = float_to_u8(c->z);
+		p[1] = float_to_u8(c->y);
+		p[2] = float_to_u8(c->x);
+		p[3] = 255;
+		break;
+	case GS_BGRA:
+	case GS_BGRA_UNORM:
+		p[0] = float_to_u8(c->z);
+		p[1] = float_to_u8(c->y);
+		p[2] = float_to_u8(c->x);
+		p[3] = float_to_u8(c->w);
+		break;
+	case GS_R10G10B10A2: {
+		uint32_t v = (uint32_t)(saturate(c->x) * 1023.0f + 0.5f) |
+			     ((uint32_t)(saturate(c->y) * 1023.0f + 0.5f)
+			      << 10) |
+			     ((uint32_t)(saturate(c->z) * 1023.0f + 0.5f)
+			      << 20) |
+			     ((uint32_t)(saturate(c->w) * 3.0f + 0.5f) << 30);
+		memcpy(p, &v, sizeof(v));
+		break;
+	}
+	case GS_RGBA16:
+		p16[0] = float_to_u16(c->x);
+		p16[1] = float_to_u16(c->y);
+		p16[2] = float_to_u16(c->z);
+		p16[3] = float_to_u16(c->w);
+		break;
+	case GS_R16:
+		p16[0] = float_to_u16(c->x);
+		break;
+	case GS_RG16:
+		p16[0] = float_to_u16(c->x);
+		p16[1] = float_to_u16(c->y);
+		break;
+	case GS_RGBA16F:
+		p16[0] = half_from_float(c->x).u;
+		p16[1] = half_from_float(c->y).u;
+		p16[2] = half_from_float(c->z).u;
+		p16[3] = half_from_float(c->w).u;
+		break;
+	case GS_RG16F:
+		p16[0] = half_from_float(c->x).u;
+		p16[1] = half_from_float(c->y).u;
+		break;
+	case GS_R16F:
+		p16[0] = half_from_float(c->x).u;
+		break;
+	case GS_RGBA32F:
+		memcpy(p32, c->ptr, sizeof(float) * 4);
+		break;
+	case GS_RG32F:
+		memcpy(p32, c->ptr, sizeof(float) * 2);
+		break;
+	case GS_R32F:
+		p32[0] = c->x;
+		break;
+	default:
+		break;
+	}
+}
+
+static inline uint8_t *texel_ptr(const struct gs_texture_2d *tex, uint32_t x,
+				 uint32_t y)
+{
+	return tex->data + (size_t)y * tex->linesize +
+	       (size_t)x * tex->texel_size;
+}
+
+void sw_texture_load(const struct gs_texture_2d *tex, uint32_t x, uint32_t y,
+		     bool srgb, struct vec4 *out)
+{
+	decode_texel(tex->base.format, texel_ptr(tex, x, y), out);
+	if (srgb)
+		gs_float3_srgb_nonlinear_to_linear(out->ptr);
+}
+
+void sw_texture_store(struct gs_texture_2d *tex, uint32_t x, uint32_t y,
+		      bool srgb, const struct vec4 *in)
+{
+	struct vec4 c = *in;
+	if (srgb)
+		gs_float3_srgb_linear_to_nonlinear(c.ptr);
+	encode_texel(tex->base.format, texel_ptr(tex, x, y), &c);
+}
+
+void sw_texture_fill(struct gs_texture_2d *tex, const struct vec4 *color)
+{
+	uint32_t bpp = tex->texel_size;
+	uint8_t texel[16];
+
+	encode_texel(tex->base.format, texel, color);
+
+	for (uint32_t x = 0; x < tex->width; x++)
+		memcpy(tex->data + (size_t)x * bpp, texel, bpp);
+	for (uint32_t y = 1; y < tex->height; y++)
+		memcpy(tex->data + (size_t)y * tex->linesize, tex->data,
+		       (size_t)tex->width * bpp);
+}
+
+/* ------------------------------------------------------------------------- */
+/* sampling */
+
+static inline int address(enum gs_address_mode mode, int i, int size,
+			  bool *border)
+{
+	switch (mode) {
+	case GS_ADDRESS_WRAP:
+		i %= size;
+		return i < 0 ? i + size : i;
+	case GS_ADDRESS_MIRROR:
+	case GS_ADDRESS_MIRRORONCE: {
+		int period = size * 2;
+		i %= period;
+		if (i < 0)
+			i += period;
+		return i < size ? i : period - 1 - i;
+	}
+	case GS_ADDRESS_BORDER:
+		if (i < 0 || i >= size) {
+			*border = true;
+			return 0;
+		}
+		return i;
+	case GS_ADDRESS_CLAMP:
+	default:
+		return i < 0 ? 0 : (i >= size ? size - 1 : i);
+	}
+}
+
+static inline void fetch(const struct gs_texture_2d *tex,
+			 const gs_samplerstate_t *ss, bool srgb, int x, int y,
+			 struct vec4 *out)
+{
+	bool border = false;
+	x = address(ss->address_u, x, (int)tex->width, &border);
+	y = address(ss->address_v, y, (int)tex->height, &border);
+
+	if (border)
+		*out = ss->border_color;
+	else
+		sw_texture_load(tex, (uint32_t)x, (uint32_t)y, srgb, out);
+}
+
+/* only magnification matters, there are no mip levels */
+static inline bool is_point_filter(enum gs_sample_filter filter)
+{
+	return filter == GS_FILTER_POINT ||
+	       filter == GS_FILTER_MIN_MAG_POINT_MIP_LINEAR ||
+	       filter == GS_FILTER_MIN_LINEAR_MAG_MIP_POINT ||
+	       filter == GS_FILTER_MIN_LINEAR_MAG_POINT_MIP_LINEAR;
+}
+
+static inline void lerp(struct vec4 *dst, const struct vec4 *a,
+			const struct vec4 *b, float t)
+{
+	for (int i = 0; i < 4; i++)
+		dst->ptr[i] = a->ptr[i] + (b->ptr[i] - a->ptr[i]) * t;
+}
+
+static void sample(const struct gs_texture_2d *tex,
+		   const gs_samplerstate_t *ss, bool srgb, float u, float v,
+		   struct vec4 *out)
+{
+	if (!tex) {
+		vec4_zero(out);
+		return;
+	}
+
+	float fx = u * (float)tex->width;
+	float fy = v * (float)tex->height;
+
+	if (is_point_filter(ss->filter)) {
+		fetch(tex, ss, srgb, (int)floorf(fx), (int)floorf(fy), out);
+		return;
+	}
+
+	fx -= 0.5f;
+	fy -= 0.5f;
+
+	float x0f = floorf(fx);
+	float y0f = floorf(fy);
+	float tx = fx - x0f;
+	float ty = fy - y0f;
+	int x0 = (int)x0f;
+	int y0 = (int)y0f;
+	struct vec4 c00, c10, c01, c11, top, bottom;
+
+	if (x0 >= 0 && y0 >= 0 && x0 + 1 < (int)tex->width &&
+	    y0 + 1 < (int)tex->height) {
+		/* interior footprint, addressing can't change anything */
+		const uint8_t *p0 = texel_ptr(tex, x0, y0);
+		const uint8_t *p1 = p0 + tex->linesize;
+		enum gs_color_format format = tex->base.format;
+
+		decode_texel(format, p0, &c00);
+		decode_texel(format, p0 + tex->texel_size, &c10);
+		decode_texel(format, p1, &c01);
+		decode_texel(format, p1 + tex->texel_size, &c11);
+		if (srgb) {
+			gs_float3_srgb_nonlinear_to_linear(c00.ptr);
+			gs_float3_srgb_nonlinear_to_linear(c10.ptr);
+			gs_float3_srgb_nonlinear_to_linear(c01.ptr);
+			gs_float3_srgb_nonlinear_to_linear(c11.ptr);
+		}
+	} else {
+		fetch(tex, ss, srgb, x0, y0, &c00);
+		fetch(tex, ss, srgb, x0 + 1, y0, &c10);
+		fetch(tex, ss, srgb, x0, y0 + 1, &c01);
+		fetch(tex, ss, srgb, x0 + 1, y0 + 1, &c11);
+	}
+
+	lerp(&top, &c00, &c10, tx);
+	lerp(&bottom, &c01, &c11, tx);
+	lerp(out, &top, &bottom, ty);
+}
+
+void sw_texture_sample(const struct gs_texture_2d *tex,
+		       const gs_samplerstate_t *ss, bool srgb, float u, float v,
+		       struct vec4 *out)
+{
+	sample(tex, ss, srgb, u, v, out);
+}
+
+/* ------------------------------------------------------------------------- */
+/* draw state, gathered once per draw so the pixel loop never looks anything
+ * up by name */
+
+struct sw_tri {
+	int64_t x[3];
+	int64_t y[3];
+	int64_t area;
+	bool tie[3];
+	float inv_w[3];
+	struct vec4 attribs[3][SW_MAX_ATTRIBS]; /* divided by w */
+	int min_x, max_x, min_y, max_y;
+
+	/* batch sprites: uv bounds and linear premultiplied color, the same
+	 * on every vertex of a sprite */
+	struct vec4 flat_bounds;
+	struct vec4 flat_color;
+};
+
+struct sw_draw {
+	gs_device_t *device;
+	struct gs_texture_2d *rt;
+	bool rt_srgb;
+
+	struct sw_tri *tris;
+	size_t num_tris;
+
+	int clip_x0, clip_y0, clip_x1, clip_y1;
+	size_t num_tiles;
+
+	/* attributes the pixel program reads, interpolated per pixel */
+	int attribs[SW_MAX_ATTRIBS];
+	size_t num_attribs;
+
+	/* passes without a native kernel run their interpreted program */
+	bool interpreted;
+	bool derivatives;
+	struct sw_binding ps;
+
+	struct sw_pixel_program program;
+	struct gs_texture_2d *image;
+	gs_samplerstate_t *sampler;
+	bool image_srgb;
+	struct gs_texture_2d *planes[2]; /* image1 and image2 */
+	bool planes_srgb[2];
+	struct vec4 uv_bounds;
+	float multiplier;
+	struct vec4 color;
+	struct vec4 color_vec[3];
+	struct vec4 color_range_min;
+	struct vec4 color_range_max;
+	struct matrix4 color_matrix;
+	struct vec4 color_offset;
+
+	struct sw_blend_state blend;
+	bool write_mask[4];
+	bool full_mask;
+};
+
+static inline void apply_flags(const struct sw_draw *draw, struct vec4 *c)
+{
+	uint32_t flags = draw->program.flags;
+
+	if (flags & SW_PS_UNPREMULTIPLY) {
+		if (c->w > 0.0f) {
+			c->x /= c->w;
+			c->y /= c->w;
+			c->z /= c->w;
+		}
+		c->x = saturate(c->x);
+		c->y = saturate(c->y);
+		c->z = saturate(c->z);
+		c->w = saturate(c->w);
+	}
+	if (flags & SW_PS_SRGB_DECOMPRESS)
+		gs_float3_srgb_nonlinear_to_linear(c->ptr);
+	if (flags & SW_PS_NONLINEAR_ALPHA) {
+		gs_float3_srgb_linear_to_nonlinear(c->ptr);
+		c->x *= c->w;
+		c->y *= c->w;
+		c->z *= c->w;
+		gs_float3_srgb_nonlinear_to_linear(c->ptr);
+	}
+	if (flags & SW_PS_ALPHA_DIVIDE) {
+		float scale = c->w > 0.0f ? 1.0f / c->w : 0.0f;
+		c->x *= scale;
+		c->y *= scale;
+		c->z *= scale;
+	}
+	if (flags & SW_PS_MULTIPLY) {
+		c->x *= draw->multiplier;
+		c->y *= draw->multiplier;
+		c->z *= draw->multiplier;
+	}
+	if (flags & SW_PS_COLOR_MATRIX) {
+		vec4_transform(c, c, &draw->color_matrix);
+		vec4_add(c, c, &draw->color_offset);
+		c->x = saturate(c->x);
+		c->y = saturate(c->y);
+		c->z = saturate(c->z);
+		c->w = saturate(c->w);
+	}
+	if (flags & SW_PS_OPAQUE)
+		c->w = 1.0f;
+}
+
+static inline float dot_vec(const struct vec4 *v, const struct vec4 *rgb)
+{
+	return v->x * rgb->x + v->y * rgb->y + v->z * rgb->z + v->w;
+}
+
+/* Load() as the reverse conversions use it, zero outside the texture */
+static inline void load_texel(const struct gs_texture_2d *tex, bool srgb,
+			      int64_t x, int64_t y, struct vec4 *out)
+{
+	if (!tex || x < 0 || y < 0 || x >= tex->width || y >= tex->height) {
+		vec4_zero(out);
+		return;
+	}
+
+	sw_texture_load(tex, (uint32_t)x, (uint32_t)y, srgb, out);
+}
+
+/* YUV_to_RGB() in format_conversion.effect */
+static inline void yuv_to_rgb(const struct sw_draw *draw, float y, float cb,
+			      float cr, struct vec4 *out)
+{
+	const struct vec4 *lo = &draw->color_range_min;
+	const struct vec4 *hi = &draw->color_range_max;
+	struct vec4 yuv;
+
+	vec4_set(&yuv, fminf(fmaxf(y, lo->x), hi->x),
+		 fminf(fmaxf(cb, lo->y), hi->y), fminf(fmaxf(cr, lo->z), hi->z),
+		 0.0f);
+	vec4_set(out, dot_vec(&draw->color_vec[0], &yuv),
+		 dot_vec(&draw->color_vec[1], &yuv),
+		 dot_vec(&draw->color_vec[2], &yuv), 1.0f);
+}
+
+/* packed 4:2:2 texels hold two pixels, uv is (texel x, texel y, chroma uv) */
+static inline void run_packed422(const struct sw_draw *draw,
+				 const struct vec4 *uv, struct vec4 *out)
+{
+	struct vec4 y01, cbcr;
+	bool left = uv->x - floorf(uv->x) < 0.5f;
+
+	load_texel(draw->image, draw->image_srgb, (int64_t)uv->x,
+		   (int64_t)uv->y, &y01);
+	sample(draw->image, draw->sampler, draw->image_srgb, uv->z, uv->w,
+	       &cbcr);
+
+	switch (draw->program.source) {
+	case SW_PS_UYVY_REVERSE:
+		yuv_to_rgb(draw, left ? y01.y : y01.w, cbcr.z, cbcr.x, out);
+		break;
+	case SW_PS_YVYU_REVERSE:
+		yuv_to_rgb(draw, left ? y01.z : y01.x, cbcr.w, cbcr.y, out);
+		break;
+	default:
+		yuv_to_rgb(draw, left ? y01.z : y01.x, cbcr.y, cbcr.w, out);
+		break;
+	}
+}
+
+static inline void run_pixel(const struct sw_draw *draw, int x, int y,
+			     const struct vec4 *uv, const struct vec4 *vcolor,
+			     struct vec4 *out)
+{
+	struct vec4 rgb, left, right;
+
+	switch (draw->program.source) {
+	case SW_PS_SAMPLE_BATCH:
+		sample(draw->image, draw->sampler, draw->image_srgb, uv->x,
+		       uv->y, out);
+		vec4_mul(out, out, vcolor);
+		apply_flags(draw, out);
+		break;
+	case SW_PS_SAMPLE:
+		sample(draw->image, draw->sampler, draw->image_srgb,
+		       clampf(uv->x, draw->uv_bounds.x, draw->uv_bounds.z),
+		       clampf(uv->y, draw->uv_bounds.y, draw->uv_bounds.w),
+		       out);
+		apply_flags(draw, out);
+		break;
+	case SW_PS_COLOR:
+		*out = draw->color;
+		break;
+	case SW_PS_VERT_COLOR:
+		vec4_mul(out, vcolor, &draw->color);
+		break;
+	case SW_PS_PLANE_Y:
+	case SW_PS_PLANE_U:
+	case SW_PS_PLANE_V: {
+		const struct vec4 *cv =
+			&draw->color_vec[draw->program.source - SW_PS_PLANE_Y];
+		if (draw->image && (uint32_t)x < draw->image->width &&
+		    (uint32_t)y < draw->image->height)
+			sw_texture_load(draw->image, x, y, draw->image_srgb,
+					&rgb);
+		else
+			vec4_zero(&rgb);
+		vec4_set(out, dot_vec(cv, &rgb), 0.0f, 0.0f, 1.0f);
+		break;
+	}
+	case SW_PS_WIDE_U:
+	case SW_PS_WIDE_V:
+	case SW_PS_WIDE_UV:
+		sample(draw->image, draw->sampler, draw->image_srgb, uv->x,
+		       uv->z, &left);
+		sample(draw->image, draw->sampler, draw->image_srgb, uv->y,
+		       uv->z, &right);
+		vec4_add(&rgb, &left, &right);
+		vec4_mulf(&rgb, &rgb, 0.5f);
+
+		if (draw->program.source == SW_PS_WIDE_UV)
+			vec4_set(out, dot_vec(&draw->color_vec[1], &rgb),
+				 dot_vec(&draw->color_vec[2], &rgb), 0.0f,
+				 1.0f);
+		else if (draw->program.source == SW_PS_WIDE_U)
+			vec4_set(out, dot_vec(&draw->color_vec[1], &rgb), 0.0f,
+				 0.0f, 1.0f);
+		else
+			vec4_set(out, dot_vec(&draw->color_vec[2], &rgb), 0.0f,
+				 0.0f, 1.0f);
+		break;
+	case SW_PS_NV12_REVERSE:
+		load_texel(draw->image, draw->image_srgb, x, y, &rgb);
+		sample(draw->planes[0], draw->sampler, draw->planes_srgb[0],
+		       uv->x, uv->y, &left);
+		yuv_to_rgb(draw, rgb.x, left.x, left.y, out);
+		break;
+	case SW_PS_I420_REVERSE:
+		load_texel(draw->image, draw->image_srgb, x, y, &rgb);
+		sample(draw->planes[0], draw->sampler, draw->planes_srgb[0],
+		       uv->x, uv->y, &left);
+		sample(draw->planes[1], draw->sampler, draw->planes_srgb[1],
+		       uv->x, uv->y, &right);
+		yuv_to_rgb(draw, rgb.x, left.x, right.x, out);
+		break;
+	case SW_PS_I444_REVERSE:
+		load_texel(draw->image, draw->image_srgb, x, y, &rgb);
+		load_texel(draw->planes[0], draw->planes_srgb[0], x, y, &left);
+		load_texel(draw->planes[1], draw->planes_srgb[1], x, y, &right);
+		yuv_to_rgb(draw, rgb.x, left.x, right.x, out);
+		break;
+	case SW_PS_UYVY_REVERSE:
+	case SW_PS_YUY2_REVERSE:
+	case SW_PS_YVYU_REVERSE:
+		run_packed422(draw, uv, out);
+		break;
+	}
+}
+
+static inline float blend_factor(enum gs_blend_type type, float src_c,
+				 float src_a, float dst_c, float dst_a,
+				 bool alpha)
+{
+	switch (type) {
+	case GS_BLEND_ZERO:
+		return 0.0f;
+	case GS_BLEND_ONE:
+		return 1.0f;
+	case GS_BLEND_SRCCOLOR:
+		return src_c;
+	case GS_BLEND_INVSRCCOLOR:
+		return 1.0f - src_c;
+	case GS_BLEND_SRCALPHA:
+		return src_a;
+	case GS_BLEND_INVSRCALPHA:
+		return 1.0f - src_a;
+	case GS_BLEND_DSTCOLOR:
+		return dst_c;
+	case GS_BLEND_INVDSTCOLOR:
+		return 1.0f - dst_c;
+	case GS_BLEND_DSTALPHA:
+		return dst_a;
+	case GS_BLEND_INVDSTALPHA:
+		return 1.0f - dst_a;
+	case GS_BLEND_SRCALPHASAT:
+		if (alpha)
+			return 1.0f;
+		return src_a < 1.0f - dst_a ? src_a : 1.0f - dst_a;
+	}
+
+	return 1.0f;
+}
+
+static inline float blend_op(enum gs_blend_op_type op, float s, float d)
+{
+	switch (op) {
+	case GS_BLEND_OP_SUBTRACT:
+		return s - d;
+	case GS_BLEND_OP_REVERSE_SUBTRACT:
+		return d - s;
+	case GS_BLEND_OP_MIN:
+		return s < d ? s : d;
+	case GS_BLEND_OP_MAX:
+		return s > d ? s : d;
+	case GS_BLEND_OP_ADD:
+	default:
+		return s + d;
+	}
+}
+
+static inline void write_pixel(const struct sw_draw *draw, int x, int y,
+			       const struct vec4 *src)
+{
+	const struct sw_blend_state *b = &draw->blend;
+	struct vec4 dst, out;
+
+	if (!b->enabled && draw->full_mask) {
+		sw_texture_store(draw->rt, x, y, draw->rt_srgb, src);
+		return;
+	}
+
+	sw_texture_load(draw->rt, x, y, draw->rt_srgb, &dst);
+
+	if (b->enabled) {
+		for (int i = 0; i < 3; i++) {
+			float s = blend_factor(b->src_c, src->ptr[i], src->w,
+					       dst.ptr[i], dst.w, false);
+			float d = blend_factor(b->dest_c, src->ptr[i], src->w,
+					       dst.ptr[i], dst.w, false);
+			out.ptr[i] = blend_op(b->op, src->ptr[i] * s,
+					      dst.ptr[i] * d);
+		}
+
+		float sa = blend_factor(b->src_a, src->w, src->w, dst.w, dst.w,
+					true);
+		float da = blend_factor(b->dest_a, src->w, src->w, dst.w,
+					dst.w, true);
+		out.w = blend_op(b->op, src->w * sa, dst.w * da);
+	} else {
+		out = *src;
+	}
+
+	for (int i = 0; i < 4; i++) {
+		if (!draw->write_mask[i])
+			out.ptr[i] = dst.ptr[i];
+	}
+
+	sw_texture_store(draw->rt, x, y, draw->rt_srgb, &out);
+}
+
+/* ------------------------------------------------------------------------- */
+/* triangle setup and tiles */
+
+static inline int64_t edge(int64_t ax, int64_t ay, int64_t bx, int64_t by,
+			   int64_t px, int64_t py)
+{
+	return (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+}
+
+/* both triangles sharing an edge walk it in opposite directions once they
+ * are wound the same way, so this picks exactly one owner for pixels that
+ * sit right on the edge */
+static inline bool owns_edge(int64_t ax, int64_t ay, int64_t bx, int64_t by)
+{
+	int64_t dx = bx - ax;
+	int64_t dy = by - ay;
+	return dy > 0 || (dy == 0 && dx > 0);
+}
+
+static inline int floor_div(int64_t v)
+{
+	return (int)(v >= 0 ? v / SUBPIXEL_ONE
+			    : -((-v + SUBPIXEL_ONE - 1) / SUBPIXEL_ONE));
+}
+
+static bool setup_tri(struct sw_tri *tri, const struct sw_draw *draw,
+		      const struct sw_vertex *v, enum gs_cull_mode cull)
+{
+	const struct gs_rect *vp = &draw->device->cur_viewport;
+	float sx[3], sy[3];
+
+	for (int i = 0; i < 3; i++) {
+		const struct vec4 *p = &v[i].pos;
+		if (p->w <= 0.0f)
+			return false;
+
+		float inv_w = 1.0f / p->w;
+		sx[i] = (p->x * inv_w + 1.0f) * 0.5f * (float)vp->cx +
+			(float)vp->x;
+		sy[i] = (1.0f - p->y * inv_w) * 0.5f * (float)vp->cy +
+			(float)vp->y;
+
+		if (fabsf(sx[i]) > MAX_SCREEN_COORD ||
+		    fabsf(sy[i]) > MAX_SCREEN_COORD)
+			return false;
+
+		tri->x[i] = (int64_t)llroundf(sx[i] * SUBPIXEL_ONE);
+		tri->y[i] = (int64_t)llroundf(sy[i] * SUBPIXEL_ONE);
+		tri->inv_w[i] = inv_w;
+		for (size_t k = 0; k < draw->num_attribs; k++) {
+			int a = draw->attribs[k];
+			vec4_mulf(&tri->attribs[i][a], &v[i].attribs[a], inv_w);
+		}
+	}
+
+	tri->area = edge(tri->x[0], tri->y[0], tri->x[1], tri->y[1], tri->x[2],
+			 tri->y[2]);
+	if (!tri->area)
+		return false;
+
+	if (!draw->interpreted &&
+	    draw->program.source == SW_PS_SAMPLE_BATCH) {
+		tri->flat_bounds = v[0].attribs[SW_ATTRIB_TEXCOORD1];
+		tri->flat_color = v[0].attribs[SW_ATTRIB_COLOR];
+		gs_float3_srgb_nonlinear_to_linear(tri->flat_color.ptr);
+		gs_premultiply_float4(tri->flat_color.ptr);
+	}
+
+	/* same winding as the GL device uses when drawing into a texture:
+	 * negative area is the front face */
+	if ((cull == GS_BACK && tri->area > 0) ||
+	    (cull == GS_FRONT && tri->area < 0))
+		return false;
+
+	if (tri->area < 0) {
+		int64_t tx = tri->x[1], ty = tri->y[1];
+		float tw = tri->inv_w[1];
+		struct vec4 ta[SW_MAX_ATTRIBS];
+
+		memcpy(ta, tri->attribs[1], sizeof(ta));
+		memcpy(tri->attribs[1], tri->attribs[2], sizeof(ta));
+		memcpy(tri->attribs[2], ta, sizeof(ta));
+
+		tri->x[1] = tri->x[2];
+		tri->y[1] = tri->y[2];
+		tri->inv_w[1] = tri->inv_w[2];
+		tri->x[2] = tx;
+		tri->y[2] = ty;
+		tri->inv_w[2] = tw;
+		tri->area = -tri->area;
+	}
+
+	for (int i = 0; i < 3; i++) {
+		int j = (i + 1) % 3;
+		tri->tie[i] = owns_edge(tri->x[i], tri->y[i], tri->x[j],
+					tri->y[j]);
+	}
+
+	int64_t min_x = tri->x[0], max_x = tri->x[0];
+	int64_t min_y = tri->y[0], max_y = tri->y[0];
+	for (int i = 1; i < 3; i++) {
+		if (tri->x[i] < min_x)
+			min_x = tri->x[i];
+		if (tri->x[i] > max_x)
+			max_x = tri->x[i];
+		if (tri->y[i] < min_y)
+			min_y = tri->y[i];
+		if (tri->y[i] > max_y)
+			max_y = tri->y[i];
+	}
+
+	tri->min_x = floor_div(min_x);
+	tri->max_x = floor_div(max_x);
+	tri->min_y = floor_div(min_y);
+	tri->max_y = floor_div(max_y);
+
+	if (tri->min_x < draw->clip_x0)
+		tri->min_x = draw->clip_x0;
+	if (tri->min_y < draw->clip_y0)
+		tri->min_y = draw->clip_y0;
+	if (tri->max_x >= draw->clip_x1)
+		tri->max_x = draw->clip_x1 - 1;
+	if (tri->max_y >= draw->clip_y1)
+		tri->max_y = draw->clip_y1 - 1;
+
+	return tri->min_x <= tri->max_x && tri->min_y <= tri->max_y;
+}
+
+static inline int64_t floor_div64(int64_t a, int64_t b)
+{
+	int64_t q = a / b;
+	return (a % b != 0 && a < 0) ? q - 1 : q;
+}
+
+/* narrows [*first, *last] (pixel steps from the row start) to where one
+ * edge function, e + k * step, is inside */
+static inline void clip_span(int64_t e, int64_t step, bool tie, int64_t *first,
+			     int64_t *last)
+{
+	if (step > 0) {
+		/* smallest k with e + k * step >= 0 (or > 0) */
+		int64_t k = tie ? floor_div64(-e + step - 1, step)
+				: floor_div64(-e, step) + 1;
+		if (k > *first)
+			*first = k;
+	} else if (step < 0) {
+		/* largest k with e + k * step >= 0 (or > 0) */
+		int64_t k = tie ? floor_div64(e, -step)
+				: floor_div64(e - 1, -step);
+		if (k < *last)
+			*last = k;
+	} else if (e < 0 || (e == 0 && !tie)) {
+		*last = *first - 1;
+	}
+}
+
+static inline void interpolate(const struct sw_draw *draw,
+			       const struct sw_tri *tri, bool affine, float w0,
+			       float w1, float w2, struct vec4 *attribs)
+{
+	float w = affine ? 1.0f / tri->inv_w[0]
+			 : 1.0f / (w0 * tri->inv_w[0] + w1 * tri->inv_w[1] +
+				   w2 * tri->inv_w[2]);
+
+	for (size_t k = 0; k < draw->num_attribs; k++) {
+		int a = draw->attribs[k];
+		for (int c = 0; c < 4; c++) {
+			attribs[a].ptr[c] = (w0 * tri->attribs[0][a].ptr[c] +
+					     w1 * tri->attribs[1][a].ptr[c] +
+					     w2 * tri->attribs[2][a].ptr[c]) *
+					    w;
+		}
+	}
+}
+
+static void raster_tri_rows(const struct sw_draw *draw,
+			    const struct sw_tri *tri, int y0, int y1,
+			    struct sw_exec *exec)
+{
+	const int64_t half = SUBPIXEL_ONE / 2;
+	const float inv_area = 1.0f / (float)tri->area;
+	const bool affine = tri->inv_w[0] == tri->inv_w[1] &&
+			    tri->inv_w[1] == tri->inv_w[2];
+
+	/* edge i runs from vertex i to vertex i + 1, and its value weights
+	 * the vertex opposite to it */
+	int64_t step_x[3], step_y[3];
+	for (int i = 0; i < 3; i++) {
+		int j = (i + 1) % 3;
+		step_x[i] = -(tri->y[j] - tri->y[i]) * SUBPIXEL_ONE;
+		step_y[i] = (tri->x[j] - tri->x[i]) * SUBPIXEL_ONE;
+	}
+
+	/* barycentric weights only change by a constant per pixel, so the
+	 * span is walked incrementally instead of re-evaluating edges */
+	const float dw0 = (float)step_x[1] * inv_area;
+	const float dw1 = (float)step_x[2] * inv_area;
+	const float dw2 = (float)step_x[0] * inv_area;
+	const float dyw0 = (float)step_y[1] * inv_area;
+	const float dyw1 = (float)step_y[2] * inv_area;
+	const float dyw2 = (float)step_y[0] * inv_area;
+
+	for (int y = y0; y <= y1; y++) {
+		int64_t py = (int64_t)y * SUBPIXEL_ONE + half;
+		int64_t px = (int64_t)tri->min_x * SUBPIXEL_ONE + half;
+		int64_t first = 0;
+		int64_t last = tri->max_x - tri->min_x;
+		int64_t e[3];
+
+		for (int i = 0; i < 3; i++) {
+			int j = (i + 1) % 3;
+			e[i] = edge(tri->x[i], tri->y[i], tri->x[j], tri->y[j],
+				    px, py);
+			clip_span(e[i], step_x[i], tri->tie[i], &first, &last);
+		}
+
+		if (first > last)
+			continue;
+
+		float w0 = (float)(e[1] + first * step_x[1]) * inv_area;
+		float w1 = (float)(e[2] + first * step_x[2]) * inv_area;
+		float w2 = (float)(e[0] + first * step_x[0]) * inv_area;
+		int x_end = tri->min_x + (int)last;
+
+		for (int x = tri->min_x + (int)first; x <= x_end; x++) {
+			struct vec4 attribs[SW_MAX_ATTRIBS];
+			struct vec4 out;
+			bool write = true;
+
+			interpolate(draw, tri, affine, w0, w1, w2, attribs);
+
+			if (draw->interpreted) {
+				struct vec4 attribs_dx[SW_MAX_ATTRIBS];
+				struct vec4 attribs_dy[SW_MAX_ATTRIBS];
+				struct sw_frag frag = {x, y, attribs, NULL,
+						       NULL};
+
+				/* neighbours for ddx()/ddy(), even where they
+				 * fall outside the triangle, as on a GPU */
+				if (draw->derivatives) {
+					interpolate(draw, tri, affine, w0 + dw0,
+						    w1 + dw1, w2 + dw2,
+						    attribs_dx);
+					interpolate(draw, tri, affine, w0 + dyw0,
+						    w1 + dyw1, w2 + dyw2,
+						    attribs_dy);
+					frag.attribs_dx = attribs_dx;
+					frag.attribs_dy = attribs_dy;
+				}
+
+				write = sw_program_run_pixel(exec, &frag, &out);
+			} else {
+				struct vec4 *uv = &attribs[SW_ATTRIB_TEXCOORD0];
+				struct vec4 *color = &attribs[SW_ATTRIB_COLOR];
+
+				if (draw->program.source ==
+				    SW_PS_SAMPLE_BATCH) {
+					const struct vec4 *b =
+						&tri->flat_bounds;
+					uv->x = clampf(uv->x, b->x, b->z);
+					uv->y = clampf(uv->y, b->y, b->w);
+					*color = tri->flat_color;
+				}
+
+				run_pixel(draw, x, y, uv, color, &out);
+			}
+
+			if (write)
+				write_pixel(draw, x, y, &out);
+
+			w0 += dw0;
+			w1 += dw1;
+			w2 += dw2;
+		}
+	}
+}
+
+static void raster_tile(void *param, size_t idx)
+{
+	const struct sw_draw *draw = param;
+	int tile_y0 = draw->clip_y0 + (int)idx * SW_TILE_ROWS;
+	int tile_y1 = tile_y0 + SW_TILE_ROWS - 1;
+	struct sw_exec exec = {0};
+
+	if (tile_y1 >= draw->clip_y1)
+		tile_y1 = draw->clip_y1 - 1;
+	if (draw->interpreted)
+		sw_exec_init(&exec, &draw->ps);
+
+	/* triangles are walked in submission order inside every tile, so
+	 * blending stays in draw order without any cross-tile sync */
+	for (size_t i = 0; i < draw->num_tris; i++) {
+		const struct sw_tri *tri = draw->tris + i;
+		int y0 = tri->min_y > tile_y0 ? tri->min_y : tile_y0;
+		int y1 = tri->max_y < tile_y1 ? tri->max_y : tile_y1;
+
+		if (y0 <= y1)
+			raster_tri_rows(draw, tri, y0, y1, &exec);
+	}
+
+	if (draw->interpreted)
+		sw_exec_free(&exec);
+}
+
+/* ------------------------------------------------------------------------- */
+
+static struct gs_texture_2d *get_image(const struct gs_shader_param *image,
+				       bool *srgb)
+{
+	struct gs_texture_2d *tex;
+
+	if (!image->texture || image->texture->type != GS_TEXTURE_2D)
+		return NULL;
+
+	tex = (struct gs_texture_2d *)image->texture;
+	*srgb = image->srgb && gs_is_srgb_format(tex->base.format);
+	return tex;
+}
+
+static void load_program_state(struct sw_draw *draw)
+{
+	gs_device_t *device = draw->device;
+	gs_shader_t *ps = device->cur_pixel_shader;
+	struct gs_shader_param *image;
+
+	if (ps->program) {
+		uint32_t used = sw_program_attribs(ps->program);
+
+		for (int a = 0; a < SW_MAX_ATTRIBS; a++) {
+			if (used & (1u << a))
+				draw->attribs[draw->num_attribs++] = a;
+		}
+
+		draw->interpreted = true;
+		draw->derivatives = sw_program_uses_derivatives(ps->program);
+		sw_binding_init(&draw->ps, ps);
+		return;
+	}
+
+	draw->attribs[draw->num_attribs++] = SW_ATTRIB_TEXCOORD0;
+	if (ps->pixel_program.source == SW_PS_VERT_COLOR)
+		draw->attribs[draw->num_attribs++] = SW_ATTRIB_COLOR;
+
+	image = sw_shader_get_image(ps, "image");
+	draw->program = ps->pixel_program;
+	draw->multiplier = 1.0f;
+	vec4_set(&draw->color, 1.0f, 1.0f, 1.0f, 1.0f);
+
+	/* effects without uv_bounds (repeat.effect) sample unclamped */
+	vec4_set(&draw->uv_bounds, -FLT_MAX, -FLT_MAX, FLT_MAX, FLT_MAX);
+
+	sw_shader_get_float(ps, "multiplier", &draw->multiplier);
+	sw_shader_get_vec4(ps, "uv_bounds", &draw->uv_bounds);
+	sw_shader_get_vec4(ps, "color", &draw->color);
+	sw_shader_get_vec4(ps, "color_vec0", &draw->color_vec[0]);
+	sw_shader_get_vec4(ps, "color_vec1", &draw->color_vec[1]);
+	sw_shader_get_vec4(ps, "color_vec2", &draw->color_vec[2]);
+
+	vec4_zero(&draw->color_range_min);
+	vec4_set(&draw->color_range_max, 1.0f, 1.0f, 1.0f, 0.0f);
+	sw_shader_get_vec4(ps, "color_range_min", &draw->color_range_min);
+	sw_shader_get_vec4(ps, "color_range_max", &draw->color_range_max);
+
+	if (draw->program.flags & SW_PS_COLOR_MATRIX) {
+		matrix4_identity(&draw->color_matrix);
+		vec4_zero(&draw->color_offset);
+		sw_shader_get_matrix4(ps, "color_matrix", &draw->color_matrix);
+		sw_shader_get_vec4(ps, "color_offset", &draw->color_offset);
+	}
+
+	draw->sampler = device->cur_samplers[0] ? device->cur_samplers[0]
+						: device->default_sampler;
+
+	if (image) {
+		if (image->next_sampler) {
+			draw->sampler = image->next_sampler;
+			image->next_sampler = NULL;
+		}
+
+		draw->image = get_image(image, &draw->image_srgb);
+	}
+
+	/* the chroma planes of the reverse conversions share def_sampler */
+	for (size_t i = 0; i < 2; i++) {
+		const char *name = i ? "image2" : "image1";
+		image = gs_shader_get_param_by_name(ps, name);
+		if (image && image->type == GS_SHADER_PARAM_TEXTURE)
+			draw->planes[i] =
+				get_image(image, &draw->planes_srgb[i]);
+	}
+}
+
+void sw_draw_triangles(gs_device_t *device, struct gs_texture_2d *rt,
+		       const struct sw_vertex *verts, size_t num_tris)
+{
+	struct sw_draw draw = {0};
+	size_t pixels = 0;
+
+	draw.device = device;
+	draw.rt = rt;
+	draw.rt_srgb = device->framebuffer_srgb &&
+		       gs_is_srgb_format(rt->base.format);
+	draw.blend = device->blend;
+	memcpy(draw.write_mask, device->write_mask, sizeof(draw.write_mask));
+	draw.full_mask = draw.write_mask[0] && draw.write_mask[1] &&
+			 draw.write_mask[2] && draw.write_mask[3];
+
+	draw.clip_x0 = device->cur_viewport.x > 0 ? device->cur_viewport.x : 0;
+	draw.clip_y0 = device->cur_viewport.y > 0 ? device->cur_viewport.y : 0;
+	draw.clip_x1 = device->cur_viewport.x + device->cur_viewport.cx;
+	draw.clip_y1 = device->cur_viewport.y + device->cur_viewport.cy;
+
+	if (device->scissor_enabled) {
+		const struct gs_rect *s = &device->cur_scissor;
+		if (s->x > draw.clip_x0)
+			draw.clip_x0 = s->x;
+		if (s->y > draw.clip_y0)
+			draw.clip_y0 = s->y;
+		if (s->x + s->cx < draw.clip_x1)
+			draw.clip_x1 = s->x + s->cx;
+		if (s->y + s->cy < draw.clip_y1)
+			draw.clip_y1 = s->y + s->cy;
+	}
+
+	if (draw.clip_x1 > (int)rt->width)
+		draw.clip_x1 = (int)rt->width;
+	if (draw.clip_y1 > (int)rt->height)
+		draw.clip_y1 = (int)rt->height;
+	if (draw.clip_x0 >= draw.clip_x1 || draw.clip_y0 >= draw.clip_y1)
+		return;
+
+	load_program_state(&draw);
+
+	draw.tris = bmalloc(sizeof(struct sw_tri) * num_tris);
+	for (size_t i = 0; i < num_tris; i++) {
+		struct sw_tri *tri = draw.tris + draw.num_tris;
+		if (setup_tri(tri, &draw, verts + i * 3,
+			      device->cur_cull_mode)) {
+			pixels += (size_t)(tri->max_x - tri->min_x + 1) *
+				  (size_t)(tri->max_y - tri->min_y + 1);
+			draw.num_tris++;
+		}
+	}
+
+	if (draw.num_tris) {
+		draw.num_tiles = (size_t)(draw.clip_y1 - draw.clip_y0 +
+					  SW_TILE_ROWS - 1) /
+				 SW_TILE_ROWS;
+
+		if (pixels >= SW_PARALLEL_MIN_PIXELS)
+			os_task_pool_run(device->raster_pool, raster_tile,
+					 &draw, draw.num_tiles);
+		else
+			for (size_t i = 0; i < draw.num_tiles; i++)
+				raster_tile(&draw, i);
+	}
+
+	if (draw.interpreted)
+		sw_binding_free(&draw.ps);
+	bfree(draw.tris);
+}
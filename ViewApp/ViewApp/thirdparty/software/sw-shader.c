@@ -0,0 +1,601 @@
+/******************************************************************************
+    Copyright (C) 2013 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <assert.h>
+
+#include <graphics/vec2.h>
+#include <graphics/vec3.h>
+#include <graphics/shader-parser.h>
+#include <graphics/matrix3.h>
+#include <util/dstr.h>
+#include "sw-subsystem.h"
+
+/*
+ * The effect parser hands every pass to the device as a standalone shader
+ * whose main() just returns a call to the pass' entry function.  Passes the
+ * compositor runs every frame (draws, solid fills, the output conversions)
+ * are matched by effect file and entry function to the native kernels below.
+ * Every other pass is compiled from its HLSL and interpreted (sw-program.c),
+ * so effects draw the same as on a GPU, only slower.
+ */
+
+struct sw_pixel_entry {
+	const char *file;
+	const char *func;
+	struct sw_pixel_program program;
+};
+
+#define PS_ENTRY(file, func, source, flags) \
+	{                                   \
+		file, func, {source, flags} \
+	}
+
+static const struct sw_pixel_entry pixel_programs[] = {
+	PS_ENTRY("default.effect", "PSDrawBare", SW_PS_SAMPLE, 0),
+	PS_ENTRY("default.effect", "PSDrawAlphaDivide", SW_PS_SAMPLE,
+		 SW_PS_ALPHA_DIVIDE),
+	PS_ENTRY("default.effect", "PSDrawNonlinearAlpha", SW_PS_SAMPLE,
+		 SW_PS_NONLINEAR_ALPHA),
+	PS_ENTRY("default.effect", "PSDrawNonlinearAlphaMultiply", SW_PS_SAMPLE,
+		 SW_PS_NONLINEAR_ALPHA | SW_PS_MULTIPLY),
+	PS_ENTRY("default.effect", "PSDrawSrgbDecompress", SW_PS_SAMPLE,
+		 SW_PS_SRGB_DECOMPRESS),
+	PS_ENTRY("default.effect", "PSDrawSrgbDecompressMultiply", SW_PS_SAMPLE,
+		 SW_PS_SRGB_DECOMPRESS | SW_PS_MULTIPLY),
+	PS_ENTRY("default.effect", "PSDrawMultiply", SW_PS_SAMPLE,
+		 SW_PS_MULTIPLY),
+	PS_ENTRY("default.effect", "PSDrawColorMatrix", SW_PS_SAMPLE,
+		 SW_PS_COLOR_MATRIX),
+	PS_ENTRY("default.effect", "PSDrawBatch", SW_PS_SAMPLE_BATCH, 0),
+	PS_ENTRY("default.effect", "PSDrawBatchMultiply", SW_PS_SAMPLE_BATCH,
+		 SW_PS_MULTIPLY),
+
+	PS_ENTRY("default_rect.effect", "PSDrawBare", SW_PS_SAMPLE, 0),
+	PS_ENTRY("default_rect.effect", "PSDrawOpaque", SW_PS_SAMPLE,
+		 SW_PS_OPAQUE),
+	PS_ENTRY("default_rect.effect", "PSDrawSrgbDecompress", SW_PS_SAMPLE,
+		 SW_PS_SRGB_DECOMPRESS),
+
+	PS_ENTRY("opaque.effect", "PSDraw", SW_PS_SAMPLE, SW_PS_OPAQUE),
+	PS_ENTRY("opaque.effect", "PSDrawSrgbDecompress", SW_PS_SAMPLE,
+		 SW_PS_OPAQUE | SW_PS_SRGB_DECOMPRESS),
+	PS_ENTRY("opaque.effect", "PSDrawSrgbDecompressMultiply", SW_PS_SAMPLE,
+		 SW_PS_OPAQUE | SW_PS_SRGB_DECOMPRESS | SW_PS_MULTIPLY),
+	PS_ENTRY("opaque.effect", "PSDrawMultiply", SW_PS_SAMPLE,
+		 SW_PS_OPAQUE | SW_PS_MULTIPLY),
+
+	PS_ENTRY("premultiplied_alpha.effect", "PSDraw", SW_PS_SAMPLE,
+		 SW_PS_UNPREMULTIPLY),
+	PS_ENTRY("repeat.effect", "PSDrawBare", SW_PS_SAMPLE, 0),
+
+	PS_ENTRY("solid.effect", "PSSolid", SW_PS_COLOR, 0),
+	PS_ENTRY("solid.effect", "PSSolidColored", SW_PS_VERT_COLOR, 0),
+
+	/* gpu conversion */
+	PS_ENTRY("format_conversion.effect", "PS_Y", SW_PS_PLANE_Y, 0),
+	PS_ENTRY("format_conversion.effect", "PS_U", SW_PS_PLANE_U, 0),
+	PS_ENTRY("format_conversion.effect", "PS_V", SW_PS_PLANE_V, 0),
+	PS_ENTRY("format_conversion.effect", "PS_U_Wide", SW_PS_WIDE_U, 0),
+	PS_ENTRY("format_conversion.effect", "PS_V_Wide", SW_PS_WIDE_V, 0),
+	PS_ENTRY("format_conversion.effect", "PS_UV_Wide", SW_PS_WIDE_UV, 0),
+	PS_ENTRY("format_conversion.effect", "PSNV12_Reverse",
+		 SW_PS_NV12_REVERSE, 0),
+	PS_ENTRY("format_conversion.effect", "PSPlanar420_Reverse",
+		 SW_PS_I420_REVERSE, 0),
+	PS_ENTRY("format_conversion.effect", "PSPlanar444_Reverse",
+		 SW_PS_I444_REVERSE, 0),
+	PS_ENTRY("format_conversion.effect", "PSUYVY_Reverse",
+		 SW_PS_UYVY_REVERSE, 0),
+	PS_ENTRY("format_conversion.effect", "PSYUY2_Reverse",
+		 SW_PS_YUY2_REVERSE, 0),
+	PS_ENTRY("format_conversion.effect", "PSYVYU_Reverse",
+		 SW_PS_YVYU_REVERSE, 0),
+};
+
+#undef PS_ENTRY
+
+struct sw_vertex_entry {
+	const char *file;
+	const char *func;
+	enum sw_vertex_program program;
+};
+
+static const struct sw_vertex_entry vertex_programs[] = {
+	{"default.effect", "VSDefault", SW_VS_TRANSFORM},
+	{"default.effect", "VSBatch", SW_VS_TRANSFORM},
+	{"default_rect.effect", "VSDefault", SW_VS_TRANSFORM},
+	{"opaque.effect", "VSDefault", SW_VS_TRANSFORM},
+	{"premultiplied_alpha.effect", "VSDefault", SW_VS_TRANSFORM},
+	{"repeat.effect", "VSDefault", SW_VS_TRANSFORM},
+	{"solid.effect", "VSSolid", SW_VS_TRANSFORM},
+	{"solid.effect", "VSSolidColored", SW_VS_TRANSFORM},
+	{"format_conversion.effect", "VSPos", SW_VS_POS_ID},
+	{"format_conversion.effect", "VSTexPos_Left", SW_VS_TEXPOS_LEFT_ID},
+	{"format_conversion.effect", "VSTexPos_TopLeft",
+	 SW_VS_TEXPOS_TOPLEFT_ID},
+	{"format_conversion.effect", "VS420Left_Reverse",
+	 SW_VS_420_LEFT_REVERSE_ID},
+	{"format_conversion.effect", "VSPacked422Left_Reverse",
+	 SW_VS_PACKED422_LEFT_REVERSE_ID},
+};
+
+/* ------------------------------------------------------------------------- */
+
+static inline void shader_param_free(struct gs_shader_param *param)
+{
+	bfree(param->name);
+	da_free(param->cur_value);
+	da_free(param->def_value);
+}
+
+/* "path/to/default.effect (Pixel shader, ...)" -> "default.effect" */
+static void get_effect_file(struct dstr *out, const char *file)
+{
+	const char *start;
+	const char *end;
+
+	if (!file)
+		return;
+
+	start = strrchr(file, '/');
+	start = start ? start + 1 : file;
+	end = strstr(start, " (");
+
+	if (end)
+		dstr_ncopy(out, start, end - start);
+	else
+		dstr_copy(out, start);
+}
+
+/* the name of the function main() returns */
+static void get_entry_func(struct dstr *out, struct shader_parser *sp)
+{
+	struct shader_func *main_func = shader_parser_getfunc(sp, "main");
+	bool found_return = false;
+
+	if (!main_func || !main_func->start)
+		return;
+
+	for (struct cf_token *token = main_func->start;
+	     token != main_func->end && token->type != CFTOKEN_NONE; token++) {
+		if (token->type != CFTOKEN_NAME)
+			continue;
+
+		if (!found_return) {
+			found_return = strref_cmp(&token->str, "return") == 0;
+		} else {
+			dstr_copy_strref(out, &token->str);
+			return;
+		}
+	}
+}
+
+static bool select_pixel_program(struct gs_shader *shader, const char *file,
+				 const char *func)
+{
+	for (size_t i = 0;
+	     i < sizeof(pixel_programs) / sizeof(pixel_programs[0]); i++) {
+		const struct sw_pixel_entry *entry = pixel_programs + i;
+
+		if (strcmp(entry->func, func) == 0 &&
+		    strcmp(entry->file, file) == 0) {
+			shader->pixel_program = entry->program;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool select_vertex_program(struct gs_shader *shader, const char *file,
+				  const char *func)
+{
+	for (size_t i = 0;
+	     i < sizeof(vertex_programs) / sizeof(vertex_programs[0]); i++) {
+		const struct sw_vertex_entry *entry = vertex_programs + i;
+
+		if (strcmp(entry->func, func) == 0 &&
+		    strcmp(entry->file, file) == 0) {
+			shader->vertex_program = entry->program;
+			shader->scale_uv =
+				strcmp(file, "repeat.effect") == 0 &&
+				gs_shader_get_param_by_name(shader, "scale");
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void add_params(struct gs_shader *shader, struct shader_parser *sp)
+{
+	for (size_t i = 0; i < sp->params.num; i++) {
+		struct shader_var *var = sp->params.array + i;
+		struct gs_shader_param param = {0};
+
+		param.array_count = var->array_count;
+		param.name = bstrdup(var->name);
+		param.shader = shader;
+		param.type = get_shader_param_type(var->type);
+
+		da_move(param.def_value, var->default_val);
+		da_copy(param.cur_value, param.def_value);
+
+		da_push_back(shader->params, &param);
+	}
+
+	shader->viewproj = gs_shader_get_param_by_name(shader, "ViewProj");
+	shader->world = gs_shader_get_param_by_name(shader, "World");
+}
+
+static void add_samplers(struct gs_shader *shader, struct shader_parser *sp)
+{
+	for (size_t i = 0; i < sp->samplers.num; i++) {
+		struct gs_sampler_info info;
+		gs_samplerstate_t *sampler;
+
+		shader_sampler_convert(sp->samplers.array + i, &info);
+		sampler = device_samplerstate_create(shader->device, &info);
+		da_push_back(shader->samplers, &sampler);
+	}
+}
+
+static struct gs_shader *shader_create(gs_device_t *device,
+				       enum gs_shader_type type,
+				       const char *shader_str, const char *file,
+				       char **error_string)
+{
+	struct gs_shader *shader = bzalloc(sizeof(struct gs_shader));
+	struct shader_parser sp;
+	struct dstr effect_file = {0};
+	struct dstr entry = {0};
+	bool native;
+	bool success;
+
+	shader->device = device;
+	shader->type = type;
+
+	shader_parser_init(&sp);
+	success = shader_parse(&sp, shader_str, file);
+	if (!success) {
+		char *errors = shader_parser_geterrors(&sp);
+		if (errors) {
+			blog(LOG_DEBUG, "Shader parser errors for %s:\n%s",
+			     file, errors);
+			if (error_string)
+				*error_string = errors;
+			else
+				bfree(errors);
+		}
+		goto cleanup;
+	}
+
+	add_params(shader, &sp);
+	add_samplers(shader, &sp);
+
+	get_effect_file(&effect_file, file);
+	get_entry_func(&entry, &sp);
+	if (!effect_file.array)
+		dstr_copy(&effect_file, "");
+	if (!entry.array)
+		dstr_copy(&entry, "");
+
+	if (type == GS_SHADER_VERTEX)
+		native = select_vertex_program(shader, effect_file.array,
+					       entry.array);
+	else
+		native = select_pixel_program(shader, effect_file.array,
+					      entry.array);
+
+	if (!native) {
+		char *errors = NULL;
+
+		shader->program = sw_program_create(type, &sp, &errors);
+		if (!shader->program) {
+			blog(LOG_WARNING,
+			     "software: can't interpret '%s' in '%s': %s",
+			     entry.array, effect_file.array,
+			     errors ? errors : "");
+			if (error_string)
+				*error_string = errors;
+			else
+				bfree(errors);
+			success = false;
+		}
+	}
+
+cleanup:
+	dstr_free(&entry);
+	dstr_free(&effect_file);
+	shader_parser_free(&sp);
+
+	if (!success) {
+		gs_shader_destroy(shader);
+		shader = NULL;
+	}
+
+	return shader;
+}
+
+gs_shader_t *device_vertexshader_create(gs_device_t *device, const char *shader,
+					const char *file, char **error_string)
+{
+	struct gs_shader *ptr;
+	ptr = shader_create(device, GS_SHADER_VERTEX, shader, file,
+			    error_string);
+	if (!ptr)
+		blog(LOG_ERROR, "device_vertexshader_create (software) failed");
+	return ptr;
+}
+
+gs_shader_t *device_pixelshader_create(gs_device_t *device, const char *shader,
+				       const char *file, char **error_string)
+{
+	struct gs_shader *ptr;
+	ptr = shader_create(device, GS_SHADER_PIXEL, shader, file,
+			    error_string);
+	if (!ptr)
+		blog(LOG_ERROR, "device_pixelshader_create (software) failed");
+	return ptr;
+}
+
+void gs_shader_destroy(gs_shader_t *shader)
+{
+	if (!shader)
+		return;
+
+	if (shader->device->cur_vertex_shader == shader)
+		shader->device->cur_vertex_shader = NULL;
+	if (shader->device->cur_pixel_shader == shader)
+		shader->device->cur_pixel_shader = NULL;
+
+	for (size_t i = 0; i < shader->samplers.num; i++)
+		gs_samplerstate_destroy(shader->samplers.array[i]);
+
+	for (size_t i = 0; i < shader->params.num; i++)
+		shader_param_free(shader->params.array + i);
+
+	sw_program_destroy(shader->program);
+	da_free(shader->samplers);
+	da_free(shader->params);
+	bfree(shader);
+}
+
+int gs_shader_get_num_params(const gs_shader_t *shader)
+{
+	return (int)shader->params.num;
+}
+
+gs_sparam_t *gs_shader_get_param_by_idx(gs_shader_t *shader, uint32_t param)
+{
+	assert(param < shader->params.num);
+	return shader->params.array + param;
+}
+
+gs_sparam_t *gs_shader_get_param_by_name(gs_shader_t *shader, const char *name)
+{
+	for (size_t i = 0; i < shader->params.num; i++) {
+		struct gs_shader_param *param = shader->params.array + i;
+
+		if (strcmp(param->name, name) == 0)
+			return param;
+	}
+
+	return NULL;
+}
+
+gs_sparam_t *gs_shader_get_viewproj_matrix(const gs_shader_t *shader)
+{
+	return shader->viewproj;
+}
+
+gs_sparam_t *gs_shader_get_world_matrix(const gs_shader_t *shader)
+{
+	return shader->world;
+}
+
+void gs_shader_get_param_info(const gs_sparam_t *param,
+			      struct gs_shader_param_info *info)
+{
+	info->type = param->type;
+	info->name = param->name;
+}
+
+void gs_shader_set_bool(gs_sparam_t *param, bool val)
+{
+	int int_val = val;
+	da_copy_array(param->cur_value, &int_val, sizeof(int_val));
+}
+
+void gs_shader_set_float(gs_sparam_t *param, float val)
+{
+	da_copy_array(param->cur_value, &val, sizeof(val));
+}
+
+void gs_shader_set_int(gs_sparam_t *param, int val)
+{
+	da_copy_array(param->cur_value, &val, sizeof(val));
+}
+
+void gs_shader_set_matrix3(gs_sparam_t *param, const struct matrix3 *val)
+{
+	struct matrix4 mat;
+	matrix4_from_matrix3(&mat, val);
+
+	da_copy_array(param->cur_value, &mat, sizeof(mat));
+}
+
+void gs_shader_set_matrix4(gs_sparam_t *param, const struct matrix4 *val)
+{
+	da_copy_array(param->cur_value, val, sizeof(*val));
+}
+
+void gs_shader_set_vec2(gs_sparam_t *param, const struct vec2 *val)
+{
+	da_copy_array(param->cur_value, val->ptr, sizeof(*val));
+}
+
+void gs_shader_set_vec3(gs_sparam_t *param, const struct vec3 *val)
+{
+	da_copy_array(param->cur_value, val->ptr, sizeof(float) * 3);
+}
+
+void gs_shader_set_vec4(gs_sparam_t *param, const struct vec4 *val)
+{
+	da_copy_array(param->cur_value, val->ptr, sizeof(*val));
+}
+
+void gs_shader_set_texture(gs_sparam_t *param, gs_texture_t *val)
+{
+	param->texture = val;
+}
+
+void gs_shader_set_val(gs_sparam_t *param, const void *val, size_t size)
+{
+	int count = param->array_count;
+	size_t expected_size = 0;
+	if (!count)
+		count = 1;
+
+	switch (param->type) {
+	case GS_SHADER_PARAM_FLOAT:
+		expected_size = sizeof(float);
+		break;
+	case GS_SHADER_PARAM_BOOL:
+	case GS_SHADER_PARAM_INT:
+		expected_size = sizeof(int);
+		break;
+	case GS_SHADER_PARAM_INT2:
+		expected_size = sizeof(int) * 2;
+		break;
+	case GS_SHADER_PARAM_INT3:
+		expected_size = sizeof(int) * 3;
+		break;
+	case GS_SHADER_PARAM_INT4:
+		expected_size = sizeof(int) * 4;
+		break;
+	case GS_SHADER_PARAM_VEC2:
+		expected_size = sizeof(float) * 2;
+		break;
+	case GS_SHADER_PARAM_VEC3:
+		expected_size = sizeof(float) * 3;
+		break;
+	case GS_SHADER_PARAM_VEC4:
+		expected_size = sizeof(float) * 4;
+		break;
+	case GS_SHADER_PARAM_MATRIX4X4:
+		expected_size = sizeof(float) * 4 * 4;
+		break;
+	case GS_SHADER_PARAM_TEXTURE:
+		expected_size = sizeof(struct gs_shader_texture);
+		break;
+	default:
+		expected_size = 0;
+	}
+
+	expected_size *= count;
+	if (!expected_size)
+		return;
+
+	if (expected_size != size) {
+		blog(LOG_ERROR, "gs_shader_set_val (software): Size of shader "
+				"param does not match the size of the input");
+		return;
+	}
+
+	if (param->type == GS_SHADER_PARAM_TEXTURE) {
+		struct gs_shader_texture shader_tex;
+		memcpy(&shader_tex, val, sizeof(shader_tex));
+		gs_shader_set_texture(param, shader_tex.tex);
+		param->srgb = shader_tex.srgb;
+	} else {
+		da_copy_array(param->cur_value, val, size);
+	}
+}
+
+void gs_shader_set_default(gs_sparam_t *param)
+{
+	gs_shader_set_val(param, param->def_value.array, param->def_value.num);
+}
+
+void gs_shader_set_next_sampler(gs_sparam_t *param, gs_samplerstate_t *sampler)
+{
+	param->next_sampler = sampler;
+}
+
+/* ------------------------------------------------------------------------- */
+
+bool sw_shader_get_float(gs_shader_t *shader, const char *name, float *val)
+{
+	struct gs_shader_param *param;
+
+	param = shader ? gs_shader_get_param_by_name(shader, name) : NULL;
+	if (!param || param->cur_value.num < sizeof(float))
+		return false;
+
+	memcpy(val, param->cur_value.array, sizeof(float));
+	return true;
+}
+
+bool sw_shader_get_vec4(gs_shader_t *shader, const char *name,
+			struct vec4 *val)
+{
+	struct gs_shader_param *param;
+
+	param = shader ? gs_shader_get_param_by_name(shader, name) : NULL;
+	if (!param || !param->cur_value.num)
+		return false;
+
+	vec4_zero(val);
+	memcpy(val->ptr, param->cur_value.array,
+	       param->cur_value.num < sizeof(float) * 4
+		       ? param->cur_value.num
+		       : sizeof(float) * 4);
+	return true;
+}
+
+bool sw_shader_get_matrix4(gs_shader_t *shader, const char *name,
+			   struct matrix4 *val)
+{
+	struct gs_shader_param *param;
+
+	param = shader ? gs_shader_get_param_by_name(shader, name) : NULL;
+	if (!param || param->cur_value.num != sizeof(*val))
+		return false;
+
+	memcpy(val, param->cur_value.array, sizeof(*val));
+	return true;
+}
+
+struct gs_shader_param *sw_shader_get_image(gs_shader_t *shader,
+					    const char *name)
+{
+	struct gs_shader_param *param;
+
+	param = shader ? gs_shader_get_param_by_name(shader, name) : NULL;
+	if (param && param->type == GS_SHADER_PARAM_TEXTURE)
+		return param;
+
+	/* plugin effects don't always call their texture "image" */
+	for (size_t i = 0; shader && i < shader->params.num; i++) {
+		param = shader->params.array + i;
+		if (param->type == GS_SHADER_PARAM_TEXTURE)
+			return param;
+	}
+
+	return NULL;
+}
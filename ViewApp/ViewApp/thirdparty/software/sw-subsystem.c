@@ -0,0 +1,1306 @@
+/******************************************************************************
+    Copyright (C) 2013 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <util/platform.h>
+#include <graphics/srgb.h>
+#include "sw-subsystem.h"
+
+/* Goofy Windows.h macros need to be removed */
+#ifdef near
+#undef near
+#endif
+#ifdef far
+#undef far
+#endif
+
+static void clear_textures(struct gs_device *device)
+{
+	for (size_t i = 0; i < GS_MAX_TEXTURES; i++)
+		device->cur_textures[i] = NULL;
+}
+
+static void convert_sampler_info(struct gs_sampler_state *sampler,
+				 const struct gs_sampler_info *info)
+{
+	sampler->filter = info->filter;
+	sampler->address_u = info->address_u;
+	sampler->address_v = info->address_v;
+	vec4_from_rgba(&sampler->border_color, info->border_color);
+}
+
+const char *device_get_name(void)
+{
+	return "Software";
+}
+
+int device_get_type(void)
+{
+	return GS_DEVICE_SOFTWARE;
+}
+
+const char *device_preprocessor_name(void)
+{
+	return "_SOFTWARE";
+}
+
+int device_create(gs_device_t **p_device, uint32_t adapter)
+{
+	struct gs_device *device = bzalloc(sizeof(struct gs_device));
+	struct gs_sampler_info def_info = {0};
+
+	UNUSED_PARAMETER(adapter);
+
+	blog(LOG_INFO, "---------------------------------");
+	blog(LOG_INFO, "Initializing software renderer...");
+
+	device->raster_pool = os_task_pool_create(0, "software raster");
+	if (!device->raster_pool)
+		goto fail;
+
+	def_info.filter = GS_FILTER_LINEAR;
+	def_info.address_u = GS_ADDRESS_CLAMP;
+	def_info.address_v = GS_ADDRESS_CLAMP;
+	def_info.address_w = GS_ADDRESS_CLAMP;
+	def_info.max_anisotropy = 1;
+	device->default_sampler = device_samplerstate_create(device, &def_info);
+
+	for (size_t i = 0; i < 4; i++)
+		device->write_mask[i] = true;
+
+	blog(LOG_INFO, "Software renderer loaded, %d raster threads",
+	     (int)os_task_pool_get_threads(device->raster_pool) + 1);
+
+	*p_device = device;
+	return GS_SUCCESS;
+
+fail:
+	blog(LOG_ERROR, "device_create (software) failed");
+	bfree(device);
+
+	*p_device = NULL;
+	return GS_ERROR_FAIL;
+}
+
+void device_destroy(gs_device_t *device)
+{
+	if (device) {
+		samplerstate_release(device->default_sampler);
+		os_task_pool_destroy(device->raster_pool);
+
+		da_free(device->shaded_verts);
+		da_free(device->tri_verts);
+		da_free(device->proj_stack);
+		bfree(device);
+	}
+}
+
+void device_enter_context(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+void device_leave_context(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+void *device_get_device_obj(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+	return NULL;
+}
+
+static bool swapchain_init_target(struct gs_swap_chain *swap)
+{
+	enum gs_color_format format = swap->info.format;
+	if (format == GS_UNKNOWN)
+		format = GS_BGRA;
+
+	gs_texture_destroy(swap->target);
+	swap->target = device_texture_create(swap->device, swap->info.cx,
+					     swap->info.cy, format, 1, NULL,
+					     GS_RENDER_TARGET);
+	return swap->target != NULL;
+}
+
+gs_swapchain_t *device_swapchain_create(gs_device_t *device,
+					const struct gs_init_data *info)
+{
+	struct gs_swap_chain *swap = bzalloc(sizeof(struct gs_swap_chain));
+
+	swap->device = device;
+	swap->info = *info;
+
+	if (!swapchain_init_target(swap)) {
+		blog(LOG_ERROR, "device_swapchain_create (software) failed");
+		gs_swapchain_destroy(swap);
+		return NULL;
+	}
+
+	return swap;
+}
+
+void device_resize(gs_device_t *device, uint32_t cx, uint32_t cy)
+{
+	struct gs_swap_chain *swap = device->cur_swap;
+
+	if (!swap) {
+		blog(LOG_WARNING, "device_resize (software): No active swap");
+		return;
+	}
+
+	if (swap->info.cx == cx && swap->info.cy == cy)
+		return;
+
+	swap->info.cx = cx;
+	swap->info.cy = cy;
+	if (!swapchain_init_target(swap))
+		blog(LOG_ERROR, "device_resize (software) failed");
+}
+
+enum gs_color_space device_get_color_space(gs_device_t *device)
+{
+	return device->cur_color_space;
+}
+
+void device_update_color_space(gs_device_t *device)
+{
+	if (!device->cur_swap)
+		blog(LOG_WARNING,
+		     "device_update_color_space (software): No active swap");
+}
+
+void device_get_size(const gs_device_t *device, uint32_t *cx, uint32_t *cy)
+{
+	if (device->cur_swap) {
+		*cx = device->cur_swap->info.cx;
+		*cy = device->cur_swap->info.cy;
+	} else {
+		blog(LOG_WARNING, "device_get_size (software): No active swap");
+		*cx = 0;
+		*cy = 0;
+	}
+}
+
+uint32_t device_get_width(const gs_device_t *device)
+{
+	if (device->cur_swap) {
+		return device->cur_swap->info.cx;
+	} else {
+		blog(LOG_WARNING, "device_get_width (software): No active swap");
+		return 0;
+	}
+}
+
+uint32_t device_get_height(const gs_device_t *device)
+{
+	if (device->cur_swap) {
+		return device->cur_swap->info.cy;
+	} else {
+		blog(LOG_WARNING,
+		     "device_get_height (software): No active swap");
+		return 0;
+	}
+}
+
+gs_samplerstate_t *
+device_samplerstate_create(gs_device_t *device,
+			   const struct gs_sampler_info *info)
+{
+	struct gs_sampler_state *sampler;
+
+	sampler = bzalloc(sizeof(struct gs_sampler_state));
+	sampler->device = device;
+	sampler->ref = 1;
+
+	convert_sampler_info(sampler, info);
+	return sampler;
+}
+
+gs_timer_t *device_timer_create(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+
+	return bzalloc(sizeof(struct gs_timer));
+}
+
+gs_timer_range_t *device_timer_range_create(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+
+	return NULL;
+}
+
+enum gs_texture_type device_get_texture_type(const gs_texture_t *texture)
+{
+	return texture->type;
+}
+
+static struct gs_shader_param *get_texture_param(gs_device_t *device,
+						 int unit)
+{
+	struct gs_shader *shader = device->cur_pixel_shader;
+	int texture_id = 0;
+
+	for (size_t i = 0; i < shader->params.num; i++) {
+		struct gs_shader_param *param = shader->params.array + i;
+		if (param->type == GS_SHADER_PARAM_TEXTURE) {
+			if (texture_id++ == unit)
+				return param;
+		}
+	}
+
+	return NULL;
+}
+
+static void device_load_texture_internal(gs_device_t *device, gs_texture_t *tex,
+					 int unit, bool srgb)
+{
+	struct gs_shader_param *param;
+
+	/* need a pixel shader to properly bind textures */
+	if (!device->cur_pixel_shader) {
+		blog(LOG_ERROR, "device_load_texture (software) failed");
+		return;
+	}
+
+	device->cur_textures[unit] = tex;
+	param = get_texture_param(device, unit);
+	if (!param)
+		return;
+
+	param->texture = tex;
+	param->srgb = srgb;
+}
+
+void device_load_texture(gs_device_t *device, gs_texture_t *tex, int unit)
+{
+	device_load_texture_internal(device, tex, unit, false);
+}
+
+void device_load_texture_srgb(gs_device_t *device, gs_texture_t *tex, int unit)
+{
+	device_load_texture_internal(device, tex, unit, true);
+}
+
+void device_load_samplerstate(gs_device_t *device, gs_samplerstate_t *ss,
+			      int unit)
+{
+	/* need a pixel shader to properly bind samplers */
+	if (!device->cur_pixel_shader)
+		ss = NULL;
+
+	device->cur_samplers[unit] = ss;
+}
+
+void device_load_vertexbuffer(gs_device_t *device, gs_vertbuffer_t *vb)
+{
+	device->cur_vertex_buffer = vb;
+}
+
+void device_load_indexbuffer(gs_device_t *device, gs_indexbuffer_t *ib)
+{
+	device->cur_index_buffer = ib;
+}
+
+void device_load_vertexshader(gs_device_t *device, gs_shader_t *vertshader)
+{
+	if (device->cur_vertex_shader == vertshader)
+		return;
+
+	if (vertshader && vertshader->type != GS_SHADER_VERTEX) {
+		blog(LOG_ERROR, "Specified shader is not a vertex shader");
+		blog(LOG_ERROR, "device_load_vertexshader (software) failed");
+		return;
+	}
+
+	device->cur_vertex_shader = vertshader;
+}
+
+static void load_default_pixelshader_samplers(struct gs_device *device,
+					      struct gs_shader *ps)
+{
+	size_t i;
+	if (!ps)
+		return;
+
+	for (i = 0; i < ps->samplers.num; i++) {
+		struct gs_sampler_state *ss = ps->samplers.array[i];
+		device->cur_samplers[i] = ss;
+	}
+
+	for (; i < GS_MAX_TEXTURES; i++)
+		device->cur_samplers[i] = NULL;
+}
+
+void device_load_pixelshader(gs_device_t *device, gs_shader_t *pixelshader)
+{
+	if (device->cur_pixel_shader == pixelshader)
+		return;
+
+	if (pixelshader && pixelshader->type != GS_SHADER_PIXEL) {
+		blog(LOG_ERROR, "Specified shader is not a pixel shader");
+		blog(LOG_ERROR, "device_load_pixelshader (software) failed");
+		return;
+	}
+
+	device->cur_pixel_shader = pixelshader;
+
+	clear_textures(device);
+
+	if (pixelshader)
+		load_default_pixelshader_samplers(device, pixelshader);
+}
+
+void device_load_default_samplerstate(gs_device_t *device, bool b_3d, int unit)
+{
+	UNUSED_PARAMETER(b_3d);
+
+	device->cur_samplers[unit] = device->default_sampler;
+}
+
+gs_shader_t *device_get_vertex_shader(const gs_device_t *device)
+{
+	return device->cur_vertex_shader;
+}
+
+gs_shader_t *device_get_pixel_shader(const gs_device_t *device)
+{
+	return device->cur_pixel_shader;
+}
+
+gs_texture_t *device_get_render_target(const gs_device_t *device)
+{
+	return device->cur_render_target;
+}
+
+gs_zstencil_t *device_get_zstencil_target(const gs_device_t *device)
+{
+	return device->cur_zstencil_buffer;
+}
+
+void device_set_render_target(gs_device_t *device, gs_texture_t *tex,
+			      gs_zstencil_t *zstencil)
+{
+	if (tex) {
+		if (tex->type != GS_TEXTURE_2D) {
+			blog(LOG_ERROR, "Texture is not a 2D texture");
+			goto fail;
+		}
+
+		if (!tex->is_render_target) {
+			blog(LOG_ERROR, "Texture is not a render target");
+			goto fail;
+		}
+	}
+
+	device->cur_render_target = tex;
+	device->cur_zstencil_buffer = zstencil;
+	return;
+
+fail:
+	blog(LOG_ERROR, "device_set_render_target (software) failed");
+}
+
+void device_set_render_target_with_color_space(gs_device_t *device,
+					       gs_texture_t *tex,
+					       gs_zstencil_t *zstencil,
+					       enum gs_color_space space)
+{
+	device_set_render_target(device, tex, zstencil);
+	device->cur_color_space = space;
+}
+
+void device_set_cube_render_target(gs_device_t *device, gs_texture_t *cubetex,
+				   int side, gs_zstencil_t *zstencil)
+{
+	UNUSED_PARAMETER(cubetex);
+	UNUSED_PARAMETER(side);
+	UNUSED_PARAMETER(zstencil);
+
+	if (cubetex) {
+		blog(LOG_ERROR, "device_set_cube_render_target (software): "
+				"cube textures are not supported");
+		return;
+	}
+
+	device_set_render_target(device, NULL, NULL);
+}
+
+void device_enable_framebuffer_srgb(gs_device_t *device, bool enable)
+{
+	device->framebuffer_srgb = enable;
+}
+
+bool device_framebuffer_srgb_enabled(gs_device_t *device)
+{
+	return device->framebuffer_srgb;
+}
+
+void device_begin_frame(gs_device_t *device)
+{
+	/* does nothing */
+	UNUSED_PARAMETER(device);
+}
+
+void device_begin_scene(gs_device_t *device)
+{
+	clear_textures(device);
+}
+
+static inline bool can_render(const gs_device_t *device, uint32_t num_verts)
+{
+	if (!device->cur_vertex_shader) {
+		blog(LOG_ERROR, "No vertex shader specified");
+		return false;
+	}
+
+	if (!device->cur_pixel_shader) {
+		blog(LOG_ERROR, "No pixel shader specified");
+		return false;
+	}
+
+	if (!device->cur_vertex_buffer && (num_verts == 0)) {
+		blog(LOG_ERROR, "No vertex buffer specified");
+		return false;
+	}
+
+	if (!device->cur_swap && !device->cur_render_target) {
+		blog(LOG_ERROR, "No active swap chain or render target");
+		return false;
+	}
+
+	return true;
+}
+
+static void update_viewproj_matrix(struct gs_device *device)
+{
+	struct gs_shader *vs = device->cur_vertex_shader;
+
+	/* no transpose here: vertices are transformed on the CPU with the
+	 * same row vector convention the matrix stack uses */
+	gs_matrix_get(&device->cur_view);
+	matrix4_mul(&device->cur_viewproj, &device->cur_view,
+		    &device->cur_proj);
+
+	if (vs->viewproj)
+		gs_shader_set_matrix4(vs->viewproj, &device->cur_viewproj);
+}
+
+static inline uint32_t get_vertex_id(const struct gs_index_buffer *ib,
+				     uint32_t i)
+{
+	if (!ib)
+		return i;
+
+	if (ib->type == GS_UNSIGNED_LONG)
+		return ((const uint32_t *)ib->data)[i];
+	return ((const uint16_t *)ib->data)[i];
+}
+
+struct vs_constants {
+	struct vec4 uv_scale;
+	float width_i;
+	float height_i;
+	float width_x2_i;
+	float width_d2;
+	float height;
+};
+
+static void run_vertex_program(gs_device_t *device, gs_shader_t *vs,
+			       const struct vs_constants *c, uint32_t id,
+			       struct sw_vertex *out)
+{
+	const struct gs_vertex_buffer *vb = device->cur_vertex_buffer;
+	float id_high = (float)(id >> 1);
+	float id_low = (float)(id & 1);
+	struct vec4 *uv = &out->attribs[SW_ATTRIB_TEXCOORD0];
+	float u_right, u_left, v;
+
+	memset(out->attribs, 0, sizeof(out->attribs));
+	vec4_set(&out->attribs[SW_ATTRIB_COLOR], 1.0f, 1.0f, 1.0f, 1.0f);
+
+	switch (vs->vertex_program) {
+	case SW_VS_TRANSFORM: {
+		const struct gs_vb_data *data = vb ? vb->data : NULL;
+		struct vec4 pos;
+
+		if (!data || !data->points || id >= data->num) {
+			vec4_zero(&out->pos);
+			return;
+		}
+
+		vec4_from_vec3(&pos, data->points + id);
+		pos.w = 1.0f;
+		vec4_transform(&out->pos, &pos, &device->cur_viewproj);
+
+		if (data->colors)
+			gs_u8x4_to_float4(out->attribs[SW_ATTRIB_COLOR].ptr,
+					  (const uint8_t *)(data->colors + id));
+
+		if (data->num_tex && data->tvarray[0].array) {
+			const struct gs_tvertarray *tv = data->tvarray;
+			size_t width = tv->width > 4 ? 4 : tv->width;
+			const float *src = (const float *)tv->array +
+					   (size_t)id * tv->width;
+
+			memcpy(uv->ptr, src, sizeof(float) * width);
+			if (vs->scale_uv) {
+				uv->x *= c->uv_scale.x;
+				uv->y *= c->uv_scale.y;
+			}
+		}
+
+		if (data->num_tex > 1 && data->tvarray[1].array) {
+			const struct gs_tvertarray *tv = data->tvarray + 1;
+			size_t width = tv->width > 4 ? 4 : tv->width;
+			const float *src = (const float *)tv->array +
+					   (size_t)id * tv->width;
+
+			memcpy(out->attribs[SW_ATTRIB_TEXCOORD1].ptr, src,
+			       sizeof(float) * width);
+		}
+		return;
+	}
+
+	case SW_VS_POS_ID:
+		vec4_set(&out->pos, id_high * 4.0f - 1.0f,
+			 id_low * 4.0f - 1.0f, 0.0f, 1.0f);
+		return;
+
+	case SW_VS_TEXPOS_LEFT_ID:
+		u_right = id_high * 2.0f;
+		u_left = u_right - c->width_i;
+		v = 1.0f - id_low * 2.0f;
+
+		vec4_set(&out->pos, id_high * 4.0f - 1.0f,
+			 id_low * 4.0f - 1.0f, 0.0f, 1.0f);
+		vec4_set(uv, u_left, u_right, v, 0.0f);
+		return;
+
+	case SW_VS_TEXPOS_TOPLEFT_ID:
+		u_right = id_high * 2.0f;
+		u_left = u_right - c->width_i;
+		v = 1.0f - id_low * 2.0f;
+
+		vec4_set(&out->pos, id_high * 4.0f - 1.0f,
+			 id_low * 4.0f - 1.0f, 0.0f, 1.0f);
+		vec4_set(uv, u_left, u_right, v - c->height_i, v);
+		return;
+
+	case SW_VS_420_LEFT_REVERSE_ID:
+		vec4_set(&out->pos, id_high * 4.0f - 1.0f,
+			 id_low * 4.0f - 1.0f, 0.0f, 1.0f);
+		vec4_set(uv, id_high * 2.0f + c->width_x2_i,
+			 1.0f - id_low * 2.0f, 0.0f, 0.0f);
+		return;
+
+	case SW_VS_PACKED422_LEFT_REVERSE_ID:
+		u_right = id_high * 2.0f;
+		v = 1.0f - id_low * 2.0f;
+
+		vec4_set(&out->pos, id_high * 4.0f - 1.0f,
+			 id_low * 4.0f - 1.0f, 0.0f, 1.0f);
+		vec4_set(uv, c->width_d2 * u_right, c->height * v,
+			 u_right + c->width_x2_i, v);
+		return;
+	}
+}
+
+static size_t assemble_triangles(gs_device_t *device,
+				 enum gs_draw_mode draw_mode)
+{
+	const struct sw_vertex *v = device->shaded_verts.array;
+	size_t num = device->shaded_verts.num;
+	size_t num_tris;
+
+	if (draw_mode == GS_TRIS)
+		num_tris = num / 3;
+	else if (draw_mode == GS_TRISTRIP)
+		num_tris = num >= 3 ? num - 2 : 0;
+	else
+		return 0;
+
+	da_resize(device->tri_verts, num_tris * 3);
+
+	for (size_t i = 0; i < num_tris; i++) {
+		struct sw_vertex *out = device->tri_verts.array + i * 3;
+
+		if (draw_mode == GS_TRIS) {
+			memcpy(out, v + i * 3, sizeof(struct sw_vertex) * 3);
+		} else if (i & 1) {
+			/* keep the winding of odd strip triangles */
+			out[0] = v[i + 1];
+			out[1] = v[i];
+			out[2] = v[i + 2];
+		} else {
+			memcpy(out, v + i, sizeof(struct sw_vertex) * 3);
+		}
+	}
+
+	return num_tris;
+}
+
+void device_draw(gs_device_t *device, enum gs_draw_mode draw_mode,
+		 uint32_t start_vert, uint32_t num_verts)
+{
+	struct gs_index_buffer *ib = device->cur_index_buffer;
+	gs_effect_t *effect = gs_get_effect();
+	struct gs_texture_2d *rt;
+	struct vs_constants constants;
+	gs_shader_t *vs;
+	size_t num_tris;
+
+	if (!can_render(device, num_verts))
+		goto fail;
+
+	if (effect)
+		gs_effect_update_params(effect);
+
+	rt = sw_get_target(device);
+	if (!rt)
+		goto fail;
+
+	vs = device->cur_vertex_shader;
+	update_viewproj_matrix(device);
+
+	vec4_set(&constants.uv_scale, 1.0f, 1.0f, 1.0f, 1.0f);
+	constants.width_i = 0.0f;
+	constants.height_i = 0.0f;
+	constants.width_x2_i = 0.0f;
+	constants.width_d2 = 0.0f;
+	constants.height = 0.0f;
+	sw_shader_get_vec4(vs, "scale", &constants.uv_scale);
+	sw_shader_get_float(vs, "width_i", &constants.width_i);
+	sw_shader_get_float(vs, "height_i", &constants.height_i);
+	sw_shader_get_float(vs, "width_x2_i", &constants.width_x2_i);
+	sw_shader_get_float(vs, "width_d2", &constants.width_d2);
+	sw_shader_get_float(vs, "height", &constants.height);
+
+	if (num_verts == 0)
+		num_verts = ib ? (uint32_t)ib->num
+			       : (uint32_t)device->cur_vertex_buffer->num;
+	if (ib && (size_t)start_vert + num_verts > ib->num) {
+		blog(LOG_ERROR, "Index buffer draw out of range");
+		goto fail;
+	}
+
+	da_resize(device->shaded_verts, num_verts);
+
+	if (vs->program) {
+		const struct gs_vertex_buffer *vb = device->cur_vertex_buffer;
+		struct sw_binding binding;
+		struct sw_exec exec;
+
+		sw_binding_init(&binding, vs);
+		sw_exec_init(&exec, &binding);
+		for (uint32_t i = 0; i < num_verts; i++)
+			sw_program_run_vertex(&exec, vb ? vb->data : NULL,
+					      get_vertex_id(ib, start_vert + i),
+					      device->shaded_verts.array + i);
+		sw_exec_free(&exec);
+		sw_binding_free(&binding);
+	} else {
+		for (uint32_t i = 0; i < num_verts; i++)
+			run_vertex_program(device, vs, &constants,
+					   get_vertex_id(ib, start_vert + i),
+					   device->shaded_verts.array + i);
+	}
+
+	num_tris = assemble_triangles(device, draw_mode);
+	if (num_tris)
+		sw_draw_triangles(device, rt, device->tri_verts.array,
+				  num_tris);
+	return;
+
+fail:
+	blog(LOG_ERROR, "device_draw (software) failed");
+}
+
+void device_end_scene(gs_device_t *device)
+{
+	/* does nothing */
+	UNUSED_PARAMETER(device);
+}
+
+void device_load_swapchain(gs_device_t *device, gs_swapchain_t *swapchain)
+{
+	device->cur_swap = swapchain;
+}
+
+void device_clear(gs_device_t *device, uint32_t clear_flags,
+		  const struct vec4 *color, float depth, uint8_t stencil)
+{
+	UNUSED_PARAMETER(depth);
+	UNUSED_PARAMETER(stencil);
+
+	if (clear_flags & GS_CLEAR_COLOR) {
+		struct gs_texture_2d *rt = sw_get_target(device);
+		struct vec4 c = *color;
+
+		if (!rt) {
+			blog(LOG_ERROR, "device_clear (software) failed");
+			return;
+		}
+
+		if (device->framebuffer_srgb &&
+		    gs_is_srgb_format(rt->base.format))
+			gs_float3_srgb_linear_to_nonlinear(c.ptr);
+		sw_texture_fill(rt, &c);
+	}
+}
+
+bool device_is_present_ready(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+	return true;
+}
+
+void device_present(gs_device_t *device)
+{
+	/* nothing to show, the swap chain target is only read back */
+	UNUSED_PARAMETER(device);
+}
+
+void device_flush(gs_device_t *device)
+{
+	/* draws complete before device_draw returns */
+	UNUSED_PARAMETER(device);
+}
+
+void device_set_cull_mode(gs_device_t *device, enum gs_cull_mode mode)
+{
+	device->cur_cull_mode = mode;
+}
+
+enum gs_cull_mode device_get_cull_mode(const gs_device_t *device)
+{
+	return device->cur_cull_mode;
+}
+
+void device_enable_blending(gs_device_t *device, bool enable)
+{
+	device->blend.enabled = enable;
+}
+
+void device_enable_depth_test(gs_device_t *device, bool enable)
+{
+	/* 2D compositing only, depth buffers are not implemented */
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(enable);
+}
+
+void device_enable_stencil_test(gs_device_t *device, bool enable)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(enable);
+}
+
+void device_enable_stencil_write(gs_device_t *device, bool enable)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(enable);
+}
+
+void device_enable_color(gs_device_t *device, bool red, bool green, bool blue,
+			 bool alpha)
+{
+	device->write_mask[0] = red;
+	device->write_mask[1] = green;
+	device->write_mask[2] = blue;
+	device->write_mask[3] = alpha;
+}
+
+void device_blend_function(gs_device_t *device, enum gs_blend_type src,
+			   enum gs_blend_type dest)
+{
+	device_blend_function_separate(device, src, dest, src, dest);
+}
+
+void device_blend_function_separate(gs_device_t *device,
+				    enum gs_blend_type src_c,
+				    enum gs_blend_type dest_c,
+				    enum gs_blend_type src_a,
+				    enum gs_blend_type dest_a)
+{
+	device->blend.src_c = src_c;
+	device->blend.dest_c = dest_c;
+	device->blend.src_a = src_a;
+	device->blend.dest_a = dest_a;
+}
+
+void device_blend_op(gs_device_t *device, enum gs_blend_op_type op)
+{
+	device->blend.op = op;
+}
+
+void device_depth_function(gs_device_t *device, enum gs_depth_test test)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(test);
+}
+
+void device_stencil_function(gs_device_t *device, enum gs_stencil_side side,
+			     enum gs_depth_test test)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(side);
+	UNUSED_PARAMETER(test);
+}
+
+void device_stencil_op(gs_device_t *device, enum gs_stencil_side side,
+		       enum gs_stencil_op_type fail,
+		       enum gs_stencil_op_type zfail,
+		       enum gs_stencil_op_type zpass)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(side);
+	UNUSED_PARAMETER(fail);
+	UNUSED_PARAMETER(zfail);
+	UNUSED_PARAMETER(zpass);
+}
+
+void device_set_viewport(gs_device_t *device, int x, int y, int width,
+			 int height)
+{
+	/* textures are stored top-down, so no flip like GL needs */
+	device->cur_viewport.x = x;
+	device->cur_viewport.y = y;
+	device->cur_viewport.cx = width;
+	device->cur_viewport.cy = height;
+}
+
+void device_get_viewport(const gs_device_t *device, struct gs_rect *rect)
+{
+	*rect = device->cur_viewport;
+}
+
+void device_set_scissor_rect(gs_device_t *device, const struct gs_rect *rect)
+{
+	device->scissor_enabled = rect != NULL;
+	if (rect)
+		device->cur_scissor = *rect;
+}
+
+void device_ortho(gs_device_t *device, float left, float right, float top,
+		  float bottom, float near, float far)
+{
+	struct matrix4 *dst = &device->cur_proj;
+
+	float rml = right - left;
+	float bmt = bottom - top;
+	float fmn = far - near;
+
+	vec4_zero(&dst->x);
+	vec4_zero(&dst->y);
+	vec4_zero(&dst->z);
+	vec4_zero(&dst->t);
+
+	dst->x.x = 2.0f / rml;
+	dst->t.x = (left + right) / -rml;
+
+	dst->y.y = 2.0f / -bmt;
+	dst->t.y = (bottom + top) / bmt;
+
+	dst->z.z = -2.0f / fmn;
+	dst->t.z = (far + near) / -fmn;
+
+	dst->t.w = 1.0f;
+}
+
+void device_frustum(gs_device_t *device, float left, float right, float top,
+		    float bottom, float near, float far)
+{
+	struct matrix4 *dst = &device->cur_proj;
+
+	float rml = right - left;
+	float tmb = top - bottom;
+	float nmf = near - far;
+	float nearx2 = 2.0f * near;
+
+	vec4_zero(&dst->x);
+	vec4_zero(&dst->y);
+	vec4_zero(&dst->z);
+	vec4_zero(&dst->t);
+
+	dst->x.x = nearx2 / rml;
+	dst->z.x = (left + right) / rml;
+
+	dst->y.y = nearx2 / tmb;
+	dst->z.y = (bottom + top) / tmb;
+
+	dst->z.z = (far + near) / nmf;
+	dst->t.z = 2.0f * (near * far) / nmf;
+
+	dst->z.w = -1.0f;
+}
+
+void device_projection_push(gs_device_t *device)
+{
+	da_push_back(device->proj_stack, &device->cur_proj);
+}
+
+void device_projection_pop(gs_device_t *device)
+{
+	struct matrix4 *end;
+	if (!device->proj_stack.num)
+		return;
+
+	end = da_end(device->proj_stack);
+	device->cur_proj = *end;
+	da_pop_back(device->proj_stack);
+}
+
+void device_debug_marker_begin(gs_device_t *device, const char *markername,
+			       const float color[4])
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(markername);
+	UNUSED_PARAMETER(color);
+}
+
+void device_debug_marker_end(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+}
+
+bool device_is_monitor_hdr(gs_device_t *device, void *monitor)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(monitor);
+	return false;
+}
+
+bool device_nv12_available(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+	return false;
+}
+
+bool device_p010_available(gs_device_t *device)
+{
+	UNUSED_PARAMETER(device);
+	return false;
+}
+
+bool device_shared_texture_available(void)
+{
+	return false;
+}
+
+void gs_swapchain_destroy(gs_swapchain_t *swapchain)
+{
+	if (!swapchain)
+		return;
+
+	if (swapchain->device->cur_swap == swapchain)
+		device_load_swapchain(swapchain->device, NULL);
+
+	gs_texture_destroy(swapchain->target);
+	bfree(swapchain);
+}
+
+void gs_samplerstate_destroy(gs_samplerstate_t *samplerstate)
+{
+	if (!samplerstate)
+		return;
+
+	if (samplerstate->device)
+		for (int i = 0; i < GS_MAX_TEXTURES; i++)
+			if (samplerstate->device->cur_samplers[i] ==
+			    samplerstate)
+				samplerstate->device->cur_samplers[i] = NULL;
+
+	samplerstate_release(samplerstate);
+}
+
+void gs_timer_destroy(gs_timer_t *timer)
+{
+	bfree(timer);
+}
+
+void gs_timer_begin(gs_timer_t *timer)
+{
+	timer->begin = os_gettime_ns();
+}
+
+void gs_timer_end(gs_timer_t *timer)
+{
+	timer->end = os_gettime_ns();
+}
+
+bool gs_timer_get_data(gs_timer_t *timer, uint64_t *ticks)
+{
+	*ticks = timer->end - timer->begin;
+	return true;
+}
+
+void gs_timer_range_destroy(gs_timer_range_t *range)
+{
+	UNUSED_PARAMETER(range);
+}
+
+void gs_timer_range_begin(gs_timer_range_t *range)
+{
+	UNUSED_PARAMETER(range);
+}
+
+void gs_timer_range_end(gs_timer_range_t *range)
+{
+	UNUSED_PARAMETER(range);
+}
+
+bool gs_timer_range_get_data(gs_timer_range_t *range, bool *disjoint,
+			     uint64_t *frequency)
+{
+	UNUSED_PARAMETER(range);
+
+	*disjoint = false;
+	*frequency = 1000000000;
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* vertex/index buffers, kept in system memory as handed over by libobs */
+
+gs_vertbuffer_t *device_vertexbuffer_create(gs_device_t *device,
+					    struct gs_vb_data *data,
+					    uint32_t flags)
+{
+	struct gs_vertex_buffer *vb = bzalloc(sizeof(struct gs_vertex_buffer));
+	vb->device = device;
+	vb->data = data;
+	vb->num = data->num;
+	vb->dynamic = flags & GS_DYNAMIC;
+
+	return vb;
+}
+
+void gs_vertexbuffer_destroy(gs_vertbuffer_t *vb)
+{
+	if (vb) {
+		if (vb->device->cur_vertex_buffer == vb)
+			vb->device->cur_vertex_buffer = NULL;
+
+		gs_vbdata_destroy(vb->data);
+		bfree(vb);
+	}
+}
+
+static inline void copy_array(void *dst, const void *src, size_t size)
+{
+	if (dst && src && dst != src)
+		memcpy(dst, src, size);
+}
+
+static void gs_vertexbuffer_flush_internal(gs_vertbuffer_t *vb,
+					   const struct gs_vb_data *data)
+{
+	struct gs_vb_data *dst = vb->data;
+	size_t num = vb->num;
+
+	if (!vb->dynamic) {
+		blog(LOG_ERROR, "vertex buffer is not dynamic");
+		goto fail;
+	}
+
+	if (data->num != num) {
+		blog(LOG_ERROR, "vertex buffer size mismatch");
+		goto fail;
+	}
+
+	copy_array(dst->points, data->points, sizeof(struct vec3) * num);
+	copy_array(dst->normals, data->normals, sizeof(struct vec3) * num);
+	copy_array(dst->tangents, data->tangents, sizeof(struct vec3) * num);
+	copy_array(dst->colors, data->colors, sizeof(uint32_t) * num);
+
+	for (size_t i = 0; i < dst->num_tex && i < data->num_tex; i++) {
+		const struct gs_tvertarray *tv = data->tvarray + i;
+		copy_array(dst->tvarray[i].array, tv->array,
+			   sizeof(float) * tv->width * num);
+	}
+
+	return;
+
+fail:
+	blog(LOG_ERROR, "gs_vertexbuffer_flush (software) failed");
+}
+
+void gs_vertexbuffer_flush(gs_vertbuffer_t *vb)
+{
+	gs_vertexbuffer_flush_internal(vb, vb->data);
+}
+
+void gs_vertexbuffer_flush_direct(gs_vertbuffer_t *vb,
+				  const struct gs_vb_data *data)
+{
+	gs_vertexbuffer_flush_internal(vb, data);
+}
+
+struct gs_vb_data *gs_vertexbuffer_get_data(const gs_vertbuffer_t *vb)
+{
+	return vb->data;
+}
+
+gs_indexbuffer_t *device_indexbuffer_create(gs_device_t *device,
+					    enum gs_index_type type,
+					    void *indices, size_t num,
+					    uint32_t flags)
+{
+	struct gs_index_buffer *ib = bzalloc(sizeof(struct gs_index_buffer));
+	size_t width = type == GS_UNSIGNED_LONG ? 4 : 2;
+
+	ib->device = device;
+	ib->data = indices;
+	ib->dynamic = flags & GS_DYNAMIC;
+	ib->num = num;
+	ib->width = width;
+	ib->size = width * num;
+	ib->type = type;
+
+	return ib;
+}
+
+void gs_indexbuffer_destroy(gs_indexbuffer_t *ib)
+{
+	if (ib) {
+		if (ib->device->cur_index_buffer == ib)
+			ib->device->cur_index_buffer = NULL;
+
+		bfree(ib->data);
+		bfree(ib);
+	}
+}
+
+void gs_indexbuffer_flush(gs_indexbuffer_t *ib)
+{
+	if (!ib->dynamic)
+		blog(LOG_ERROR, "gs_indexbuffer_flush (software) failed: "
+				"index buffer is not dynamic");
+}
+
+void gs_indexbuffer_flush_direct(gs_indexbuffer_t *ib, const void *data)
+{
+	if (!ib->dynamic) {
+		blog(LOG_ERROR, "gs_indexbuffer_flush_direct (software) failed: "
+				"index buffer is not dynamic");
+		return;
+	}
+
+	copy_array(ib->data, data, ib->size);
+}
+
+void *gs_indexbuffer_get_data(const gs_indexbuffer_t *ib)
+{
+	return ib->data;
+}
+
+size_t gs_indexbuffer_get_num_indices(const gs_indexbuffer_t *ib)
+{
+	return ib->num;
+}
+
+enum gs_index_type gs_indexbuffer_get_type(const gs_indexbuffer_t *ib)
+{
+	return ib->type;
+}
+
+/* ------------------------------------------------------------------------- */
+/* platform texture sharing, none of which exists without a GPU */
+
+#ifdef __APPLE__
+gs_texture_t *device_texture_create_from_iosurface(gs_device_t *device,
+						   void *iosurf)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(iosurf);
+	return NULL;
+}
+
+gs_texture_t *device_texture_open_shared(gs_device_t *device, uint32_t handle)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(handle);
+	return NULL;
+}
+
+bool gs_texture_rebind_iosurface(gs_texture_t *texture, void *iosurf)
+{
+	UNUSED_PARAMETER(texture);
+	UNUSED_PARAMETER(iosurf);
+	return false;
+}
+#endif
+
+#if defined(__linux__) || defined(__FreeBSD__) || defined(__DragonFly__)
+gs_texture_t *device_texture_create_from_dmabuf(
+	gs_device_t *device, unsigned int width, unsigned int height,
+	uint32_t drm_format, enum gs_color_format color_format,
+	uint32_t n_planes, const int *fds, const uint32_t *strides,
+	const uint32_t *offsets, const uint64_t *modifiers)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(width);
+	UNUSED_PARAMETER(height);
+	UNUSED_PARAMETER(drm_format);
+	UNUSED_PARAMETER(color_format);
+	UNUSED_PARAMETER(n_planes);
+	UNUSED_PARAMETER(fds);
+	UNUSED_PARAMETER(strides);
+	UNUSED_PARAMETER(offsets);
+	UNUSED_PARAMETER(modifiers);
+	return NULL;
+}
+
+bool device_query_dmabuf_capabilities(gs_device_t *device,
+				      enum gs_dmabuf_flags *dmabuf_flags,
+				      uint32_t **drm_formats, size_t *n_formats)
+{
+	UNUSED_PARAMETER(device);
+
+	*dmabuf_flags = GS_DMABUF_FLAG_NONE;
+	*drm_formats = NULL;
+	*n_formats = 0;
+	return false;
+}
+
+bool device_query_dmabuf_modifiers_for_format(gs_device_t *device,
+					      uint32_t drm_format,
+					      uint64_t **modifiers,
+					      size_t *n_modifiers)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(drm_format);
+
+	*modifiers = NULL;
+	*n_modifiers = 0;
+	return false;
+}
+
+gs_texture_t *device_texture_create_from_pixmap(
+	gs_device_t *device, uint32_t width, uint32_t height,
+	enum gs_color_format color_format, uint32_t target, void *pixmap)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(width);
+	UNUSED_PARAMETER(height);
+	UNUSED_PARAMETER(color_format);
+	UNUSED_PARAMETER(target);
+	UNUSED_PARAMETER(pixmap);
+	return NULL;
+}
+#endif
@@ -0,0 +1,369 @@
+/******************************************************************************
+    Copyright (C) 2013 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#pragma once
+
+/*
+ * Software (CPU) graphics subsystem
+ *
+ *   Headless implementation of the device exports for machines without a
+ * GPU.  Textures live in system memory in their native format, draws are
+ * rasterized on the CPU in horizontal tiles spread across a task pool.  The
+ * common effect passes run through native kernels looked up by effect file
+ * and entry function (see sw-shader.c), every other pass is compiled from
+ * its HLSL and interpreted (see sw-program.c).
+ */
+
+#include <util/darray.h>
+#include <util/threading.h>
+#include <util/task.h>
+#include <graphics/graphics.h>
+#include <graphics/device-exports.h>
+#include <graphics/matrix4.h>
+#include <graphics/vec4.h>
+
+/* rows per raster tile, each tile is one task pool job */
+#define SW_TILE_ROWS 32
+
+/* draws smaller than this many pixels are rasterized on the calling thread */
+#define SW_PARALLEL_MIN_PIXELS (256 * 256)
+
+struct gs_sampler_state {
+	gs_device_t *device;
+	volatile long ref;
+
+	enum gs_sample_filter filter;
+	enum gs_address_mode address_u;
+	enum gs_address_mode address_v;
+	struct vec4 border_color;
+};
+
+static inline void samplerstate_addref(gs_samplerstate_t *ss)
+{
+	os_atomic_inc_long(&ss->ref);
+}
+
+static inline void samplerstate_release(gs_samplerstate_t *ss)
+{
+	if (os_atomic_dec_long(&ss->ref) == 0)
+		bfree(ss);
+}
+
+struct gs_timer {
+	uint64_t begin;
+	uint64_t end;
+};
+
+struct gs_timer_range {
+	int unused;
+};
+
+/* ------------------------------------------------------------------------- */
+/* native shader programs */
+
+enum sw_vertex_program {
+	SW_VS_TRANSFORM,          /* mul(float4(pos, 1), ViewProj) */
+	SW_VS_POS_ID,             /* VSPos: full target triangle from id */
+	SW_VS_TEXPOS_LEFT_ID,     /* VSTexPos_Left: left-sited chroma uvs */
+	SW_VS_TEXPOS_TOPLEFT_ID,  /* VSTexPos_TopLeft: top-left sited uvs */
+	SW_VS_420_LEFT_REVERSE_ID,     /* VS420Left_Reverse */
+	SW_VS_PACKED422_LEFT_REVERSE_ID, /* VSPacked422Left_Reverse */
+};
+
+enum sw_pixel_source {
+	SW_PS_SAMPLE,     /* image.Sample(def_sampler, uv) */
+	SW_PS_SAMPLE_BATCH, /* sample clamped to TEXCOORD1 * linear vertex color */
+	SW_PS_COLOR,      /* uniform color */
+	SW_PS_VERT_COLOR, /* vertex color * uniform color */
+	SW_PS_PLANE_Y,    /* dot(color_vec0, image.Load(pos)) */
+	SW_PS_PLANE_U,    /* dot(color_vec1, image.Load(pos)) */
+	SW_PS_PLANE_V,    /* dot(color_vec2, image.Load(pos)) */
+	SW_PS_WIDE_U,     /* color_vec1 over the average of two samples */
+	SW_PS_WIDE_V,     /* color_vec2 over the average of two samples */
+	SW_PS_WIDE_UV,    /* both chroma planes, two samples */
+	SW_PS_NV12_REVERSE, /* Y load, CbCr sample, YUV_to_RGB */
+	SW_PS_I420_REVERSE, /* Y load, Cb and Cr samples, YUV_to_RGB */
+	SW_PS_I444_REVERSE, /* Y, Cb and Cr loads, YUV_to_RGB */
+	SW_PS_UYVY_REVERSE, /* packed 4:2:2, Y load, CbCr sample */
+	SW_PS_YUY2_REVERSE,
+	SW_PS_YVYU_REVERSE,
+};
+
+#define SW_PS_SRGB_DECOMPRESS (1 << 0)
+#define SW_PS_NONLINEAR_ALPHA (1 << 1)
+#define SW_PS_ALPHA_DIVIDE (1 << 2)
+#define SW_PS_MULTIPLY (1 << 3)
+#define SW_PS_OPAQUE (1 << 4)
+#define SW_PS_UNPREMULTIPLY (1 << 5)
+#define SW_PS_COLOR_MATRIX (1 << 6)
+
+struct sw_pixel_program {
+	enum sw_pixel_source source;
+	uint32_t flags;
+};
+
+struct gs_shader_param {
+	enum gs_shader_param_type type;
+
+	char *name;
+	gs_shader_t *shader;
+	gs_samplerstate_t *next_sampler;
+	int array_count;
+
+	struct gs_texture *texture;
+	bool srgb;
+
+	DARRAY(uint8_t) cur_value;
+	DARRAY(uint8_t) def_value;
+};
+
+struct sw_program;
+
+struct gs_shader {
+	gs_device_t *device;
+	enum gs_shader_type type;
+
+	/* interpreted program, NULL when a native kernel runs the pass */
+	struct sw_program *program;
+
+	enum sw_vertex_program vertex_program;
+	struct sw_pixel_program pixel_program;
+	bool scale_uv;
+
+	struct gs_shader_param *viewproj;
+	struct gs_shader_param *world;
+
+	DARRAY(struct gs_shader_param) params;
+	DARRAY(gs_samplerstate_t *) samplers;
+};
+
+extern bool sw_shader_get_float(gs_shader_t *shader, const char *name,
+				float *val);
+extern bool sw_shader_get_vec4(gs_shader_t *shader, const char *name,
+			       struct vec4 *val);
+extern bool sw_shader_get_matrix4(gs_shader_t *shader, const char *name,
+				  struct matrix4 *val);
+extern struct gs_shader_param *sw_shader_get_image(gs_shader_t *shader,
+						   const char *name);
+
+/* ------------------------------------------------------------------------- */
+
+struct gs_vertex_buffer {
+	gs_device_t *device;
+	struct gs_vb_data *data;
+	size_t num;
+	bool dynamic;
+	bool owned;
+};
+
+struct gs_index_buffer {
+	gs_device_t *device;
+	enum gs_index_type type;
+	void *data;
+	size_t num;
+	size_t width;
+	size_t size;
+	bool dynamic;
+};
+
+struct gs_texture {
+	gs_device_t *device;
+	enum gs_texture_type type;
+	enum gs_color_format format;
+	uint32_t levels;
+	bool is_dynamic;
+	bool is_render_target;
+};
+
+struct gs_texture_2d {
+	struct gs_texture base;
+
+	uint32_t width;
+	uint32_t height;
+	uint32_t texel_size;
+	uint32_t linesize;
+	uint8_t *data;
+};
+
+struct gs_stage_surface {
+	gs_device_t *device;
+
+	enum gs_color_format format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t linesize;
+	uint8_t *data;
+};
+
+struct gs_zstencil_buffer {
+	gs_device_t *device;
+	enum gs_zstencil_format format;
+	uint32_t width;
+	uint32_t height;
+};
+
+/* headless swap chains render into a plain texture that is never shown */
+struct gs_swap_chain {
+	gs_device_t *device;
+	struct gs_init_data info;
+	gs_texture_t *target;
+};
+
+struct sw_blend_state {
+	bool enabled;
+	enum gs_blend_type src_c;
+	enum gs_blend_type dest_c;
+	enum gs_blend_type src_a;
+	enum gs_blend_type dest_a;
+	enum gs_blend_op_type op;
+};
+
+/* vertex program outputs other than the position, by semantic */
+enum sw_attrib {
+	SW_ATTRIB_TEXCOORD0,
+	SW_ATTRIB_TEXCOORD1,
+	SW_ATTRIB_TEXCOORD2,
+	SW_ATTRIB_TEXCOORD3,
+	SW_ATTRIB_TEXCOORD4,
+	SW_ATTRIB_TEXCOORD5,
+	SW_ATTRIB_COLOR,
+	SW_ATTRIB_COLOR1,
+	SW_ATTRIB_NORMAL,
+	SW_ATTRIB_TANGENT,
+	SW_MAX_ATTRIBS
+};
+
+#define SW_MAX_TEXCOORDS (SW_ATTRIB_TEXCOORD5 + 1)
+
+struct sw_vertex {
+	struct vec4 pos;
+	struct vec4 attribs[SW_MAX_ATTRIBS];
+};
+
+struct gs_device {
+	os_task_pool_t *raster_pool;
+	gs_samplerstate_t *default_sampler;
+
+	gs_texture_t *cur_render_target;
+	gs_zstencil_t *cur_zstencil_buffer;
+	gs_texture_t *cur_textures[GS_MAX_TEXTURES];
+	gs_samplerstate_t *cur_samplers[GS_MAX_TEXTURES];
+
+	gs_vertbuffer_t *cur_vertex_buffer;
+	gs_indexbuffer_t *cur_index_buffer;
+	gs_shader_t *cur_vertex_shader;
+	gs_shader_t *cur_pixel_shader;
+	gs_swapchain_t *cur_swap;
+	enum gs_color_space cur_color_space;
+
+	enum gs_cull_mode cur_cull_mode;
+	struct gs_rect cur_viewport;
+	struct gs_rect cur_scissor;
+	bool scissor_enabled;
+	bool framebuffer_srgb;
+	bool write_mask[4];
+	struct sw_blend_state blend;
+
+	struct matrix4 cur_proj;
+	struct matrix4 cur_view;
+	struct matrix4 cur_viewproj;
+	DARRAY(struct matrix4) proj_stack;
+
+	/* scratch reused across draws, only touched by the graphics thread */
+	DARRAY(struct sw_vertex) shaded_verts;
+	DARRAY(struct sw_vertex) tri_verts;
+};
+
+/* ------------------------------------------------------------------------- */
+/* interpreted programs (sw-program.c) */
+
+struct shader_parser;
+
+/* uniforms, textures and samplers of one shader, gathered once per draw */
+struct sw_binding {
+	const struct sw_program *program;
+	float *statics;
+	struct gs_texture_2d *textures[GS_MAX_TEXTURES];
+	bool srgb[GS_MAX_TEXTURES];
+	gs_samplerstate_t *samplers[GS_MAX_TEXTURES];
+};
+
+/* per thread execution state */
+struct sw_exec {
+	const struct sw_binding *binding;
+	float *frame;
+	float *derivs;
+	uint8_t *recorded;
+	uint32_t pending;
+	int mode;
+	bool discarded;
+};
+
+/* one pixel, attributes at the pixel and at its right and lower
+ * neighbours (the latter two only for programs that take derivatives) */
+struct sw_frag {
+	int x;
+	int y;
+	const struct vec4 *attribs;
+	const struct vec4 *attribs_dx;
+	const struct vec4 *attribs_dy;
+};
+
+extern struct sw_program *sw_program_create(enum gs_shader_type type,
+					    struct shader_parser *sp,
+					    char **error);
+extern void sw_program_destroy(struct sw_program *program);
+extern uint32_t sw_program_attribs(const struct sw_program *program);
+extern bool sw_program_uses_derivatives(const struct sw_program *program);
+
+extern void sw_binding_init(struct sw_binding *binding, gs_shader_t *shader);
+extern void sw_binding_free(struct sw_binding *binding);
+
+extern void sw_exec_init(struct sw_exec *exec,
+			 const struct sw_binding *binding);
+extern void sw_exec_free(struct sw_exec *exec);
+
+extern void sw_program_run_vertex(struct sw_exec *exec,
+				  const struct gs_vb_data *data, uint32_t id,
+				  struct sw_vertex *out);
+extern bool sw_program_run_pixel(struct sw_exec *exec,
+				 const struct sw_frag *frag, struct vec4 *out);
+
+/* ------------------------------------------------------------------------- */
+/* rasterizer (sw-raster.c) */
+
+extern void sw_texture_load(const struct gs_texture_2d *tex, uint32_t x,
+			    uint32_t y, bool srgb, struct vec4 *out);
+extern void sw_texture_store(struct gs_texture_2d *tex, uint32_t x,
+			     uint32_t y, bool srgb, const struct vec4 *in);
+extern void sw_texture_fill(struct gs_texture_2d *tex,
+			    const struct vec4 *color);
+extern void sw_texture_sample(const struct gs_texture_2d *tex,
+			      const gs_samplerstate_t *ss, bool srgb, float u,
+			      float v, struct vec4 *out);
+
+extern void sw_draw_triangles(gs_device_t *device, struct gs_texture_2d *rt,
+			      const struct sw_vertex *verts, size_t num_tris);
+
+static inline struct gs_texture_2d *sw_get_target(gs_device_t *device)
+{
+	if (device->cur_render_target)
+		return (struct gs_texture_2d *)device->cur_render_target;
+	if (device->cur_swap)
+		return (struct gs_texture_2d *)device->cur_swap->target;
+	return NULL;
+}
@@ -0,0 +1,416 @@
+/******************************************************************************
+    Copyright (C) 2013 by Hugh Bailey <obs.jim@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include "sw-subsystem.h"
+
+static inline uint32_t get_linesize(enum gs_color_format format, uint32_t cx)
+{
+	uint32_t linesize = cx * gs_get_format_bpp(format) / 8;
+	return (linesize + 31) & ~31U;
+}
+
+gs_texture_t *device_texture_create(gs_device_t *device, uint32_t width,
+				    uint32_t height,
+				    enum gs_color_format color_format,
+				    uint32_t levels, const uint8_t **data,
+				    uint32_t flags)
+{
+	struct gs_texture_2d *tex;
+
+	if (gs_is_compressed_format(color_format) ||
+	    !gs_get_format_bpp(color_format) || !width || !height) {
+		blog(LOG_ERROR,
+		     "device_texture_create (software): "
+		     "unsupported texture %ux%u format %d",
+		     width, height, (int)color_format);
+		return NULL;
+	}
+
+	tex = bzalloc(sizeof(struct gs_texture_2d));
+	tex->base.device = device;
+	tex->base.type = GS_TEXTURE_2D;
+	tex->base.format = color_format;
+	tex->base.levels = levels;
+	tex->base.is_dynamic = (flags & GS_DYNAMIC) != 0;
+	tex->base.is_render_target = (flags & GS_RENDER_TARGET) != 0;
+	tex->width = width;
+	tex->height = height;
+	tex->texel_size = gs_get_format_bpp(color_format) / 8;
+	tex->linesize = get_linesize(color_format, width);
+	tex->data = bmalloc((size_t)tex->linesize * height);
+
+	if (data && *data) {
+		uint32_t row = width * tex->texel_size;
+		for (uint32_t y = 0; y < height; y++)
+			memcpy(tex->data + (size_t)y * tex->linesize,
+			       *data + (size_t)y * row, row);
+	} else {
+		memset(tex->data, 0, (size_t)tex->linesize * height);
+	}
+
+	/* mip levels other than the base level are never sampled here */
+	return (gs_texture_t *)tex;
+}
+
+static inline bool is_texture_2d(const gs_texture_t *tex, const char *func)
+{
+	bool is_tex2d = tex->type == GS_TEXTURE_2D;
+	if (!is_tex2d)
+		blog(LOG_ERROR, "%s (software): Texture is not a 2D texture",
+		     func);
+	return is_tex2d;
+}
+
+void gs_texture_destroy(gs_texture_t *tex)
+{
+	struct gs_texture_2d *tex2d = (struct gs_texture_2d *)tex;
+	if (!tex)
+		return;
+
+	gs_device_t *device = tex->device;
+	for (size_t i = 0; i < GS_MAX_TEXTURES; i++) {
+		if (device->cur_textures[i] == tex)
+			device->cur_textures[i] = NULL;
+	}
+	if (device->cur_render_target == tex)
+		device->cur_render_target = NULL;
+
+	bfree(tex2d->data);
+	bfree(tex);
+}
+
+uint32_t gs_texture_get_width(const gs_texture_t *tex)
+{
+	const struct gs_texture_2d *tex2d = (const struct gs_texture_2d *)tex;
+	if (!is_texture_2d(tex, "gs_texture_get_width"))
+		return 0;
+
+	return tex2d->width;
+}
+
+uint32_t gs_texture_get_height(const gs_texture_t *tex)
+{
+	const struct gs_texture_2d *tex2d = (const struct gs_texture_2d *)tex;
+	if (!is_texture_2d(tex, "gs_texture_get_height"))
+		return 0;
+
+	return tex2d->height;
+}
+
+enum gs_color_format gs_texture_get_color_format(const gs_texture_t *tex)
+{
+	return tex->format;
+}
+
+bool gs_texture_map(gs_texture_t *tex, uint8_t **ptr, uint32_t *linesize)
+{
+	struct gs_texture_2d *tex2d = (struct gs_texture_2d *)tex;
+
+	if (!is_texture_2d(tex, "gs_texture_map"))
+		goto fail;
+
+	if (!tex2d->base.is_dynamic) {
+		blog(LOG_ERROR, "Texture is not dynamic");
+		goto fail;
+	}
+
+	*ptr = tex2d->data;
+	*linesize = tex2d->linesize;
+	return true;
+
+fail:
+	blog(LOG_ERROR, "gs_texture_map (software) failed");
+	return false;
+}
+
+void gs_texture_unmap(gs_texture_t *tex)
+{
+	/* texture memory is written in place */
+	UNUSED_PARAMETER(tex);
+}
+
+bool gs_texture_is_rect(const gs_texture_t *tex)
+{
+	UNUSED_PARAMETER(tex);
+	return false;
+}
+
+void *gs_texture_get_obj(gs_texture_t *tex)
+{
+	struct gs_texture_2d *tex2d = (struct gs_texture_2d *)tex;
+	if (!is_texture_2d(tex, "gs_texture_get_obj"))
+		return NULL;
+
+	return tex2d->data;
+}
+
+/* ------------------------------------------------------------------------- */
+
+gs_texture_t *device_cubetexture_create(gs_device_t *device, uint32_t size,
+					enum gs_color_format color_format,
+					uint32_t levels, const uint8_t **data,
+					uint32_t flags)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(size);
+	UNUSED_PARAMETER(color_format);
+	UNUSED_PARAMETER(levels);
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(flags);
+
+	blog(LOG_ERROR, "device_cubetexture_create (software): "
+			"cube textures are not supported");
+	return NULL;
+}
+
+void gs_cubetexture_destroy(gs_texture_t *cubetex)
+{
+	UNUSED_PARAMETER(cubetex);
+}
+
+uint32_t gs_cubetexture_get_size(const gs_texture_t *cubetex)
+{
+	UNUSED_PARAMETER(cubetex);
+	return 0;
+}
+
+enum gs_color_format
+gs_cubetexture_get_color_format(const gs_texture_t *cubetex)
+{
+	UNUSED_PARAMETER(cubetex);
+	return GS_UNKNOWN;
+}
+
+gs_texture_t *device_voltexture_create(gs_device_t *device, uint32_t width,
+				       uint32_t height, uint32_t depth,
+				       enum gs_color_format color_format,
+				       uint32_t levels,
+				       const uint8_t *const *data,
+				       uint32_t flags)
+{
+	UNUSED_PARAMETER(device);
+	UNUSED_PARAMETER(width);
+	UNUSED_PARAMETER(height);
+	UNUSED_PARAMETER(depth);
+	UNUSED_PARAMETER(color_format);
+	UNUSED_PARAMETER(levels);
+	UNUSED_PARAMETER(data);
+	UNUSED_PARAMETER(flags);
+
+	blog(LOG_ERROR, "device_voltexture_create (software): "
+			"volume textures are not supported");
+	return NULL;
+}
+
+void gs_voltexture_destroy(gs_texture_t *voltex)
+{
+	UNUSED_PARAMETER(voltex);
+}
+
+uint32_t gs_voltexture_get_width(const gs_texture_t *voltex)
+{
+	UNUSED_PARAMETER(voltex);
+	return 0;
+}
+
+uint32_t gs_voltexture_get_height(const gs_texture_t *voltex)
+{
+	UNUSED_PARAMETER(voltex);
+	return 0;
+}
+
+uint32_t gs_voltexture_get_depth(const gs_texture_t *voltex)
+{
+	UNUSED_PARAMETER(voltex);
+	return 0;
+}
+
+enum gs_color_format gs_voltexture_get_color_format(const gs_texture_t *voltex)
+{
+	UNUSED_PARAMETER(voltex);
+	return GS_UNKNOWN;
+}
+
+/* ------------------------------------------------------------------------- */
+
+gs_zstencil_t *device_zstencil_create(gs_device_t *device, uint32_t width,
+				      uint32_t height,
+				      enum gs_zstencil_format format)
+{
+	struct gs_zstencil_buffer *zs;
+
+	/* depth and stencil are not used by any of the 2D rendering paths,
+	 * the buffer only exists so texrenders can be created with one */
+	zs = bzalloc(sizeof(struct gs_zstencil_buffer));
+	zs->device = device;
+	zs->format = format;
+	zs->width = width;
+	zs->height = height;
+	return zs;
+}
+
+void gs_zstencil_destroy(gs_zstencil_t *zs)
+{
+	if (zs && zs->device->cur_zstencil_buffer == zs)
+		zs->device->cur_zstencil_buffer = NULL;
+	bfree(zs);
+}
+
+/* ------------------------------------------------------------------------- */
+
+gs_stagesurf_t *device_stagesurface_create(gs_device_t *device, uint32_t width,
+					   uint32_t height,
+					   enum gs_color_format color_format)
+{
+	struct gs_stage_surface *surf;
+
+	if (gs_is_compressed_format(color_format) ||
+	    !gs_get_format_bpp(color_format)) {
+		blog(LOG_ERROR, "device_stagesurface_create (software) failed");
+		return NULL;
+	}
+
+	surf = bzalloc(sizeof(struct gs_stage_surface));
+	surf->device = device;
+	surf->format = color_format;
+	surf->width = width;
+	surf->height = height;
+	surf->linesize = get_linesize(color_format, width);
+	surf->data = bzalloc((size_t)surf->linesize * height);
+	return surf;
+}
+
+void gs_stagesurface_destroy(gs_stagesurf_t *stagesurf)
+{
+	if (stagesurf) {
+		bfree(stagesurf->data);
+		bfree(stagesurf);
+	}
+}
+
+void device_stage_texture(gs_device_t *device, gs_stagesurf_t *dst,
+			  gs_texture_t *src)
+{
+	struct gs_texture_2d *tex2d = (struct gs_texture_2d *)src;
+
+	if (!src || !is_texture_2d(src, "device_stage_texture"))
+		goto fail;
+	if (tex2d->base.format != dst->format || tex2d->width != dst->width ||
+	    tex2d->height != dst->height) {
+		blog(LOG_ERROR, "Source and destination formats or "
+				"dimensions do not match");
+		goto fail;
+	}
+
+	uint32_t row = dst->width * gs_get_format_bpp(dst->format) / 8;
+	for (uint32_t y = 0; y < dst->height; y++)
+		memcpy(dst->data + (size_t)y * dst->linesize,
+		       tex2d->data + (size_t)y * tex2d->linesize, row);
+
+	UNUSED_PARAMETER(device);
+	return;
+
+fail:
+	blog(LOG_ERROR, "device_stage_texture (software) failed");
+}
+
+uint32_t gs_stagesurface_get_width(const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->width;
+}
+
+uint32_t gs_stagesurface_get_height(const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->height;
+}
+
+enum gs_color_format
+gs_stagesurface_get_color_format(const gs_stagesurf_t *stagesurf)
+{
+	return stagesurf->format;
+}
+
+bool gs_stagesurface_map(gs_stagesurf_t *stagesurf, uint8_t **data,
+			 uint32_t *linesize)
+{
+	*data = stagesurf->data;
+	*linesize = stagesurf->linesize;
+	return true;
+}
+
+void gs_stagesurface_unmap(gs_stagesurf_t *stagesurf)
+{
+	UNUSED_PARAMETER(stagesurf);
+}
+
+/* ------------------------------------------------------------------------- */
+
+void device_copy_texture_region(gs_device_t *device, gs_texture_t *dst,
+				uint32_t dst_x, uint32_t dst_y,
+				gs_texture_t *src, uint32_t src_x,
+				uint32_t src_y, uint32_t src_w, uint32_t src_h)
+{
+	struct gs_texture_2d *src2d = (struct gs_texture_2d *)src;
+	struct gs_texture_2d *dst2d = (struct gs_texture_2d *)dst;
+
+	if (!src) {
+		blog(LOG_ERROR, "Source texture is NULL");
+		goto fail;
+	}
+	if (!dst) {
+		blog(LOG_ERROR, "Destination texture is NULL");
+		goto fail;
+	}
+	if (dst->type != GS_TEXTURE_2D || src->type != GS_TEXTURE_2D) {
+		blog(LOG_ERROR, "Source and destination textures must be 2D "
+				"textures");
+		goto fail;
+	}
+	if (dst->format != src->format) {
+		blog(LOG_ERROR, "Source and destination formats do not match");
+		goto fail;
+	}
+
+	uint32_t nw = src_w ? src_w : src2d->width - src_x;
+	uint32_t nh = src_h ? src_h : src2d->height - src_y;
+
+	if (src_x + nw > src2d->width || src_y + nh > src2d->height ||
+	    dst_x + nw > dst2d->width || dst_y + nh > dst2d->height) {
+		blog(LOG_ERROR, "Copy region is out of bounds");
+		goto fail;
+	}
+
+	uint32_t bpp = gs_get_format_bpp(src->format) / 8;
+	for (uint32_t y = 0; y < nh; y++)
+		memcpy(dst2d->data + (size_t)(dst_y + y) * dst2d->linesize +
+			       (size_t)dst_x * bpp,
+		       src2d->data + (size_t)(src_y + y) * src2d->linesize +
+			       (size_t)src_x * bpp,
+		       (size_t)nw * bpp);
+
+	UNUSED_PARAMETER(device);
+	return;
+
+fail:
+	blog(LOG_ERROR, "device_copy_texture_region (software) failed");
+}
+
+void device_copy_texture(gs_device_t *device, gs_texture_t *dst,
+			 gs_texture_t *src)
+{
+	device_copy_texture_region(device, dst, 0, 0, src, 0, 0, 0, 0);
+}
@@ -1,28 +1,33 @@
 #include <obs-internal.h>
 
-//bool obs_audio_monitoring_available(void)
-//{
-//	return false;
-//}
+/* the macOS target builds the CoreAudio monitor next to this one */
+#ifndef __APPLE__
 
-//void obs_enum_audio_monitoring_devices(obs_enum_audio_device_cb cb, void *data)
-//{
-//	UNUSED_PARAMETER(cb);
-//	UNUSED_PARAMETER(data);
-//}
+bool obs_audio_monitoring_available(void)
+{
+	return false;
+}
 
-//struct audio_monitor *audio_monitor_create(obs_source_t *source)
-//{
-//	UNUSED_PARAMETER(source);
-//	return NULL;
-//}
+void obs_enum_audio_monitoring_devices(obs_enum_audio_device_cb cb, void *data)
+{
+	UNUSED_PARAMETER(cb);
+	UNUSED_PARAMETER(data);
+}
 
-//void audio_monitor_reset(struct audio_monitor *monitor)
-//{
-//	UNUSED_PARAMETER(monitor);
-//}
+struct audio_monitor *audio_monitor_create(obs_source_t *source)
+{
+	UNUSED_PARAMETER(source);
+	return NULL;
+}
 
-//void audio_monitor_destroy(struct audio_monitor *monitor)
-//{
-//	UNUSED_PARAMETER(monitor);
-//}
+void audio_monitor_reset(struct audio_monitor *monitor)
+{
+	UNUSED_PARAMETER(monitor);
+}
+
+void audio_monitor_destroy(struct audio_monitor *monitor)
+{
+	UNUSED_PARAMETER(monitor);
+}
+
+#endif
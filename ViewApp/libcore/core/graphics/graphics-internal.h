@@ -479,6 +479,13 @@ struct gs_exports {
 		void *pixmap);
 #endif
 };
+/* gs_draw_sprite_batch copies its sprites' textures into one of these, one
+ * per texture format, and draws the whole batch from it */
+struct gs_sprite_atlas {
+	enum gs_color_format format;
+	gs_texture_t *tex;
+};
+
 ///源和目标的混合因子
 struct blend_state {
 	bool enabled;
@@ -505,6 +512,8 @@ struct graphics_subsystem {
 	struct gs_effect *cur_effect;
     ///OpenGL的顶点相关的缓冲对象
 	gs_vertbuffer_t *sprite_buffer;
+	gs_vertbuffer_t *sprite_batch_buffer;
+	DARRAY(struct gs_sprite_atlas) sprite_atlases;
     ///更新数据后是否立即绘制(更新数据后有时需要)
 	bool using_immediate;
     //需要暂时缓存起来的顶点数据
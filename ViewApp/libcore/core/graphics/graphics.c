@@ -145,6 +145,31 @@ static bool graphics_init_sprite_vb(struct graphics_subsystem *graphics)
 	return true;
 }
 
+static bool graphics_init_sprite_batch_vb(struct graphics_subsystem *graphics)
+{
+	const size_t num = GS_SPRITE_BATCH_SIZE * 6;
+	struct gs_vb_data *vbd;
+
+	vbd = gs_vbdata_create();
+	vbd->num = num;
+	vbd->points = bzalloc(sizeof(struct vec3) * num);
+	vbd->colors = bzalloc(sizeof(uint32_t) * num);
+	vbd->num_tex = 2;
+	vbd->tvarray = bzalloc(sizeof(struct gs_tvertarray) * 2);
+	vbd->tvarray[0].width = 2;
+	vbd->tvarray[0].array = bzalloc(sizeof(float) * 2 * num);
+	vbd->tvarray[1].width = 4;
+	vbd->tvarray[1].array = bzalloc(sizeof(float) * 4 * num);
+
+	graphics->sprite_batch_buffer =
+		graphics->exports.device_vertexbuffer_create(graphics->device,
+							     vbd, GS_DYNAMIC);
+	if (!graphics->sprite_batch_buffer)
+		return false;
+
+	return true;
+}
+
 static bool graphics_init(struct graphics_subsystem *graphics)
 {
 	struct matrix4 top_mat;
@@ -158,6 +183,8 @@ static bool graphics_init(struct graphics_subsystem *graphics)
 		return false;
 	if (!graphics_init_sprite_vb(graphics))
 		return false;
+	if (!graphics_init_sprite_batch_vb(graphics))
+		return false;
 	if (pthread_mutex_init(&graphics->mutex, NULL) != 0)
 		return false;
 	if (pthread_mutex_init(&graphics->effect_mutex, NULL) != 0)
@@ -241,6 +268,11 @@ void gs_destroy(graphics_t *graphics)
 
 		graphics->exports.gs_vertexbuffer_destroy(
 			graphics->sprite_buffer);
+		graphics->exports.gs_vertexbuffer_destroy(
+			graphics->sprite_batch_buffer);
+		for (size_t i = 0; i < graphics->sprite_atlases.num; i++)
+			graphics->exports.gs_texture_destroy(
+				graphics->sprite_atlases.array[i].tex);
 		graphics->exports.gs_vertexbuffer_destroy(
 			graphics->immediate_vertbuffer);
 		graphics->exports.device_destroy(graphics->device);
@@ -253,6 +285,7 @@ void gs_destroy(graphics_t *graphics)
 	da_free(graphics->matrix_stack);
 	da_free(graphics->viewport_stack);
 	da_free(graphics->blend_state_stack);
+	da_free(graphics->sprite_atlases);
 	if (graphics->module)
 		os_dlclose(graphics->module);
 	bfree(graphics);
@@ -1115,6 +1148,234 @@ void gs_draw_sprite(gs_texture_t *tex, uint32_t flip, uint32_t width,
 	gs_draw(GS_TRISTRIP, 0, 0);
 }
 
+/* the first texel of every atlas is white, solid sprites sample it */
+#define SPRITE_ATLAS_HALF_ONE 0x3C00
+
+static inline bool sprite_atlas_format(enum gs_color_format format)
+{
+	return format == GS_RGBA || format == GS_BGRA || format == GS_RGBA16F;
+}
+
+static gs_texture_t *get_sprite_atlas(graphics_t *graphics,
+				      enum gs_color_format format)
+{
+	struct gs_sprite_atlas *atlas;
+	uint16_t white[4];
+	const uint8_t *data = (const uint8_t *)white;
+	gs_texture_t *texel;
+	gs_texture_t *tex;
+
+	for (size_t i = 0; i < graphics->sprite_atlases.num; i++) {
+		atlas = graphics->sprite_atlases.array + i;
+		if (atlas->format == format)
+			return atlas->tex;
+	}
+
+	if (format == GS_RGBA16F) {
+		for (size_t i = 0; i < 4; i++)
+			white[i] = SPRITE_ATLAS_HALF_ONE;
+	} else {
+		memset(white, 0xFF, sizeof(white));
+	}
+
+	texel = gs_texture_create(1, 1, format, 1, &data, 0);
+	tex = gs_texture_create(GS_SPRITE_ATLAS_SIZE, GS_SPRITE_ATLAS_SIZE,
+				format, 1, NULL, 0);
+	if (!texel || !tex) {
+		blog(LOG_ERROR, "Failed to create sprite atlas");
+		gs_texture_destroy(texel);
+		gs_texture_destroy(tex);
+		return NULL;
+	}
+
+	gs_copy_texture_region(tex, 0, 0, texel, 0, 0, 1, 1);
+	gs_texture_destroy(texel);
+
+	atlas = da_push_back_new(graphics->sprite_atlases);
+	atlas->format = format;
+	atlas->tex = tex;
+	return tex;
+}
+
+/* fills the atlas in rows as high as their highest sprite */
+struct sprite_packer {
+	uint32_t x;
+	uint32_t y;
+	uint32_t row_cy;
+};
+
+static bool pack_sprite(struct sprite_packer *packer, uint32_t cx,
+			uint32_t cy, uint32_t *x, uint32_t *y)
+{
+	if (packer->x + cx > GS_SPRITE_ATLAS_SIZE) {
+		packer->x = 0;
+		packer->y += packer->row_cy;
+		packer->row_cy = 0;
+	}
+	if (cx > GS_SPRITE_ATLAS_SIZE ||
+	    packer->y + cy > GS_SPRITE_ATLAS_SIZE)
+		return false;
+
+	*x = packer->x;
+	*y = packer->y;
+	packer->x += cx;
+	if (cy > packer->row_cy)
+		packer->row_cy = cy;
+	return true;
+}
+
+bool gs_sprite_batch_supported(gs_texture_t *tex, uint32_t cx, uint32_t cy)
+{
+	if (!gs_valid("gs_sprite_batch_supported"))
+		return false;
+	if (!tex)
+		return true;
+
+	/* bigger sprites leave room for few others in the atlas, and are
+	 * bound by fill rate more than by draw calls anyway */
+	return gs_get_texture_type(tex) == GS_TEXTURE_2D &&
+	       !gs_texture_is_rect(tex) &&
+	       sprite_atlas_format(gs_texture_get_color_format(tex)) &&
+	       cx <= GS_SPRITE_ATLAS_SIZE / 2 && cy <= GS_SPRITE_ATLAS_SIZE / 2;
+}
+
+static void build_batch_sprite(struct gs_vb_data *data, size_t idx,
+			       const struct gs_sprite_batch_item *sprite,
+			       uint32_t atlas_x, uint32_t atlas_y)
+{
+	/* two triangles wound like the sprite strip */
+	static const size_t corners[6] = {0, 1, 2, 2, 1, 3};
+	const float texel = 1.0f / (float)GS_SPRITE_ATLAS_SIZE;
+	struct vec3 *points = data->points + idx * 6;
+	uint32_t *colors = data->colors + idx * 6;
+	struct vec2 *uvs = (struct vec2 *)data->tvarray[0].array + idx * 6;
+	float *bounds = (float *)data->tvarray[1].array + idx * 6 * 4;
+	float fcx = (float)sprite->cx;
+	float fcy = (float)sprite->cy;
+	struct vec3 pos[4];
+	struct vec2 uv[4];
+	struct vec4 bound;
+
+	if (sprite->tex) {
+		float u0 = (float)atlas_x * texel;
+		float v0 = (float)atlas_y * texel;
+		float u1 = u0 + fcx * texel;
+		float v1 = v0 + fcy * texel;
+
+		vec2_set(uv, u0, v0);
+		vec2_set(uv + 1, u1, v0);
+		vec2_set(uv + 2, u0, v1);
+		vec2_set(uv + 3, u1, v1);
+
+		/* keeps bilinear taps off the neighbouring sprites */
+		vec4_set(&bound, u0 + 0.5f * texel, v0 + 0.5f * texel,
+			 u1 - 0.5f * texel, v1 - 0.5f * texel);
+	} else {
+		for (size_t i = 0; i < 4; i++)
+			vec2_set(uv + i, 0.5f * texel, 0.5f * texel);
+		vec4_set(&bound, 0.5f * texel, 0.5f * texel, 0.5f * texel,
+			 0.5f * texel);
+	}
+
+	/* transform on the CPU so every sprite shares the world matrix */
+	vec3_zero(pos);
+	vec3_set(pos + 1, fcx, 0.0f, 0.0f);
+	vec3_set(pos + 2, 0.0f, fcy, 0.0f);
+	vec3_set(pos + 3, fcx, fcy, 0.0f);
+	for (size_t i = 0; i < 4; i++)
+		vec3_transform(pos + i, pos + i, sprite->transform);
+
+	for (size_t i = 0; i < 6; i++) {
+		points[i] = pos[corners[i]];
+		uvs[i] = uv[corners[i]];
+		colors[i] = sprite->color;
+		memcpy(bounds + i * 4, bound.ptr, sizeof(float) * 4);
+	}
+}
+
+/* packs sprites into one atlas until it is full, a texture of another
+ * format comes up, or the vertex buffer is full; returns how many */
+static size_t fill_sprite_batch(graphics_t *graphics,
+				const struct gs_sprite_batch_item *sprites,
+				size_t count, gs_texture_t **p_atlas)
+{
+	struct gs_vb_data *data =
+		gs_vertexbuffer_get_data(graphics->sprite_batch_buffer);
+	struct sprite_packer packer = {1, 0, 1};
+	gs_texture_t *atlas = NULL;
+	enum gs_color_format format = GS_UNKNOWN;
+	size_t num = 0;
+
+	for (; num < count && num < GS_SPRITE_BATCH_SIZE; num++) {
+		const struct gs_sprite_batch_item *sprite = sprites + num;
+		uint32_t x = 0;
+		uint32_t y = 0;
+
+		if (sprite->tex) {
+			enum gs_color_format tex_format =
+				gs_texture_get_color_format(sprite->tex);
+
+			if (atlas && tex_format != format)
+				break;
+			if (!atlas) {
+				atlas = get_sprite_atlas(graphics, tex_format);
+				if (!atlas)
+					break;
+				format = tex_format;
+			}
+			if (!pack_sprite(&packer, sprite->cx, sprite->cy, &x,
+					 &y))
+				break;
+
+			gs_copy_texture_region(atlas, x, y, sprite->tex,
+					       sprite->x, sprite->y,
+					       sprite->cx, sprite->cy);
+		}
+
+		build_batch_sprite(data, num, sprite, x, y);
+	}
+
+	if (!atlas && num)
+		atlas = get_sprite_atlas(graphics, GS_RGBA);
+
+	*p_atlas = atlas;
+	return num;
+}
+
+void gs_draw_sprite_batch(gs_eparam_t *image, bool srgb,
+			  const struct gs_sprite_batch_item *sprites,
+			  size_t count)
+{
+	graphics_t *graphics = thread_graphics;
+
+	if (!gs_valid_p2("gs_draw_sprite_batch", image, sprites))
+		return;
+
+	while (count) {
+		gs_texture_t *atlas;
+		size_t num = fill_sprite_batch(graphics, sprites, count, &atlas);
+
+		if (!num || !atlas) {
+			blog(LOG_ERROR, "gs_draw_sprite_batch: no sprite atlas "
+					"for the sprite");
+			num = num ? num : 1;
+		} else {
+			if (srgb)
+				gs_effect_set_texture_srgb(image, atlas);
+			else
+				gs_effect_set_texture(image, atlas);
+
+			gs_vertexbuffer_flush(graphics->sprite_batch_buffer);
+			gs_load_vertexbuffer(graphics->sprite_batch_buffer);
+			gs_load_indexbuffer(NULL);
+			gs_draw(GS_TRIS, 0, (uint32_t)(num * 6));
+		}
+
+		sprites += num;
+		count -= num;
+	}
+}
+
 void gs_draw_sprite_subregion(gs_texture_t *tex, uint32_t flip, uint32_t sub_x,
 			      uint32_t sub_y, uint32_t sub_cx, uint32_t sub_cy)
 {
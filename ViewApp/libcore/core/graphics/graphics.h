@@ -580,6 +580,7 @@ struct gs_init_data {
 
 #define GS_DEVICE_OPENGL 1
 #define GS_DEVICE_DIRECT3D_11 2
+#define GS_DEVICE_SOFTWARE 3
 
 //一些常量
 EXPORT const char *gs_get_device_name(void);
@@ -694,6 +695,37 @@ EXPORT void gs_draw_sprite_subregion(gs_texture_t *tex, uint32_t flip,
 				     uint32_t x, uint32_t y, uint32_t cx,
 				     uint32_t cy);
 
+struct gs_sprite_batch_item {
+	/** NULL draws a solid rectangle of color */
+	gs_texture_t *tex;
+	/** Region of tex to draw, its size is also the sprite's size */
+	uint32_t x;
+	uint32_t y;
+	uint32_t cx;
+	uint32_t cy;
+	/** 0xAABBGGRR in sRGB, premultiplied in linear and multiplied with
+	 * the texture */
+	uint32_t color;
+	/** Applied on top of the current matrix */
+	const struct matrix4 *transform;
+};
+
+/**
+ * Draws 2D sprites with the current effect pass and blend state, which must
+ * be one of the default effect's DrawBatch techniques.  The sprites' regions
+ * are copied into an atlas texture set on image, and up to
+ * GS_SPRITE_BATCH_SIZE sprites sharing an atlas go out in one draw.  Use
+ * gs_sprite_batch_supported to check a texture first.
+ */
+#define GS_SPRITE_BATCH_SIZE 256
+#define GS_SPRITE_ATLAS_SIZE 2048
+
+EXPORT bool gs_sprite_batch_supported(gs_texture_t *tex, uint32_t cx,
+				      uint32_t cy);
+EXPORT void gs_draw_sprite_batch(gs_eparam_t *image, bool srgb,
+				 const struct gs_sprite_batch_item *sprites,
+				 size_t count);
+
 EXPORT void gs_draw_cube_backdrop(gs_texture_t *cubetex, const struct quat *rot,
 				  float left, float right, float top,
 				  float bottom, float znear);
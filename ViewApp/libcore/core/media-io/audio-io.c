@@ -28,6 +28,19 @@
 #include "audio-io.h"
 #include "audio-resampler.h"
 
+#if (defined(__x86_64__) || defined(__i386__)) && \
+	(defined(__GNUC__) || defined(__clang__))
+#define AUDIO_MIX_DISPATCH
+
+/* has to come before simde, which defines some of the same names as
+ * macros.  unoptimized builds get _mm_round_ps as a macro as well, drop it
+ * so simde's alias doesn't redefine it */
+#include <immintrin.h>
+#undef _mm_round_ps
+#endif
+
+#include "../util/sse-intrin.h"
+
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
@@ -86,6 +99,193 @@ struct audio_output {
     
 };
 
+/* ------------------------------------------------------------------------- */
+/* Mixing kernels.  The base versions use SSE2, which on ARM goes through
+ * simde's NEON mappings; x86 picks AVX2 at runtime when it's there.  Every
+ * lane does the same multiply and add as the scalar tail, so results don't
+ * depend on which version ran. */
+
+static inline void mix_add_sse2(float *dst, const float *src, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 val = _mm_add_ps(_mm_loadu_ps(dst + i),
+					_mm_loadu_ps(src + i));
+		_mm_storeu_ps(dst + i, val);
+	}
+	for (; i < count; i++)
+		dst[i] += src[i];
+}
+
+static inline void mix_scale_sse2(float *buf, float gain, size_t count)
+{
+	const __m128 gain_vec = _mm_set1_ps(gain);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(buf + i, _mm_mul_ps(_mm_loadu_ps(buf + i),
+						  gain_vec));
+	for (; i < count; i++)
+		buf[i] *= gain;
+}
+
+static inline void mix_add_mul_sse2(float *dst, const float *src,
+				    const float *gain, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 val = _mm_mul_ps(_mm_loadu_ps(src + i),
+					_mm_loadu_ps(gain + i));
+		_mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), val));
+	}
+	for (; i < count; i++)
+		dst[i] += src[i] * gain[i];
+}
+
+/* NaN becomes 0, the rest is clamped to -1..1; the raw samples also go to
+ * unclamped when it isn't NULL */
+static inline void mix_clamp_sse2(float *buf, float *unclamped, size_t count)
+{
+	const __m128 min_vec = _mm_set1_ps(-1.0f);
+	const __m128 max_vec = _mm_set1_ps(1.0f);
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4) {
+		__m128 val = _mm_loadu_ps(buf + i);
+
+		if (unclamped)
+			_mm_storeu_ps(unclamped + i, val);
+
+		val = _mm_and_ps(val, _mm_cmpord_ps(val, val));
+		val = _mm_min_ps(_mm_max_ps(val, min_vec), max_vec);
+		_mm_storeu_ps(buf + i, val);
+	}
+	for (; i < count; i++) {
+		float val = buf[i];
+
+		if (unclamped)
+			unclamped[i] = val;
+
+		val = (val == val) ? val : 0.0f;
+		val = (val > 1.0f) ? 1.0f : val;
+		val = (val < -1.0f) ? -1.0f : val;
+		buf[i] = val;
+	}
+}
+
+#ifdef AUDIO_MIX_DISPATCH
+
+/* no fma here on purpose, a fused multiply-add rounds differently */
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+static bool has_avx2(void)
+{
+	static volatile int avx2 = -1;
+
+	if (avx2 < 0) {
+		__builtin_cpu_init();
+		avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+	}
+
+	return avx2 == 1;
+}
+
+TARGET_AVX2 static void mix_add_avx2(float *dst, const float *src,
+				     size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 val = _mm256_add_ps(_mm256_loadu_ps(dst + i),
+					   _mm256_loadu_ps(src + i));
+		_mm256_storeu_ps(dst + i, val);
+	}
+	mix_add_sse2(dst + i, src + i, count - i);
+}
+
+TARGET_AVX2 static void mix_scale_avx2(float *buf, float gain, size_t count)
+{
+	const __m256 gain_vec = _mm256_set1_ps(gain);
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8)
+		_mm256_storeu_ps(buf + i, _mm256_mul_ps(_mm256_loadu_ps(buf + i),
+							gain_vec));
+	mix_scale_sse2(buf + i, gain, count - i);
+}
+
+TARGET_AVX2 static void mix_add_mul_avx2(float *dst, const float *src,
+					 const float *gain, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 val = _mm256_mul_ps(_mm256_loadu_ps(src + i),
+					   _mm256_loadu_ps(gain + i));
+		_mm256_storeu_ps(dst + i,
+				 _mm256_add_ps(_mm256_loadu_ps(dst + i), val));
+	}
+	mix_add_mul_sse2(dst + i, src + i, gain + i, count - i);
+}
+
+TARGET_AVX2 static void mix_clamp_avx2(float *buf, float *unclamped,
+				       size_t count)
+{
+	const __m256 min_vec = _mm256_set1_ps(-1.0f);
+	const __m256 max_vec = _mm256_set1_ps(1.0f);
+	size_t i = 0;
+
+	for (; i + 8 <= count; i += 8) {
+		__m256 val = _mm256_loadu_ps(buf + i);
+
+		if (unclamped)
+			_mm256_storeu_ps(unclamped + i, val);
+
+		val = _mm256_and_ps(val, _mm256_cmp_ps(val, val, _CMP_ORD_Q));
+		val = _mm256_min_ps(_mm256_max_ps(val, min_vec), max_vec);
+		_mm256_storeu_ps(buf + i, val);
+	}
+	mix_clamp_sse2(buf + i, unclamped ? unclamped + i : NULL, count - i);
+}
+
+#define DISPATCH(func, ...)                     \
+	do {                                    \
+		if (has_avx2()) {               \
+			func##_avx2(__VA_ARGS__); \
+			return;                 \
+		}                               \
+	} while (false)
+#else
+#define DISPATCH(func, ...)
+#endif
+
+void audio_mix_add(float *dst, const float *src, size_t count)
+{
+	DISPATCH(mix_add, dst, src, count);
+	mix_add_sse2(dst, src, count);
+}
+
+void audio_mix_scale(float *buf, float gain, size_t count)
+{
+	DISPATCH(mix_scale, buf, gain, count);
+	mix_scale_sse2(buf, gain, count);
+}
+
+void audio_mix_add_mul(float *dst, const float *src, const float *gain,
+		       size_t count)
+{
+	DISPATCH(mix_add_mul, dst, src, gain, count);
+	mix_add_mul_sse2(dst, src, gain, count);
+}
+
+static void mix_clamp(float *buf, float *unclamped, size_t count)
+{
+	DISPATCH(mix_clamp, buf, unclamped, count);
+	mix_clamp_sse2(buf, unclamped, count);
+}
+
 /* ------------------------------------------------------------------------- */
 
 static bool resample_audio_output(struct audio_input *input,
@@ -112,21 +312,48 @@ static bool resample_audio_output(struct audio_input *input,
 
 	return success;
 }
+/* what each mix produces this tick, taken from its inputs before mixing */
+struct mix_outputs {
+	uint32_t active;
+	uint32_t clamped;
+	uint32_t unclamped;
+};
+
 ///=====输出到编码器
 static inline void do_audio_output(struct audio_output *audio, size_t mix_idx,
+				   const struct mix_outputs *outputs,
 				   uint64_t timestamp, uint32_t frames)
 {
 	struct audio_mix *mix = &audio->mixes[mix_idx];
+	uint32_t mix_bit = 1 << mix_idx;
+	bool clamped = (outputs->clamped & mix_bit) != 0;
+	bool unclamped = (outputs->unclamped & mix_bit) != 0;
 	struct audio_data data;
 
+	/* nothing was mixed for inputs connected after the tick started */
+	if ((outputs->active & mix_bit) == 0)
+		return;
+
 	pthread_mutex_lock(&audio->input_mutex);
 
 	for (size_t i = mix->inputs.num; i > 0; i--) {
 		struct audio_input *input = mix->inputs.array + (i - 1);
+		float(*buf)[AUDIO_OUTPUT_FRAMES];
+
+		/* without clamped inputs the buffer is left unclamped */
+		if (input->conversion.allow_clipping) {
+			if (!clamped)
+				buf = mix->buffer;
+			else if (unclamped)
+				buf = mix->buffer_unclamped;
+			else
+				continue;
+		} else {
+			if (!clamped)
+				continue;
+			buf = mix->buffer;
+		}
 
-		float(*buf)[AUDIO_OUTPUT_FRAMES] =
-			input->conversion.allow_clipping ? mix->buffer_unclamped
-							 : mix->buffer;
 		for (size_t i = 0; i < audio->planes; i++)
 			data.data[i] = (uint8_t *)buf[i];
 
@@ -140,31 +367,48 @@ static inline void do_audio_output(struct audio_output *audio, size_t mix_idx,
 	pthread_mutex_unlock(&audio->input_mutex);
 }
 
-static inline void clamp_audio_output(struct audio_output *audio, size_t bytes)
+static void get_mix_outputs(struct audio_output *audio,
+			    struct mix_outputs *outputs)
+{
+	memset(outputs, 0, sizeof(*outputs));
+
+	pthread_mutex_lock(&audio->input_mutex);
+	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
+		struct audio_mix *mix = &audio->mixes[mix_idx];
+		uint32_t mix_bit = 1 << mix_idx;
+
+		for (size_t i = 0; i < mix->inputs.num; i++) {
+			if (mix->inputs.array[i].conversion.allow_clipping)
+				outputs->unclamped |= mix_bit;
+			else
+				outputs->clamped |= mix_bit;
+		}
+	}
+	pthread_mutex_unlock(&audio->input_mutex);
+
+	outputs->active = outputs->clamped | outputs->unclamped;
+}
+
+static inline void clamp_audio_output(struct audio_output *audio,
+				      const struct mix_outputs *outputs,
+				      size_t bytes)
 {
 	size_t float_size = bytes / sizeof(float);
 
 	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
 		struct audio_mix *mix = &audio->mixes[mix_idx];
+		uint32_t mix_bit = 1 << mix_idx;
+		bool unclamped = (outputs->unclamped & mix_bit) != 0;
 
-		/* do not process mixing if a specific mix is inactive */
-		if (!mix->inputs.num)
+		/* unclamped-only mixes are sent straight from the buffer */
+		if ((outputs->clamped & mix_bit) == 0)
 			continue;
 
-		for (size_t plane = 0; plane < audio->planes; plane++) {
-			float *mix_data = mix->buffer[plane];
-			float *mix_end = &mix_data[float_size];
-			/* Unclamped mix is copied directly. */
-			memcpy(mix->buffer_unclamped[plane], mix_data, bytes);
-
-			while (mix_data < mix_end) {
-				float val = *mix_data;
-				val = (val == val) ? val : 0.0f;
-				val = (val > 1.0f) ? 1.0f : val;
-				val = (val < -1.0f) ? -1.0f : val;
-				*(mix_data++) = val;
-			}
-		}
+		for (size_t plane = 0; plane < audio->planes; plane++)
+			mix_clamp(mix->buffer[plane],
+				  unclamped ? mix->buffer_unclamped[plane]
+					    : NULL,
+				  float_size);
 	}
 }
 ///=====混音&&输出到编码器 audio_time当前tick的时间  prev_time上一次tick的时间
@@ -173,7 +417,7 @@ static void input_and_output(struct audio_output *audio, uint64_t audio_time,
 {
 	size_t bytes = AUDIO_OUTPUT_FRAMES * audio->block_size;
 	struct audio_output_data data[MAX_AUDIO_MIXES];
-	uint32_t active_mixes = 0;
+	struct mix_outputs outputs;
 	uint64_t new_ts = 0;
 	bool success;
 
@@ -185,35 +429,33 @@ static void input_and_output(struct audio_output *audio, uint64_t audio_time,
 #endif
 
 	/* get mixers */
-	pthread_mutex_lock(&audio->input_mutex);
-	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++) {
-		if (audio->mixes[i].inputs.num)
-			active_mixes |= (1 << i);
-	}
-	pthread_mutex_unlock(&audio->input_mutex);
+	get_mix_outputs(audio, &outputs);
 
-	/* clear mix buffers */
+	/* clear mix buffers, only mixes somebody listens to get mixed into */
 	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
 		struct audio_mix *mix = &audio->mixes[mix_idx];
+		bool active = (outputs.active & (1 << mix_idx)) != 0;
 
-		memset(mix->buffer, 0, sizeof(mix->buffer));
-
-		for (size_t i = 0; i < audio->planes; i++)
+		for (size_t i = 0; i < audio->planes; i++) {
+			if (active)
+				memset(mix->buffer[i], 0, bytes);
 			data[mix_idx].data[i] = mix->buffer[i];
+		}
 	}
 
 	/* get new audio data  音频IO线程获取音频数据回调   */
 	success = audio->input_cb(audio->input_param, prev_time, audio_time,
-				  &new_ts, active_mixes, data);
+				  &new_ts, outputs.active, data);
 	if (!success)
 		return;
 
 	/* clamps(限制) audio data to -1.0..1.0 */
-	clamp_audio_output(audio, bytes);
+	clamp_audio_output(audio, &outputs, bytes);
 
 	/* output */
 	for (size_t i = 0; i < MAX_AUDIO_MIXES; i++)
-		do_audio_output(audio, i, new_ts, AUDIO_OUTPUT_FRAMES);
+		do_audio_output(audio, i, &outputs, new_ts,
+				AUDIO_OUTPUT_FRAMES);
 }
 
 static void *audio_thread(void *param)
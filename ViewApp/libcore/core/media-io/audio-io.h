@@ -239,6 +239,12 @@ EXPORT uint32_t audio_output_get_sample_rate(const audio_t *audio);
 EXPORT const struct audio_output_info *
 audio_output_get_info(const audio_t *audio);
 
+/* mixing kernels: dst += src, buf *= gain, dst += src * gain[i] */
+EXPORT void audio_mix_add(float *dst, const float *src, size_t count);
+EXPORT void audio_mix_scale(float *buf, float gain, size_t count);
+EXPORT void audio_mix_add_mul(float *dst, const float *src, const float *gain,
+			      size_t count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,130 @@
+/*
+ * Micro-benchmark for the audio mix kernels in audio-io.c.
+ *
+ * Mixes SOURCES sources into every mix and channel the way audio_callback
+ * does once per tick, first with plain scalar loops and then with
+ * audio_mix_add/audio_mix_scale/audio_mix_add_mul.  The kernels have to
+ * produce exactly the same floats as the scalar loops, odd lengths and
+ * unaligned starts included.
+ *
+ * Standalone program, not part of any target.  Build it against the
+ * libcore framework, which exports the kernels and os_gettime_ns:
+ *   cc -O2 -I<libcore/core> -F<build dir> -framework libcore \
+ *      audio-mix-bench.c -o audio-mix-bench
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <util/platform.h>
+#include <media-io/audio-io.h>
+
+#define CHECK(condition)                                                    \
+	do {                                                                \
+		if (!(condition)) {                                         \
+			fprintf(stderr, "%s:%d: error: check failed: %s\n", \
+				__FILE__, __LINE__, #condition);            \
+			exit(1);                                            \
+		}                                                           \
+	} while (0)
+
+#define SOURCES 40
+#define MIXES MAX_AUDIO_MIXES
+#define CHANNELS 2
+#define FRAMES AUDIO_OUTPUT_FRAMES
+#define TICKS 2000
+
+static float src[SOURCES][MIXES][CHANNELS][FRAMES];
+static float mix_ref[MIXES][CHANNELS][FRAMES];
+static float mix_out[MIXES][CHANNELS][FRAMES];
+static float gain[FRAMES];
+
+static void __attribute__((noinline))
+scalar_add(float *dst, const float *src, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		dst[i] += src[i];
+}
+
+static void __attribute__((noinline))
+scalar_scale(float *buf, float gain, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		buf[i] *= gain;
+}
+
+static void __attribute__((noinline))
+scalar_add_mul(float *dst, const float *src, const float *gain, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		dst[i] += src[i] * gain[i];
+}
+
+static void test_matches_scalar(void)
+{
+	memset(mix_ref, 0, sizeof(mix_ref));
+	memset(mix_out, 0, sizeof(mix_out));
+
+	for (size_t s = 0; s < SOURCES; s++) {
+		for (size_t m = 0; m < MIXES; m++) {
+			for (size_t c = 0; c < CHANNELS; c++) {
+				size_t start = (s * 7) % 13;
+				const float *in = src[s][m][c];
+
+				scalar_add(mix_ref[m][c] + start, in,
+					   FRAMES - start);
+				audio_mix_add(mix_out[m][c] + start, in,
+					      FRAMES - start);
+
+				scalar_add_mul(mix_ref[m][c], in, gain,
+					       FRAMES - 3);
+				audio_mix_add_mul(mix_out[m][c], in, gain,
+						  FRAMES - 3);
+
+				scalar_scale(mix_ref[m][c], 0.99f, FRAMES - 1);
+				audio_mix_scale(mix_out[m][c], 0.99f,
+						FRAMES - 1);
+			}
+		}
+	}
+
+	CHECK(memcmp(mix_ref, mix_out, sizeof(mix_ref)) == 0);
+}
+
+#define BENCH(name, call)                                                     \
+	do {                                                                  \
+		uint64_t start = os_gettime_ns();                             \
+		for (int tick = 0; tick < TICKS; tick++)                      \
+			for (size_t s = 0; s < SOURCES; s++)                  \
+				for (size_t m = 0; m < MIXES; m++)            \
+					for (size_t c = 0; c < CHANNELS; c++) \
+						call;                         \
+		double us = (double)(os_gettime_ns() - start) / 1000.0 /     \
+			    TICKS;                                            \
+		printf("%-20s %8.1f us/tick\n", name, us);                   \
+	} while (0)
+
+int main(void)
+{
+	for (size_t i = 0; i < sizeof(src) / sizeof(float); i++)
+		((float *)src)[i] = (float)rand() / (float)RAND_MAX * 2.0f - 1.0f;
+	for (size_t i = 0; i < FRAMES; i++)
+		gain[i] = (float)i / (float)FRAMES;
+
+	test_matches_scalar();
+
+	printf("%d sources, %d mixes, %d channels, %d frames\n", SOURCES,
+	       MIXES, CHANNELS, FRAMES);
+
+	BENCH("scalar add", scalar_add(mix_ref[m][c], src[s][m][c], FRAMES));
+	BENCH("audio_mix_add",
+	      audio_mix_add(mix_out[m][c], src[s][m][c], FRAMES));
+	BENCH("scalar scale", scalar_scale(src[s][m][c], 1.0f, FRAMES));
+	BENCH("audio_mix_scale", audio_mix_scale(src[s][m][c], 1.0f, FRAMES));
+	BENCH("scalar add_mul",
+	      scalar_add_mul(mix_ref[m][c], src[s][m][c], gain, FRAMES));
+	BENCH("audio_mix_add_mul",
+	      audio_mix_add_mul(mix_out[m][c], src[s][m][c], gain, FRAMES));
+
+	return 0;
+}
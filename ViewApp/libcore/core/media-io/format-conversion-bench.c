@@ -0,0 +1,291 @@
+/*
+ * Micro-benchmark for the packed/planar YUV kernels in format-conversion.c.
+ *
+ * Runs every kernel at 720p through 4K, once with the base SSE2/C version
+ * that used to be the only one and then with each AVX2/AVX-512 variant the
+ * CPU supports.  Every variant has to write exactly the same bytes as the
+ * base version; the 1352x760 size leaves a tail on every vector width.
+ *
+ * Standalone program, not part of any target.  It builds format-conversion.c
+ * in directly to reach the per-level kernels:
+ *   cc -O2 -I<libcore/core> format-conversion-bench.c \
+ *      -o format-conversion-bench
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "format-conversion.c"
+
+#define CHECK(condition)                                                    \
+	do {                                                                \
+		if (!(condition)) {                                         \
+			fprintf(stderr, "%s:%d: error: check failed: %s\n", \
+				__FILE__, __LINE__, #condition);            \
+			exit(1);                                            \
+		}                                                           \
+	} while (0)
+
+/* pixels converted per measurement, split into whole frames */
+#define PIXEL_BUDGET 100000000ULL
+
+/* the decompress kernels read and write past a line the way the originals
+ * do, keep a few lines of slack after every buffer */
+#define SLACK_LINES 4
+
+#ifndef FORMAT_CONVERSION_DISPATCH
+enum simd_level {
+	SIMD_LEVEL_BASE,
+};
+
+static enum simd_level get_simd_level(void)
+{
+	return SIMD_LEVEL_BASE;
+}
+#endif
+
+static const char *level_names[] = {"base", "avx2", "avx512"};
+
+struct bench_size {
+	const char *name;
+	uint32_t cx;
+	uint32_t cy;
+};
+
+static const struct bench_size sizes[] = {
+	{"720p", 1280, 720},   {"tails", 1352, 760}, {"1080p", 1920, 1080},
+	{"1440p", 2560, 1440}, {"4K", 3840, 2160},
+};
+
+struct frame {
+	uint32_t cx;
+	uint32_t cy;
+
+	uint8_t *uyvx;
+	uint8_t *planes[3];
+	uint8_t *packed;
+
+	uint8_t *out[3];
+	uint8_t *out_packed;
+	size_t plane_size;
+	size_t packed_size;
+};
+
+static uint8_t *alloc_random(size_t size)
+{
+	uint8_t *data = aligned_alloc(64, (size + 63) & ~(size_t)63);
+	CHECK(data != NULL);
+
+	for (size_t i = 0; i < size; i++)
+		data[i] = (uint8_t)rand();
+	return data;
+}
+
+static void frame_init(struct frame *f, uint32_t cx, uint32_t cy)
+{
+	f->cx = cx;
+	f->cy = cy;
+	f->plane_size = (size_t)cx * (cy + SLACK_LINES);
+	f->packed_size = (size_t)cx * 4 * (cy + SLACK_LINES);
+
+	f->uyvx = alloc_random(f->packed_size);
+	f->packed = alloc_random(f->packed_size);
+	f->out_packed = alloc_random(f->packed_size);
+	for (size_t i = 0; i < 3; i++) {
+		f->planes[i] = alloc_random(f->plane_size);
+		f->out[i] = alloc_random(f->plane_size);
+	}
+}
+
+static void frame_free(struct frame *f)
+{
+	free(f->uyvx);
+	free(f->packed);
+	free(f->out_packed);
+	for (size_t i = 0; i < 3; i++) {
+		free(f->planes[i]);
+		free(f->out[i]);
+	}
+}
+
+static void frame_clear_output(struct frame *f)
+{
+	memset(f->out_packed, 0xCD, f->packed_size);
+	for (size_t i = 0; i < 3; i++)
+		memset(f->out[i], 0xCD, f->plane_size);
+}
+
+/* ------------------------------------------------------------------------- */
+
+#ifdef FORMAT_CONVERSION_DISPATCH
+#define RUN_LEVEL(func, base_func, ...)          \
+	switch (level) {                         \
+	case SIMD_LEVEL_AVX512:                  \
+		func##_avx512(__VA_ARGS__);      \
+		break;                           \
+	case SIMD_LEVEL_AVX2:                    \
+		func##_avx2(__VA_ARGS__);        \
+		break;                           \
+	case SIMD_LEVEL_BASE:                    \
+		base_func(__VA_ARGS__, 0);       \
+		break;                           \
+	}
+#else
+#define RUN_LEVEL(func, base_func, ...) \
+	do {                            \
+		UNUSED_PARAMETER(level);\
+		base_func(__VA_ARGS__, 0); \
+	} while (false)
+#endif
+
+static void run_uyvx_to_i420(enum simd_level level, struct frame *f)
+{
+	const uint32_t linesize[] = {f->cx, f->cx / 2, f->cx / 2};
+	RUN_LEVEL(compress_uyvx_to_i420, compress_uyvx_to_i420_sse2, f->uyvx,
+		  f->cx * 4, 0, f->cy, f->out, linesize);
+}
+
+static void run_uyvx_to_nv12(enum simd_level level, struct frame *f)
+{
+	const uint32_t linesize[] = {f->cx, f->cx};
+	RUN_LEVEL(compress_uyvx_to_nv12, compress_uyvx_to_nv12_sse2, f->uyvx,
+		  f->cx * 4, 0, f->cy, f->out, linesize);
+}
+
+static void run_uyvx_to_i444(enum simd_level level, struct frame *f)
+{
+	const uint32_t linesize[] = {f->cx, f->cx, f->cx};
+	RUN_LEVEL(convert_uyvx_to_i444, convert_uyvx_to_i444_sse2, f->uyvx,
+		  f->cx * 4, 0, f->cy, f->out, linesize);
+}
+
+static void run_decompress_420(enum simd_level level, struct frame *f)
+{
+	const uint8_t *const input[] = {f->planes[0], f->planes[1],
+					f->planes[2]};
+	const uint32_t linesize[] = {f->cx, f->cx / 2, f->cx / 2};
+	RUN_LEVEL(decompress_420, decompress_420_c, input, linesize, 0, f->cy,
+		  f->out_packed, f->cx * 4);
+}
+
+static void run_decompress_nv12(enum simd_level level, struct frame *f)
+{
+	const uint8_t *const input[] = {f->planes[0], f->planes[1]};
+	const uint32_t linesize[] = {f->cx, f->cx};
+	RUN_LEVEL(decompress_nv12, decompress_nv12_c, input, linesize, 0,
+		  f->cy, f->out_packed, f->cx * 4);
+}
+
+static void run_decompress_yuy2(enum simd_level level, struct frame *f)
+{
+	RUN_LEVEL(decompress_422, decompress_422_c, f->packed, f->cx * 2, 0,
+		  f->cy, f->out_packed, f->cx * 2, false);
+}
+
+static void run_decompress_uyvy(enum simd_level level, struct frame *f)
+{
+	RUN_LEVEL(decompress_422, decompress_422_c, f->packed, f->cx * 2, 0,
+		  f->cy, f->out_packed, f->cx * 2, true);
+}
+
+struct kernel {
+	const char *name;
+	void (*run)(enum simd_level level, struct frame *f);
+};
+
+static const struct kernel kernels[] = {
+	{"uyvx_to_i420", run_uyvx_to_i420},
+	{"uyvx_to_nv12", run_uyvx_to_nv12},
+	{"uyvx_to_i444", run_uyvx_to_i444},
+	{"decompress_420", run_decompress_420},
+	{"decompress_nv12", run_decompress_nv12},
+	{"decompress_422", run_decompress_yuy2},
+	{"decompress_422 lum", run_decompress_uyvy},
+};
+
+/* ------------------------------------------------------------------------- */
+
+static uint64_t gettime_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static double bench(const struct kernel *k, enum simd_level level,
+		    struct frame *f)
+{
+	uint64_t frames = PIXEL_BUDGET / ((uint64_t)f->cx * f->cy);
+	if (!frames)
+		frames = 1;
+
+	k->run(level, f);
+
+	uint64_t start = gettime_ns();
+	for (uint64_t i = 0; i < frames; i++)
+		k->run(level, f);
+	return (double)(gettime_ns() - start) / 1000000.0 / (double)frames;
+}
+
+/* runs the base version into a copy, then checks the variant byte for
+ * byte, slack included */
+static void check_matches_base(const struct kernel *k, enum simd_level level,
+			       struct frame *f)
+{
+	uint8_t *ref_packed = malloc(f->packed_size);
+	uint8_t *ref[3];
+
+	CHECK(ref_packed != NULL);
+
+	frame_clear_output(f);
+	k->run(SIMD_LEVEL_BASE, f);
+	memcpy(ref_packed, f->out_packed, f->packed_size);
+	for (size_t i = 0; i < 3; i++) {
+		ref[i] = malloc(f->plane_size);
+		CHECK(ref[i] != NULL);
+		memcpy(ref[i], f->out[i], f->plane_size);
+	}
+
+	frame_clear_output(f);
+	k->run(level, f);
+	CHECK(memcmp(ref_packed, f->out_packed, f->packed_size) == 0);
+	for (size_t i = 0; i < 3; i++) {
+		CHECK(memcmp(ref[i], f->out[i], f->plane_size) == 0);
+		free(ref[i]);
+	}
+
+	free(ref_packed);
+}
+
+int main(void)
+{
+	const enum simd_level max_level = get_simd_level();
+
+	printf("%-19s %-6s", "ms/frame", "size");
+	for (int level = SIMD_LEVEL_BASE; level <= (int)max_level; level++)
+		printf(" %9s", level_names[level]);
+	printf("\n");
+
+	for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+		struct frame f;
+		frame_init(&f, sizes[s].cx, sizes[s].cy);
+
+		for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]);
+		     k++) {
+			printf("%-19s %-6s", kernels[k].name, sizes[s].name);
+
+			for (int level = SIMD_LEVEL_BASE;
+			     level <= (int)max_level; level++) {
+				check_matches_base(&kernels[k], level, &f);
+				printf(" %9.3f", bench(&kernels[k], level, &f));
+			}
+			printf("\n");
+		}
+
+		frame_free(&f);
+	}
+
+	return 0;
+}
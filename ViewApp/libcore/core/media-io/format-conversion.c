@@ -17,6 +17,17 @@
 
 #include "format-conversion.h"
 
+#if (defined(__x86_64__) || defined(__i386__)) && \
+	(defined(__GNUC__) || defined(__clang__))
+#define FORMAT_CONVERSION_DISPATCH
+
+/* has to come before simde, which defines some of the same names as
+ * macros.  unoptimized builds get _mm_round_ps as a macro as well, drop it
+ * so simde's alias doesn't redefine it */
+#include <immintrin.h>
+#undef _mm_round_ps
+#endif
+
 #include "../util/sse-intrin.h"
 
 /* ...surprisingly, if I don't use a macro to force inlining, it causes the
@@ -90,9 +101,11 @@ static FORCE_INLINE uint32_t min_uint32(uint32_t a, uint32_t b)
 	return a < b ? a : b;
 }
 
-void compress_uyvx_to_i420(const uint8_t *input, uint32_t in_linesize,
-			   uint32_t start_y, uint32_t end_y, uint8_t *output[],
-			   const uint32_t out_linesize[])
+static void compress_uyvx_to_i420_sse2(const uint8_t *input, uint32_t in_linesize,
+				       uint32_t start_y, uint32_t end_y,
+				       uint8_t *output[],
+				       const uint32_t out_linesize[],
+				       uint32_t start_x)
 {
 	uint8_t *lum_plane = output[0];
 	uint8_t *u_plane = output[1];
@@ -109,7 +122,7 @@ void compress_uyvx_to_i420(const uint8_t *input, uint32_t in_linesize,
 		uint32_t lum_y_pos = y * out_linesize[0];
 		uint32_t x;
 
-		for (x = 0; x < width; x += 4) {
+		for (x = start_x; x < width; x += 4) {
 			const uint8_t *img = input + y_pos + x * 4;
 			uint32_t lum_pos0 = lum_y_pos + x;
 			uint32_t lum_pos1 = lum_pos0 + out_linesize[0];
@@ -127,9 +140,11 @@ void compress_uyvx_to_i420(const uint8_t *input, uint32_t in_linesize,
 	}
 }
 
-void compress_uyvx_to_nv12(const uint8_t *input, uint32_t in_linesize,
-			   uint32_t start_y, uint32_t end_y, uint8_t *output[],
-			   const uint32_t out_linesize[])
+static void compress_uyvx_to_nv12_sse2(const uint8_t *input, uint32_t in_linesize,
+				       uint32_t start_y, uint32_t end_y,
+				       uint8_t *output[],
+				       const uint32_t out_linesize[],
+				       uint32_t start_x)
 {
 	uint8_t *lum_plane = output[0];
 	uint8_t *chroma_plane = output[1];
@@ -145,7 +160,7 @@ void compress_uyvx_to_nv12(const uint8_t *input, uint32_t in_linesize,
 		uint32_t lum_y_pos = y * out_linesize[0];
 		uint32_t x;
 
-		for (x = 0; x < width; x += 4) {
+		for (x = start_x; x < width; x += 4) {
 			const uint8_t *img = input + y_pos + x * 4;
 			uint32_t lum_pos0 = lum_y_pos + x;
 			uint32_t lum_pos1 = lum_pos0 + out_linesize[0];
@@ -162,9 +177,11 @@ void compress_uyvx_to_nv12(const uint8_t *input, uint32_t in_linesize,
 	}
 }
 
-void convert_uyvx_to_i444(const uint8_t *input, uint32_t in_linesize,
-			  uint32_t start_y, uint32_t end_y, uint8_t *output[],
-			  const uint32_t out_linesize[])
+static void convert_uyvx_to_i444_sse2(const uint8_t *input, uint32_t in_linesize,
+				      uint32_t start_y, uint32_t end_y,
+				      uint8_t *output[],
+				      const uint32_t out_linesize[],
+				      uint32_t start_x)
 {
 	uint8_t *lum_plane = output[0];
 	uint8_t *u_plane = output[1];
@@ -181,7 +198,7 @@ void convert_uyvx_to_i444(const uint8_t *input, uint32_t in_linesize,
 		uint32_t lum_y_pos = y * out_linesize[0];
 		uint32_t x;
 
-		for (x = 0; x < width; x += 4) {
+		for (x = start_x; x < width; x += 4) {
 			const uint8_t *img = input + y_pos + x * 4;
 			uint32_t lum_pos0 = lum_y_pos + x;
 			uint32_t lum_pos1 = lum_pos0 + out_linesize[0];
@@ -200,9 +217,10 @@ void convert_uyvx_to_i444(const uint8_t *input, uint32_t in_linesize,
 	}
 }
 
-void decompress_420(const uint8_t *const input[], const uint32_t in_linesize[],
-		    uint32_t start_y, uint32_t end_y, uint8_t *output,
-		    uint32_t out_linesize)
+static void decompress_420_c(const uint8_t *const input[],
+			     const uint32_t in_linesize[], uint32_t start_y,
+			     uint32_t end_y, uint8_t *output,
+			     uint32_t out_linesize, uint32_t start_x)
 {
 	uint32_t start_y_d2 = start_y / 2;
 	uint32_t width_d2 = in_linesize[0] / 2;
@@ -210,18 +228,19 @@ void decompress_420(const uint8_t *const input[], const uint32_t in_linesize[],
 	uint32_t y;
 
 	for (y = start_y_d2; y < height_d2; y++) {
-		const uint8_t *chroma0 = input[1] + y * in_linesize[1];
-		const uint8_t *chroma1 = input[2] + y * in_linesize[2];
+		const uint8_t *chroma0 = input[1] + y * in_linesize[1] + start_x;
+		const uint8_t *chroma1 = input[2] + y * in_linesize[2] + start_x;
 		register const uint8_t *lum0, *lum1;
 		register uint32_t *output0, *output1;
 		uint32_t x;
 
-		lum0 = input[0] + y * 2 * in_linesize[0];
+		lum0 = input[0] + y * 2 * in_linesize[0] + start_x * 2;
 		lum1 = lum0 + in_linesize[0];
-		output0 = (uint32_t *)(output + y * 2 * out_linesize);
+		output0 = (uint32_t *)(output + y * 2 * out_linesize) +
+			  start_x * 2;
 		output1 = (uint32_t *)((uint8_t *)output0 + out_linesize);
 
-		for (x = 0; x < width_d2; x++) {
+		for (x = start_x; x < width_d2; x++) {
 			uint32_t out;
 			out = (*(chroma0++) << 8) | *(chroma1++);
 
@@ -234,9 +253,10 @@ void decompress_420(const uint8_t *const input[], const uint32_t in_linesize[],
 	}
 }
 
-void decompress_nv12(const uint8_t *const input[], const uint32_t in_linesize[],
-		     uint32_t start_y, uint32_t end_y, uint8_t *output,
-		     uint32_t out_linesize)
+static void decompress_nv12_c(const uint8_t *const input[],
+			      const uint32_t in_linesize[], uint32_t start_y,
+			      uint32_t end_y, uint8_t *output,
+			      uint32_t out_linesize, uint32_t start_x)
 {
 	uint32_t start_y_d2 = start_y / 2;
 	uint32_t width_d2 = min_uint32(in_linesize[0], out_linesize) / 2;
@@ -249,13 +269,15 @@ void decompress_nv12(const uint8_t *const input[], const uint32_t in_linesize[],
 		register uint32_t *output0, *output1;
 		uint32_t x;
 
-		chroma = (const uint16_t *)(input[1] + y * in_linesize[1]);
-		lum0 = input[0] + y * 2 * in_linesize[0];
+		chroma = (const uint16_t *)(input[1] + y * in_linesize[1]) +
+			 start_x;
+		lum0 = input[0] + y * 2 * in_linesize[0] + start_x * 2;
 		lum1 = lum0 + in_linesize[0];
-		output0 = (uint32_t *)(output + y * 2 * out_linesize);
+		output0 = (uint32_t *)(output + y * 2 * out_linesize) +
+			  start_x * 2;
 		output1 = (uint32_t *)((uint8_t *)output0 + out_linesize);
 
-		for (x = 0; x < width_d2; x++) {
+		for (x = start_x; x < width_d2; x++) {
 			uint32_t out = *(chroma++) << 8;
 
 			*(output0++) = *(lum0++) | out;
@@ -267,9 +289,10 @@ void decompress_nv12(const uint8_t *const input[], const uint32_t in_linesize[],
 	}
 }
 
-void decompress_422(const uint8_t *input, uint32_t in_linesize,
-		    uint32_t start_y, uint32_t end_y, uint8_t *output,
-		    uint32_t out_linesize, bool leading_lum)
+static void decompress_422_c(const uint8_t *input, uint32_t in_linesize,
+			     uint32_t start_y, uint32_t end_y, uint8_t *output,
+			     uint32_t out_linesize, bool leading_lum,
+			     uint32_t start_x)
 {
 	uint32_t width_d2 = min_uint32(in_linesize, out_linesize) / 2;
 	uint32_t y;
@@ -282,7 +305,9 @@ void decompress_422(const uint8_t *input, uint32_t in_linesize,
 		for (y = start_y; y < end_y; y++) {
 			input32 = (const uint32_t *)(input + y * in_linesize);
 			input32_end = input32 + width_d2;
-			output32 = (uint32_t *)(output + y * out_linesize);
+			input32 += start_x;
+			output32 = (uint32_t *)(output + y * out_linesize) +
+				   start_x * 2;
 
 			while (input32 < input32_end) {
 				register uint32_t dw = *input32;
@@ -300,7 +325,9 @@ void decompress_422(const uint8_t *input, uint32_t in_linesize,
 		for (y = start_y; y < end_y; y++) {
 			input32 = (const uint32_t *)(input + y * in_linesize);
 			input32_end = input32 + width_d2;
-			output32 = (uint32_t *)(output + y * out_linesize);
+			input32 += start_x;
+			output32 = (uint32_t *)(output + y * out_linesize) +
+				   start_x * 2;
 
 			while (input32 < input32_end) {
 				register uint32_t dw = *input32;
@@ -316,3 +343,851 @@ void decompress_422(const uint8_t *input, uint32_t in_linesize,
 		}
 	}
 }
+
+/* ------------------------------------------------------------------------- */
+/* AVX2 / AVX-512 variants, picked at runtime.  Each one handles as much of
+ * every line as fits its vector width and leaves the rest to the base
+ * version above.  On ARM the base versions already go through simde's NEON
+ * mappings. */
+
+#ifdef FORMAT_CONVERSION_DISPATCH
+
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx2,avx512f,avx512bw")))
+
+enum simd_level {
+	SIMD_LEVEL_BASE,
+	SIMD_LEVEL_AVX2,
+	SIMD_LEVEL_AVX512,
+};
+
+static enum simd_level get_simd_level(void)
+{
+	static volatile int level = -1;
+
+	if (level < 0) {
+		__builtin_cpu_init();
+
+		if (__builtin_cpu_supports("avx512f") &&
+		    __builtin_cpu_supports("avx512bw"))
+			level = SIMD_LEVEL_AVX512;
+		else if (__builtin_cpu_supports("avx2"))
+			level = SIMD_LEVEL_AVX2;
+		else
+			level = SIMD_LEVEL_BASE;
+	}
+
+	return (enum simd_level)level;
+}
+
+/* gathers the luma byte of every 32-bit UYVX pixel into the low dword of
+ * each 128-bit lane */
+#define UYVX_LUMA_SHUFFLE                                                    \
+	1, 5, 9, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+
+/* after summing 2x2 chroma blocks, picks U/V of the two blocks in a lane.
+ * interleaved for nv12, U U V V for i420 */
+#define UYVX_NV12_SHUFFLE                                                    \
+	0, 2, 8, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+#define UYVX_I420_SHUFFLE                                                    \
+	0, 8, 2, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+
+/* Y, U and V of every pixel of a lane in dwords 0, 1 and 2 */
+#define UYVX_I444_SHUFFLE                                                    \
+	1, 5, 9, 13, 0, 4, 8, 12, 2, 6, 10, 14, -1, -1, -1, -1
+
+TARGET_AVX2 static inline __m256i avx2_uyvx_luma(__m256i line)
+{
+	const __m256i shuf = _mm256_setr_epi8(UYVX_LUMA_SHUFFLE,
+					      UYVX_LUMA_SHUFFLE);
+	const __m256i idx = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
+
+	return _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(line, shuf),
+					   idx);
+}
+
+TARGET_AVX2 static inline __m256i avx2_uyvx_chroma(__m256i line1,
+						   __m256i line2,
+						   __m256i shuf)
+{
+	const __m256i uv_mask = _mm256_set1_epi16(0x00FF);
+	const __m256i idx = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
+
+	__m256i sum = _mm256_add_epi16(_mm256_and_si256(line1, uv_mask),
+				       _mm256_and_si256(line2, uv_mask));
+	sum = _mm256_add_epi16(
+		sum, _mm256_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+	sum = _mm256_srli_epi16(sum, 2);
+
+	return _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(sum, shuf),
+					   idx);
+}
+
+TARGET_AVX2 static void compress_uyvx_to_i420_avx2(
+	const uint8_t *input, uint32_t in_linesize, uint32_t start_y,
+	uint32_t end_y, uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint8_t *lum_plane = output[0];
+	uint8_t *u_plane = output[1];
+	uint8_t *v_plane = output[2];
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t width_vec = width & ~7;
+
+	const __m256i uv_shuf = _mm256_setr_epi8(UYVX_I420_SHUFFLE,
+						 UYVX_I420_SHUFFLE);
+	const __m128i split = _mm_setr_epi8(0, 1, 4, 5, 2, 3, 6, 7, -1, -1, -1,
+					    -1, -1, -1, -1, -1);
+
+	for (uint32_t y = start_y; y < end_y; y += 2) {
+		uint32_t y_pos = y * in_linesize;
+		uint32_t chroma_y_pos = (y >> 1) * out_linesize[1];
+		uint32_t lum_y_pos = y * out_linesize[0];
+
+		for (uint32_t x = 0; x < width_vec; x += 8) {
+			const uint8_t *img = input + y_pos + x * 4;
+			uint8_t *lum0 = lum_plane + lum_y_pos + x;
+			uint8_t *lum1 = lum0 + out_linesize[0];
+
+			__m256i line1 = _mm256_loadu_si256((const __m256i *)img);
+			__m256i line2 = _mm256_loadu_si256(
+				(const __m256i *)(img + in_linesize));
+
+			_mm_storel_epi64((__m128i *)lum0,
+					 _mm256_castsi256_si128(
+						 avx2_uyvx_luma(line1)));
+			_mm_storel_epi64((__m128i *)lum1,
+					 _mm256_castsi256_si128(
+						 avx2_uyvx_luma(line2)));
+
+			__m128i uv = _mm_shuffle_epi8(
+				_mm256_castsi256_si128(avx2_uyvx_chroma(
+					line1, line2, uv_shuf)),
+				split);
+			uint32_t chroma_pos = chroma_y_pos + (x >> 1);
+			*(uint32_t *)(u_plane + chroma_pos) =
+				(uint32_t)_mm_cvtsi128_si32(uv);
+			*(uint32_t *)(v_plane + chroma_pos) =
+				(uint32_t)_mm_extract_epi32(uv, 1);
+		}
+	}
+
+	if (width_vec < width)
+		compress_uyvx_to_i420_sse2(input, in_linesize, start_y, end_y,
+					   output, out_linesize, width_vec);
+}
+
+TARGET_AVX2 static void compress_uyvx_to_nv12_avx2(
+	const uint8_t *input, uint32_t in_linesize, uint32_t start_y,
+	uint32_t end_y, uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint8_t *lum_plane = output[0];
+	uint8_t *chroma_plane = output[1];
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t width_vec = width & ~7;
+
+	const __m256i uv_shuf = _mm256_setr_epi8(UYVX_NV12_SHUFFLE,
+						 UYVX_NV12_SHUFFLE);
+
+	for (uint32_t y = start_y; y < end_y; y += 2) {
+		uint32_t y_pos = y * in_linesize;
+		uint32_t chroma_y_pos = (y >> 1) * out_linesize[1];
+		uint32_t lum_y_pos = y * out_linesize[0];
+
+		for (uint32_t x = 0; x < width_vec; x += 8) {
+			const uint8_t *img = input + y_pos + x * 4;
+			uint8_t *lum0 = lum_plane + lum_y_pos + x;
+			uint8_t *lum1 = lum0 + out_linesize[0];
+
+			__m256i line1 = _mm256_loadu_si256((const __m256i *)img);
+			__m256i line2 = _mm256_loadu_si256(
+				(const __m256i *)(img + in_linesize));
+
+			_mm_storel_epi64((__m128i *)lum0,
+					 _mm256_castsi256_si128(
+						 avx2_uyvx_luma(line1)));
+			_mm_storel_epi64((__m128i *)lum1,
+					 _mm256_castsi256_si128(
+						 avx2_uyvx_luma(line2)));
+			_mm_storel_epi64(
+				(__m128i *)(chroma_plane + chroma_y_pos + x),
+				_mm256_castsi256_si128(avx2_uyvx_chroma(
+					line1, line2, uv_shuf)));
+		}
+	}
+
+	if (width_vec < width)
+		compress_uyvx_to_nv12_sse2(input, in_linesize, start_y, end_y,
+					   output, out_linesize, width_vec);
+}
+
+TARGET_AVX2 static inline void avx2_store_i444(uint8_t *output[],
+					       uint32_t pos, __m256i line)
+{
+	const __m256i shuf = _mm256_setr_epi8(UYVX_I444_SHUFFLE,
+					      UYVX_I444_SHUFFLE);
+	const __m256i idx = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+	__m256i yuv = _mm256_permutevar8x32_epi32(
+		_mm256_shuffle_epi8(line, shuf), idx);
+	__m128i yu = _mm256_castsi256_si128(yuv);
+
+	_mm_storel_epi64((__m128i *)(output[0] + pos), yu);
+	_mm_storel_epi64((__m128i *)(output[1] + pos),
+			 _mm_srli_si128(yu, 8));
+	_mm_storel_epi64((__m128i *)(output[2] + pos),
+			 _mm256_extracti128_si256(yuv, 1));
+}
+
+TARGET_AVX2 static void convert_uyvx_to_i444_avx2(
+	const uint8_t *input, uint32_t in_linesize, uint32_t start_y,
+	uint32_t end_y, uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t width_vec = width & ~7;
+
+	for (uint32_t y = start_y; y < end_y; y += 2) {
+		uint32_t y_pos = y * in_linesize;
+		uint32_t lum_y_pos = y * out_linesize[0];
+
+		for (uint32_t x = 0; x < width_vec; x += 8) {
+			const uint8_t *img = input + y_pos + x * 4;
+			uint32_t lum_pos0 = lum_y_pos + x;
+
+			avx2_store_i444(output, lum_pos0,
+					_mm256_loadu_si256(
+						(const __m256i *)img));
+			avx2_store_i444(output, lum_pos0 + out_linesize[0],
+					_mm256_loadu_si256(
+						(const __m256i *)(img +
+								  in_linesize)));
+		}
+	}
+
+	if (width_vec < width)
+		convert_uyvx_to_i444_sse2(input, in_linesize, start_y, end_y,
+					  output, out_linesize, width_vec);
+}
+
+TARGET_AVX2 static void decompress_420_avx2(const uint8_t *const input[],
+					    const uint32_t in_linesize[],
+					    uint32_t start_y, uint32_t end_y,
+					    uint8_t *output,
+					    uint32_t out_linesize)
+{
+	uint32_t width_d2 = in_linesize[0] / 2;
+	uint32_t width_vec = width_d2 & ~7;
+
+	for (uint32_t y = start_y / 2; y < end_y / 2; y++) {
+		const uint8_t *chroma0 = input[1] + y * in_linesize[1];
+		const uint8_t *chroma1 = input[2] + y * in_linesize[2];
+		const uint8_t *lum0 = input[0] + y * 2 * in_linesize[0];
+		const uint8_t *lum1 = lum0 + in_linesize[0];
+		uint8_t *output0 = output + y * 2 * out_linesize;
+		uint8_t *output1 = output0 + out_linesize;
+
+		for (uint32_t x = 0; x < width_vec; x += 8) {
+			__m128i u = _mm_loadl_epi64(
+				(const __m128i *)(chroma0 + x));
+			__m128i v = _mm_loadl_epi64(
+				(const __m128i *)(chroma1 + x));
+			__m128i uv = _mm_unpacklo_epi8(v, u);
+			__m256i uv0 = _mm256_cvtepu16_epi32(
+				_mm_unpacklo_epi16(uv, uv));
+			__m256i uv1 = _mm256_cvtepu16_epi32(
+				_mm_unpackhi_epi16(uv, uv));
+
+			__m128i l0 = _mm_loadu_si128(
+				(const __m128i *)(lum0 + x * 2));
+			__m128i l1 = _mm_loadu_si128(
+				(const __m128i *)(lum1 + x * 2));
+			__m256i *out0 = (__m256i *)(output0 + x * 8);
+			__m256i *out1 = (__m256i *)(output1 + x * 8);
+
+			_mm256_storeu_si256(
+				out0,
+				_mm256_or_si256(uv0, _mm256_slli_epi32(
+							     _mm256_cvtepu8_epi32(l0),
+							     16)));
+			_mm256_storeu_si256(
+				out0 + 1,
+				_mm256_or_si256(
+					uv1,
+					_mm256_slli_epi32(
+						_mm256_cvtepu8_epi32(
+							_mm_srli_si128(l0, 8)),
+						16)));
+			_mm256_storeu_si256(
+				out1,
+				_mm256_or_si256(uv0, _mm256_slli_epi32(
+							     _mm256_cvtepu8_epi32(l1),
+							     16)));
+			_mm256_storeu_si256(
+				out1 + 1,
+				_mm256_or_si256(
+					uv1,
+					_mm256_slli_epi32(
+						_mm256_cvtepu8_epi32(
+							_mm_srli_si128(l1, 8)),
+						16)));
+		}
+	}
+
+	if (width_vec < width_d2)
+		decompress_420_c(input, in_linesize, start_y, end_y, output,
+				 out_linesize, width_vec);
+}
+
+TARGET_AVX2 static void decompress_nv12_avx2(const uint8_t *const input[],
+					     const uint32_t in_linesize[],
+					     uint32_t start_y, uint32_t end_y,
+					     uint8_t *output,
+					     uint32_t out_linesize)
+{
+	uint32_t width_d2 = min_uint32(in_linesize[0], out_linesize) / 2;
+	uint32_t width_vec = width_d2 & ~7;
+
+	for (uint32_t y = start_y / 2; y < end_y / 2; y++) {
+		const uint8_t *chroma = input[1] + y * in_linesize[1];
+		const uint8_t *lum0 = input[0] + y * 2 * in_linesize[0];
+		const uint8_t *lum1 = lum0 + in_linesize[0];
+		uint8_t *output0 = output + y * 2 * out_linesize;
+		uint8_t *output1 = output0 + out_linesize;
+
+		for (uint32_t x = 0; x < width_vec; x += 8) {
+			__m128i uv = _mm_loadu_si128(
+				(const __m128i *)(chroma + x * 2));
+			__m256i uv0 = _mm256_slli_epi32(
+				_mm256_cvtepu16_epi32(
+					_mm_unpacklo_epi16(uv, uv)),
+				8);
+			__m256i uv1 = _mm256_slli_epi32(
+				_mm256_cvtepu16_epi32(
+					_mm_unpackhi_epi16(uv, uv)),
+				8);
+
+			__m128i l0 = _mm_loadu_si128(
+				(const __m128i *)(lum0 + x * 2));
+			__m128i l1 = _mm_loadu_si128(
+				(const __m128i *)(lum1 + x * 2));
+			__m256i *out0 = (__m256i *)(output0 + x * 8);
+			__m256i *out1 = (__m256i *)(output1 + x * 8);
+
+			_mm256_storeu_si256(
+				out0,
+				_mm256_or_si256(uv0, _mm256_cvtepu8_epi32(l0)));
+			_mm256_storeu_si256(
+				out0 + 1,
+				_mm256_or_si256(uv1,
+						_mm256_cvtepu8_epi32(
+							_mm_srli_si128(l0, 8))));
+			_mm256_storeu_si256(
+				out1,
+				_mm256_or_si256(uv0, _mm256_cvtepu8_epi32(l1)));
+			_mm256_storeu_si256(
+				out1 + 1,
+				_mm256_or_si256(uv1,
+						_mm256_cvtepu8_epi32(
+							_mm_srli_si128(l1, 8))));
+		}
+	}
+
+	if (width_vec < width_d2)
+		decompress_nv12_c(input, in_linesize, start_y, end_y, output,
+				  out_linesize, width_vec);
+}
+
+TARGET_AVX2 static void decompress_422_avx2(const uint8_t *input,
+					    uint32_t in_linesize,
+					    uint32_t start_y, uint32_t end_y,
+					    uint8_t *output,
+					    uint32_t out_linesize,
+					    bool leading_lum)
+{
+	uint32_t width_d2 = min_uint32(in_linesize, out_linesize) / 2;
+	uint32_t width_vec = width_d2 & ~7;
+
+	/* the second pixel of each pair repeats its own luma in place of
+	 * the first pixel's */
+	const __m256i keep_mask = _mm256_set1_epi32(
+		leading_lum ? (int)0xFFFFFF00 : (int)0xFFFF00FF);
+	const __m256i move_mask =
+		_mm256_set1_epi32(leading_lum ? 0x000000FF : 0x0000FF00);
+
+	for (uint32_t y = start_y; y < end_y; y++) {
+		const uint8_t *in_line = input + y * in_linesize;
+		uint8_t *out_line = output + y * out_linesize;
+
+		for (uint32_t x = 0; x < width_vec; x += 8) {
+			__m256i dw = _mm256_loadu_si256(
+				(const __m256i *)(in_line + x * 4));
+			__m256i second = _mm256_or_si256(
+				_mm256_and_si256(dw, keep_mask),
+				_mm256_and_si256(_mm256_srli_epi32(dw, 16),
+						 move_mask));
+			__m256i lo = _mm256_unpacklo_epi32(dw, second);
+			__m256i hi = _mm256_unpackhi_epi32(dw, second);
+			__m256i *out = (__m256i *)(out_line + x * 8);
+
+			_mm256_storeu_si256(out,
+					    _mm256_permute2x128_si256(lo, hi,
+								      0x20));
+			_mm256_storeu_si256(out + 1,
+					    _mm256_permute2x128_si256(lo, hi,
+								      0x31));
+		}
+
+		/* a line's output can run into the next one's, finish each
+		 * line before the next so overlapping writes land in the
+		 * same order as in decompress_422_c */
+		if (width_vec < width_d2)
+			decompress_422_c(input, in_linesize, y, y + 1, output,
+					 out_linesize, leading_lum, width_vec);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+
+TARGET_AVX512 static inline __m512i avx512_uyvx_luma(__m512i line)
+{
+	const __m512i shuf = _mm512_broadcast_i32x4(
+		_mm_setr_epi8(UYVX_LUMA_SHUFFLE));
+	const __m512i idx = _mm512_setr_epi32(0, 4, 8, 12, 0, 0, 0, 0, 0, 0,
+					      0, 0, 0, 0, 0, 0);
+
+	return _mm512_permutexvar_epi32(idx, _mm512_shuffle_epi8(line, shuf));
+}
+
+TARGET_AVX512 static inline __m128i avx512_uyvx_chroma(__m512i line1,
+						       __m512i line2,
+						       __m128i shuf)
+{
+	const __m512i uv_mask = _mm512_set1_epi16(0x00FF);
+	const __m512i idx = _mm512_setr_epi32(0, 4, 8, 12, 0, 0, 0, 0, 0, 0,
+					      0, 0, 0, 0, 0, 0);
+
+	__m512i sum = _mm512_add_epi16(_mm512_and_si512(line1, uv_mask),
+				       _mm512_and_si512(line2, uv_mask));
+	sum = _mm512_add_epi16(
+		sum, _mm512_shuffle_epi32(
+			     sum, (_MM_PERM_ENUM)_MM_SHUFFLE(2, 3, 0, 1)));
+	sum = _mm512_srli_epi16(sum, 2);
+	sum = _mm512_shuffle_epi8(sum, _mm512_broadcast_i32x4(shuf));
+
+	return _mm512_castsi512_si128(_mm512_permutexvar_epi32(idx, sum));
+}
+
+TARGET_AVX512 static void compress_uyvx_to_i420_avx512(
+	const uint8_t *input, uint32_t in_linesize, uint32_t start_y,
+	uint32_t end_y, uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint8_t *lum_plane = output[0];
+	uint8_t *u_plane = output[1];
+	uint8_t *v_plane = output[2];
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t width_vec = width & ~15;
+
+	const __m128i uv_shuf = _mm_setr_epi8(UYVX_I420_SHUFFLE);
+	const __m128i split = _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6,
+					    7, 10, 11, 14, 15);
+
+	for (uint32_t y = start_y; y < end_y; y += 2) {
+		uint32_t y_pos = y * in_linesize;
+		uint32_t chroma_y_pos = (y >> 1) * out_linesize[1];
+		uint32_t lum_y_pos = y * out_linesize[0];
+
+		for (uint32_t x = 0; x < width_vec; x += 16) {
+			const uint8_t *img = input + y_pos + x * 4;
+			uint8_t *lum0 = lum_plane + lum_y_pos + x;
+			uint8_t *lum1 = lum0 + out_linesize[0];
+
+			__m512i line1 = _mm512_loadu_si512(img);
+			__m512i line2 = _mm512_loadu_si512(img + in_linesize);
+
+			_mm_storeu_si128((__m128i *)lum0,
+					 _mm512_castsi512_si128(
+						 avx512_uyvx_luma(line1)));
+			_mm_storeu_si128((__m128i *)lum1,
+					 _mm512_castsi512_si128(
+						 avx512_uyvx_luma(line2)));
+
+			__m128i uv = _mm_shuffle_epi8(
+				avx512_uyvx_chroma(line1, line2, uv_shuf),
+				split);
+			uint32_t chroma_pos = chroma_y_pos + (x >> 1);
+			_mm_storel_epi64((__m128i *)(u_plane + chroma_pos), uv);
+			_mm_storel_epi64((__m128i *)(v_plane + chroma_pos),
+					 _mm_srli_si128(uv, 8));
+		}
+	}
+
+	if (width_vec < width)
+		compress_uyvx_to_i420_sse2(input, in_linesize, start_y, end_y,
+					   output, out_linesize, width_vec);
+}
+
+TARGET_AVX512 static void compress_uyvx_to_nv12_avx512(
+	const uint8_t *input, uint32_t in_linesize, uint32_t start_y,
+	uint32_t end_y, uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint8_t *lum_plane = output[0];
+	uint8_t *chroma_plane = output[1];
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t width_vec = width & ~15;
+
+	const __m128i uv_shuf = _mm_setr_epi8(UYVX_NV12_SHUFFLE);
+
+	for (uint32_t y = start_y; y < end_y; y += 2) {
+		uint32_t y_pos = y * in_linesize;
+		uint32_t chroma_y_pos = (y >> 1) * out_linesize[1];
+		uint32_t lum_y_pos = y * out_linesize[0];
+
+		for (uint32_t x = 0; x < width_vec; x += 16) {
+			const uint8_t *img = input + y_pos + x * 4;
+			uint8_t *lum0 = lum_plane + lum_y_pos + x;
+			uint8_t *lum1 = lum0 + out_linesize[0];
+
+			__m512i line1 = _mm512_loadu_si512(img);
+			__m512i line2 = _mm512_loadu_si512(img + in_linesize);
+
+			_mm_storeu_si128((__m128i *)lum0,
+					 _mm512_castsi512_si128(
+						 avx512_uyvx_luma(line1)));
+			_mm_storeu_si128((__m128i *)lum1,
+					 _mm512_castsi512_si128(
+						 avx512_uyvx_luma(line2)));
+			_mm_storeu_si128(
+				(__m128i *)(chroma_plane + chroma_y_pos + x),
+				avx512_uyvx_chroma(line1, line2, uv_shuf));
+		}
+	}
+
+	if (width_vec < width)
+		compress_uyvx_to_nv12_sse2(input, in_linesize, start_y, end_y,
+					   output, out_linesize, width_vec);
+}
+
+TARGET_AVX512 static inline void avx512_store_i444(uint8_t *output[],
+						   uint32_t pos, __m512i line)
+{
+	const __m512i shuf = _mm512_broadcast_i32x4(
+		_mm_setr_epi8(UYVX_I444_SHUFFLE));
+	const __m512i idx = _mm512_setr_epi32(0, 4, 8, 12, 1, 5, 9, 13, 2, 6,
+					      10, 14, 3, 7, 11, 15);
+
+	__m512i yuv = _mm512_permutexvar_epi32(idx,
+					       _mm512_shuffle_epi8(line, shuf));
+
+	_mm_storeu_si128((__m128i *)(output[0] + pos),
+			 _mm512_castsi512_si128(yuv));
+	_mm_storeu_si128((__m128i *)(output[1] + pos),
+			 _mm512_extracti32x4_epi32(yuv, 1));
+	_mm_storeu_si128((__m128i *)(output[2] + pos),
+			 _mm512_extracti32x4_epi32(yuv, 2));
+}
+
+TARGET_AVX512 static void convert_uyvx_to_i444_avx512(
+	const uint8_t *input, uint32_t in_linesize, uint32_t start_y,
+	uint32_t end_y, uint8_t *output[], const uint32_t out_linesize[])
+{
+	uint32_t width = min_uint32(in_linesize, out_linesize[0]);
+	uint32_t width_vec = width & ~15;
+
+	for (uint32_t y = start_y; y < end_y; y += 2) {
+		uint32_t y_pos = y * in_linesize;
+		uint32_t lum_y_pos = y * out_linesize[0];
+
+		for (uint32_t x = 0; x < width_vec; x += 16) {
+			const uint8_t *img = input + y_pos + x * 4;
+			uint32_t lum_pos0 = lum_y_pos + x;
+
+			avx512_store_i444(output, lum_pos0,
+					  _mm512_loadu_si512(img));
+			avx512_store_i444(output, lum_pos0 + out_linesize[0],
+					  _mm512_loadu_si512(img +
+							     in_linesize));
+		}
+	}
+
+	if (width_vec < width)
+		convert_uyvx_to_i444_sse2(input, in_linesize, start_y, end_y,
+					  output, out_linesize, width_vec);
+}
+
+/* duplicates each 16-bit chroma value of uv into two 32-bit pixels */
+TARGET_AVX512 static inline __m512i avx512_dup_chroma(__m128i uv)
+{
+	return _mm512_cvtepu16_epi32(_mm256_set_m128i(
+		_mm_unpackhi_epi16(uv, uv), _mm_unpacklo_epi16(uv, uv)));
+}
+
+TARGET_AVX512 static void decompress_420_avx512(const uint8_t *const input[],
+						const uint32_t in_linesize[],
+						uint32_t start_y,
+						uint32_t end_y,
+						uint8_t *output,
+						uint32_t out_linesize)
+{
+	uint32_t width_d2 = in_linesize[0] / 2;
+	uint32_t width_vec = width_d2 & ~15;
+
+	for (uint32_t y = start_y / 2; y < end_y / 2; y++) {
+		const uint8_t *chroma0 = input[1] + y * in_linesize[1];
+		const uint8_t *chroma1 = input[2] + y * in_linesize[2];
+		const uint8_t *lum0 = input[0] + y * 2 * in_linesize[0];
+		const uint8_t *lum1 = lum0 + in_linesize[0];
+		uint8_t *output0 = output + y * 2 * out_linesize;
+		uint8_t *output1 = output0 + out_linesize;
+
+		for (uint32_t x = 0; x < width_vec; x += 16) {
+			__m128i u = _mm_loadu_si128(
+				(const __m128i *)(chroma0 + x));
+			__m128i v = _mm_loadu_si128(
+				(const __m128i *)(chroma1 + x));
+			__m512i uv0 =
+				avx512_dup_chroma(_mm_unpacklo_epi8(v, u));
+			__m512i uv1 =
+				avx512_dup_chroma(_mm_unpackhi_epi8(v, u));
+
+			__m256i l0 = _mm256_loadu_si256(
+				(const __m256i *)(lum0 + x * 2));
+			__m256i l1 = _mm256_loadu_si256(
+				(const __m256i *)(lum1 + x * 2));
+			uint8_t *out0 = output0 + x * 8;
+			uint8_t *out1 = output1 + x * 8;
+
+			_mm512_storeu_si512(
+				out0,
+				_mm512_or_si512(
+					uv0,
+					_mm512_slli_epi32(
+						_mm512_cvtepu8_epi32(
+							_mm256_castsi256_si128(
+								l0)),
+						16)));
+			_mm512_storeu_si512(
+				out0 + 64,
+				_mm512_or_si512(
+					uv1,
+					_mm512_slli_epi32(
+						_mm512_cvtepu8_epi32(
+							_mm256_extracti128_si256(
+								l0, 1)),
+						16)));
+			_mm512_storeu_si512(
+				out1,
+				_mm512_or_si512(
+					uv0,
+					_mm512_slli_epi32(
+						_mm512_cvtepu8_epi32(
+							_mm256_castsi256_si128(
+								l1)),
+						16)));
+			_mm512_storeu_si512(
+				out1 + 64,
+				_mm512_or_si512(
+					uv1,
+					_mm512_slli_epi32(
+						_mm512_cvtepu8_epi32(
+							_mm256_extracti128_si256(
+								l1, 1)),
+						16)));
+		}
+	}
+
+	if (width_vec < width_d2)
+		decompress_420_c(input, in_linesize, start_y, end_y, output,
+				 out_linesize, width_vec);
+}
+
+TARGET_AVX512 static void decompress_nv12_avx512(const uint8_t *const input[],
+						 const uint32_t in_linesize[],
+						 uint32_t start_y,
+						 uint32_t end_y,
+						 uint8_t *output,
+						 uint32_t out_linesize)
+{
+	uint32_t width_d2 = min_uint32(in_linesize[0], out_linesize) / 2;
+	uint32_t width_vec = width_d2 & ~15;
+
+	for (uint32_t y = start_y / 2; y < end_y / 2; y++) {
+		const uint8_t *chroma = input[1] + y * in_linesize[1];
+		const uint8_t *lum0 = input[0] + y * 2 * in_linesize[0];
+		const uint8_t *lum1 = lum0 + in_linesize[0];
+		uint8_t *output0 = output + y * 2 * out_linesize;
+		uint8_t *output1 = output0 + out_linesize;
+
+		for (uint32_t x = 0; x < width_vec; x += 16) {
+			__m512i uv0 = _mm512_slli_epi32(
+				avx512_dup_chroma(_mm_loadu_si128(
+					(const __m128i *)(chroma + x * 2))),
+				8);
+			__m512i uv1 = _mm512_slli_epi32(
+				avx512_dup_chroma(_mm_loadu_si128(
+					(const __m128i *)(chroma + x * 2 +
+							  16))),
+				8);
+
+			__m256i l0 = _mm256_loadu_si256(
+				(const __m256i *)(lum0 + x * 2));
+			__m256i l1 = _mm256_loadu_si256(
+				(const __m256i *)(lum1 + x * 2));
+			uint8_t *out0 = output0 + x * 8;
+			uint8_t *out1 = output1 + x * 8;
+
+			_mm512_storeu_si512(
+				out0, _mm512_or_si512(
+					      uv0, _mm512_cvtepu8_epi32(
+							   _mm256_castsi256_si128(
+								   l0))));
+			_mm512_storeu_si512(
+				out0 + 64,
+				_mm512_or_si512(
+					uv1, _mm512_cvtepu8_epi32(
+						     _mm256_extracti128_si256(
+							     l0, 1))));
+			_mm512_storeu_si512(
+				out1, _mm512_or_si512(
+					      uv0, _mm512_cvtepu8_epi32(
+							   _mm256_castsi256_si128(
+								   l1))));
+			_mm512_storeu_si512(
+				out1 + 64,
+				_mm512_or_si512(
+					uv1, _mm512_cvtepu8_epi32(
+						     _mm256_extracti128_si256(
+							     l1, 1))));
+		}
+	}
+
+	if (width_vec < width_d2)
+		decompress_nv12_c(input, in_linesize, start_y, end_y, output,
+				  out_linesize, width_vec);
+}
+
+TARGET_AVX512 static void decompress_422_avx512(const uint8_t *input,
+						uint32_t in_linesize,
+						uint32_t start_y,
+						uint32_t end_y,
+						uint8_t *output,
+						uint32_t out_linesize,
+						bool leading_lum)
+{
+	uint32_t width_d2 = min_uint32(in_linesize, out_linesize) / 2;
+	uint32_t width_vec = width_d2 & ~15;
+
+	const __m512i keep_mask = _mm512_set1_epi32(
+		leading_lum ? (int)0xFFFFFF00 : (int)0xFFFF00FF);
+	const __m512i move_mask =
+		_mm512_set1_epi32(leading_lum ? 0x000000FF : 0x0000FF00);
+	const __m512i first_idx = _mm512_setr_epi64(0, 1, 8, 9, 2, 3, 10, 11);
+	const __m512i second_idx =
+		_mm512_setr_epi64(4, 5, 12, 13, 6, 7, 14, 15);
+
+	for (uint32_t y = start_y; y < end_y; y++) {
+		const uint8_t *in_line = input + y * in_linesize;
+		uint8_t *out_line = output + y * out_linesize;
+
+		for (uint32_t x = 0; x < width_vec; x += 16) {
+			__m512i dw = _mm512_loadu_si512(in_line + x * 4);
+			__m512i second = _mm512_or_si512(
+				_mm512_and_si512(dw, keep_mask),
+				_mm512_and_si512(_mm512_srli_epi32(dw, 16),
+						 move_mask));
+			__m512i lo = _mm512_unpacklo_epi32(dw, second);
+			__m512i hi = _mm512_unpackhi_epi32(dw, second);
+			uint8_t *out = out_line + x * 8;
+
+			_mm512_storeu_si512(out, _mm512_permutex2var_epi64(
+							 lo, first_idx, hi));
+			_mm512_storeu_si512(out + 64,
+					    _mm512_permutex2var_epi64(
+						    lo, second_idx, hi));
+		}
+
+		if (width_vec < width_d2)
+			decompress_422_c(input, in_linesize, y, y + 1, output,
+					 out_linesize, leading_lum, width_vec);
+	}
+}
+
+#endif
+
+/* ------------------------------------------------------------------------- */
+
+#ifdef FORMAT_CONVERSION_DISPATCH
+#define DISPATCH(func, ...)                                     \
+	do {                                                    \
+		switch (get_simd_level()) {                     \
+		case SIMD_LEVEL_AVX512:                         \
+			func##_avx512(__VA_ARGS__);             \
+			return;                                 \
+		case SIMD_LEVEL_AVX2:                           \
+			func##_avx2(__VA_ARGS__);               \
+			return;                                 \
+		case SIMD_LEVEL_BASE:                           \
+			break;                                  \
+		}                                               \
+	} while (false)
+#else
+#define DISPATCH(func, ...)
+#endif
+
+void compress_uyvx_to_i420(const uint8_t *input, uint32_t in_linesize,
+			   uint32_t start_y, uint32_t end_y, uint8_t *output[],
+			   const uint32_t out_linesize[])
+{
+	DISPATCH(compress_uyvx_to_i420, input, in_linesize, start_y, end_y,
+		 output, out_linesize);
+	compress_uyvx_to_i420_sse2(input, in_linesize, start_y, end_y, output,
+				   out_linesize, 0);
+}
+
+void compress_uyvx_to_nv12(const uint8_t *input, uint32_t in_linesize,
+			   uint32_t start_y, uint32_t end_y, uint8_t *output[],
+			   const uint32_t out_linesize[])
+{
+	DISPATCH(compress_uyvx_to_nv12, input, in_linesize, start_y, end_y,
+		 output, out_linesize);
+	compress_uyvx_to_nv12_sse2(input, in_linesize, start_y, end_y, output,
+				   out_linesize, 0);
+}
+
+void convert_uyvx_to_i444(const uint8_t *input, uint32_t in_linesize,
+			  uint32_t start_y, uint32_t end_y, uint8_t *output[],
+			  const uint32_t out_linesize[])
+{
+	DISPATCH(convert_uyvx_to_i444, input, in_linesize, start_y, end_y,
+		 output, out_linesize);
+	convert_uyvx_to_i444_sse2(input, in_linesize, start_y, end_y, output,
+				  out_linesize, 0);
+}
+
+void decompress_420(const uint8_t *const input[], const uint32_t in_linesize[],
+		    uint32_t start_y, uint32_t end_y, uint8_t *output,
+		    uint32_t out_linesize)
+{
+	DISPATCH(decompress_420, input, in_linesize, start_y, end_y, output,
+		 out_linesize);
+	decompress_420_c(input, in_linesize, start_y, end_y, output,
+			 out_linesize, 0);
+}
+
+void decompress_nv12(const uint8_t *const input[], const uint32_t in_linesize[],
+		     uint32_t start_y, uint32_t end_y, uint8_t *output,
+		     uint32_t out_linesize)
+{
+	DISPATCH(decompress_nv12, input, in_linesize, start_y, end_y, output,
+		 out_linesize);
+	decompress_nv12_c(input, in_linesize, start_y, end_y, output,
+			  out_linesize, 0);
+}
+
+void decompress_422(const uint8_t *input, uint32_t in_linesize,
+		    uint32_t start_y, uint32_t end_y, uint8_t *output,
+		    uint32_t out_linesize, bool leading_lum)
+{
+	DISPATCH(decompress_422, input, in_linesize, start_y, end_y, output,
+		 out_linesize, leading_lum);
+	decompress_422_c(input, in_linesize, start_y, end_y, output,
+			 out_linesize, leading_lum, 0);
+}
@@ -0,0 +1,206 @@
+/*
+ * Benchmark for video_frame_copy_planes in video-frame.c.
+ *
+ * Copies frames from 720p to 8K, small enough for the plain memcpy path up
+ * to sizes that take the streaming and threaded paths, once the way
+ * copy_frame_data used to (memcpy per plane, or per line when linesizes
+ * differ) and then through video_frame_copy_planes with 0, 1, 2 and 4 copy
+ * threads.  Every copy has to match the memcpy one byte for byte.
+ *
+ * Standalone program, not part of any target.  Build it against the
+ * libcore framework, which exports the copy functions and os_gettime_ns:
+ *   cc -O2 -I<libcore/core> -F<build dir> -framework libcore \
+ *      video-frame-copy-bench.c -o video-frame-copy-bench
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <util/platform.h>
+#include <media-io/video-frame.h>
+
+#define CHECK(condition)                                                    \
+	do {                                                                \
+		if (!(condition)) {                                         \
+			fprintf(stderr, "%s:%d: error: check failed: %s\n", \
+				__FILE__, __LINE__, #condition);            \
+			exit(1);                                            \
+		}                                                           \
+	} while (0)
+
+/* bytes copied per measurement, split into whole frames */
+#define BYTE_BUDGET (1024ULL * 1024 * 1024)
+
+struct bench_frame {
+	const char *name;
+	uint32_t width;
+	uint32_t height;
+	enum video_format format;
+	/* extra bytes per source line, to take the per-line path */
+	uint32_t src_padding;
+};
+
+static const struct bench_frame frames[] = {
+	{"720p NV12", 1280, 720, VIDEO_FORMAT_NV12, 0},
+	{"1080p NV12", 1920, 1080, VIDEO_FORMAT_NV12, 0},
+	{"1080p I420 pad", 1920, 1080, VIDEO_FORMAT_I420, 64},
+	{"1080p BGRA", 1920, 1080, VIDEO_FORMAT_BGRA, 0},
+	{"4K NV12", 3840, 2160, VIDEO_FORMAT_NV12, 0},
+	{"4K BGRA", 3840, 2160, VIDEO_FORMAT_BGRA, 0},
+	{"8K NV12", 7680, 4320, VIDEO_FORMAT_NV12, 0},
+};
+
+static const size_t thread_counts[] = {0, 1, 2, 4};
+
+struct copy_set {
+	struct video_plane_copy planes[MAX_AV_PLANES];
+	size_t num;
+	size_t bytes;
+	uint8_t *src[MAX_AV_PLANES];
+	uint8_t *dst[MAX_AV_PLANES];
+	uint8_t *ref[MAX_AV_PLANES];
+	size_t dst_size[MAX_AV_PLANES];
+};
+
+static void add_plane(struct copy_set *set, uint32_t linesize, uint32_t lines,
+		      uint32_t src_padding)
+{
+	size_t i = set->num++;
+	size_t src_size = (size_t)(linesize + src_padding) * lines;
+
+	set->dst_size[i] = (size_t)linesize * lines;
+	set->src[i] = malloc(src_size);
+	set->dst[i] = malloc(set->dst_size[i]);
+	set->ref[i] = malloc(set->dst_size[i]);
+	CHECK(set->src[i] && set->dst[i] && set->ref[i]);
+
+	for (size_t b = 0; b < src_size; b++)
+		set->src[i][b] = (uint8_t)rand();
+
+	set->planes[i].dst = set->dst[i];
+	set->planes[i].src = set->src[i];
+	set->planes[i].dst_linesize = linesize;
+	set->planes[i].src_linesize = linesize + src_padding;
+	set->planes[i].lines = lines;
+	set->bytes += set->dst_size[i];
+}
+
+static void copy_set_init(struct copy_set *set, const struct bench_frame *f)
+{
+	const uint32_t cx = f->width;
+	const uint32_t cy = f->height;
+	const uint32_t pad = f->src_padding;
+
+	memset(set, 0, sizeof(*set));
+
+	switch (f->format) {
+	case VIDEO_FORMAT_NV12:
+		add_plane(set, cx, cy, pad);
+		add_plane(set, cx, cy / 2, pad);
+		break;
+	case VIDEO_FORMAT_I420:
+		add_plane(set, cx, cy, pad);
+		add_plane(set, cx / 2, cy / 2, pad / 2);
+		add_plane(set, cx / 2, cy / 2, pad / 2);
+		break;
+	default:
+		add_plane(set, cx * 4, cy, pad);
+		break;
+	}
+}
+
+static void copy_set_free(struct copy_set *set)
+{
+	for (size_t i = 0; i < set->num; i++) {
+		free(set->src[i]);
+		free(set->dst[i]);
+		free(set->ref[i]);
+	}
+}
+
+/* copy_frame_data_plane before video_frame_copy_planes */
+static void copy_memcpy(const struct copy_set *set)
+{
+	for (size_t i = 0; i < set->num; i++) {
+		const struct video_plane_copy *p = &set->planes[i];
+
+		if (p->src_linesize == p->dst_linesize) {
+			memcpy(p->dst, p->src,
+			       (size_t)p->dst_linesize * p->lines);
+		} else {
+			for (uint32_t y = 0; y < p->lines; y++)
+				memcpy(p->dst + (size_t)y * p->dst_linesize,
+				       p->src + (size_t)y * p->src_linesize,
+				       p->dst_linesize);
+		}
+	}
+}
+
+static void copy_planes(const struct copy_set *set)
+{
+	video_frame_copy_planes(set->planes, set->num);
+}
+
+static double bench(void (*copy)(const struct copy_set *set),
+		    const struct copy_set *set)
+{
+	uint64_t iterations = BYTE_BUDGET / set->bytes;
+	if (!iterations)
+		iterations = 1;
+
+	copy(set);
+
+	uint64_t start = os_gettime_ns();
+	for (uint64_t i = 0; i < iterations; i++)
+		copy(set);
+	return (double)(os_gettime_ns() - start) / 1000000.0 /
+	       (double)iterations;
+}
+
+static void check_matches_memcpy(struct copy_set *set)
+{
+	for (size_t i = 0; i < set->num; i++)
+		memset(set->dst[i], 0, set->dst_size[i]);
+	copy_memcpy(set);
+	for (size_t i = 0; i < set->num; i++)
+		memcpy(set->ref[i], set->dst[i], set->dst_size[i]);
+
+	for (size_t i = 0; i < set->num; i++)
+		memset(set->dst[i], 0, set->dst_size[i]);
+	copy_planes(set);
+	for (size_t i = 0; i < set->num; i++)
+		CHECK(memcmp(set->ref[i], set->dst[i], set->dst_size[i]) == 0);
+}
+
+int main(void)
+{
+	const size_t num_threads =
+		sizeof(thread_counts) / sizeof(thread_counts[0]);
+
+	printf("%-15s %8s %9s", "ms/copy", "MB", "memcpy");
+	for (size_t t = 0; t < num_threads; t++)
+		printf("  %zu thread%s", thread_counts[t],
+		       thread_counts[t] == 1 ? " " : "s");
+	printf("\n");
+
+	for (size_t f = 0; f < sizeof(frames) / sizeof(frames[0]); f++) {
+		struct copy_set set;
+		copy_set_init(&set, &frames[f]);
+
+		printf("%-15s %8.2f %9.3f", frames[f].name,
+		       (double)set.bytes / (1024.0 * 1024.0),
+		       bench(copy_memcpy, &set));
+
+		for (size_t t = 0; t < num_threads; t++) {
+			video_frame_copy_set_threads(thread_counts[t]);
+			check_matches_memcpy(&set);
+			printf(" %9.3f", bench(copy_planes, &set));
+		}
+		printf("\n");
+
+		copy_set_free(&set);
+	}
+
+	video_frame_copy_set_threads(0);
+	return 0;
+}
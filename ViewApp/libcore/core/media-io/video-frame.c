@@ -16,9 +16,508 @@
 ******************************************************************************/
 
 #include "video-frame.h"
+#include "../util/darray.h"
+#include "../util/threading.h"
+#include "../util/task.h"
+#include "../util/platform.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define COPY_STREAM_STORES 1
+#endif
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
 
 #define ALIGN_SIZE(size, align) size = (((size) + (align - 1)) & (~(align - 1)))
 
+/* ------------------------------------------------------------------------- */
+/* frame buffer pool                                                         */
+
+/* frame buffers are recycled process-wide through free lists per size
+ * class.  a class is the buffer size a format/resolution needs rounded up
+ * to 1/8th of its power of two, so near-identical resolutions share.
+ *
+ * unless a limit is set, the pool keeps at most as much idle as is in use
+ * plus POOL_IDLE_MIN, and a class nothing allocated from for POOL_STALE_NS
+ * (a source changed resolution or went away) is released altogether. */
+
+#define POOL_HEADER_SIZE 64
+#define POOL_SMALL_GRANULE 4096
+#define POOL_HUGEPAGE_MIN (2 * 1024 * 1024)
+#define POOL_IDLE_MIN (16 * 1024 * 1024)
+#define POOL_STALE_NS 3000000000ULL
+#define POOL_SWEEP_NS 1000000000ULL
+
+struct pool_block {
+	size_t size;
+	struct pool_block *next;
+	bool mapped;
+};
+
+struct pool_class {
+	size_t size;
+	struct pool_block *free;
+	size_t num_free;
+	uint64_t last_alloc;
+};
+
+static struct {
+	pthread_mutex_t mutex;
+	DARRAY(struct pool_class) classes;
+	/* 0 follows live usage */
+	size_t limit;
+	bool hugepages;
+	uint64_t last_sweep;
+
+	uint64_t hits;
+	uint64_t misses;
+	size_t idle_bytes;
+	size_t used_bytes;
+	size_t peak_bytes;
+} pool = {.mutex = PTHREAD_MUTEX_INITIALIZER};
+
+static size_t pool_class_size(size_t size)
+{
+	if (size <= POOL_SMALL_GRANULE * 16)
+		return (size + POOL_SMALL_GRANULE - 1) &
+		       ~(size_t)(POOL_SMALL_GRANULE - 1);
+
+	size_t step = (size_t)1 << (63 - __builtin_clzll(size) - 3);
+	return (size + step - 1) & ~(step - 1);
+}
+
+static struct pool_class *pool_find_class(size_t size)
+{
+	for (size_t i = 0; i < pool.classes.num; i++) {
+		struct pool_class *cls = pool.classes.array + i;
+		if (cls->size == size)
+			return cls;
+	}
+
+	return NULL;
+}
+
+static struct pool_class *pool_get_class(size_t size)
+{
+	struct pool_class *cls = pool_find_class(size);
+	if (cls)
+		return cls;
+
+	cls = da_push_back_new(pool.classes);
+	cls->size = size;
+	return cls;
+}
+
+/* the idle bytes allowed while used_bytes are handed out */
+static inline size_t pool_idle_limit(size_t used_bytes)
+{
+	return pool.limit ? pool.limit : POOL_IDLE_MIN + used_bytes;
+}
+
+static struct pool_block *pool_block_create(size_t size)
+{
+	struct pool_block *block = NULL;
+	bool mapped = false;
+
+#if defined(__linux__)
+	if (pool.hugepages && size >= POOL_HUGEPAGE_MIN) {
+		void *ptr = mmap(NULL, size + POOL_HEADER_SIZE,
+				 PROT_READ | PROT_WRITE,
+				 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (ptr != MAP_FAILED) {
+			madvise(ptr, size + POOL_HEADER_SIZE, MADV_HUGEPAGE);
+			block = ptr;
+			mapped = true;
+		}
+	}
+#endif
+
+	if (!block)
+		block = bmalloc(size + POOL_HEADER_SIZE);
+
+	block->size = size;
+	block->next = NULL;
+	block->mapped = mapped;
+	return block;
+}
+
+static void pool_block_destroy(struct pool_block *block)
+{
+#if defined(__linux__)
+	if (block->mapped) {
+		munmap(block, block->size + POOL_HEADER_SIZE);
+		return;
+	}
+#endif
+	bfree(block);
+}
+
+/* unlinks the free lists of classes other than keep_size not allocated
+ * from since before stale_ts and drops them, returns the unlinked blocks */
+static struct pool_block *pool_collect_stale(uint64_t stale_ts,
+					     size_t keep_size)
+{
+	struct pool_block *blocks = NULL;
+	size_t i = 0;
+
+	while (i < pool.classes.num) {
+		struct pool_class *cls = pool.classes.array + i;
+
+		if (cls->last_alloc >= stale_ts || cls->size == keep_size) {
+			i++;
+			continue;
+		}
+
+		while (cls->free) {
+			struct pool_block *block = cls->free;
+			cls->free = block->next;
+			pool.idle_bytes -= block->size;
+
+			block->next = blocks;
+			blocks = block;
+		}
+
+		da_erase(pool.classes, i);
+	}
+
+	return blocks;
+}
+
+static void pool_destroy_list(struct pool_block *blocks)
+{
+	while (blocks) {
+		struct pool_block *next = blocks->next;
+		pool_block_destroy(blocks);
+		blocks = next;
+	}
+}
+
+static inline struct pool_block *pool_block_from_ptr(void *ptr)
+{
+	return (struct pool_block *)((uint8_t *)ptr - POOL_HEADER_SIZE);
+}
+
+void *video_frame_pool_alloc(size_t size)
+{
+	struct pool_block *block = NULL;
+	struct pool_block *stale = NULL;
+	struct pool_class *cls;
+	uint64_t now = os_gettime_ns();
+
+	size = pool_class_size(size);
+
+	pthread_mutex_lock(&pool.mutex);
+	if (now - pool.last_sweep >= POOL_SWEEP_NS) {
+		if (now > POOL_STALE_NS)
+			stale = pool_collect_stale(now - POOL_STALE_NS,
+						   size);
+		pool.last_sweep = now;
+	}
+
+	cls = pool_get_class(size);
+	cls->last_alloc = now;
+	if (cls->free) {
+		block = cls->free;
+		cls->free = block->next;
+		cls->num_free--;
+		pool.idle_bytes -= size;
+		pool.hits++;
+	} else {
+		pool.misses++;
+	}
+
+	pool.used_bytes += size;
+	if (pool.used_bytes > pool.peak_bytes)
+		pool.peak_bytes = pool.used_bytes;
+	pthread_mutex_unlock(&pool.mutex);
+
+	pool_destroy_list(stale);
+
+	if (!block)
+		block = pool_block_create(size);
+
+	return (uint8_t *)block + POOL_HEADER_SIZE;
+}
+
+void video_frame_pool_free(void *ptr)
+{
+	struct pool_block *block;
+	struct pool_class *cls;
+	size_t size;
+
+	if (!ptr)
+		return;
+
+	block = pool_block_from_ptr(ptr);
+	size = block->size;
+
+	pthread_mutex_lock(&pool.mutex);
+
+	/* frames still in flight when their class went stale are not kept */
+	cls = pool_find_class(size);
+	if (cls && pool.idle_bytes + size <= pool_idle_limit(pool.used_bytes)) {
+		block->next = cls->free;
+		cls->free = block;
+		cls->num_free++;
+		pool.idle_bytes += size;
+		block = NULL;
+	}
+
+	pool.used_bytes -= size;
+	pthread_mutex_unlock(&pool.mutex);
+
+	if (block)
+		pool_block_destroy(block);
+}
+
+static void pool_trim_to(size_t limit)
+{
+	struct pool_block *blocks = NULL;
+
+	pthread_mutex_lock(&pool.mutex);
+
+	/* release the largest buffers first, they are the least likely to
+	 * match a new allocation */
+	while (pool.idle_bytes > limit) {
+		struct pool_class *largest = NULL;
+
+		for (size_t i = 0; i < pool.classes.num; i++) {
+			struct pool_class *cls = pool.classes.array + i;
+			if (cls->free && (!largest || cls->size > largest->size))
+				largest = cls;
+		}
+		if (!largest)
+			break;
+
+		struct pool_block *block = largest->free;
+		largest->free = block->next;
+		largest->num_free--;
+		pool.idle_bytes -= block->size;
+
+		block->next = blocks;
+		blocks = block;
+	}
+
+	pthread_mutex_unlock(&pool.mutex);
+
+	pool_destroy_list(blocks);
+}
+
+void video_frame_pool_set_limit(size_t max_idle_bytes)
+{
+	size_t limit;
+
+	pthread_mutex_lock(&pool.mutex);
+	pool.limit = max_idle_bytes;
+	limit = pool_idle_limit(pool.used_bytes);
+	pthread_mutex_unlock(&pool.mutex);
+
+	pool_trim_to(limit);
+}
+
+void video_frame_pool_set_hugepages(bool enable)
+{
+	pthread_mutex_lock(&pool.mutex);
+	pool.hugepages = enable;
+	pthread_mutex_unlock(&pool.mutex);
+}
+
+void video_frame_pool_trim(void)
+{
+	pool_trim_to(0);
+
+	pthread_mutex_lock(&pool.mutex);
+	if (!pool.used_bytes)
+		da_free(pool.classes);
+	pthread_mutex_unlock(&pool.mutex);
+}
+
+void video_frame_pool_get_stats(struct video_frame_pool_stats *stats)
+{
+	if (!stats)
+		return;
+
+	pthread_mutex_lock(&pool.mutex);
+	stats->hits = pool.hits;
+	stats->misses = pool.misses;
+	stats->idle_bytes = pool.idle_bytes;
+	stats->used_bytes = pool.used_bytes;
+	stats->peak_bytes = pool.peak_bytes;
+	stats->limit = pool_idle_limit(pool.used_bytes);
+	pthread_mutex_unlock(&pool.mutex);
+}
+
+/* ------------------------------------------------------------------------- */
+/* large frame copies                                                        */
+
+/* below this a plain memcpy is fastest and the destination is likely to be
+ * read back soon anyway */
+#define COPY_STREAM_MIN (2 * 1024 * 1024)
+/* worth waking the copy threads from here on */
+#define COPY_THREADED_MIN (8 * 1024 * 1024)
+#define COPY_BAND_SIZE (512 * 1024)
+
+static struct {
+	pthread_mutex_t mutex;
+	os_task_pool_t *pool;
+} copy_threads = {.mutex = PTHREAD_MUTEX_INITIALIZER};
+
+struct copy_job {
+	const struct video_plane_copy *planes;
+	size_t num;
+	uint32_t band_lines[MAX_AV_PLANES];
+	size_t first_band[MAX_AV_PLANES + 1];
+	bool stream;
+};
+
+static inline uint32_t plane_line_size(const struct video_plane_copy *p)
+{
+	return p->dst_linesize < p->src_linesize ? p->dst_linesize
+						 : p->src_linesize;
+}
+
+static void copy_block(uint8_t *dst, const uint8_t *src, size_t size,
+		       bool stream)
+{
+#ifdef COPY_STREAM_STORES
+	if (stream) {
+		size_t head = (16 - ((uintptr_t)dst & 15)) & 15;
+		if (head > size)
+			head = size;
+
+		memcpy(dst, src, head);
+		dst += head;
+		src += head;
+		size -= head;
+
+		for (; size >= 64; size -= 64, dst += 64, src += 64) {
+			const __m128i *s = (const __m128i *)src;
+			__m128i a = _mm_loadu_si128(s);
+			__m128i b = _mm_loadu_si128(s + 1);
+			__m128i c = _mm_loadu_si128(s + 2);
+			__m128i d = _mm_loadu_si128(s + 3);
+			_mm_stream_si128((__m128i *)dst, a);
+			_mm_stream_si128((__m128i *)dst + 1, b);
+			_mm_stream_si128((__m128i *)dst + 2, c);
+			_mm_stream_si128((__m128i *)dst + 3, d);
+		}
+	}
+#else
+	(void)stream;
+#endif
+	memcpy(dst, src, size);
+}
+
+static void copy_lines(const struct video_plane_copy *p, uint32_t y,
+		       uint32_t lines, bool stream)
+{
+	uint8_t *dst = p->dst + (size_t)y * p->dst_linesize;
+	const uint8_t *src = p->src + (size_t)y * p->src_linesize;
+
+	if (p->dst_linesize == p->src_linesize) {
+		copy_block(dst, src, (size_t)p->dst_linesize * lines, stream);
+		return;
+	}
+
+	uint32_t size = plane_line_size(p);
+	for (uint32_t i = 0; i < lines; i++) {
+		copy_block(dst, src, size, stream);
+		dst += p->dst_linesize;
+		src += p->src_linesize;
+	}
+}
+
+static void copy_band_task(void *param, size_t idx)
+{
+	struct copy_job *job = param;
+	size_t plane = 0;
+
+	while (idx >= job->first_band[plane + 1])
+		plane++;
+
+	const struct video_plane_copy *p = &job->planes[plane];
+	uint32_t y = (uint32_t)(idx - job->first_band[plane]) *
+		     job->band_lines[plane];
+	uint32_t lines = p->lines - y < job->band_lines[plane]
+				 ? p->lines - y
+				 : job->band_lines[plane];
+
+	copy_lines(p, y, lines, job->stream);
+
+#ifdef COPY_STREAM_STORES
+	/* streaming stores are weakly ordered, make them visible before the
+	 * job is reported done */
+	if (job->stream)
+		_mm_sfence();
+#endif
+}
+
+void video_frame_copy_planes(const struct video_plane_copy *planes, size_t num)
+{
+	struct copy_job job = {.planes = planes, .num = num};
+	size_t total = 0;
+
+	if (num > MAX_AV_PLANES)
+		num = MAX_AV_PLANES;
+
+	for (size_t i = 0; i < num; i++)
+		total += (size_t)plane_line_size(&planes[i]) * planes[i].lines;
+
+	if (total < COPY_STREAM_MIN) {
+		for (size_t i = 0; i < num; i++)
+			copy_lines(&planes[i], 0, planes[i].lines, false);
+		return;
+	}
+
+	job.stream = true;
+	for (size_t i = 0; i < num; i++) {
+		uint32_t line = plane_line_size(&planes[i]);
+		uint32_t band = line ? COPY_BAND_SIZE / line : 1;
+		if (!band)
+			band = 1;
+
+		job.band_lines[i] = band;
+		job.first_band[i + 1] = job.first_band[i] +
+					(planes[i].lines + band - 1) / band;
+	}
+
+	size_t bands = job.first_band[num];
+
+	/* if another producer is using the threads, copying inline beats
+	 * queueing behind it */
+	if (total >= COPY_THREADED_MIN &&
+	    pthread_mutex_trylock(&copy_threads.mutex) == 0) {
+		bool done = false;
+
+		if (copy_threads.pool) {
+			os_task_pool_run(copy_threads.pool, copy_band_task,
+					 &job, bands);
+			done = true;
+		}
+
+		pthread_mutex_unlock(&copy_threads.mutex);
+		if (done)
+			return;
+	}
+
+	for (size_t i = 0; i < bands; i++)
+		copy_band_task(&job, i);
+}
+
+void video_frame_copy_set_threads(size_t threads)
+{
+	pthread_mutex_lock(&copy_threads.mutex);
+	os_task_pool_destroy(copy_threads.pool);
+	copy_threads.pool = threads ? os_task_pool_create(threads,
+							  "video frame copy")
+				    : NULL;
+	pthread_mutex_unlock(&copy_threads.mutex);
+}
+
+/* ------------------------------------------------------------------------- */
+
 /* messy code alarm */
 void video_frame_init(struct video_frame *frame, enum video_format format,
 		      uint32_t width, uint32_t height)
@@ -49,7 +548,7 @@ void video_frame_init(struct video_frame *frame, enum video_format format,
 		offsets[1] = size;
 		size += quarter_area;
 		ALIGN_SIZE(size, alignment);
-		frame->data[0] = bmalloc(size);
+		frame->data[0] = video_frame_pool_alloc(size);
 		frame->data[1] = (uint8_t *)frame->data[0] + offsets[0];
 		frame->data[2] = (uint8_t *)frame->data[0] + offsets[1];
 		frame->linesize[0] = width;
@@ -65,7 +564,7 @@ void video_frame_init(struct video_frame *frame, enum video_format format,
 		const uint32_t cbcr_width = (width + 1) & (UINT32_MAX - 1);
 		size += cbcr_width * ((height + 1) / 2);
 		ALIGN_SIZE(size, alignment);
-		frame->data[0] = bmalloc(size);
+		frame->data[0] = video_frame_pool_alloc(size);
 		frame->data[1] = (uint8_t *)frame->data[0] + offsets[0];
 		frame->linesize[0] = width;
 		frame->linesize[1] = cbcr_width;
@@ -75,7 +574,7 @@ void video_frame_init(struct video_frame *frame, enum video_format format,
 	case VIDEO_FORMAT_Y800:
 		size = width * height;
 		ALIGN_SIZE(size, alignment);
-		frame->data[0] = bmalloc(size);
+		frame->data[0] = video_frame_pool_alloc(size);
 		frame->linesize[0] = width;
 		break;
 
@@ -86,7 +585,7 @@ void video_frame_init(struct video_frame *frame, enum video_format format,
 			((width + 1) & (UINT32_MAX - 1)) * 2;
 		size = double_width * height;
 		ALIGN_SIZE(size, alignment);
-		frame->data[0] = bmalloc(size);
+		frame->data[0] = video_frame_pool_alloc(size);
 		frame->linesize[0] = double_width;
 		break;
 	}
@@ -97,14 +596,14 @@ void video_frame_init(struct video_frame *frame, enum video_format format,
 	case VIDEO_FORMAT_AYUV:
 		size = width * height * 4;
 		ALIGN_SIZE(size, alignment);
-		frame->data[0] = bmalloc(size);
+		frame->data[0] = video_frame_pool_alloc(size);
 		frame->linesize[0] = width * 4;
 		break;
 
 	case VIDEO_FORMAT_I444:
 		size = width * height;
 		ALIGN_SIZE(size, alignment);
-		frame->data[0] = bmalloc(size * 3);
+		frame->data[0] = video_frame_pool_alloc(size * 3);
 		frame->data[1] = (uint8_t *)frame->data[0] + size;
 		frame->data[2] = (uint8_t *)frame->data[1] + size;
 		frame->linesize[0] = width;
@@ -115,7 +614,7 @@ void video_frame_init(struct video_frame *frame, enum video_format format,
 	case VIDEO_FORMAT_I412:
 		size = width * height * 2;
 		ALIGN_SIZE(size, alignment);
-		frame->data[0] = bmalloc(size * 3);
+		frame->data[0] = video_frame_pool_alloc(size * 3);
 		frame->data[1] = (uint8_t *)frame->data[0] + size;
 		frame->data[2] = (uint8_t *)frame->data[1] + size;
 		frame->linesize[0] = width * 2;
@@ -126,7 +625,7 @@ void video_frame_init(struct video_frame *frame, enum video_format format,
 	case VIDEO_FORMAT_BGR3:
 		size = width * height * 3;
 		ALIGN_SIZE(size, alignment);
-		frame->data[0] = bmalloc(size);
+		frame->data[0] = video_frame_pool_alloc(size);
 		frame->linesize[0] = width * 3;
 		break;
 
@@ -141,7 +640,7 @@ void video_frame_init(struct video_frame *frame, enum video_format format,
 		offsets[1] = size;
 		size += half_area;
 		ALIGN_SIZE(size, alignment);
-		frame->data[0] = bmalloc(size);
+		frame->data[0] = video_frame_pool_alloc(size);
 		frame->data[1] = (uint8_t *)frame->data[0] + offsets[0];
 		frame->data[2] = (uint8_t *)frame->data[0] + offsets[1];
 		frame->linesize[0] = width;
@@ -162,7 +661,7 @@ void video_frame_init(struct video_frame *frame, enum video_format format,
 		offsets[1] = size;
 		size += half_area_size;
 		ALIGN_SIZE(size, alignment);
-		frame->data[0] = bmalloc(size);
+		frame->data[0] = video_frame_pool_alloc(size);
 		frame->data[1] = (uint8_t *)frame->data[0] + offsets[0];
 		frame->data[2] = (uint8_t *)frame->data[0] + offsets[1];
 		frame->linesize[0] = width * 2;
@@ -186,7 +685,7 @@ void video_frame_init(struct video_frame *frame, enum video_format format,
 		offsets[2] = size;
 		size += width * height;
 		ALIGN_SIZE(size, alignment);
-		frame->data[0] = bmalloc(size);
+		frame->data[0] = video_frame_pool_alloc(size);
 		frame->data[1] = (uint8_t *)frame->data[0] + offsets[0];
 		frame->data[2] = (uint8_t *)frame->data[0] + offsets[1];
 		frame->data[3] = (uint8_t *)frame->data[0] + offsets[2];
@@ -211,7 +710,7 @@ void video_frame_init(struct video_frame *frame, enum video_format format,
 		offsets[2] = size;
 		size += width * height;
 		ALIGN_SIZE(size, alignment);
-		frame->data[0] = bmalloc(size);
+		frame->data[0] = video_frame_pool_alloc(size);
 		frame->data[1] = (uint8_t *)frame->data[0] + offsets[0];
 		frame->data[2] = (uint8_t *)frame->data[0] + offsets[1];
 		frame->data[3] = (uint8_t *)frame->data[0] + offsets[2];
@@ -234,7 +733,7 @@ void video_frame_init(struct video_frame *frame, enum video_format format,
 		offsets[2] = size;
 		size += width * height;
 		ALIGN_SIZE(size, alignment);
-		frame->data[0] = bmalloc(size);
+		frame->data[0] = video_frame_pool_alloc(size);
 		frame->data[1] = (uint8_t *)frame->data[0] + offsets[0];
 		frame->data[2] = (uint8_t *)frame->data[0] + offsets[1];
 		frame->data[3] = (uint8_t *)frame->data[0] + offsets[2];
@@ -258,7 +757,7 @@ void video_frame_init(struct video_frame *frame, enum video_format format,
 		offsets[2] = size;
 		size += plane_size;
 		ALIGN_SIZE(size, alignment);
-		frame->data[0] = bmalloc(size);
+		frame->data[0] = video_frame_pool_alloc(size);
 		frame->data[1] = (uint8_t *)frame->data[0] + offsets[0];
 		frame->data[2] = (uint8_t *)frame->data[0] + offsets[1];
 		frame->data[3] = (uint8_t *)frame->data[0] + offsets[2];
@@ -281,7 +780,7 @@ void video_frame_init(struct video_frame *frame, enum video_format format,
 		offsets[1] = size;
 		size += quarter_area * 2;
 		ALIGN_SIZE(size, alignment);
-		frame->data[0] = bmalloc(size);
+		frame->data[0] = video_frame_pool_alloc(size);
 		frame->data[1] = (uint8_t *)frame->data[0] + offsets[0];
 		frame->data[2] = (uint8_t *)frame->data[0] + offsets[1];
 		frame->linesize[0] = width * 2;
@@ -297,7 +796,7 @@ void video_frame_init(struct video_frame *frame, enum video_format format,
 		const uint32_t cbcr_width = (width + 1) & (UINT32_MAX - 1);
 		size += cbcr_width * ((height + 1) / 2) * 2;
 		ALIGN_SIZE(size, alignment);
-		frame->data[0] = bmalloc(size);
+		frame->data[0] = video_frame_pool_alloc(size);
 		frame->data[1] = (uint8_t *)frame->data[0] + offsets[0];
 		frame->linesize[0] = width * 2;
 		frame->linesize[1] = cbcr_width * 2;
@@ -311,7 +810,7 @@ void video_frame_init(struct video_frame *frame, enum video_format format,
 		const uint32_t cbcr_width = (width + 1) & (UINT32_MAX - 1);
 		size += cbcr_width * height * 2;
 		ALIGN_SIZE(size, alignment);
-		frame->data[0] = bmalloc(size);
+		frame->data[0] = video_frame_pool_alloc(size);
 		frame->data[1] = (uint8_t *)frame->data[0] + offsets[0];
 		frame->linesize[0] = width * 2;
 		frame->linesize[1] = cbcr_width * 2;
@@ -324,7 +823,7 @@ void video_frame_init(struct video_frame *frame, enum video_format format,
 		offsets[0] = size;
 		size += width * height * 4;
 		ALIGN_SIZE(size, alignment);
-		frame->data[0] = bmalloc(size);
+		frame->data[0] = video_frame_pool_alloc(size);
 		frame->data[1] = (uint8_t *)frame->data[0] + offsets[0];
 		frame->linesize[0] = width * 2;
 		frame->linesize[1] = width * 4;
@@ -335,7 +834,7 @@ void video_frame_init(struct video_frame *frame, enum video_format format,
 		const uint32_t adjusted_width = ((width + 5) / 6) * 16;
 		size = adjusted_width * height;
 		ALIGN_SIZE(size, alignment);
-		frame->data[0] = bmalloc(size);
+		frame->data[0] = video_frame_pool_alloc(size);
 		frame->linesize[0] = adjusted_width;
 		break;
 	}
@@ -25,6 +25,56 @@ struct video_frame {
 	uint32_t linesize[MAX_AV_PLANES];
 };
 
+struct video_frame_pool_stats {
+	uint64_t hits;
+	uint64_t misses;
+	/** Bytes kept in the pool's free lists */
+	size_t idle_bytes;
+	/** Bytes of buffers currently handed out */
+	size_t used_bytes;
+	size_t peak_bytes;
+	/** Idle bytes the pool currently allows */
+	size_t limit;
+};
+
+/**
+ * Frame buffers are shared process-wide.  Buffers allocated here must be
+ * freed with video_frame_pool_free; video_frame_init and
+ * obs_source_frame_init allocate their planes from the pool.
+ */
+EXPORT void *video_frame_pool_alloc(size_t size);
+EXPORT void video_frame_pool_free(void *ptr);
+
+/**
+ * Caps the bytes kept idle in the pool.  0, the default, allows as much
+ * idle as is in use plus 16MB.  Either way sizes nothing allocated for a
+ * few seconds are released.
+ */
+EXPORT void video_frame_pool_set_limit(size_t max_idle_bytes);
+/** Backs buffers of 2MB and up with transparent hugepages (Linux only) */
+EXPORT void video_frame_pool_set_hugepages(bool enable);
+/** Frees every idle buffer */
+EXPORT void video_frame_pool_trim(void);
+EXPORT void video_frame_pool_get_stats(struct video_frame_pool_stats *stats);
+
+struct video_plane_copy {
+	uint8_t *dst;
+	const uint8_t *src;
+	uint32_t dst_linesize;
+	uint32_t src_linesize;
+	uint32_t lines;
+};
+
+/**
+ * Copies frame planes, each line copying the smaller of the two
+ * linesizes.  Large frames bypass the cache with streaming stores and are
+ * split across the copy threads.
+ */
+EXPORT void video_frame_copy_planes(const struct video_plane_copy *planes,
+				    size_t num);
+/** Sets the number of helper threads for large copies, 0 to copy inline */
+EXPORT void video_frame_copy_set_threads(size_t threads);
+
 EXPORT void video_frame_init(struct video_frame *frame,
 			     enum video_format format, uint32_t width,
 			     uint32_t height);
@@ -32,7 +82,7 @@ EXPORT void video_frame_init(struct video_frame *frame,
 static inline void video_frame_free(struct video_frame *frame)
 {
 	if (frame) {
-		bfree(frame->data[0]);
+		video_frame_pool_free(frame->data[0]);
 		memset(frame, 0, sizeof(struct video_frame));
 	}
 }
@@ -50,7 +100,7 @@ video_frame_create(enum video_format format, uint32_t width, uint32_t height)
 static inline void video_frame_destroy(struct video_frame *frame)
 {
 	if (frame) {
-		bfree(frame->data[0]);
+		video_frame_pool_free(frame->data[0]);
 		bfree(frame);
 	}
 }
@@ -0,0 +1,330 @@
+/*
+ * Contention benchmark for the video-io frame handoff.
+ *
+ * A producer thread stands in for the graphics thread and hands FRAMES
+ * frames to the video thread through video_output_lock_frame/unlock_frame,
+ * staying at most half the cache ahead.  INPUTS encoders are connected and
+ * a third thread connects and disconnects another one the whole time.  The
+ * same run
+ * is then repeated against a copy of the old handoff, which shared
+ * data_mutex between both threads and held input_mutex while calling the
+ * inputs.  Reports the producer's per-frame handoff cost, and checks that
+ * every input saw every frame.
+ *
+ * Standalone program, not part of any target.  Build it against the
+ * libcore framework, which exports video-io and os_gettime_ns:
+ *   cc -O2 -I<libcore/core> -F<build dir> -framework libcore \
+ *      video-io-bench.c -o video-io-bench
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <media-io/video-io.h>
+#include <media-io/video-frame.h>
+
+#define CHECK(condition)                                                    \
+	do {                                                                \
+		if (!(condition)) {                                         \
+			fprintf(stderr, "%s:%d: error: check failed: %s\n", \
+				__FILE__, __LINE__, #condition);            \
+			exit(1);                                            \
+		}                                                           \
+	} while (0)
+
+#define FRAMES 200000
+#define INPUTS 4
+#define CACHE_SIZE 16
+
+static uint32_t handoff_ns[FRAMES];
+static volatile long delivered[INPUTS + 1];
+static volatile bool churning;
+
+static int compare_u32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+	return (x > y) - (x < y);
+}
+
+static void report(const char *name, uint64_t total_ns)
+{
+	qsort(handoff_ns, FRAMES, sizeof(handoff_ns[0]), compare_u32);
+
+	printf("%-10s %7.1f ns/frame  p50 %5u  p99 %6u  p99.9 %7u  max %8u\n",
+	       name, (double)total_ns / FRAMES, handoff_ns[FRAMES / 2],
+	       handoff_ns[FRAMES * 99 / 100], handoff_ns[FRAMES * 999 / 1000],
+	       handoff_ns[FRAMES - 1]);
+}
+
+/* keeps the producer from running more than half the cache ahead, so the
+ * handoff is measured with both sides busy instead of on a full ring */
+static void throttle(size_t frame)
+{
+	while (frame > (size_t)os_atomic_load_long(&delivered[0]) +
+				CACHE_SIZE / 2)
+		os_sleep_ms(0);
+}
+
+static void wait_delivered(void)
+{
+	for (size_t i = 0; i < INPUTS; i++) {
+		int waited = 0;
+		while (os_atomic_load_long(&delivered[i]) < FRAMES) {
+			CHECK(waited++ < 10000);
+			os_sleep_ms(1);
+		}
+		CHECK(os_atomic_load_long(&delivered[i]) == FRAMES);
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* the handoff as it was before the ring: both sides take data_mutex, and
+ * the video thread holds input_mutex while it calls the inputs */
+
+struct locked_frame {
+	int count;
+	int skipped;
+	uint64_t timestamp;
+};
+
+struct locked_output {
+	pthread_mutex_t data_mutex;
+	pthread_mutex_t input_mutex;
+	os_sem_t *update_semaphore;
+	pthread_t thread;
+	volatile bool stop;
+
+	size_t available_frames;
+	size_t first_added;
+	size_t last_added;
+	struct locked_frame cache[CACHE_SIZE];
+
+	size_t num_inputs;
+};
+
+static bool locked_cur_frame(struct locked_output *out)
+{
+	struct locked_frame *frame;
+	bool complete;
+
+	pthread_mutex_lock(&out->data_mutex);
+	frame = &out->cache[out->first_added];
+	pthread_mutex_unlock(&out->data_mutex);
+
+	pthread_mutex_lock(&out->input_mutex);
+	for (size_t i = 0; i < out->num_inputs; i++)
+		os_atomic_inc_long(&delivered[i]);
+	pthread_mutex_unlock(&out->input_mutex);
+
+	pthread_mutex_lock(&out->data_mutex);
+	complete = --frame->count == 0;
+
+	if (complete) {
+		if (++out->first_added == CACHE_SIZE)
+			out->first_added = 0;
+		if (++out->available_frames == CACHE_SIZE)
+			out->last_added = out->first_added;
+	} else if (frame->skipped > 0) {
+		--frame->skipped;
+	}
+	pthread_mutex_unlock(&out->data_mutex);
+
+	return complete;
+}
+
+static void *locked_thread(void *param)
+{
+	struct locked_output *out = param;
+
+	while (os_sem_wait(out->update_semaphore) == 0) {
+		if (out->stop)
+			break;
+		while (!out->stop && !locked_cur_frame(out))
+			;
+	}
+
+	return NULL;
+}
+
+static bool locked_lock_frame(struct locked_output *out, uint64_t timestamp)
+{
+	bool locked;
+
+	pthread_mutex_lock(&out->data_mutex);
+
+	if (out->available_frames == 0) {
+		out->cache[out->last_added].count += 1;
+		out->cache[out->last_added].skipped += 1;
+		locked = false;
+	} else {
+		if (out->available_frames != CACHE_SIZE) {
+			if (++out->last_added == CACHE_SIZE)
+				out->last_added = 0;
+		}
+
+		out->cache[out->last_added].timestamp = timestamp;
+		out->cache[out->last_added].count = 1;
+		out->cache[out->last_added].skipped = 0;
+		locked = true;
+	}
+
+	pthread_mutex_unlock(&out->data_mutex);
+	return locked;
+}
+
+static void locked_unlock_frame(struct locked_output *out)
+{
+	pthread_mutex_lock(&out->data_mutex);
+	out->available_frames--;
+	pthread_mutex_unlock(&out->data_mutex);
+
+	os_sem_post(out->update_semaphore);
+}
+
+static void *locked_churn_thread(void *param)
+{
+	struct locked_output *out = param;
+
+	while (os_atomic_load_bool(&churning)) {
+		pthread_mutex_lock(&out->input_mutex);
+		out->num_inputs = INPUTS + 1;
+		pthread_mutex_unlock(&out->input_mutex);
+		os_sleep_ms(1);
+
+		pthread_mutex_lock(&out->input_mutex);
+		out->num_inputs = INPUTS;
+		pthread_mutex_unlock(&out->input_mutex);
+		os_sleep_ms(1);
+	}
+
+	return NULL;
+}
+
+static void bench_locked(void)
+{
+	struct locked_output out = {.available_frames = CACHE_SIZE,
+				    .num_inputs = INPUTS};
+	pthread_t churn;
+
+	memset((void *)delivered, 0, sizeof(delivered));
+	CHECK(pthread_mutex_init(&out.data_mutex, NULL) == 0);
+	CHECK(pthread_mutex_init(&out.input_mutex, NULL) == 0);
+	CHECK(os_sem_init(&out.update_semaphore, 0) == 0);
+	CHECK(pthread_create(&out.thread, NULL, locked_thread, &out) == 0);
+
+	os_atomic_set_bool(&churning, true);
+	CHECK(pthread_create(&churn, NULL, locked_churn_thread, &out) == 0);
+
+	uint64_t total = 0;
+	for (size_t i = 0; i < FRAMES; i++) {
+		uint64_t t = os_gettime_ns();
+		if (locked_lock_frame(&out, t))
+			locked_unlock_frame(&out);
+		handoff_ns[i] = (uint32_t)(os_gettime_ns() - t);
+		total += handoff_ns[i];
+		throttle(i);
+	}
+
+	os_atomic_set_bool(&churning, false);
+	pthread_join(churn, NULL);
+	wait_delivered();
+
+	out.stop = true;
+	os_sem_post(out.update_semaphore);
+	pthread_join(out.thread, NULL);
+	os_sem_destroy(out.update_semaphore);
+	pthread_mutex_destroy(&out.input_mutex);
+	pthread_mutex_destroy(&out.data_mutex);
+
+	report("mutexes", total);
+}
+
+/* ------------------------------------------------------------------------- */
+/* the same run through video-io */
+
+static void input_callback(void *param, struct video_data *frame)
+{
+	os_atomic_inc_long(param);
+	UNUSED_PARAMETER(frame);
+}
+
+static void *churn_thread(void *param)
+{
+	video_t *video = param;
+
+	while (os_atomic_load_bool(&churning)) {
+		video_output_connect(video, NULL, input_callback,
+				     (void *)&delivered[INPUTS]);
+		os_sleep_ms(1);
+		video_output_disconnect(video, input_callback,
+					(void *)&delivered[INPUTS]);
+		os_sleep_ms(1);
+	}
+
+	return NULL;
+}
+
+static void bench_video_io(void)
+{
+	struct video_output_info info = {
+		.name = "bench",
+		.format = VIDEO_FORMAT_RGBA,
+		.fps_num = 60,
+		.fps_den = 1,
+		.width = 64,
+		.height = 64,
+		.cache_size = CACHE_SIZE,
+		.colorspace = VIDEO_CS_709,
+		.range = VIDEO_RANGE_PARTIAL,
+	};
+	video_t *video;
+	pthread_t churn;
+
+	memset((void *)delivered, 0, sizeof(delivered));
+	CHECK(video_output_open(&video, &info) == VIDEO_OUTPUT_SUCCESS);
+	for (size_t i = 0; i < INPUTS; i++)
+		CHECK(video_output_connect(video, NULL, input_callback,
+					   (void *)&delivered[i]));
+
+	os_atomic_set_bool(&churning, true);
+	CHECK(pthread_create(&churn, NULL, churn_thread, video) == 0);
+
+	uint64_t total = 0;
+	for (size_t i = 0; i < FRAMES; i++) {
+		struct video_frame frame;
+		uint64_t t = os_gettime_ns();
+		if (video_output_lock_frame(video, &frame, 1, t)) {
+			frame.data[0][0] = (uint8_t)i;
+			video_output_unlock_frame(video);
+		}
+		handoff_ns[i] = (uint32_t)(os_gettime_ns() - t);
+		total += handoff_ns[i];
+		throttle(i);
+	}
+
+	os_atomic_set_bool(&churning, false);
+	pthread_join(churn, NULL);
+	wait_delivered();
+
+	for (size_t i = 0; i < INPUTS; i++)
+		video_output_disconnect(video, input_callback,
+					(void *)&delivered[i]);
+	video_output_stop(video);
+	video_output_close(video);
+
+	report("video-io", total);
+}
+
+int main(void)
+{
+	printf("%d frames, %d inputs, %d cached frames\n", FRAMES, INPUTS,
+	       CACHE_SIZE);
+
+	bench_locked();
+	bench_video_io();
+
+	return 0;
+}
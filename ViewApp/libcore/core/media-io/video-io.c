@@ -22,6 +22,7 @@
 #include "../util/profiler.h"
 #include "../util/threading.h"
 #include "../util/darray.h"
+#include "../util/task.h"
 #include "../util/util_uint64.h"
 
 #include "format-conversion.h"
@@ -36,47 +37,92 @@ extern profiler_name_store_t *obs_get_profiler_name_store(void);
 
 struct cached_frame_info {
 	struct video_data frame;
-	int skipped;
-	int count;
+	volatile long skipped;
+	volatile long count;
+
+	/* set for frames queued with video_output_push_frame_ref, in which
+	 * case the planes come from ref_frame instead of the cache buffers */
+	struct video_data ref_frame;
+	void (*release)(void *param);
+	void *release_param;
 };
-///====写入到编码器
-struct video_input {
-	struct video_scale_info conversion;
+///====同一种转换每帧只做一次 由需要该转换的输入共享
+struct video_conversion {
+	struct video_scale_info info;
 	video_scaler_t *scaler;
 	struct video_frame frame[MAX_CONVERT_BUFFERS];
 	int cur_frame;
+	bool success;
+
+	/* number of inputs sharing this conversion, only touched with
+	 * input_mutex held */
+	long refs;
+	const char *profile_name;
+};
+
+///====写入到编码器
+struct video_input {
+	struct video_scale_info conversion;
+	struct video_conversion *convert;
 
 	void (*callback)(void *param, struct video_data *frame);
 	void *param;
+
+	const char *profile_name;
 };
 
-static inline void video_input_free(struct video_input *input)
+static inline void video_conversion_free(struct video_conversion *convert)
 {
+	if (!convert)
+		return;
+
 	for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
-		video_frame_free(&input->frame[i]);
-	video_scaler_destroy(input->scaler);
+		video_frame_free(&convert->frame[i]);
+	video_scaler_destroy(convert->scaler);
+	bfree(convert);
+}
+
+static inline void video_input_free(struct video_input *input)
+{
+	bfree(input);
+}
+
+static inline void atomic_add_long(volatile long *val, long add)
+{
+	long cur = os_atomic_load_long(val);
+	while (!os_atomic_compare_exchange_long(val, &cur, cur + add))
+		;
 }
 /// 一个画布对应一个输出  目前只有主画面  从画布输出的视频帧 存储到这里
 struct video_output {
 	struct video_output_info info;
     ///单独线程处理 接收数据 ===>放缩  ===>输出
 	pthread_t thread;
-	pthread_mutex_t data_mutex;
 	bool stop;
 
+	os_task_pool_t *input_pool;
+
 	os_sem_t *update_semaphore;
 	uint64_t frame_time;
 	volatile long skipped_frames;
 	volatile long total_frames;
 
+	/* connect/disconnect serialize on input_mutex and publish a new list
+	 * by flipping cur_inputs, the video thread only reads the published
+	 * list and marks itself with input_readers (odd while reading) */
 	pthread_mutex_t input_mutex;
     ///写入到编码器
-	DARRAY(struct video_input) inputs;
-
-    ///缓冲区可写入的帧数   初始值是缓冲区的大小
-	size_t available_frames;
+	DARRAY(struct video_input *) inputs[2];
+	DARRAY(struct video_conversion *) conversions[2];
+	volatile long cur_inputs;
+	volatile long input_readers;
+
+	/* single producer (graphics thread), single consumer (video thread)
+	 * ring, queued_frames is the only state both sides write */
+	volatile long queued_frames;
     size_t first_added;      // 最早的待处理帧位置 最开始添加的  由消费者控制
     size_t last_added;       // 最新写入的帧位置    (生产者)在添加时修改last_added
+    size_t next_added;       // 下一个写入位置 由生产者控制
     ///环形缓冲区 视频帧 存储到这里
 	struct cached_frame_info cache[MAX_CACHE_SIZE];
 
@@ -88,87 +134,149 @@ struct video_output {
 
 /* ------------------------------------------------------------------------- */
 ///====放缩
-static inline bool scale_video_output(struct video_input *input,
-				      struct video_data *data)
+static void scale_conversion(struct video_conversion *convert,
+			     const struct video_data *data)
 {
-	bool success = true;
+	struct video_frame *frame;
 
-	if (input->scaler) {
-		struct video_frame *frame;
+	if (++convert->cur_frame == MAX_CONVERT_BUFFERS)
+		convert->cur_frame = 0;
 
-		if (++input->cur_frame == MAX_CONVERT_BUFFERS)
-			input->cur_frame = 0;
+	frame = &convert->frame[convert->cur_frame];
 
-		frame = &input->frame[input->cur_frame];
+	profile_start(convert->profile_name);
+	convert->success = video_scaler_scale(
+		convert->scaler, frame->data, frame->linesize,
+		(const uint8_t *const *)data->data, data->linesize);
+	profile_end(convert->profile_name);
 
-		success = video_scaler_scale(input->scaler, frame->data,
-					     frame->linesize,
-					     (const uint8_t *const *)data->data,
-					     data->linesize);
+	if (!convert->success)
+		blog(LOG_WARNING, "video-io: Could not scale frame!");
+}
 
-		if (success) {
-			for (size_t i = 0; i < MAX_AV_PLANES; i++) {
-				data->data[i] = frame->data[i];
-				data->linesize[i] = frame->linesize[i];
-			}
-		} else {
-			blog(LOG_WARNING, "video-io: Could not scale frame!");
+static void process_input(struct video_input *input,
+			  const struct video_data *src)
+{
+	struct video_conversion *convert = input->convert;
+	struct video_data frame = *src;
+
+	if (convert) {
+		struct video_frame *scaled;
+
+		if (!convert->success)
+			return;
+
+		scaled = &convert->frame[convert->cur_frame];
+		for (size_t i = 0; i < MAX_AV_PLANES; i++) {
+			frame.data[i] = scaled->data[i];
+			frame.linesize[i] = scaled->linesize[i];
 		}
 	}
 
-	return success;
+	profile_start(input->profile_name);
+    ///输入到编码器中
+	input->callback(input->param, &frame);
+	profile_end(input->profile_name);
+}
+
+struct input_pass {
+	struct video_conversion **conversions;
+	struct video_input **inputs;
+	const struct video_data *frame;
+};
+
+static void scale_conversion_task(void *param, size_t idx)
+{
+	struct input_pass *pass = param;
+
+	scale_conversion(pass->conversions[idx], pass->frame);
+	profile_reenable_thread();
 }
+
+static void process_input_task(void *param, size_t idx)
+{
+	struct input_pass *pass = param;
+
+	process_input(pass->inputs[idx], pass->frame);
+	profile_reenable_thread();
+}
+
 ///====消费当前有效帧
 static inline bool video_output_cur_frame(struct video_output *video)
 {
 	struct cached_frame_info *frame_info;
 	bool complete;
-	bool skipped;
+	long count;
 
 	/* -------------------------------- */
 
-	pthread_mutex_lock(&video->data_mutex);
-
+	/* the slot stays ours until queued_frames is decremented below */
 	frame_info = &video->cache[video->first_added];
 
-	pthread_mutex_unlock(&video->data_mutex);
-
 	/* -------------------------------- */
 
-	pthread_mutex_lock(&video->input_mutex);
+	os_atomic_inc_long(&video->input_readers);
 
-	for (size_t i = 0; i < video->inputs.num; i++) {
-		struct video_input *input = video->inputs.array + i;
-		struct video_data frame = frame_info->frame;
-        ///输入到编码器中
-		if (scale_video_output(input, &frame))
-			input->callback(input->param, &frame);
+	struct video_data frame = frame_info->frame;
+	if (frame_info->release) {
+		memcpy(frame.data, frame_info->ref_frame.data,
+		       sizeof(frame.data));
+		memcpy(frame.linesize, frame_info->ref_frame.linesize,
+		       sizeof(frame.linesize));
 	}
 
-	pthread_mutex_unlock(&video->input_mutex);
+	long list = os_atomic_load_long(&video->cur_inputs);
+	size_t num_conversions = video->conversions[list].num;
+	size_t num = video->inputs[list].num;
+	struct input_pass pass = {
+		.conversions = video->conversions[list].array,
+		.inputs = video->inputs[list].array,
+		.frame = &frame,
+	};
+
+	/* each distinct conversion is scaled once, then every input gets
+	 * either the source frame or its shared converted frame.  both steps
+	 * only depend on the source frame, so they can run in parallel.
+	 * os_task_pool_run waits for all of them, which keeps each input's
+	 * frames in order */
+	if (video->input_pool && num_conversions > 1)
+		os_task_pool_run(video->input_pool, scale_conversion_task,
+				 &pass, num_conversions);
+	else
+		for (size_t i = 0; i < num_conversions; i++)
+			scale_conversion_task(&pass, i);
+
+	if (video->input_pool && num > 1)
+		os_task_pool_run(video->input_pool, process_input_task, &pass,
+				 num);
+	else
+		for (size_t i = 0; i < num; i++)
+			process_input(pass.inputs[i], pass.frame);
+
+	os_atomic_inc_long(&video->input_readers);
 
 	/* -------------------------------- */
 
-	pthread_mutex_lock(&video->data_mutex);
-    
     ///缓冲区的处理
 	frame_info->frame.timestamp += video->frame_time;
-	complete = --frame_info->count == 0;
-	skipped = frame_info->skipped > 0;
+	count = os_atomic_dec_long(&frame_info->count);
+	complete = count == 0;
 
 	if (complete) {
+		if (frame_info->release) {
+			frame_info->release(frame_info->release_param);
+			frame_info->release = NULL;
+		}
+
 		if (++video->first_added == video->info.cache_size)
 			video->first_added = 0;
 
-		if (++video->available_frames == video->info.cache_size)
-			video->last_added = video->first_added;
-	} else if (skipped) {
-		--frame_info->skipped;
+		os_atomic_dec_long(&video->queued_frames);
+	} else if (os_atomic_load_long(&frame_info->skipped) > 0) {
+		os_atomic_dec_long(&frame_info->skipped);
 		os_atomic_inc_long(&video->skipped_frames);
 	}
 
-	pthread_mutex_unlock(&video->data_mutex);
-
 	/* -------------------------------- */
 
 	return complete;
@@ -223,7 +331,7 @@ static inline void init_cache(struct video_output *video)
 				 video->info.height);
 	}
 
-	video->available_frames = video->info.cache_size;
+	video->queued_frames = 0;
 }
 ///===创建video_output 开启线程  并打开
 int video_output_open(video_t **video, struct video_output_info *info)
@@ -241,12 +349,16 @@ int video_output_open(video_t **video, struct video_output_info *info)
 	out->frame_time =
 		util_mul_div64(1000000000ULL, info->fps_den, info->fps_num);
 
-	if (pthread_mutex_init_recursive(&out->data_mutex) != 0)
-		goto fail0;
 	if (pthread_mutex_init_recursive(&out->input_mutex) != 0)
-		goto fail1;
+		goto fail0;
 	if (os_sem_init(&out->update_semaphore, 0) != 0)
-		goto fail2;
+		goto fail1;
+	if (info->input_threads) {
+		out->input_pool = os_task_pool_create(info->input_threads,
+						      "video-io: input worker");
+		if (!out->input_pool)
+			goto fail2;
+	}
 	if (pthread_create(&out->thread, NULL, video_thread, out) != 0)
 		goto fail3;
 
@@ -256,11 +368,11 @@ int video_output_open(video_t **video, struct video_output_info *info)
 	return VIDEO_OUTPUT_SUCCESS;
 
 fail3:
-	os_sem_destroy(out->update_semaphore);
+	os_task_pool_destroy(out->input_pool);
 fail2:
-	pthread_mutex_destroy(&out->input_mutex);
+	os_sem_destroy(out->update_semaphore);
 fail1:
-	pthread_mutex_destroy(&out->data_mutex);
+	pthread_mutex_destroy(&out->input_mutex);
 fail0:
 	bfree(out);
 	return VIDEO_OUTPUT_FAIL;
@@ -273,18 +385,34 @@ void video_output_close(video_t *video)
     ///此处等待线程结束
 	video_output_stop(video);
 
+	for (long i = 0; i < video->queued_frames; i++) {
+		struct cached_frame_info *cfi =
+			&video->cache[(video->first_added + i) %
+				      video->info.cache_size];
+		if (cfi->release) {
+			cfi->release(cfi->release_param);
+			cfi->release = NULL;
+		}
+	}
+
 	pthread_mutex_lock(&video->input_mutex);
 
-	for (size_t i = 0; i < video->inputs.num; i++)
-		video_input_free(&video->inputs.array[i]);
-	da_free(video->inputs);
+	long list = video->cur_inputs;
+	for (size_t i = 0; i < video->inputs[list].num; i++)
+		video_input_free(video->inputs[list].array[i]);
+	for (size_t i = 0; i < video->conversions[list].num; i++)
+		video_conversion_free(video->conversions[list].array[i]);
+	da_free(video->inputs[0]);
+	da_free(video->inputs[1]);
+	da_free(video->conversions[0]);
+	da_free(video->conversions[1]);
 
 	for (size_t i = 0; i < video->info.cache_size; i++)
 		video_frame_free((struct video_frame *)&video->cache[i]);
 
 	pthread_mutex_unlock(&video->input_mutex);
+	os_task_pool_destroy(video->input_pool);
 	os_sem_destroy(video->update_semaphore);
-	pthread_mutex_destroy(&video->data_mutex);
 	pthread_mutex_destroy(&video->input_mutex);
 
 	bfree(video);
@@ -295,8 +423,10 @@ static size_t video_get_input_idx(const video_t *video,
 						   struct video_data *frame),
 				  void *param)
 {
-	for (size_t i = 0; i < video->inputs.num; i++) {
-		struct video_input *input = video->inputs.array + i;
+	long list = video->cur_inputs;
+
+	for (size_t i = 0; i < video->inputs[list].num; i++) {
+		struct video_input *input = video->inputs[list].array[i];
 		if (input->callback == callback && input->param == param)
 			return i;
 	}
@@ -304,6 +434,31 @@ static size_t video_get_input_idx(const video_t *video,
 	return DARRAY_INVALID;
 }
 
+/* call with input_mutex held.  returns the index of the unpublished copy of
+ * the input list, which the video thread is guaranteed not to be reading */
+static inline long begin_input_update(video_t *video)
+{
+	long next = video->cur_inputs ^ 1;
+
+	da_copy(video->inputs[next], video->inputs[video->cur_inputs]);
+	da_copy(video->conversions[next],
+		video->conversions[video->cur_inputs]);
+	return next;
+}
+
+/* publishes the updated list and waits out any pass of the video thread
+ * that could still be using the old one */
+static void end_input_update(video_t *video, long next)
+{
+	os_atomic_set_long(&video->cur_inputs, next);
+
+	long readers = os_atomic_load_long(&video->input_readers);
+	if (readers & 1) {
+		while (os_atomic_load_long(&video->input_readers) == readers)
+			os_sleep_ms(1);
+	}
+}
+
 static bool match_range(enum video_range_type a, enum video_range_type b)
 {
 	return (a == VIDEO_RANGE_FULL) == (b == VIDEO_RANGE_FULL);
@@ -330,9 +485,56 @@ static bool match_space(enum video_colorspace a, enum video_colorspace b)
 {
 	return collapse_space(a) == collapse_space(b);
 }
-///======
+/* compares what the scaler resolves the conversions to, so inputs asking
+ * for e.g. VIDEO_CS_DEFAULT and VIDEO_CS_709 share one scaler */
+static inline bool scale_info_equal(const struct video_scale_info *a,
+				    const struct video_scale_info *b)
+{
+	return a->format == b->format && a->width == b->width &&
+	       a->height == b->height && match_range(a->range, b->range) &&
+	       match_space(a->colorspace, b->colorspace);
+}
+
+static struct video_conversion *
+video_conversion_create(struct video_output *video,
+			const struct video_scale_info *info)
+{
+	struct video_scale_info from = {.format = video->info.format,
+					.width = video->info.width,
+					.height = video->info.height,
+					.range = video->info.range,
+					.colorspace = video->info.colorspace};
+	struct video_conversion *convert = bzalloc(sizeof(*convert));
+
+	convert->info = *info;
+
+	int ret = video_scaler_create(&convert->scaler, info, &from,
+				      VIDEO_SCALE_FAST_BILINEAR);
+	if (ret != VIDEO_SCALER_SUCCESS) {
+		if (ret == VIDEO_SCALER_BAD_CONVERSION)
+			blog(LOG_ERROR, "video_input_init: Bad "
+					"scale conversion type");
+		else
+			blog(LOG_ERROR, "video_input_init: Failed to "
+					"create scaler");
+
+		bfree(convert);
+		return NULL;
+	}
+
+	for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
+		video_frame_init(&convert->frame[i], info->format, info->width,
+				 info->height);
+
+	convert->profile_name = profile_store_name(
+		obs_get_profiler_name_store(), "video_scale(%s: %s %ux%u)",
+		video->info.name, get_video_format_name(info->format),
+		info->width, info->height);
+	return convert;
+}
+///======给输入找到或者创建所需的转换   list:尚未发布的输入列表
 static inline bool video_input_init(struct video_input *input,
-				    struct video_output *video)
+				    struct video_output *video, long list)
 {
 	if (input->conversion.width != video->info.width ||
 	    input->conversion.height != video->info.height ||
@@ -340,32 +542,28 @@ static inline bool video_input_init(struct video_input *input,
 	    !match_range(input->conversion.range, video->info.range) ||
 	    !match_space(input->conversion.colorspace,
 			 video->info.colorspace)) {
-		struct video_scale_info from = {.format = video->info.format,
-						.width = video->info.width,
-						.height = video->info.height,
-						.range = video->info.range,
-						.colorspace =
-							video->info.colorspace};
-
-		int ret = video_scaler_create(&input->scaler,
-					      &input->conversion, &from,
-					      VIDEO_SCALE_FAST_BILINEAR);
-		if (ret != VIDEO_SCALER_SUCCESS) {
-			if (ret == VIDEO_SCALER_BAD_CONVERSION)
-				blog(LOG_ERROR, "video_input_init: Bad "
-						"scale conversion type");
-			else
-				blog(LOG_ERROR, "video_input_init: Failed to "
-						"create scaler");
-
-			return false;
+		struct video_conversion *convert = NULL;
+
+		for (size_t i = 0; i < video->conversions[list].num; i++) {
+			struct video_conversion *cur =
+				video->conversions[list].array[i];
+			if (scale_info_equal(&cur->info, &input->conversion)) {
+				convert = cur;
+				break;
+			}
 		}
 
-		for (size_t i = 0; i < MAX_CONVERT_BUFFERS; i++)
-			video_frame_init(&input->frame[i],
-					 input->conversion.format,
-					 input->conversion.width,
-					 input->conversion.height);
+		if (!convert) {
+			convert = video_conversion_create(video,
+							  &input->conversion);
+			if (!convert)
+				return false;
+
+			da_push_back(video->conversions[list], &convert);
+		}
+
+		convert->refs++;
+		input->convert = convert;
 	}
 
 	return true;
@@ -390,36 +588,46 @@ bool video_output_connect(video_t *video,
 	pthread_mutex_lock(&video->input_mutex);
     ///没有找到对应的input
 	if (video_get_input_idx(video, callback, param) == DARRAY_INVALID) {
-		struct video_input input;
-		memset(&input, 0, sizeof(input));
+		struct video_input *input = bzalloc(sizeof(*input));
 
-		input.callback = callback;
-		input.param = param;
+		input->callback = callback;
+		input->param = param;
 
 		if (conversion) {
-			input.conversion = *conversion;
+			input->conversion = *conversion;
 		} else {
-			input.conversion.format = video->info.format;
-			input.conversion.width = video->info.width;
-			input.conversion.height = video->info.height;
-			input.conversion.range = video->info.range;
-			input.conversion.colorspace = video->info.colorspace;
+			input->conversion.format = video->info.format;
+			input->conversion.width = video->info.width;
+			input->conversion.height = video->info.height;
+			input->conversion.range = video->info.range;
+			input->conversion.colorspace = video->info.colorspace;
 		}
 
-		if (input.conversion.width == 0)
-			input.conversion.width = video->info.width;
-		if (input.conversion.height == 0)
-			input.conversion.height = video->info.height;
+		if (input->conversion.width == 0)
+			input->conversion.width = video->info.width;
+		if (input->conversion.height == 0)
+			input->conversion.height = video->info.height;
+
+		input->profile_name = profile_store_name(
+			obs_get_profiler_name_store(), "video_input(%s: %s %ux%u)",
+			video->info.name,
+			get_video_format_name(input->conversion.format),
+			input->conversion.width, input->conversion.height);
 
-		success = video_input_init(&input, video);
+		long next = begin_input_update(video);
+
+		success = video_input_init(input, video, next);
 		if (success) {
-			if (video->inputs.num == 0) {
+			if (video->inputs[next].num == 0) {
 				if (!os_atomic_load_long(&video->gpu_refs)) {
 					reset_frames(video);
 				}
 				os_atomic_set_bool(&video->raw_active, true);
 			}
-			da_push_back(video->inputs, &input);
+			da_push_back(video->inputs[next], &input);
+			end_input_update(video, next);
+		} else {
+			video_input_free(input);
 		}
 	}
 
@@ -456,10 +664,21 @@ void video_output_disconnect(video_t *video,
 
 	size_t idx = video_get_input_idx(video, callback, param);
 	if (idx != DARRAY_INVALID) {
-		video_input_free(video->inputs.array + idx);
-		da_erase(video->inputs, idx);
+		long next = begin_input_update(video);
+		struct video_input *input = video->inputs[next].array[idx];
+		struct video_conversion *convert = input->convert;
+
+		da_erase(video->inputs[next], idx);
+		if (convert && --convert->refs == 0)
+			da_erase_item(video->conversions[next], &convert);
+		else
+			convert = NULL;
+
+		end_input_update(video, next);
+		video_input_free(input);
+		video_conversion_free(convert);
 
-		if (video->inputs.num == 0) {
+		if (video->inputs[next].num == 0) {
 			os_atomic_set_bool(&video->raw_active, false);
 			if (!os_atomic_load_long(&video->gpu_refs)) {
 				log_skipped(video);
@@ -481,43 +700,54 @@ const struct video_output_info *video_output_get_info(const video_t *video)
 {
 	return video ? &video->info : NULL;
 }
+/* reserves the next cache slot for the graphics thread, or when the cache is
+ * full, has the newest queued frame repeat count more times instead */
+static struct cached_frame_info *reserve_frame(video_t *video, int count,
+					       uint64_t timestamp)
+{
+	struct cached_frame_info *cfi;
+
+    ///此处应该是线程处理太慢 导致了拥堵   据系统CPU核心数或可用内存动态调整cache_size
+	while ((size_t)os_atomic_load_long(&video->queued_frames) ==
+	       video->info.cache_size) {
+		/* the ring is full, so have the newest queued frame repeat.
+		 * its count only drops to 0 right before the video thread
+		 * releases the slot, in which case there is room again */
+		cfi = &video->cache[video->last_added];
+
+		long cur = os_atomic_load_long(&cfi->count);
+		while (cur > 0) {
+			if (os_atomic_compare_exchange_long(&cfi->count, &cur,
+							    cur + count)) {
+				atomic_add_long(&cfi->skipped, count);
+				return NULL;
+			}
+		}
+	}
+
+	cfi = &video->cache[video->next_added];
+	cfi->frame.timestamp = timestamp;
+	cfi->release = NULL;
+	os_atomic_set_long(&cfi->count, count);
+	os_atomic_set_long(&cfi->skipped, 0);
+	return cfi;
+}
+
 ///====获取缓冲区中一个帧的指针 用于写入数据   返回true 表示锁定成功  count:当前帧要使用几次
 bool video_output_lock_frame(video_t *video, struct video_frame *frame,
 			     int count, uint64_t timestamp)
 {
 	struct cached_frame_info *cfi;
-	bool locked;
 
 	if (!video)
 		return false;
 
-	pthread_mutex_lock(&video->data_mutex);
-
-    ///此处应该是线程处理太慢 导致了拥堵   据系统CPU核心数或可用内存动态调整cache_size
-	if (video->available_frames == 0) {
-		video->cache[video->last_added].count += count;
-		video->cache[video->last_added].skipped += count;
-		locked = false;
-
-	} else {
-		if (video->available_frames != video->info.cache_size) {
-			if (++video->last_added == video->info.cache_size)
-				video->last_added = 0;
-		}
-
-		cfi = &video->cache[video->last_added];
-		cfi->frame.timestamp = timestamp;
-		cfi->count = count;
-		cfi->skipped = 0;
-        
-		memcpy(frame, &cfi->frame, sizeof(*frame));
-
-		locked = true;
-	}
-
-	pthread_mutex_unlock(&video->data_mutex);
+	cfi = reserve_frame(video, count, timestamp);
+	if (!cfi)
+		return false;
 
-	return locked;
+	memcpy(frame, &cfi->frame, sizeof(*frame));
+	return true;
 }
 ///=== 锁定成功后都会unlock
 void video_output_unlock_frame(video_t *video)
@@ -525,13 +755,35 @@ void video_output_unlock_frame(video_t *video)
 	if (!video)
 		return;
 
-	pthread_mutex_lock(&video->data_mutex);
-    ///此时可写入的帧数-1
-	video->available_frames--;
+	video->last_added = video->next_added;
+	if (++video->next_added == video->info.cache_size)
+		video->next_added = 0;
+
+    ///发布该帧 此时可写入的帧数-1
+	os_atomic_inc_long(&video->queued_frames);
     ///线程继续
 	os_sem_post(video->update_semaphore);
+}
 
-	pthread_mutex_unlock(&video->data_mutex);
+bool video_output_push_frame_ref(video_t *video,
+				 const struct video_data *frame, int count,
+				 void (*release)(void *param), void *param)
+{
+	struct cached_frame_info *cfi;
+
+	if (!video || !release)
+		return false;
+
+	cfi = reserve_frame(video, count, frame->timestamp);
+	if (!cfi)
+		return false;
+
+	cfi->ref_frame = *frame;
+	cfi->release = release;
+	cfi->release_param = param;
+
+	video_output_unlock_frame(video);
+	return true;
 }
 
 uint64_t video_output_get_frame_time(const video_t *video)
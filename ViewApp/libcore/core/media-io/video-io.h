@@ -133,6 +133,10 @@ struct video_output_info {
 
 	enum video_colorspace colorspace;
 	enum video_range_type range;
+
+	/* worker threads used to scale and dispatch frames to several inputs
+	 * concurrently, 0 processes every input on the video thread */
+	size_t input_threads;
 };
 
 static inline bool format_is_yuv(enum video_format format)
@@ -321,6 +325,18 @@ EXPORT bool video_output_lock_frame(video_t *video, struct video_frame *frame,
                                     int count, uint64_t timestamp);
 EXPORT void video_output_unlock_frame(video_t *video);
 
+/**
+ * Queues a frame that video-io does not own.  Inputs read the planes in place,
+ * and release(param) is called from the video thread once every input is done
+ * with the frame.  Returns false if the frame was not queued (the cache was
+ * full, so the previous frame is repeated instead), in which case release is
+ * not called and the caller still owns the planes.
+ */
+EXPORT bool video_output_push_frame_ref(video_t *video,
+					const struct video_data *frame,
+					int count, void (*release)(void *param),
+					void *param);
+
 
 EXPORT uint64_t video_output_get_frame_time(const video_t *video);
 
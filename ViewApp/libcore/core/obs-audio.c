@@ -27,17 +27,54 @@ struct ts_info {
 #define DEBUG_AUDIO 0
 #define DEBUG_LAGGED_AUDIO 0
 
+/* below this the worker wakeups cost more than rendering serially */
+#define MIN_PARALLEL_AUDIO_SOURCES 4
+
+extern THREAD_LOCAL bool is_audio_thread;
+
+/* scenes and transitions only carry what their children route to them,
+ * anything else has audio of its own */
+static inline bool routes_from_children(const obs_source_t *source)
+{
+	return source->info.type == OBS_SOURCE_TYPE_SCENE ||
+	       source->info.type == OBS_SOURCE_TYPE_TRANSITION;
+}
+
+/* the tree is walked children first, so a source's routes are complete by
+ * the time it's passed along to its parent */
+static inline void route_audio(obs_source_t *parent, obs_source_t *source)
+{
+	uint32_t routes = source->audio_routes;
+
+	if (!routes_from_children(source))
+		routes = 0xFFFFFFFF;
+
+	source->audio_routes = routes & source->audio_mixers;
+
+	if (parent) {
+		parent->audio_routes |= source->audio_routes;
+		if (parent->audio_render_level <= source->audio_render_level)
+			parent->audio_render_level =
+				source->audio_render_level + 1;
+	}
+}
+
 static void push_audio_tree(obs_source_t *parent, obs_source_t *source, void *p)
 {
 	struct obs_core_audio *audio = p;
 
-	if (da_find(audio->render_order, &source, 0) == DARRAY_INVALID) {
+	if (!source->audio_render_cached) {
 		obs_source_t *s = obs_source_get_ref(source);
-		if (s)
+		if (s) {
+			s->audio_render_cached = true;
 			da_push_back(audio->render_order, &s);
+		}
 	}
 
-	UNUSED_PARAMETER(parent);
+	route_audio(parent, source);
+
+	if (audio->render_depth < source->audio_render_level)
+		audio->render_depth = source->audio_render_level;
 }
 
 static inline size_t convert_time_to_frames(size_t sample_rate, uint64_t t)
@@ -63,17 +100,13 @@ static inline void mix_audio(struct audio_output_data *mixes,
 	}
 
 	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
-		for (size_t ch = 0; ch < channels; ch++) {
-			register float *mix = mixes[mix_idx].data[ch];
-			register float *aud = source->audio_output_buf[mix_idx][ch];
-			register float *end;
+		if ((source->audio_render_mixers & (1 << mix_idx)) == 0)
+			continue;
 
-			mix += start_point;
-			end = aud + total_floats;
-
-			while (aud < end)
-				*(mix++) += *(aud++);
-		}
+		for (size_t ch = 0; ch < channels; ch++)
+			audio_mix_add(mixes[mix_idx].data[ch] + start_point,
+				      source->audio_output_buf[mix_idx][ch],
+				      total_floats);
 	}
 }
 ///===丢弃当前source->audio_ts - start_ts 之间的采样  因为此时source已经滞后了
@@ -491,10 +524,186 @@ static inline const char *calc_min_ts(struct obs_core_data *data,
 	return buffering_name;
 }
 
-static inline void release_audio_sources(struct obs_core_audio *audio)
+void release_audio_graph(struct obs_core_audio *audio)
+{
+	for (size_t i = 0; i < audio->render_order.num; i++) {
+		obs_source_t *source = audio->render_order.array[i];
+
+		source->audio_routes = 0;
+		source->audio_render_level = 0;
+		source->audio_render_cached = false;
+		obs_source_release(source);
+	}
+
+	da_resize(audio->render_order, 0);
+	da_resize(audio->root_nodes, 0);
+	da_resize(audio->render_stage, 0);
+	audio->render_depth = 0;
+	audio->render_valid = false;
+}
+
+/* the graph holds a reference to everything in it, so a source nothing
+ * else references any more would otherwise be kept alive by it */
+static inline bool audio_graph_orphaned(struct obs_core_audio *audio)
+{
+	for (size_t i = 0; i < audio->render_order.num; i++) {
+		obs_source_t *source = audio->render_order.array[i];
+		if (os_atomic_load_long(&source->context.control->ref.refs) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+static void build_audio_graph(struct obs_core_audio *audio)
+{
+	struct obs_core_data *data = &obs->data;
+	struct obs_source *source;
+
+	/* NOTE: these are source channels, not audio channels
+	 遍历出所有音频相关的source
+	 */
+	for (uint32_t i = 0; i < MAX_CHANNELS; i++) {
+		source = obs_get_output_source(i);
+		if (source) {
+			obs_source_enum_active_tree(source, push_audio_tree,
+						    audio);
+			push_audio_tree(NULL, source, audio);
+			da_push_back(audio->root_nodes, &source);
+			obs_source_release(source);
+		}
+	}
+
+	pthread_mutex_lock(&data->audio_sources_mutex);
+	source = data->first_audio_source;
+	while (source) {
+		push_audio_tree(NULL, source, audio);
+		source = (struct obs_source *)source->next_audio_source;
+	}
+	pthread_mutex_unlock(&data->audio_sources_mutex);
+
+	/* levels are only final once the whole tree has been walked */
+	for (uint32_t level = 0; level <= audio->render_depth; level++) {
+		for (size_t i = 0; i < audio->render_order.num; i++) {
+			source = audio->render_order.array[i];
+			if (source->audio_render_level == level)
+				da_push_back(audio->render_stage, &source);
+		}
+	}
+
+	audio->render_valid = true;
+}
+
+static void update_audio_graph(struct obs_core_audio *audio)
 {
-	for (size_t i = 0; i < audio->render_order.num; i++)
-		obs_source_release(audio->render_order.array[i]);
+	long generation = os_atomic_load_long(&audio->render_generation);
+
+	if (audio->render_valid && audio->render_built == generation &&
+	    !audio_graph_orphaned(audio))
+		return;
+
+	release_audio_graph(audio);
+	build_audio_graph(audio);
+	audio->render_built = generation;
+}
+
+struct audio_render_pass {
+	obs_source_t **sources;
+	uint32_t mixers;
+	size_t channels;
+	size_t sample_rate;
+	size_t audio_size;
+	uint64_t start_ts;
+	bool buffering_maxed;
+};
+
+static void render_audio_source(struct audio_render_pass *pass,
+				obs_source_t *source)
+{
+	uint32_t source_mixers = pass->mixers & source->audio_routes;
+
+	obs_source_audio_render(source, source_mixers, pass->channels,
+				pass->sample_rate, pass->audio_size);
+
+	/* if a source has gone backward in time and we can no
+	 * longer buffer, drop some or all of its audio
+	 缓冲区已满  且source此时source已滞后  所以丢一些数据 追赶时钟
+	 */
+	if (pass->buffering_maxed && source->audio_ts != 0 &&
+	    source->audio_ts < pass->start_ts) {
+		if (source->info.audio_render) {
+			blog(LOG_DEBUG,
+			     "render audio source %s timestamp has "
+			     "gone backwards",
+			     obs_source_get_name(source));
+
+			/* just avoid further damage */
+			source->audio_pending = true;
+#if DEBUG_AUDIO == 1
+			/* this should really be fixed */
+			assert(false);
+#endif
+		} else {
+			pthread_mutex_lock(&source->audio_buf_mutex);
+			bool rerender = ignore_audio(source, pass->channels,
+						     pass->sample_rate,
+						     pass->start_ts);
+			pthread_mutex_unlock(&source->audio_buf_mutex);
+
+			/* if we (potentially) recovered, re-render */
+			if (rerender)
+				obs_source_audio_render(source, source_mixers,
+							pass->channels,
+							pass->sample_rate,
+							pass->audio_size);
+		}
+	}
+}
+
+static void render_audio_task(void *param, size_t idx)
+{
+	struct audio_render_pass *pass = param;
+
+	/* render callbacks expect to be on the audio thread, so audio tasks
+	 * they queue have to run inline rather than wait on this tick */
+	is_audio_thread = true;
+	render_audio_source(pass, pass->sources[idx]);
+}
+
+/* children are always a level below their parents, so everything on one
+ * level only reads buffers that are already rendered.  mixing still walks
+ * root_nodes in order afterwards, so the output doesn't change */
+static void render_audio_level(struct obs_core_audio *audio,
+			       struct audio_render_pass *pass, size_t count)
+{
+	if (audio->render_pool && count >= MIN_PARALLEL_AUDIO_SOURCES) {
+		os_task_pool_run(audio->render_pool, render_audio_task, pass,
+				 count);
+		return;
+	}
+
+	for (size_t i = 0; i < count; i++)
+		render_audio_source(pass, pass->sources[i]);
+}
+
+static void render_audio_graph(struct obs_core_audio *audio,
+			       struct audio_render_pass *pass)
+{
+	obs_source_t **stage = audio->render_stage.array;
+	size_t num = audio->render_stage.num;
+	size_t start = 0;
+
+	while (start < num) {
+		uint32_t level = stage[start]->audio_render_level;
+		size_t end = start + 1;
+
+		while (end < num && stage[end]->audio_render_level == level)
+			end++;
+
+		pass->sources = stage + start;
+		render_audio_level(audio, pass, end - start);
+		start = end;
+	}
 }
 
 static inline void execute_audio_tasks(void)
@@ -527,12 +736,10 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 	size_t sample_rate = audio_output_get_sample_rate(audio->audio);
 	size_t channels = audio_output_get_channels(audio->audio);
 	struct ts_info ts = {start_ts_in, end_ts_in};
+	struct audio_render_pass pass;
 	size_t audio_size;
 	uint64_t min_ts;
 
-	da_resize(audio->render_order, 0);
-	da_resize(audio->root_nodes, 0);
-    
 	circlebuf_push_back(&audio->buffered_timestamps, &ts, sizeof(ts));
     ///取出缓冲区的第一个时间戳 给ts
 	circlebuf_peek_front(&audio->buffered_timestamps, &ts, sizeof(ts));
@@ -545,70 +752,19 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 #endif
 
 	/* ------------------------------------------------ */
-	/* build audio render order
-	 * NOTE: these are source channels, not audio channels
-     遍历出所有音频相关的source
-     */
-	for (uint32_t i = 0; i < MAX_CHANNELS; i++) {
-		obs_source_t *source = obs_get_output_source(i);
-		if (source) {
-			obs_source_enum_active_tree(source, push_audio_tree, audio);
-			push_audio_tree(NULL, source, audio);
-			da_push_back(audio->root_nodes, &source);
-			obs_source_release(source);
-		}
-	}
-	pthread_mutex_lock(&data->audio_sources_mutex);
-	source = data->first_audio_source;
-	while (source) {
-		push_audio_tree(NULL, source, audio);
-		source = (struct obs_source *)source->next_audio_source;
-	}
-	pthread_mutex_unlock(&data->audio_sources_mutex);
+	/* build audio render order */
+	update_audio_graph(audio);
 
-    
-    
 	/* ------------------------------------------------ */
 	/* render audio data */
-	for (size_t i = 0; i < audio->render_order.num; i++) {
-		obs_source_t *source = audio->render_order.array[i];
-		obs_source_audio_render(source, mixers, channels, sample_rate,audio_size);
-
-		/* if a source has gone backward in time and we can no
-		 * longer buffer, drop some or all of its audio
-         缓冲区已满  且source此时source已滞后  所以丢一些数据 追赶时钟
-         */
-		if (audio_buffering_maxed(audio) && source->audio_ts != 0 &&
-		    source->audio_ts < ts.start) {
-			if (source->info.audio_render) {
-				blog(LOG_DEBUG,
-				     "render audio source %s timestamp has "
-				     "gone backwards",
-				     obs_source_get_name(source));
-
-				/* just avoid further damage */
-				source->audio_pending = true;
-#if DEBUG_AUDIO == 1
-				/* this should really be fixed */
-				assert(false);
-#endif
-			} else {
-				pthread_mutex_lock(&source->audio_buf_mutex);
-				bool rerender = ignore_audio(source, channels,
-							     sample_rate,
-							     ts.start);
-				pthread_mutex_unlock(&source->audio_buf_mutex);
-
-				/* if we (potentially) recovered, re-render */
-				if (rerender)
-					obs_source_audio_render(source, mixers,
-								channels,
-								sample_rate,
-								audio_size);
-			}
-		}
-	}
-
+	pass.mixers = mixers;
+	pass.channels = channels;
+	pass.sample_rate = sample_rate;
+	pass.audio_size = audio_size;
+	pass.start_ts = ts.start;
+	pass.buffering_maxed = audio_buffering_maxed(audio);
+
+	render_audio_graph(audio, &pass);
 	/* ------------------------------------------------ */
 	/* get minimum audio timestamp */
 	pthread_mutex_lock(&data->audio_sources_mutex);
@@ -659,10 +815,6 @@ bool audio_callback(void *param, uint64_t start_ts_in, uint64_t end_ts_in,
 
 	pthread_mutex_unlock(&data->audio_sources_mutex);
 
-	/* ------------------------------------------------ */
-	/* release audio sources */
-	release_audio_sources(audio);
-
 	circlebuf_pop_front(&audio->buffered_timestamps, NULL, sizeof(ts));
 
 	*out_ts = ts.start;
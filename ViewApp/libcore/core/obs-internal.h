@@ -47,6 +47,7 @@
 	HASH_ADD(hh_uuid, head, uuid_field[0], UUID_STR_LENGTH, add)
 
 #define NUM_TEXTURES 2
+#define MAX_TEXTURES 8
 #define NUM_CHANNELS 3
 #define MICROSECOND_DEN 1000000
 #define NUM_ENCODE_TEXTURES 10
@@ -214,6 +215,9 @@ void obs_hotkey_name_map_free(void);
 //主画布和预览画布都对应一个obs_view
 struct obs_view {
 	pthread_mutex_t channels_mutex;
+	/* staging ring depth of mixes added for this view, 0 for the global
+	 * obs_set_video_readback depth */
+	uint32_t readback_depth;
     ///视频： 转场source->scene_source->input_sources   当前选中的转场source
     ///音频： 桌面音频source 、
 	obs_source_t *channels[MAX_CHANNELS];
@@ -272,6 +276,14 @@ struct obs_task_info {
 	obs_task_t task;
 	void *param;
 };
+
+struct obs_core_video_mix;
+
+/* a staging slot whose mapped surfaces were handed to video-io directly */
+struct obs_raw_frame_ref {
+	struct obs_core_video_mix *video;
+	volatile long refs;
+};
 /*
  ///每一个画布对应一个obs_core_video_mix和一个线程
  画布上会有多个source 最终将多个source混合 并输出  (多个source在view->channels里)
@@ -280,11 +292,11 @@ struct obs_core_video_mix {
 	struct obs_view *view;
     ///cur_texture 对应当前纹理
     ///
-	gs_stagesurf_t *active_copy_surfaces[NUM_TEXTURES][NUM_CHANNELS];
-	gs_stagesurf_t *copy_surfaces[NUM_TEXTURES][NUM_CHANNELS];
+	gs_stagesurf_t *active_copy_surfaces[MAX_TEXTURES][NUM_CHANNELS];
+	gs_stagesurf_t *copy_surfaces[MAX_TEXTURES][NUM_CHANNELS];
 	gs_texture_t *convert_textures[NUM_CHANNELS];
 #ifdef _WIN32
-	gs_stagesurf_t *copy_surfaces_encode[NUM_TEXTURES];
+	gs_stagesurf_t *copy_surfaces_encode[MAX_TEXTURES];
 	gs_texture_t *convert_textures_encode[NUM_CHANNELS];
 #endif
     ///绘制的数据会存储在这个纹理上
@@ -293,7 +305,7 @@ struct obs_core_video_mix {
 	gs_texture_t *output_texture;
 	enum gs_color_space render_space;
 	bool texture_rendered;
-	bool textures_copied[NUM_TEXTURES];
+	bool textures_copied[MAX_TEXTURES];
 	bool texture_converted;
     
     ///nv12纹理
@@ -303,8 +315,24 @@ struct obs_core_video_mix {
     ///从GPU中读出frame 存储到此处
 	struct circlebuf vframe_info_buffer;
 	struct circlebuf vframe_info_buffer_gpu;
-	gs_stagesurf_t *mapped_surfaces[NUM_CHANNELS];
+	gs_stagesurf_t *mapped_surfaces[MAX_TEXTURES][NUM_CHANNELS];
 	int cur_texture;
+	int prev_texture;
+
+	/* staging ring depth, and whether raw outputs read the mapped
+	 * surfaces in place.  a slot stays mapped while video-io holds it,
+	 * and at most num_textures - 2 slots are held so there is always
+	 * one free to stage into */
+	int num_textures;
+	bool zero_copy_raw;
+	struct obs_raw_frame_ref raw_refs[MAX_TEXTURES];
+	volatile long raw_frames_held;
+
+	/* frame mapped by this tick's readback, handed to video-io after
+	 * every mix has been read back */
+	struct video_data readback_frame;
+	bool readback_ready;
+	struct obs_video_readback_stats readback_stats;
 
     /*
      两对状态
@@ -348,7 +376,60 @@ struct obs_core_video_mix {
 	float color_matrix[16];
 };
 
-extern struct obs_core_video_mix *obs_create_video_mix(struct obs_video_info *ovi);
+/* log-linear histogram of microsecond durations: the first 8 buckets are
+ * 1us wide, after that each power of two is split into 8 buckets, so any
+ * value is resolved to within 12.5% up to about a minute.  written by the
+ * graphics thread only, read by anyone without locking. */
+#define FRAME_HIST_SUB_BITS 3
+#define FRAME_HIST_SUB_COUNT (1 << FRAME_HIST_SUB_BITS)
+#define FRAME_HIST_BUCKETS (FRAME_HIST_SUB_COUNT * 24)
+
+struct obs_frame_histogram {
+	volatile long counts[FRAME_HIST_BUCKETS];
+	volatile long max_us;
+};
+
+static inline size_t frame_hist_bucket(uint64_t us)
+{
+	if (us < FRAME_HIST_SUB_COUNT)
+		return (size_t)us;
+
+	size_t msb = 63 - (size_t)__builtin_clzll(us);
+	size_t shift = msb - FRAME_HIST_SUB_BITS;
+	size_t idx = (shift + 1) * FRAME_HIST_SUB_COUNT +
+		     (size_t)((us >> shift) & (FRAME_HIST_SUB_COUNT - 1));
+
+	return idx < FRAME_HIST_BUCKETS ? idx : FRAME_HIST_BUCKETS - 1;
+}
+
+/* midpoint of the bucket, in microseconds */
+static inline uint64_t frame_hist_value(size_t idx)
+{
+	if (idx < FRAME_HIST_SUB_COUNT)
+		return idx;
+
+	size_t shift = idx / FRAME_HIST_SUB_COUNT - 1;
+	uint64_t sub = idx % FRAME_HIST_SUB_COUNT;
+	return ((FRAME_HIST_SUB_COUNT + sub) << shift) +
+	       ((1ULL << shift) >> 1);
+}
+
+struct obs_video_frame_times {
+	struct obs_frame_histogram loop;
+	struct obs_frame_histogram sleep_overshoot;
+	struct obs_frame_histogram tick_sources;
+	struct obs_frame_histogram output_frames;
+	struct obs_frame_histogram render_displays;
+	volatile long missed_deadlines;
+	/* scene items culled so far in this frame, graphics thread only */
+	long frame_culled_items;
+	volatile long last_culled_items;
+	volatile long max_culled_items;
+	volatile bool reset;
+};
+
+extern struct obs_core_video_mix *
+obs_create_video_mix(struct obs_view *view, struct obs_video_info *ovi);
 extern void obs_free_video_mix(struct obs_core_video_mix *video);
 ///所有的视频相关
 struct obs_core_video {
@@ -378,6 +459,7 @@ struct obs_core_video {
 	uint32_t total_frames;
     ///延迟的帧数
 	uint32_t lagged_frames;
+	struct obs_video_frame_times frame_times;
 	bool thread_initialized;
 
 	gs_texture_t *transparent_texture;
@@ -408,6 +490,12 @@ struct obs_core_video {
 	pthread_mutex_t task_mutex;
 	struct circlebuf tasks;
 
+	/* readback settings for mixes created from now on */
+	uint32_t readback_depth;
+	bool readback_zero_copy;
+	enum obs_frame_clock frame_clock;
+	uint64_t frame_clock_spin_ns;
+
 	pthread_mutex_t mixes_mutex;
     ///所有画布(目前看到mixes中只有main_mix)
 	DARRAY(struct obs_core_video_mix *) mixes;
@@ -420,8 +508,18 @@ struct audio_monitor;
 struct obs_core_audio {
 	audio_t *audio;
 
+	/* the render graph is kept between ticks and only rebuilt once
+	 * render_generation has moved on from the one it was built at */
 	DARRAY(struct obs_source *) render_order;
 	DARRAY(struct obs_source *) root_nodes;
+	/* render_order sorted by render level */
+	DARRAY(struct obs_source *) render_stage;
+	/* deepest render level in the audio tree */
+	uint32_t render_depth;
+	volatile long render_generation;
+	long render_built;
+	bool render_valid;
+	os_task_pool_t *render_pool;
     ///开始缓冲时的 时钟时间 
 	uint64_t buffered_ts;
 	struct circlebuf buffered_timestamps;
@@ -580,6 +678,14 @@ struct obs_core {
 
 extern struct obs_core *obs;
 
+/* call after anything that changes what obs_source_enum_active_tree returns
+ * or how audio is routed, the audio thread rebuilds its render graph */
+static inline void obs_invalidate_audio_graph(void)
+{
+	if (obs)
+		os_atomic_inc_long(&obs->audio.render_generation);
+}
+
 struct obs_graphics_context {
     // video线程上一次的tick时间
     uint64_t video_time;
@@ -592,6 +698,8 @@ struct obs_graphics_context {
     //该线程每秒tick的帧数
 	uint32_t fps_total_frames;
 	const char *video_thread_name;
+	os_frame_clock_t *frame_clock;
+	os_task_pool_t *tick_pool;
 };
 
 ///====所有source 画布绘制 以及画布的输出 (输出到每个画布对应的video_output中)
@@ -609,6 +717,7 @@ extern gs_effect_t *obs_load_effect(gs_effect_t **effect, const char *file);
 extern bool audio_callback(void *param, uint64_t start_ts_in,
 			   uint64_t end_ts_in, uint64_t *out_ts,
 			   uint32_t mixers, struct audio_output_data *mixes);
+extern void release_audio_graph(struct obs_core_audio *audio);
 
 extern struct obs_core_video_mix *get_mix_for_video(video_t *video);
 
@@ -775,8 +884,99 @@ struct async_frame {
 	struct obs_source_frame *frame;
 	long unused_count;
 	bool used;
+	/* arrived through async_ready_ring, goes back through
+	 * async_free_ring */
+	bool ring;
+};
+
+/* single-producer/single-consumer frame ring.  the producer owns head,
+ * the consumer owns tail */
+#define ASYNC_RING_SIZE 32
+
+struct async_frame_ring {
+	struct obs_source_frame *frames[ASYNC_RING_SIZE];
+	volatile long head;
+	volatile long tail;
+};
+
+static inline bool async_ring_push(struct async_frame_ring *ring,
+				   struct obs_source_frame *frame)
+{
+	long head = os_atomic_load_long(&ring->head);
+	if (head - os_atomic_load_long(&ring->tail) == ASYNC_RING_SIZE)
+		return false;
+
+	ring->frames[head & (ASYNC_RING_SIZE - 1)] = frame;
+	os_atomic_set_long(&ring->head, head + 1);
+	return true;
+}
+
+static inline struct obs_source_frame *
+async_ring_pop(struct async_frame_ring *ring)
+{
+	long tail = os_atomic_load_long(&ring->tail);
+	if (tail == os_atomic_load_long(&ring->head))
+		return NULL;
+
+	struct obs_source_frame *frame =
+		ring->frames[tail & (ASYNC_RING_SIZE - 1)];
+	os_atomic_set_long(&ring->tail, tail + 1);
+	return frame;
+}
+
+/* audio on its way from obs_source_output_audio to the audio thread.
+ * callers of source_output_audio_data are serialized by audio_mutex and
+ * the audio thread drains under audio_buf_mutex, so one producer and one
+ * consumer use each ring at a time */
+#define AUDIO_RING_SIZE 32
+
+struct audio_packet {
+	float *data[MAX_AUDIO_CHANNELS];
+	size_t channels;
+	/* frames per channel the buffers hold */
+	uint32_t capacity;
+	uint32_t frames;
+	uint64_t timestamp;
+	bool push_back;
+};
+
+struct audio_packet_ring {
+	struct audio_packet *packets[AUDIO_RING_SIZE];
+	volatile long head;
+	volatile long tail;
 };
 
+static inline bool audio_ring_push(struct audio_packet_ring *ring,
+				   struct audio_packet *packet)
+{
+	long head = os_atomic_load_long(&ring->head);
+	if (head - os_atomic_load_long(&ring->tail) == AUDIO_RING_SIZE)
+		return false;
+
+	ring->packets[head & (AUDIO_RING_SIZE - 1)] = packet;
+	os_atomic_set_long(&ring->head, head + 1);
+	return true;
+}
+
+static inline struct audio_packet *
+audio_ring_pop(struct audio_packet_ring *ring)
+{
+	long tail = os_atomic_load_long(&ring->tail);
+	if (tail == os_atomic_load_long(&ring->head))
+		return NULL;
+
+	struct audio_packet *packet =
+		ring->packets[tail & (AUDIO_RING_SIZE - 1)];
+	os_atomic_set_long(&ring->tail, tail + 1);
+	return packet;
+}
+
+static inline bool audio_ring_empty(struct audio_packet_ring *ring)
+{
+	return os_atomic_load_long(&ring->tail) ==
+	       os_atomic_load_long(&ring->head);
+}
+
 enum audio_action_type {
 	AUDIO_ACTION_VOL,
 	AUDIO_ACTION_MUTE,
@@ -865,6 +1065,10 @@ struct obs_source {
      */
 	bool enabled;
 
+	/* bumped whenever what the source renders may have changed, so scenes
+	 * can tell when a cached render of it is stale */
+	volatile long render_serial;
+
 	/* hint to allow sources to render more quickly 目前没有发现有用的地方
      （当变换矩阵只有平移时 才置为1） */
 	bool texcoords_centered;
@@ -886,6 +1090,9 @@ struct obs_source {
 	uint64_t next_audio_sys_ts_min;
     //上一个从帧缓冲区获取到的frame的timestamp
 	uint64_t last_frame_ts;
+	/* async_frames limit, 0 for MAX_ASYNC_FRAMES */
+	uint32_t async_queue_depth;
+	struct obs_source_async_stats async_stats;
     ///当前tick执行时 上一次tick的时钟时间
 	uint64_t last_sys_timestamp;
     ///异步渲染是否已经结束
@@ -914,10 +1121,22 @@ struct obs_source {
     ///渲染后的数据
 	float *audio_output_buf[MAX_AUDIO_MIXES][MAX_AUDIO_CHANNELS];
 	float *audio_mix_buf[MAX_AUDIO_CHANNELS];
+	/* mixes the source's audio can reach this tick, worked out while
+	 * building the render order (composites get their children's) */
+	uint32_t audio_routes;
+	/* mixes audio_output_buf was rendered for in the current tick */
+	uint32_t audio_render_mixers;
+	/* 0 for leaves, otherwise one above the deepest child; sources on the
+	 * same level don't depend on each other and can render together */
+	uint32_t audio_render_level;
+	/* already in the audio render graph */
+	bool audio_render_cached;
 	struct resample_info sample_info;
 	audio_resampler_t *resampler;
 	pthread_mutex_t audio_actions_mutex;
 	pthread_mutex_t audio_buf_mutex;
+	struct audio_packet_ring audio_ready_ring;
+	struct audio_packet_ring audio_free_ring;
 	pthread_mutex_t audio_mutex;
 	pthread_mutex_t audio_cb_mutex;
 	DARRAY(struct audio_cb_info) audio_cb_list;
@@ -963,6 +1182,8 @@ struct obs_source {
 	bool async_active;
     ///当前source的纹理及纹理渲染器是否已经准备好
 	bool async_update_texture;
+	/* frame for this tick was already picked by a tick worker */
+	bool async_frame_selected;
     //不使用异步缓冲 
 	bool async_unbuffered;
 	bool async_decoupled;
@@ -973,6 +1194,14 @@ struct obs_source {
     //帧缓冲区（是对async_cache的引用）
     DARRAY(struct obs_source_frame *) async_frames;
 	pthread_mutex_t async_mutex;
+	/* the first thread to output async video hands frames over through
+	 * these rings without taking async_mutex; any other thread uses the
+	 * locked path */
+	volatile long async_producer;
+	/* set by other threads to ask the producer to give the rings up */
+	volatile bool async_producer_release;
+	struct async_frame_ring async_ready_ring;
+	struct async_frame_ring async_free_ring;
     //当前帧的宽高
 	uint32_t async_width;
 	uint32_t async_height;
@@ -1036,6 +1265,7 @@ struct obs_source {
     ///是否正在滤镜处理
 	bool rendering_filter;
 	bool filter_bypass_active;
+	struct obs_source_filter_stats filter_stats;
 
 	/* sources specific hotkeys */
 	obs_hotkey_pair_id mute_unmute_key;
@@ -1274,9 +1504,40 @@ extern void obs_source_deactivate(obs_source_t *source, enum view_type type);
  3 根据frame准备好当前的纹理及纹理渲染器 
  */
 extern void obs_source_video_tick(obs_source_t *source, float seconds);
+
+/* tick_sources splits the tick in three when it has a tick pool: the
+ * graphics-free async frame selection on workers, the rest of the tick on
+ * the graphics thread, then OBS_SOURCE_PARALLEL_TICK video_ticks on
+ * workers again */
+extern void obs_source_video_tick_prepare(obs_source_t *source);
+extern void obs_source_video_tick_main(obs_source_t *source, float seconds,
+				       bool defer_parallel);
+extern void obs_source_video_tick_deferred(obs_source_t *source,
+					   float seconds);
 extern float obs_source_get_target_volume(obs_source_t *source,
 					  obs_source_t *target);
 
+/* mixes everything a source's render depends on into key; returns false if
+ * the source may change without bumping its render serial */
+extern bool obs_source_render_cache_key(obs_source_t *source, uint64_t *key);
+extern bool obs_scene_render_cache_key(obs_scene_t *scene, uint64_t *key);
+
+/* true if the source will cover its whole size with opaque pixels */
+extern bool obs_source_render_opaque(obs_source_t *source);
+/* does the per-frame work of a render that scene culling skipped */
+extern void obs_source_video_render_culled(obs_source_t *source);
+extern void obs_scene_video_render_culled(obs_scene_t *scene);
+extern gs_texture_t *obs_source_get_async_draw_texture(obs_source_t *source,
+						       bool *flip);
+extern bool obs_source_get_draw_sprite(obs_source_t *source,
+				       struct obs_source_sprite *sprite);
+
+static inline uint64_t render_cache_key_mix(uint64_t key, uint64_t val)
+{
+	key ^= val + 0x9e3779b97f4a7c15ULL + (key << 6) + (key >> 2);
+	return key;
+}
+
 extern void obs_source_audio_render(obs_source_t *source, uint32_t mixers,
 				    size_t channels, size_t sample_rate,
 				    size_t size);
@@ -0,0 +1,260 @@
+/******************************************************************************
+    Copyright (C) 2013 by Hugh Bailey <obs.jim@gmail.com>
+    Copyright (C) 2014 by Zachary Lund <admin@computerquip.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+/*
+ *   Headless Linux platform.  There is no X11 or Wayland hotkey backend in
+ * this tree, the core runs on the software graphics device, so hotkeys are
+ * registered and saved as usual but never report a key as pressed.
+ */
+
+#include "obs-internal.h"
+#include "obs-nix.h"
+#include "util/dstr.h"
+#include "util/platform.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/utsname.h>
+
+struct obs_hotkeys_platform {
+	int unused;
+};
+
+const char *boundle(void)
+{
+	return "";
+}
+
+bool is_in_bundle(void)
+{
+	return false;
+}
+
+const char *get_module_extension(void)
+{
+	return ".so";
+}
+
+static const char *module_bin[] = {
+	"../../obs-plugins/64bit",
+	OBS_INSTALL_PREFIX "/" OBS_PLUGIN_DESTINATION,
+};
+
+static const char *module_data[] = {
+	OBS_DATA_PATH "/obs-plugins/%module%",
+	OBS_INSTALL_DATA_PATH "/obs-plugins/%module%",
+};
+
+static const int module_patterns_size =
+	sizeof(module_bin) / sizeof(module_bin[0]);
+
+void add_default_module_paths(void)
+{
+	char *module_bin_path =
+		os_get_executable_path_ptr("../" OBS_PLUGIN_DESTINATION);
+	char *module_data_path = os_get_executable_path_ptr(
+		"../" OBS_DATA_PATH "/obs-plugins/%module%");
+
+	if (module_bin_path && module_data_path)
+		obs_add_module_path(module_bin_path, module_data_path);
+
+	bfree(module_bin_path);
+	bfree(module_data_path);
+
+	for (int i = 0; i < module_patterns_size; i++)
+		obs_add_module_path(module_bin[i], module_data[i]);
+}
+
+char *find_libobs_data_file(const char *file)
+{
+	struct dstr output = {0};
+
+	char *relative = os_get_executable_path_ptr("../" OBS_DATA_PATH
+						    "/libobs/");
+	if (relative) {
+		dstr_copy(&output, relative);
+		dstr_cat(&output, file);
+		bfree(relative);
+
+		if (os_file_exists(output.array))
+			return output.array;
+	}
+
+	dstr_copy(&output, OBS_INSTALL_DATA_PATH "/libobs/");
+	dstr_cat(&output, file);
+	if (os_file_exists(output.array))
+		return output.array;
+
+	dstr_free(&output);
+	return NULL;
+}
+
+static void log_processor_info(void)
+{
+	FILE *fp = fopen("/proc/cpuinfo", "r");
+	char *line = NULL;
+	size_t linecap = 0;
+
+	if (!fp)
+		return;
+
+	while (getline(&line, &linecap, fp) != -1) {
+		if (!strncmp(line, "model name", 10)) {
+			char *start = strchr(line, ':');
+			if (start && start[1]) {
+				line[strcspn(line, "\n")] = 0;
+				blog(LOG_INFO, "CPU Name: %s", start + 2);
+				break;
+			}
+		}
+	}
+
+	free(line);
+	fclose(fp);
+}
+
+static void log_processor_cores(void)
+{
+	blog(LOG_INFO, "Physical Cores: %d, Logical Cores: %d",
+	     os_get_physical_cores(), os_get_logical_cores());
+}
+
+static void log_memory_info(void)
+{
+	long pages = sysconf(_SC_PHYS_PAGES);
+	long page_size = sysconf(_SC_PAGESIZE);
+
+	if (pages > 0 && page_size > 0)
+		blog(LOG_INFO, "Physical Memory: %lldMB Total",
+		     (long long)pages * page_size / 1024 / 1024);
+}
+
+static void log_distribution_info(void)
+{
+	FILE *fp = fopen("/etc/os-release", "r");
+	char *line = NULL;
+	size_t linecap = 0;
+
+	if (!fp)
+		fp = fopen("/usr/lib/os-release", "r");
+	if (!fp) {
+		blog(LOG_INFO, "Distribution: Missing /etc/os-release !");
+		return;
+	}
+
+	while (getline(&line, &linecap, fp) != -1) {
+		if (!strncmp(line, "PRETTY_NAME=", 12)) {
+			line[strcspn(line, "\n")] = 0;
+			blog(LOG_INFO, "Distribution: %s", line + 12);
+			break;
+		}
+	}
+
+	free(line);
+	fclose(fp);
+}
+
+static void log_kernel_version(void)
+{
+	struct utsname info;
+	if (uname(&info) < 0)
+		return;
+
+	blog(LOG_INFO, "Kernel Version: %s %s", info.sysname, info.release);
+}
+
+void log_system_info(void)
+{
+	log_processor_info();
+	log_processor_cores();
+	log_memory_info();
+	log_distribution_info();
+	log_kernel_version();
+}
+
+bool obs_hotkeys_platform_init(struct obs_core_hotkeys *hotkeys)
+{
+	hotkeys->platform_context = bzalloc(sizeof(obs_hotkeys_platform_t));
+	return true;
+}
+
+void obs_hotkeys_platform_free(struct obs_core_hotkeys *hotkeys)
+{
+	bfree(hotkeys->platform_context);
+	hotkeys->platform_context = NULL;
+}
+
+bool obs_hotkeys_platform_is_pressed(obs_hotkeys_platform_t *context,
+				     obs_key_t key)
+{
+	UNUSED_PARAMETER(context);
+	UNUSED_PARAMETER(key);
+	return false;
+}
+
+void obs_key_to_str(obs_key_t key, struct dstr *dstr)
+{
+	const char *name = obs_key_to_name(key);
+	dstr_copy(dstr, obs_get_hotkey_translation(key, name));
+}
+
+void obs_key_combination_to_str(obs_key_combination_t combination,
+				struct dstr *str)
+{
+	struct dstr key_str = {0};
+
+	if (combination.key != OBS_KEY_NONE)
+		obs_key_to_str(combination.key, &key_str);
+
+	dstr_free(str);
+
+#define ADD_MODIFIER(mod, key)                                          \
+	do {                                                            \
+		if (combination.modifiers & mod) {                      \
+			dstr_cat(str, obs_get_hotkey_translation(       \
+					      key, obs_key_to_name(key))); \
+			dstr_cat(str, " + ");                           \
+		}                                                       \
+	} while (false)
+
+	ADD_MODIFIER(INTERACT_CONTROL_KEY, OBS_KEY_CONTROL);
+	ADD_MODIFIER(INTERACT_ALT_KEY, OBS_KEY_ALT);
+	ADD_MODIFIER(INTERACT_SHIFT_KEY, OBS_KEY_SHIFT);
+	ADD_MODIFIER(INTERACT_COMMAND_KEY, OBS_KEY_META);
+#undef ADD_MODIFIER
+
+	if (key_str.len)
+		dstr_cat_dstr(str, &key_str);
+	else if (str->len >= 3)
+		dstr_resize(str, str->len - 3);
+
+	dstr_free(&key_str);
+}
+
+obs_key_t obs_key_from_virtual_key(int code)
+{
+	UNUSED_PARAMETER(code);
+	return OBS_KEY_NONE;
+}
+
+int obs_key_to_virtual_key(obs_key_t key)
+{
+	UNUSED_PARAMETER(key);
+	return 0;
+}
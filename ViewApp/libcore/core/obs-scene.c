@@ -32,6 +32,8 @@ static void get_ungrouped_transform(obs_sceneitem_t *group, struct vec2 *pos,
 				    struct vec2 *scale, float *rot);
 static inline bool crop_enabled(const struct obs_sceneitem_crop *crop);
 static inline bool item_texture_enabled(const struct obs_scene_item *item);
+static uint32_t scene_getwidth(void *data);
+static uint32_t scene_getheight(void *data);
 static void init_hotkeys(obs_scene_t *scene, obs_sceneitem_t *item,
 			 const char *name);
 
@@ -237,11 +239,25 @@ static void remove_all_items(struct obs_scene *scene)
 	da_free(items);
 }
 ///=====
+static void free_render_cache(struct obs_scene *scene)
+{
+	if (scene->render_cache.num) {
+		obs_enter_graphics();
+		for (size_t i = 0; i < scene->render_cache.num; i++)
+			gs_texrender_destroy(
+				scene->render_cache.array[i].texrender);
+		obs_leave_graphics();
+	}
+
+	da_free(scene->render_cache);
+}
+
 static void scene_destroy(void *data)
 {
 	struct obs_scene *scene = data;
 
 	remove_all_items(scene);
+	free_render_cache(scene);
 
 	pthread_mutex_destroy(&scene->video_mutex);
 	pthread_mutex_destroy(&scene->audio_mutex);
@@ -322,6 +338,7 @@ static inline void detach_sceneitem(struct obs_scene_item *item)
 		item->next->prev = item->prev;
 
 	item->parent = NULL;
+	obs_invalidate_audio_graph();
 }
 ///==== 把obs_scene_item插入到obs_scene(包括group_scene)下面的item的双向列表中
 static inline void attach_sceneitem(struct obs_scene *parent,
@@ -342,6 +359,8 @@ static inline void attach_sceneitem(struct obs_scene *parent,
 			parent->first_item->prev = item;
 		parent->first_item = item;
 	}
+
+	obs_invalidate_audio_graph();
 }
 ///计算锚点
 void add_alignment(struct vec2 *v, uint32_t align, int cx, int cy)
@@ -555,67 +574,10 @@ static inline bool item_texture_enabled(const struct obs_scene_item *item)
 	       (item_is_scene(item) && !item->is_group);
 }
 
-static void render_item_texture(struct obs_scene_item *item,
-				enum gs_color_space current_space,
-				enum gs_color_space source_space)
+static const char *get_item_tech_name(enum gs_color_space current_space,
+				      enum gs_color_space source_space,
+				      bool upscale, float *p_multiplier)
 {
-	gs_texture_t *tex = gs_texrender_get_texture(item->item_render);
-	if (!tex) {
-		return;
-	}
-
-	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_ITEM_TEXTURE,
-			      "render_item_texture");
-
-	gs_effect_t *effect = obs->video.default_effect;
-	enum obs_scale_type type = item->scale_filter;
-	uint32_t cx = gs_texture_get_width(tex);
-	uint32_t cy = gs_texture_get_height(tex);
-
-	bool upscale = false;
-	if (type != OBS_SCALE_DISABLE) {
-		if (type == OBS_SCALE_POINT) {
-			gs_eparam_t *image =
-				gs_effect_get_param_by_name(effect, "image");
-			gs_effect_set_next_sampler(image,
-						   obs->video.point_sampler);
-
-		} else if (!close_float(item->output_scale.x, 1.0f, EPSILON) ||
-			   !close_float(item->output_scale.y, 1.0f, EPSILON)) {
-			if (item->output_scale.x < 0.5f ||
-			    item->output_scale.y < 0.5f) {
-				effect = obs->video.bilinear_lowres_effect;
-			} else if (type == OBS_SCALE_BICUBIC) {
-				effect = obs->video.bicubic_effect;
-			} else if (type == OBS_SCALE_LANCZOS) {
-				effect = obs->video.lanczos_effect;
-			} else if (type == OBS_SCALE_AREA) {
-				effect = obs->video.area_effect;
-				upscale = (item->output_scale.x >= 1.0f) &&
-					  (item->output_scale.y >= 1.0f);
-			}
-
-			gs_eparam_t *const scale_param =
-				gs_effect_get_param_by_name(effect,
-							    "base_dimension");
-			if (scale_param) {
-				struct vec2 base_res = {(float)cx, (float)cy};
-
-				gs_effect_set_vec2(scale_param, &base_res);
-			}
-
-			gs_eparam_t *const scale_i_param =
-				gs_effect_get_param_by_name(effect,
-							    "base_dimension_i");
-			if (scale_i_param) {
-				struct vec2 base_res_i = {1.0f / (float)cx,
-							  1.0f / (float)cy};
-
-				gs_effect_set_vec2(scale_i_param, &base_res_i);
-			}
-		}
-	}
-
 	float multiplier = 1.f;
 
 	if (current_space == GS_CS_709_SCRGB) {
@@ -690,6 +652,88 @@ static void render_item_texture(struct obs_scene_item *item,
 		}
 	}
 
+	*p_multiplier = multiplier;
+	return tech_name;
+}
+
+/* picks the effect for the item's scale filter; cx and cy are the size of
+ * the texture it will sample */
+static gs_effect_t *get_item_scale_effect(const struct obs_scene_item *item,
+					  uint32_t cx, uint32_t cy,
+					  bool *p_upscale)
+{
+	gs_effect_t *effect = obs->video.default_effect;
+	enum obs_scale_type type = item->scale_filter;
+
+	bool upscale = false;
+	if (type != OBS_SCALE_DISABLE) {
+		if (type == OBS_SCALE_POINT) {
+			gs_eparam_t *image =
+				gs_effect_get_param_by_name(effect, "image");
+			gs_effect_set_next_sampler(image,
+						   obs->video.point_sampler);
+
+		} else if (!close_float(item->output_scale.x, 1.0f, EPSILON) ||
+			   !close_float(item->output_scale.y, 1.0f, EPSILON)) {
+			if (item->output_scale.x < 0.5f ||
+			    item->output_scale.y < 0.5f) {
+				effect = obs->video.bilinear_lowres_effect;
+			} else if (type == OBS_SCALE_BICUBIC) {
+				effect = obs->video.bicubic_effect;
+			} else if (type == OBS_SCALE_LANCZOS) {
+				effect = obs->video.lanczos_effect;
+			} else if (type == OBS_SCALE_AREA) {
+				effect = obs->video.area_effect;
+				upscale = (item->output_scale.x >= 1.0f) &&
+					  (item->output_scale.y >= 1.0f);
+			}
+
+			gs_eparam_t *const scale_param =
+				gs_effect_get_param_by_name(effect,
+							    "base_dimension");
+			if (scale_param) {
+				struct vec2 base_res = {(float)cx, (float)cy};
+
+				gs_effect_set_vec2(scale_param, &base_res);
+			}
+
+			gs_eparam_t *const scale_i_param =
+				gs_effect_get_param_by_name(effect,
+							    "base_dimension_i");
+			if (scale_i_param) {
+				struct vec2 base_res_i = {1.0f / (float)cx,
+							  1.0f / (float)cy};
+
+				gs_effect_set_vec2(scale_i_param, &base_res_i);
+			}
+		}
+	}
+
+	*p_upscale = upscale;
+	return effect;
+}
+
+static void render_item_texture(struct obs_scene_item *item,
+				enum gs_color_space current_space,
+				enum gs_color_space source_space)
+{
+	gs_texture_t *tex = gs_texrender_get_texture(item->item_render);
+	if (!tex) {
+		return;
+	}
+
+	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_ITEM_TEXTURE,
+			      "render_item_texture");
+
+	bool upscale;
+	gs_effect_t *effect = get_item_scale_effect(item, gs_texture_get_width(tex),
+						    gs_texture_get_height(tex),
+						    &upscale);
+
+	float multiplier;
+	const char *tech_name = get_item_tech_name(current_space, source_space,
+						   upscale, &multiplier);
+
 	gs_eparam_t *const multiplier_param =
 		gs_effect_get_param_by_name(effect, "multiplier");
 	if (multiplier_param)
@@ -725,18 +769,13 @@ static bool are_texcoords_centered(struct matrix4 *m)
 	copy.t.y = floorf(m->t.y);
 	return memcmp(m, &copy, sizeof(*m)) == 0;
 }
-///===绘制scene_item
-static inline void render_item(struct obs_scene_item *item)
+/* renders the item's source into its texrender when it needs one, returns
+ * false if the item has nothing to draw */
+static bool update_item_render(struct obs_scene_item *item,
+			       enum gs_color_space source_space)
 {
-	GS_DEBUG_MARKER_BEGIN_FORMAT(GS_DEBUG_COLOR_ITEM, "Item: %s",
-				     obs_source_get_name(item->source));
-
 	const bool use_texrender = item_texture_enabled(item);
-
-	obs_source_t *const source = item->source;
-	const enum gs_color_space current_space = gs_get_color_space();
-	const enum gs_color_space source_space = obs_source_get_color_space(source, 1, &current_space);
-	const enum gs_color_format format =	gs_get_format_from_space(source_space);
+	const enum gs_color_format format = gs_get_format_from_space(source_space);
 
 	if (item->item_render &&
 	    (!use_texrender || (gs_texrender_get_format(item->item_render) != format))) {
@@ -753,7 +792,7 @@ static inline void render_item(struct obs_scene_item *item)
 		uint32_t height = obs_source_get_height(item->source);
 
 		if (!width || !height) {
-			goto cleanup;
+			return false;
 		}
 
 		uint32_t cx = calc_cx(item, width);
@@ -794,6 +833,13 @@ static inline void render_item(struct obs_scene_item *item)
 		}
 	}
 
+	return true;
+}
+
+static void draw_item(struct obs_scene_item *item,
+		      enum gs_color_space current_space,
+		      enum gs_color_space source_space)
+{
 	const bool linear_srgb =
 		!item->item_render ||
 		(item->blend_method != OBS_BLEND_METHOD_SRGB_OFF);
@@ -825,8 +871,121 @@ static inline void render_item(struct obs_scene_item *item)
 	}
 	gs_matrix_pop();
 	gs_set_linear_srgb(previous);
+}
+
+/* the scale effects clamp sampling to the crop through uv_bounds, so any
+ * crop and filter can sample an async source's own texture and the item
+ * does not need a texrender of it */
+static inline bool item_direct_allowed(const struct obs_scene_item *item)
+{
+	return item->blend_method != OBS_BLEND_METHOD_SRGB_OFF &&
+	       default_blending_enabled(item) && !item_is_scene(item) &&
+	       !transition_active(item->show_transition) &&
+	       !transition_active(item->hide_transition);
+}
+
+static void render_item_direct(struct obs_scene_item *item, gs_texture_t *tex,
+			       bool flip, enum gs_color_space current_space)
+{
+	const uint32_t width = gs_texture_get_width(tex);
+	const uint32_t height = gs_texture_get_height(tex);
+	const uint32_t cx = calc_cx(item, width);
+	const uint32_t cy = calc_cy(item, height);
+
+	if (!cx || !cy)
+		return;
+
+	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_ITEM_TEXTURE,
+			      "render_item_direct");
+
+	bool upscale;
+	gs_effect_t *effect = get_item_scale_effect(item, width, height,
+						    &upscale);
+	float multiplier;
+	const char *tech_name = get_item_tech_name(current_space, GS_CS_SRGB,
+						   upscale, &multiplier);
+
+	gs_eparam_t *const multiplier_param =
+		gs_effect_get_param_by_name(effect, "multiplier");
+	if (multiplier_param)
+		gs_effect_set_float(multiplier_param, multiplier);
+
+	/* keep every tap on the texel centers inside the crop, the way the
+	 * texrender's own edges would; a flipped texture keeps the bottom
+	 * crop in its first rows */
+	const uint32_t top = flip ? item->crop.bottom : item->crop.top;
+	gs_eparam_t *const bounds_param =
+		gs_effect_get_param_by_name(effect, "uv_bounds");
+	if (bounds_param) {
+		struct vec4 bounds;
+		vec4_set(&bounds, ((float)item->crop.left + 0.5f) / (float)width,
+			 ((float)top + 0.5f) / (float)height,
+			 ((float)(item->crop.left + cx) - 0.5f) / (float)width,
+			 ((float)(top + cy) - 0.5f) / (float)height);
+		gs_effect_set_vec4(bounds_param, &bounds);
+	}
+
+	const bool previous = gs_set_linear_srgb(true);
+	const bool previous_srgb = gs_framebuffer_srgb_enabled();
+	gs_enable_framebuffer_srgb(true);
+	gs_effect_set_texture_srgb(gs_effect_get_param_by_name(effect, "image"),
+				   tex);
+
+	gs_blend_state_push();
+	gs_blend_function_separate(
+		obs_blend_mode_params[item->blend_type].src_color,
+		obs_blend_mode_params[item->blend_type].dst_color,
+		obs_blend_mode_params[item->blend_type].src_alpha,
+		obs_blend_mode_params[item->blend_type].dst_alpha);
+	gs_blend_op(obs_blend_mode_params[item->blend_type].op);
+
+	gs_matrix_push();
+	gs_matrix_mul(&item->draw_transform);
+	while (gs_effect_loop(effect, tech_name))
+		gs_draw_sprite_subregion(tex, flip ? GS_FLIP_V : 0,
+					 item->crop.left, top, cx, cy);
+	gs_matrix_pop();
+
+	/* everything else drawing with these effects samples the whole
+	 * texture */
+	if (bounds_param)
+		gs_effect_set_default(bounds_param);
+
+	gs_blend_state_pop();
+	gs_enable_framebuffer_srgb(previous_srgb);
+	gs_set_linear_srgb(previous);
+
+	GS_DEBUG_MARKER_END();
+}
+
+///===绘制scene_item
+static inline void render_item(struct obs_scene_item *item)
+{
+	GS_DEBUG_MARKER_BEGIN_FORMAT(GS_DEBUG_COLOR_ITEM, "Item: %s",
+				     obs_source_get_name(item->source));
+
+	const enum gs_color_space current_space = gs_get_color_space();
+	gs_texture_t *direct = NULL;
+	bool flip = false;
+
+	if (item_texture_enabled(item) && item_direct_allowed(item))
+		direct = obs_source_get_async_draw_texture(item->source, &flip);
+
+	if (direct) {
+		if (item->item_render) {
+			gs_texrender_destroy(item->item_render);
+			item->item_render = NULL;
+		}
+		render_item_direct(item, direct, flip, current_space);
+	} else {
+		const enum gs_color_space source_space =
+			obs_source_get_color_space(item->source, 1,
+						   &current_space);
+
+		if (update_item_render(item, source_space))
+			draw_item(item, current_space, source_space);
+	}
 
-cleanup:
 	GS_DEBUG_MARKER_END();
 }
 
@@ -892,6 +1051,537 @@ static void update_transforms_and_prune_sources(obs_scene_t *scene,
 	if (rebuild_group && group_sceneitem)
 		resize_group(group_sceneitem);
 }
+/* runs of fewer clean items than this are cheaper to just draw */
+#define MIN_CACHED_RUN_ITEMS 2
+
+static inline bool item_rendered(const struct obs_scene_item *item)
+{
+	return item->user_visible || transition_active(item->hide_transition);
+}
+
+static inline uint64_t render_cache_key_data(uint64_t key, const void *data,
+					     size_t size)
+{
+	const uint8_t *bytes = data;
+	uint64_t hash = 0xcbf29ce484222325ULL;
+
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	return render_cache_key_mix(key, hash);
+}
+
+static bool item_render_cache_key(struct obs_scene_item *item, uint64_t *key)
+{
+	if (transition_active(item->show_transition) ||
+	    transition_active(item->hide_transition) ||
+	    os_atomic_load_bool(&item->update_transform))
+		return false;
+
+	*key = render_cache_key_mix(*key, (uintptr_t)item);
+	*key = render_cache_key_mix(*key, item->user_visible);
+	if (!item->user_visible)
+		return true;
+
+	/* the run is composited back with normal blending in linear space,
+	 * other blend modes have to see what is really beneath them */
+	if (item->blend_type != OBS_BLEND_NORMAL ||
+	    item->blend_method == OBS_BLEND_METHOD_SRGB_OFF)
+		return false;
+
+	*key = render_cache_key_data(*key, &item->draw_transform,
+				     sizeof(item->draw_transform));
+	*key = render_cache_key_data(*key, &item->crop, sizeof(item->crop));
+	*key = render_cache_key_mix(*key, ((uint64_t)item->last_width << 32) |
+						  item->last_height);
+	*key = render_cache_key_mix(*key, item->scale_filter);
+
+	return obs_source_render_cache_key(item->source, key);
+}
+
+bool obs_scene_render_cache_key(obs_scene_t *scene, uint64_t *key)
+{
+	struct obs_scene_item *item;
+	bool cacheable = true;
+
+	video_lock(scene);
+	for (item = scene->first_item; item && cacheable; item = item->next)
+		cacheable = item_render_cache_key(item, key);
+	video_unlock(scene);
+
+	*key = render_cache_key_mix(*key, ((uint64_t)scene_getwidth(scene)
+					   << 32) |
+						  scene_getheight(scene));
+	return cacheable;
+}
+
+/* items drawn from their texrender without a scale filter only differ in
+ * texture and transform, so consecutive ones can share one draw setup */
+static inline bool item_batchable(const struct obs_scene_item *item)
+{
+	const uint32_t async_video = OBS_SOURCE_ASYNC_VIDEO;
+
+	/* async items may skip their texrender altogether in render_item */
+	if ((item->source->info.output_flags & async_video) == async_video &&
+	    item_direct_allowed(item))
+		return false;
+
+	return !item->culled && item_texture_enabled(item) &&
+	       !scale_filter_enabled(item);
+}
+
+/* sources that draw a single texture or color join a batch without a
+ * texrender, their crop is the sprite's region */
+static bool get_item_sprite(struct obs_scene_item *item,
+			    struct gs_sprite_batch_item *sprite)
+{
+	struct obs_source_sprite source_sprite;
+	uint32_t width;
+	uint32_t height;
+
+	if (item->culled || scale_filter_enabled(item) ||
+	    !item_direct_allowed(item) ||
+	    !obs_source_get_draw_sprite(item->source, &source_sprite))
+		return false;
+
+	if (source_sprite.texture) {
+		width = gs_texture_get_width(source_sprite.texture);
+		height = gs_texture_get_height(source_sprite.texture);
+	} else {
+		width = obs_source_get_width(item->source);
+		height = obs_source_get_height(item->source);
+	}
+
+	if (item->crop.left + item->crop.right >= width ||
+	    item->crop.top + item->crop.bottom >= height)
+		return false;
+
+	sprite->tex = source_sprite.texture;
+	sprite->x = item->crop.left;
+	sprite->y = item->crop.top;
+	sprite->cx = calc_cx(item, width);
+	sprite->cy = calc_cy(item, height);
+	sprite->color = source_sprite.color;
+	sprite->transform = &item->draw_transform;
+
+	return gs_sprite_batch_supported(sprite->tex, sprite->cx, sprite->cy);
+}
+
+/* the default effect's technique that draws a batch like tech_name draws a
+ * single item, NULL if there is none */
+static const char *get_batch_tech_name(const char *tech_name)
+{
+	if (strcmp(tech_name, "Draw") == 0)
+		return "DrawBatch";
+	if (strcmp(tech_name, "DrawMultiply") == 0)
+		return "DrawBatchMultiply";
+	return NULL;
+}
+
+struct item_batch {
+	struct gs_sprite_batch_item sprites[GS_SPRITE_BATCH_SIZE];
+	size_t num;
+	const char *tech_name;
+	float multiplier;
+	enum obs_blending_type blend_type;
+	enum obs_blending_method blend_method;
+};
+
+static void draw_item_batch(const struct item_batch *batch)
+{
+	gs_effect_t *effect = obs->video.default_effect;
+	const bool linear_srgb =
+		batch->blend_method != OBS_BLEND_METHOD_SRGB_OFF;
+	const bool previous = gs_set_linear_srgb(linear_srgb);
+	const bool previous_srgb = gs_framebuffer_srgb_enabled();
+	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
+	gs_eparam_t *const multiplier_param =
+		gs_effect_get_param_by_name(effect, "multiplier");
+
+	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_ITEM_TEXTURE, "render_item_batch");
+
+	if (multiplier_param)
+		gs_effect_set_float(multiplier_param, batch->multiplier);
+
+	gs_enable_framebuffer_srgb(linear_srgb);
+	gs_blend_state_push();
+	gs_blend_function_separate(
+		obs_blend_mode_params[batch->blend_type].src_color,
+		obs_blend_mode_params[batch->blend_type].dst_color,
+		obs_blend_mode_params[batch->blend_type].src_alpha,
+		obs_blend_mode_params[batch->blend_type].dst_alpha);
+	gs_blend_op(obs_blend_mode_params[batch->blend_type].op);
+
+	while (gs_effect_loop(effect, batch->tech_name))
+		gs_draw_sprite_batch(image, linear_srgb, batch->sprites,
+				     batch->num);
+
+	gs_blend_state_pop();
+	gs_enable_framebuffer_srgb(previous_srgb);
+	gs_set_linear_srgb(previous);
+
+	GS_DEBUG_MARKER_END();
+}
+
+/* collects consecutive items that draw as sprites, rendering texrenders
+ * where needed, then draws them all at once; returns how many items were
+ * used, 0 if item must be drawn on its own */
+static size_t render_item_batch(struct obs_scene_item *item, size_t count)
+{
+	const enum gs_color_space current_space = gs_get_color_space();
+	struct item_batch batch;
+	size_t used = 0;
+
+	batch.num = 0;
+
+	for (; used < count && batch.num < GS_SPRITE_BATCH_SIZE;
+	     used++, item = item->next) {
+		if (!item_rendered(item))
+			continue;
+
+		struct gs_sprite_batch_item *sprite = batch.sprites + batch.num;
+		const bool direct = get_item_sprite(item, sprite);
+		if (!direct && !item_batchable(item))
+			break;
+
+		const enum gs_color_space source_space =
+			obs_source_get_color_space(item->source, 1,
+						   &current_space);
+		float multiplier;
+		const char *tech_name = get_batch_tech_name(get_item_tech_name(
+			current_space, source_space, false, &multiplier));
+
+		if (!tech_name)
+			break;
+		if (batch.num && (strcmp(tech_name, batch.tech_name) != 0 ||
+				  multiplier != batch.multiplier ||
+				  item->blend_type != batch.blend_type ||
+				  item->blend_method != batch.blend_method))
+			break;
+
+		if (direct) {
+			if (item->item_render) {
+				gs_texrender_destroy(item->item_render);
+				item->item_render = NULL;
+			}
+		} else {
+			uint32_t width = obs_source_get_width(item->source);
+			uint32_t height = obs_source_get_height(item->source);
+
+			/* the texrender goes into the atlas at its own size */
+			if (calc_cx(item, width) > GS_SPRITE_ATLAS_SIZE / 2 ||
+			    calc_cy(item, height) > GS_SPRITE_ATLAS_SIZE / 2)
+				break;
+			if (!update_item_render(item, source_space))
+				continue;
+
+			gs_texture_t *tex =
+				gs_texrender_get_texture(item->item_render);
+			if (!tex)
+				continue;
+
+			sprite->tex = tex;
+			sprite->x = 0;
+			sprite->y = 0;
+			sprite->cx = gs_texture_get_width(tex);
+			sprite->cy = gs_texture_get_height(tex);
+			sprite->color = 0xFFFFFFFF;
+			sprite->transform = &item->draw_transform;
+
+			/* already rendered, render_item draws the texrender */
+			if (!gs_sprite_batch_supported(tex, sprite->cx,
+						       sprite->cy))
+				break;
+		}
+
+		if (!batch.num) {
+			batch.tech_name = tech_name;
+			batch.multiplier = multiplier;
+			batch.blend_type = item->blend_type;
+			batch.blend_method = item->blend_method;
+		}
+		batch.num++;
+	}
+
+	if (batch.num)
+		draw_item_batch(&batch);
+
+	return used;
+}
+
+static void render_items(struct obs_scene_item *item, size_t count)
+{
+	while (count > 0) {
+		size_t used = render_item_batch(item, count);
+
+		if (!used) {
+			if (item->culled)
+				obs_source_video_render_culled(item->source);
+			else
+				render_item(item);
+			used = 1;
+		}
+
+		count -= used;
+		while (used--)
+			item = item->next;
+	}
+}
+
+void obs_scene_video_render_culled(obs_scene_t *scene)
+{
+	struct obs_scene_item *item;
+
+	video_lock(scene);
+	for (item = scene->first_item; item; item = item->next) {
+		if (item_rendered(item))
+			obs_source_video_render_culled(item->source);
+	}
+	video_unlock(scene);
+}
+
+/* an item is only culled when a single occluder covers all of it, so a
+ * few occluders are enough for typical layouts */
+#define MAX_OCCLUDERS 8
+
+static const char *cull_items_name = "cull_items";
+
+struct cull_rect {
+	float left;
+	float top;
+	float right;
+	float bottom;
+};
+
+static inline bool cull_rect_contains(const struct cull_rect *outer,
+				      const struct cull_rect *inner)
+{
+	return inner->left >= outer->left && inner->top >= outer->top &&
+	       inner->right <= outer->right && inner->bottom <= outer->bottom;
+}
+
+static bool item_draw_rect(const struct obs_scene_item *item,
+			   struct cull_rect *rect)
+{
+	uint32_t width = item->last_width;
+	uint32_t height = item->last_height;
+
+	if (item_texture_enabled(item)) {
+		width = calc_cx(item, width);
+		height = calc_cy(item, height);
+	}
+	if (!width || !height)
+		return false;
+
+	rect->left = rect->top = M_INFINITE;
+	rect->right = rect->bottom = -M_INFINITE;
+
+	for (int i = 0; i < 4; i++) {
+		struct vec3 corner;
+		vec3_set(&corner, (i & 1) ? (float)width : 0.0f,
+			 (i & 2) ? (float)height : 0.0f, 0.0f);
+		vec3_transform(&corner, &corner, &item->draw_transform);
+
+		rect->left = fminf(rect->left, corner.x);
+		rect->top = fminf(rect->top, corner.y);
+		rect->right = fmaxf(rect->right, corner.x);
+		rect->bottom = fmaxf(rect->bottom, corner.y);
+	}
+
+	return true;
+}
+
+static inline bool item_opaque(struct obs_scene_item *item)
+{
+	const struct matrix4 *m = &item->draw_transform;
+
+	return item->user_visible && !transition_active(item->show_transition) &&
+	       item->blend_type == OBS_BLEND_NORMAL && m->x.y == 0.0f &&
+	       m->y.x == 0.0f && obs_source_render_opaque(item->source);
+}
+
+/* walks the items top down, culling those that are entirely off-canvas or
+ * entirely inside an opaque item drawn above them */
+static size_t cull_items(struct obs_scene *scene)
+{
+	struct cull_rect occluders[MAX_OCCLUDERS];
+	size_t num_occluders = 0;
+	size_t culled = 0;
+	struct cull_rect canvas = {0.0f, 0.0f, (float)scene_getwidth(scene),
+				   (float)scene_getheight(scene)};
+	/* groups draw straight into their parent, which does the clipping */
+	const bool clip = !scene->is_group && canvas.right > 0.0f &&
+			  canvas.bottom > 0.0f;
+	struct obs_scene_item *item = scene->first_item;
+
+	while (item && item->next)
+		item = item->next;
+
+	for (; item; item = item->prev) {
+		struct cull_rect rect;
+
+		item->culled = false;
+		if (!item_rendered(item) || item->is_group ||
+		    !item_draw_rect(item, &rect))
+			continue;
+
+		if (clip && (rect.right <= canvas.left ||
+			     rect.bottom <= canvas.top ||
+			     rect.left >= canvas.right ||
+			     rect.top >= canvas.bottom))
+			item->culled = true;
+
+		for (size_t i = 0; i < num_occluders && !item->culled; i++)
+			item->culled = cull_rect_contains(&occluders[i], &rect);
+
+		if (item->culled)
+			culled++;
+		else if (num_occluders < MAX_OCCLUDERS && item_opaque(item))
+			occluders[num_occluders++] = rect;
+	}
+
+	return culled;
+}
+
+/* the cache holds premultiplied color, same as a nested scene's texture */
+static void draw_render_cache(gs_texture_t *tex, int x, int y)
+{
+	gs_effect_t *effect = obs->video.default_effect;
+	const bool previous = gs_set_linear_srgb(true);
+
+	gs_blend_state_push();
+	gs_blend_function_separate(GS_BLEND_ONE, GS_BLEND_INVSRCALPHA,
+				   GS_BLEND_ONE, GS_BLEND_INVSRCALPHA);
+
+	while (gs_effect_loop(effect, "Draw"))
+		obs_source_draw(tex, x, y, 0, 0, false);
+
+	gs_blend_state_pop();
+	gs_set_linear_srgb(previous);
+}
+
+/* the whole pixels of the scene the run's items draw to, false if none */
+static bool run_draw_rect(struct obs_scene *scene,
+			  struct obs_scene_item *first, size_t count,
+			  struct cull_rect *bounds)
+{
+	struct obs_scene_item *item = first;
+
+	bounds->left = bounds->top = M_INFINITE;
+	bounds->right = bounds->bottom = -M_INFINITE;
+
+	for (size_t i = 0; i < count; i++, item = item->next) {
+		struct cull_rect rect;
+
+		if (!item_rendered(item) || item->culled)
+			continue;
+
+		/* a group's own rect doesn't tell where its items draw */
+		if (item->is_group) {
+			bounds->left = bounds->top = 0.0f;
+			bounds->right = (float)scene_getwidth(scene);
+			bounds->bottom = (float)scene_getheight(scene);
+			break;
+		}
+
+		if (!item_draw_rect(item, &rect))
+			continue;
+
+		bounds->left = fminf(bounds->left, rect.left);
+		bounds->top = fminf(bounds->top, rect.top);
+		bounds->right = fmaxf(bounds->right, rect.right);
+		bounds->bottom = fmaxf(bounds->bottom, rect.bottom);
+	}
+
+	bounds->left = floorf(fmaxf(bounds->left, 0.0f));
+	bounds->top = floorf(fmaxf(bounds->top, 0.0f));
+	bounds->right = ceilf(fminf(bounds->right, (float)scene_getwidth(scene)));
+	bounds->bottom =
+		ceilf(fminf(bounds->bottom, (float)scene_getheight(scene)));
+
+	return bounds->right > bounds->left && bounds->bottom > bounds->top;
+}
+
+static bool render_cached_run(struct obs_scene *scene, size_t idx,
+			      struct obs_scene_item *first, size_t count,
+			      uint64_t key)
+{
+	const enum gs_color_space space = gs_get_color_space();
+	const enum gs_color_format format = gs_get_format_from_space(space);
+	struct scene_render_cache *cache;
+	struct cull_rect bounds;
+	uint32_t cx, cy;
+	int x, y;
+
+	/* nothing of the run shows on the scene, not worth a cache */
+	if (!run_draw_rect(scene, first, count, &bounds))
+		return false;
+
+	x = (int)bounds.left;
+	y = (int)bounds.top;
+	cx = (uint32_t)(bounds.right - bounds.left);
+	cy = (uint32_t)(bounds.bottom - bounds.top);
+
+	if (idx == scene->render_cache.num)
+		da_push_back_new(scene->render_cache);
+	cache = &scene->render_cache.array[idx];
+
+	if (cache->texrender &&
+	    gs_texrender_get_format(cache->texrender) != format) {
+		gs_texrender_destroy(cache->texrender);
+		cache->texrender = NULL;
+	}
+	if (!cache->texrender) {
+		cache->texrender = gs_texrender_create(format, GS_ZS_NONE);
+		cache->first = NULL;
+		if (!cache->texrender)
+			return false;
+	}
+
+	if (cache->first != first || cache->count != count ||
+	    cache->key != key || cache->space != space || cache->x != x ||
+	    cache->y != y || cache->cx != cx || cache->cy != cy) {
+		struct vec4 clear_color;
+
+		cache->first = NULL;
+		gs_texrender_reset(cache->texrender);
+		if (!gs_texrender_begin_with_color_space(cache->texrender, cx,
+							 cy, space))
+			return false;
+
+		vec4_zero(&clear_color);
+		gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+		gs_ortho(bounds.left, bounds.right, bounds.top, bounds.bottom,
+			 -100.0f, 100.0f);
+
+		render_items(first, count);
+		gs_texrender_end(cache->texrender);
+
+		cache->first = first;
+		cache->count = count;
+		cache->key = key;
+		cache->space = space;
+		cache->x = x;
+		cache->y = y;
+		cache->cx = cx;
+		cache->cy = cy;
+	}
+
+	draw_render_cache(gs_texrender_get_texture(cache->texrender), x, y);
+	return true;
+}
+
+static void trim_render_cache(struct obs_scene *scene, size_t runs)
+{
+	while (scene->render_cache.num > runs) {
+		size_t last = scene->render_cache.num - 1;
+		gs_texrender_destroy(scene->render_cache.array[last].texrender);
+		da_pop_back(scene->render_cache);
+	}
+}
+
 ///scene_source的内置渲染
 static void scene_video_render(void *data, gs_effect_t *effect)
 {
@@ -907,18 +1597,50 @@ static void scene_video_render(void *data, gs_effect_t *effect)
 		update_transforms_and_prune_sources(scene, &remove_items.da,
 						    NULL);
 	}
+
+	profile_start(cull_items_name);
+	obs->video.frame_times.frame_culled_items += (long)cull_items(scene);
+	profile_end(cull_items_name);
     ///设置状态机的混合模式
 	gs_blend_state_push();
 	gs_reset_blend_state();
 
+	/* items whose sources are all unchanged since the last frame are
+	 * drawn from a cached texture, one per run of such items */
+	size_t runs = 0;
 	item = scene->first_item;
 	while (item) {
-		if (item->user_visible ||
-		    transition_active(item->hide_transition))
-			render_item(item);
+		struct obs_scene_item *next = item;
+		size_t count = 0;
+		size_t rendered = 0;
+		uint64_t key = 0;
+
+		while (next) {
+			uint64_t item_key = key;
+			if (!item_render_cache_key(next, &item_key))
+				break;
 
-		item = item->next;
+			/* culling depends on items outside the run */
+			key = render_cache_key_mix(item_key, next->culled);
+			rendered += item_rendered(next) && !next->culled;
+			count++;
+			next = next->next;
+		}
+
+		if (!count) {
+			render_items(item, 1);
+			next = item->next;
+		} else if (rendered >= MIN_CACHED_RUN_ITEMS &&
+			   render_cached_run(scene, runs, item, count, key)) {
+			runs++;
+		} else {
+			render_items(item, count);
+		}
+
+		item = next;
 	}
+
+	trim_render_cache(scene, runs);
     ///取消绘制scene前的混合模式
 	gs_blend_state_pop();
 
@@ -948,6 +1670,7 @@ static void set_visibility(struct obs_scene_item *item, bool vis)
 	os_atomic_set_long(&item->active_refs, vis ? 1 : 0);
 	item->visible = vis;
 	item->user_visible = vis;
+	obs_invalidate_audio_graph();
 
 	pthread_mutex_unlock(&item->actions_mutex);
 }
@@ -1308,6 +2031,7 @@ static void apply_scene_item_audio_actions(struct obs_scene_item *item,
 		item->visible = action.visible;
 		if (!item->visible)
 			deref_count++;
+		obs_invalidate_audio_graph();
 
 		if (buf && new_frame_num > frame_num) {
 			for (; frame_num < new_frame_num; frame_num++)
@@ -1370,24 +2094,13 @@ static void process_all_audio_actions(struct obs_scene_item *item,
 static void mix_audio_with_buf(float *p_out, float *p_in, float *buf_in,
 			       size_t pos, size_t count)
 {
-	register float *out = p_out + pos;
-	register float *buf = buf_in;
-	register float *in = p_in;
-	register float *end = in + count;
-
-	while (in < end)
-		*(out++) += *(in++) * *(buf++);
+	audio_mix_add_mul(p_out + pos, p_in, buf_in, count);
 }
 
 static inline void mix_audio(float *p_out, float *p_in, size_t pos,
 			     size_t count)
 {
-	register float *out = p_out + pos;
-	register float *in = p_in;
-	register float *end = in + count;
-
-	while (in < end)
-		*(out++) += *(in++);
+	audio_mix_add(p_out + pos, p_in, count);
 }
 
 static bool scene_audio_render(void *data, uint64_t *ts_out,
@@ -1486,7 +2199,8 @@ static bool scene_audio_render(void *data, uint64_t *ts_out,
 		obs_source_get_audio_mix(source, &child_audio);
 
 		for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
-			if ((mixers & (1 << mix)) == 0)
+			if ((mixers & source->audio_render_mixers &
+			     (1 << mix)) == 0)
 				continue;
 
 			for (size_t ch = 0; ch < channels; ch++) {
@@ -2798,6 +3512,7 @@ bool obs_sceneitem_set_visible(obs_sceneitem_t *item, bool visible)
 			if (!obs_source_add_active_child(item->parent->source,
 							 item->source)) {
 				os_atomic_dec_long(&item->active_refs);
+				obs_invalidate_audio_graph();
 				return false;
 			}
 		}
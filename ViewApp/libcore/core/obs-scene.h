@@ -26,6 +26,20 @@ struct item_action {
 	bool visible;
 	uint64_t timestamp;
 };
+/* cached render of a run of consecutive items whose sources are clean */
+struct scene_render_cache {
+	struct obs_scene_item *first;
+	size_t count;
+	uint64_t key;
+	enum gs_color_space space;
+	/* part of the scene the run covers */
+	int x;
+	int y;
+	uint32_t cx;
+	uint32_t cy;
+	gs_texrender_t *texrender;
+};
+
 /*
  一个scene下会有多个scene_item  每一个scene_item代表一种source(源)
  ex:image_source
@@ -56,6 +70,8 @@ struct obs_scene_item {
     bool user_visible;
     ///当是音频source的时候此时不可见 视频可见
 	bool visible;
+	/* off-canvas or covered by an opaque item this frame */
+	bool culled;
     
     
 	bool selected;
@@ -141,4 +157,6 @@ struct obs_scene {
 	pthread_mutex_t video_mutex;
 	pthread_mutex_t audio_mutex;
 	struct obs_scene_item *first_item;
+
+	DARRAY(struct scene_render_cache) render_cache;
 };
@@ -0,0 +1,314 @@
+/*
+ * Stress benchmark for the async source handoff in obs-source.c.
+ *
+ * SOURCES async sources sit in a scene on output channel 0, each fed by
+ * its own thread at 60 fps with an NV12 frame and a packet of planar float
+ * audio per tick, while the graphics and audio threads consume them.  The
+ * same run is then repeated with every source's rings claimed by a thread
+ * that has already exited, so the producers all take the async_mutex path
+ * that multi-producer sources use.  Reports the cost of each
+ * obs_source_output_video/obs_source_output_audio call and the graphics
+ * loop timings, and checks that every source had its frames shown.
+ *
+ * Runs on the software renderer by default; pass a graphics module and the
+ * libcore data directory to use another:
+ *   obs-source-async-bench libobs-opengl <libcore/core/data>
+ *
+ * Standalone program, not part of any target.  Build it against the
+ * libcore framework, or on Linux against the CMake build of libcore:
+ *   cc -O2 -I<libcore/core> -F<build dir> -framework libcore \
+ *      obs-source-async-bench.c -o obs-source-async-bench
+ *   cc -O2 -I<libcore/core> obs-source-async-bench.c \
+ *      -o obs-source-async-bench -L<build dir>/libcore -lcore -lpthread
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <obs.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#define CHECK(condition)                                                    \
+	do {                                                                \
+		if (!(condition)) {                                         \
+			fprintf(stderr, "%s:%d: error: check failed: %s\n", \
+				__FILE__, __LINE__, #condition);            \
+			exit(1);                                            \
+		}                                                           \
+	} while (0)
+
+#define SOURCES 32
+#define FPS 60
+#define SECONDS 10
+#define FRAMES (FPS * SECONDS)
+#define FRAME_NS (1000000000ULL / FPS)
+#define WIDTH 320
+#define HEIGHT 180
+#define SAMPLE_RATE 48000
+#define AUDIO_FRAMES (SAMPLE_RATE / FPS)
+
+struct producer {
+	obs_source_t *source;
+	pthread_t thread;
+	uint64_t late_ticks;
+	uint32_t video_ns[FRAMES];
+	uint32_t audio_ns[FRAMES];
+};
+
+static struct producer producers[SOURCES];
+static uint32_t samples[SOURCES * FRAMES];
+static uint8_t luma[WIDTH * HEIGHT];
+static uint8_t chroma[WIDTH * HEIGHT / 2];
+static float audio_planes[2][AUDIO_FRAMES];
+static uint64_t start_ns;
+
+static const char *bench_get_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return "Async bench source";
+}
+
+static void *bench_create(obs_data_t *settings, obs_source_t *source)
+{
+	UNUSED_PARAMETER(settings);
+	UNUSED_PARAMETER(source);
+	return bzalloc(1);
+}
+
+static void bench_destroy(void *data)
+{
+	bfree(data);
+}
+
+static struct obs_source_info bench_source_info = {
+	.id = "async_bench_source",
+	.type = OBS_SOURCE_TYPE_INPUT,
+	.output_flags = OBS_SOURCE_ASYNC_VIDEO | OBS_SOURCE_AUDIO,
+	.get_name = bench_get_name,
+	.create = bench_create,
+	.destroy = bench_destroy,
+};
+
+static void init_frame(struct obs_source_frame *frame)
+{
+	memset(frame, 0, sizeof(*frame));
+	frame->data[0] = luma;
+	frame->data[1] = chroma;
+	frame->linesize[0] = WIDTH;
+	frame->linesize[1] = WIDTH;
+	frame->width = WIDTH;
+	frame->height = HEIGHT;
+	frame->format = VIDEO_FORMAT_NV12;
+	video_format_get_parameters_for_format(VIDEO_CS_709,
+					       VIDEO_RANGE_PARTIAL,
+					       VIDEO_FORMAT_NV12,
+					       frame->color_matrix,
+					       frame->color_range_min,
+					       frame->color_range_max);
+}
+
+static void init_audio(struct obs_source_audio *audio)
+{
+	memset(audio, 0, sizeof(*audio));
+	audio->data[0] = (const uint8_t *)audio_planes[0];
+	audio->data[1] = (const uint8_t *)audio_planes[1];
+	audio->frames = AUDIO_FRAMES;
+	audio->speakers = SPEAKERS_STEREO;
+	audio->format = AUDIO_FORMAT_FLOAT_PLANAR;
+	audio->samples_per_sec = SAMPLE_RATE;
+}
+
+static void *produce(void *param)
+{
+	struct producer *p = param;
+	struct obs_source_frame frame;
+	struct obs_source_audio audio;
+
+	init_frame(&frame);
+	init_audio(&audio);
+
+	for (size_t i = 0; i < FRAMES; i++) {
+		uint64_t due = start_ns + i * FRAME_NS;
+		if (!os_sleepto_ns(due))
+			p->late_ticks++;
+
+		frame.timestamp = due;
+		audio.timestamp = due;
+
+		uint64_t t0 = os_gettime_ns();
+		obs_source_output_video(p->source, &frame);
+		uint64_t t1 = os_gettime_ns();
+		obs_source_output_audio(p->source, &audio);
+		uint64_t t2 = os_gettime_ns();
+
+		p->video_ns[i] = (uint32_t)(t1 - t0);
+		p->audio_ns[i] = (uint32_t)(t2 - t1);
+	}
+
+	return NULL;
+}
+
+/* outputs one frame to every source and exits without giving up their
+ * rings, so every producer that follows is a second producer */
+static void *claim_rings(void *param)
+{
+	struct obs_source_frame frame;
+	UNUSED_PARAMETER(param);
+
+	init_frame(&frame);
+	frame.timestamp = os_gettime_ns();
+
+	for (size_t i = 0; i < SOURCES; i++)
+		obs_source_output_video(producers[i].source, &frame);
+	return NULL;
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+	return (x > y) - (x < y);
+}
+
+static void report_calls(const char *name, bool video)
+{
+	const size_t count = SOURCES * FRAMES;
+	uint64_t total = 0;
+
+	for (size_t i = 0; i < SOURCES; i++) {
+		const uint32_t *ns = video ? producers[i].video_ns
+					   : producers[i].audio_ns;
+		memcpy(samples + i * FRAMES, ns, sizeof(uint32_t) * FRAMES);
+	}
+	for (size_t i = 0; i < count; i++)
+		total += samples[i];
+
+	qsort(samples, count, sizeof(samples[0]), compare_u32);
+
+	printf("  %-6s %8.1f ns/call  p50 %6u  p99 %7u  p99.9 %8u  max %9u\n",
+	       name, (double)total / count, samples[count / 2],
+	       samples[count * 99 / 100], samples[count * 999 / 1000],
+	       samples[count - 1]);
+}
+
+static void report_graphics(uint32_t lagged)
+{
+	struct obs_video_frame_stats stats;
+	CHECK(obs_get_video_frame_stats(&stats));
+
+	printf("  loop   p50 %5.2f ms  p99 %5.2f ms  max %6.2f ms  "
+	       "missed %llu  lagged %u\n",
+	       stats.loop.p50_ns / 1e6, stats.loop.p99_ns / 1e6,
+	       stats.loop.max_ns / 1e6,
+	       (unsigned long long)stats.missed_deadlines, lagged);
+	printf("  tick   p50 %5.2f ms  p99 %5.2f ms  max %6.2f ms\n",
+	       stats.tick_sources.p50_ns / 1e6,
+	       stats.tick_sources.p99_ns / 1e6,
+	       stats.tick_sources.max_ns / 1e6);
+}
+
+static void run(const char *name, bool locked)
+{
+	obs_scene_t *scene = obs_scene_create(name);
+	uint64_t late_ticks = 0;
+
+	for (size_t i = 0; i < SOURCES; i++) {
+		char source_name[32];
+		snprintf(source_name, sizeof(source_name), "%s %zu", name, i);
+
+		producers[i].source = obs_source_create(
+			"async_bench_source", source_name, NULL, NULL);
+		producers[i].late_ticks = 0;
+		CHECK(producers[i].source);
+		CHECK(obs_scene_add(scene, producers[i].source));
+	}
+
+	obs_set_output_source(0, obs_scene_get_source(scene));
+
+	if (locked) {
+		pthread_t thread;
+		CHECK(pthread_create(&thread, NULL, claim_rings, NULL) == 0);
+		pthread_join(thread, NULL);
+	}
+
+	os_sleep_ms(500);
+	obs_reset_video_frame_stats();
+	uint32_t lagged = obs_get_lagged_frames();
+
+	start_ns = os_gettime_ns() + 100000000ULL;
+	for (size_t i = 0; i < SOURCES; i++)
+		CHECK(pthread_create(&producers[i].thread, NULL, produce,
+				     &producers[i]) == 0);
+	for (size_t i = 0; i < SOURCES; i++) {
+		pthread_join(producers[i].thread, NULL);
+		late_ticks += producers[i].late_ticks;
+	}
+
+	os_sleep_ms(200);
+	lagged = obs_get_lagged_frames() - lagged;
+
+	printf("%s (%llu of %d producer ticks late)\n", name,
+	       (unsigned long long)late_ticks, SOURCES * FRAMES);
+	report_calls("video", true);
+	report_calls("audio", false);
+	report_graphics(lagged);
+
+	/* the source size is only set once the graphics thread has taken a
+	 * frame from the source */
+	for (size_t i = 0; i < SOURCES; i++) {
+		CHECK(obs_source_get_width(producers[i].source) == WIDTH);
+		CHECK(obs_source_get_height(producers[i].source) == HEIGHT);
+	}
+
+	obs_set_output_source(0, NULL);
+	for (size_t i = 0; i < SOURCES; i++) {
+		obs_source_remove(producers[i].source);
+		obs_source_release(producers[i].source);
+		producers[i].source = NULL;
+	}
+	obs_scene_release(scene);
+}
+
+int main(int argc, char *argv[])
+{
+	struct obs_video_info ovi = {0};
+	struct obs_audio_info oai = {0};
+
+	memset(luma, 0x80, sizeof(luma));
+	memset(chroma, 0x80, sizeof(chroma));
+	for (size_t i = 0; i < AUDIO_FRAMES; i++)
+		audio_planes[0][i] = audio_planes[1][i] = 0.25f;
+
+	CHECK(obs_startup("en-US", NULL, NULL));
+	if (argc > 2)
+		obs_add_data_path(argv[2]);
+
+	ovi.graphics_module = argc > 1 ? argv[1] : "libobs-software";
+	ovi.fps_num = FPS;
+	ovi.fps_den = 1;
+	ovi.base_width = 640;
+	ovi.base_height = 360;
+	ovi.output_width = 640;
+	ovi.output_height = 360;
+	ovi.output_format = VIDEO_FORMAT_NV12;
+	ovi.gpu_conversion = true;
+	ovi.colorspace = VIDEO_CS_709;
+	ovi.range = VIDEO_RANGE_PARTIAL;
+	ovi.scale_type = OBS_SCALE_BILINEAR;
+	CHECK(obs_reset_video(&ovi) == OBS_VIDEO_SUCCESS);
+
+	oai.samples_per_sec = SAMPLE_RATE;
+	oai.speakers = SPEAKERS_STEREO;
+	CHECK(obs_reset_audio(&oai));
+
+	obs_register_source(&bench_source_info);
+
+	printf("%d async sources, %dx%d NV12 at %d fps, %d s\n", SOURCES,
+	       WIDTH, HEIGHT, FPS, SECONDS);
+	run("ring", false);
+	run("locked", true);
+
+	obs_shutdown();
+	return 0;
+}
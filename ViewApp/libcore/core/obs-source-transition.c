@@ -91,6 +91,7 @@ void obs_transition_clear(obs_source_t *transition)
 	transition->transitioning_video = false;
 	transition->transitioning_audio = false;
 	unlock_transition(transition);
+	obs_invalidate_audio_graph();
     ///=== 影藏transition下的所有source
 	for (size_t i = 0; i < 2; i++) {
 		if (s[i] && active[i])
@@ -269,6 +270,7 @@ static void set_source(obs_source_t *transition, enum obs_transition_target targ
 	transition->transition_sources[idx] = add_success ? new_child : NULL;
 
 	unlock_transition(transition);
+	obs_invalidate_audio_graph();
 
 	if (add_success) {
 		if (transition->transition_cx == 0 ||
@@ -388,6 +390,8 @@ bool obs_transition_start(obs_source_t *transition,
 		transition->transitioning_audio = true;
 	}
 
+	obs_invalidate_audio_graph();
+
 	obs_source_dosignal(transition, "source_transition_start","transition_start");
 
 	recalculate_transition_size(transition);
@@ -437,6 +441,7 @@ void obs_transition_set(obs_source_t *transition, obs_source_t *source)
 	transition->transition_manual_val = 0.0f;
 	transition->transition_manual_target = 0.0f;
 	unlock_transition(transition);
+	obs_invalidate_audio_graph();
 
 	for (size_t i = 0; i < 2; i++) {
 		if (s[i] && active[i])
@@ -599,6 +604,7 @@ void obs_transition_load(obs_source_t *tr, obs_data_t *data)
 	tr->transition_cx = (uint32_t)cx;
 	tr->transition_cy = (uint32_t)cy;
 	unlock_transition(tr);
+	obs_invalidate_audio_graph();
 
 	recalculate_transition_size(tr);
 	recalculate_transition_matrices(tr);
@@ -690,12 +696,14 @@ static void obs_transition_stop(obs_source_t *transition)
     ///置换第一个source
 	transition->transition_sources[0] = transition->transition_sources[1];
 	transition->transition_sources[1] = NULL;
+	obs_invalidate_audio_graph();
 }
 ///====
 static inline void handle_stop(obs_source_t *transition)
 {
 	if (transition->info.transition_stop)
 		transition->info.transition_stop(transition->context.data);
+	obs_invalidate_audio_graph();
 	obs_source_dosignal(transition, "source_transition_stop",
 			    "transition_stop");
 }
@@ -949,7 +957,7 @@ static void process_audio(obs_source_t *transition, obs_source_t *child,
 		struct audio_output_data *output = &audio->output[mix_idx];
 		struct audio_output_data *input = &child_audio.output[mix_idx];
 
-		if ((mixers & (1 << mix_idx)) == 0)
+		if ((mixers & child->audio_render_mixers & (1 << mix_idx)) == 0)
 			continue;
 
 		for (size_t ch = 0; ch < channels; ch++) {
@@ -963,6 +971,20 @@ static void process_audio(obs_source_t *transition, obs_source_t *child,
 	}
 }
 
+static void copy_audio(obs_source_t *child,
+		       struct obs_source_audio_mix *audio, uint32_t mixers)
+{
+	for (size_t mix_idx = 0; mix_idx < MAX_AUDIO_MIXES; mix_idx++) {
+		if ((mixers & child->audio_render_mixers & (1 << mix_idx)) == 0)
+			continue;
+
+		memcpy(audio->output[mix_idx].data[0],
+		       child->audio_output_buf[mix_idx][0],
+		       AUDIO_OUTPUT_FRAMES * MAX_AUDIO_CHANNELS *
+			       sizeof(float));
+	}
+}
+
 static inline uint64_t calc_min_ts(obs_source_t *sources[2])
 {
 	uint64_t min_ts = 0;
@@ -1042,9 +1064,7 @@ bool obs_transition_audio_render(obs_source_t *transition, uint64_t *ts_out,
 					      min_ts, mixers, channels,
 					      sample_rate, mix_b);
 		} else if (state.s[0]) {
-			memcpy(audio->output[0].data[0],
-			       state.s[0]->audio_output_buf[0][0],
-			       TOTAL_AUDIO_SIZE);
+			copy_audio(state.s[0], audio, mixers);
 		}
 
 		obs_source_release(state.s[0]);
@@ -1087,6 +1107,7 @@ static inline obs_source_t *copy_source_state(obs_source_t *tr_dest, obs_source_
 
 	tr_dest->transition_sources[idx] = new_child;
 	tr_dest->transition_source_active[idx] = active;
+	obs_invalidate_audio_graph();
 
 	if (active && new_child)
 		obs_source_add_active_child(tr_dest, new_child);
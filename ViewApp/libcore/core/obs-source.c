@@ -45,6 +45,11 @@ static inline bool deinterlacing_enabled(const struct obs_source *source)
 	return source->deinterlace_mode != OBS_DEINTERLACE_MODE_DISABLE;
 }
 
+static inline void render_dirty(struct obs_source *source)
+{
+	os_atomic_inc_long(&source->render_serial);
+}
+
 static inline bool destroying(const struct obs_source *source)
 {
 	return os_atomic_load_long(&source->destroying);
@@ -135,19 +140,50 @@ const char *obs_source_get_display_name(const char *id)
 	return (info != NULL) ? info->get_name(info->type_data) : NULL;
 }
 ///=====初始化音频的缓冲区
-static void allocate_audio_output_buffer(struct obs_source *source)
+/* mixes a source isn't rendered for point here until they're needed; it's
+ * only ever read */
+static float silent_audio_output[AUDIO_OUTPUT_FRAMES * MAX_AUDIO_CHANNELS];
+
+static inline bool audio_output_allocated(const struct obs_source *source,
+					  size_t mix)
 {
-	size_t size = sizeof(float) * AUDIO_OUTPUT_FRAMES * MAX_AUDIO_CHANNELS *
-		      MAX_AUDIO_MIXES;
-	float *ptr = bzalloc(size);
+	return source->audio_output_buf[mix][0] &&
+	       source->audio_output_buf[mix][0] != silent_audio_output;
+}
+
+static void set_audio_output_mix(struct obs_source *source, size_t mix,
+				 float *ptr)
+{
+	for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++)
+		source->audio_output_buf[mix][i] = ptr + AUDIO_OUTPUT_FRAMES * i;
+}
+
+static void allocate_audio_output_mixes(struct obs_source *source,
+					uint32_t mixers)
+{
+	size_t size = sizeof(float) * AUDIO_OUTPUT_FRAMES * MAX_AUDIO_CHANNELS;
 
 	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
-		size_t mix_pos = mix * AUDIO_OUTPUT_FRAMES * MAX_AUDIO_CHANNELS;
+		if ((mixers & (1 << mix)) != 0 &&
+		    !audio_output_allocated(source, mix))
+			set_audio_output_mix(source, mix, bzalloc(size));
+	}
+}
 
-		for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++) {
-			source->audio_output_buf[mix][i] =
-				ptr + mix_pos + AUDIO_OUTPUT_FRAMES * i;
-		}
+///=====初始化音频输出缓冲区 (only the first mix, the rest on first use)
+static void allocate_audio_output_buffer(struct obs_source *source)
+{
+	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++)
+		set_audio_output_mix(source, mix, silent_audio_output);
+
+	allocate_audio_output_mixes(source, 1);
+}
+
+static void free_audio_output_buffer(struct obs_source *source)
+{
+	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
+		if (audio_output_allocated(source, mix))
+			bfree(source->audio_output_buf[mix][0]);
 	}
 }
 ///=====初始化音频的混音缓冲区
@@ -242,6 +278,7 @@ static void obs_source_init_finalize(struct obs_source *source)
 		obs->data.first_audio_source = source;
 
 		pthread_mutex_unlock(&obs->data.audio_sources_mutex);
+		obs_invalidate_audio_graph();
 	}
 
     //插入到hash表中
@@ -611,6 +648,8 @@ void obs_source_frame_init(struct obs_source_frame *frame,
 	frame->format = format;
 	frame->width = width;
 	frame->height = height;
+	frame->release = NULL;
+	frame->release_param = NULL;
 
 	for (size_t i = 0; i < MAX_AV_PLANES; i++) {
 		frame->data[i] = vid_frame.data[i];
@@ -627,6 +666,10 @@ static inline void obs_source_frame_decref(struct obs_source_frame *frame)
 static bool obs_source_filter_remove_refless(obs_source_t *source,
 					     obs_source_t *filter);
 static void obs_source_destroy_defer(struct obs_source *source);
+static void drain_async_ring(struct obs_source *source);
+static void free_async_rings(struct obs_source *source);
+static void drain_audio_ring(obs_source_t *source);
+static void free_audio_rings(obs_source_t *source);
 ///====
 void obs_source_destroy(struct obs_source *source)
 {
@@ -663,6 +706,7 @@ void obs_source_destroy(struct obs_source *source)
 				source->prev_next_audio_source;
 	}
 	pthread_mutex_unlock(&obs->data.audio_sources_mutex);
+	obs_invalidate_audio_graph();
 
 	if (source->filter_parent)
 		obs_source_filter_remove_refless(source->filter_parent, source);
@@ -707,6 +751,7 @@ static void obs_source_destroy_defer(struct obs_source *source)
 
 	for (i = 0; i < source->async_cache.num; i++)
 		obs_source_frame_decref(source->async_cache.array[i].frame);
+	free_async_rings(source);
 
 	gs_enter_context(obs->video.graphics);
 	if (source->async_texrender)
@@ -727,8 +772,9 @@ static void obs_source_destroy_defer(struct obs_source *source)
 		bfree(source->audio_data.data[i]);
 	for (i = 0; i < MAX_AUDIO_CHANNELS; i++)
 		circlebuf_free(&source->audio_input_buf[i]);
+	free_audio_rings(source);
 	audio_resampler_destroy(source->resampler);
-	bfree(source->audio_output_buf[0][0]);
+	free_audio_output_buffer(source);
 	bfree(source->audio_mix_buf[0]);
 
 	obs_source_frame_destroy(source->async_preload_frame);
@@ -979,6 +1025,7 @@ static void obs_source_deferred_update(obs_source_t *source)
 				    source->context.settings);
 		os_atomic_compare_swap_long(&source->defer_update_count, count,
 					    0);
+		render_dirty(source);
 		obs_source_dosignal(source, "source_update", "update");
 	}
 }
@@ -1009,6 +1056,105 @@ void obs_source_reset_settings(obs_source_t *source, obs_data_t *settings)
 	obs_data_clear(source->context.settings);
 	obs_source_update(source, settings);
 }
+void obs_source_mark_dirty(obs_source_t *source)
+{
+	if (obs_source_valid(source, "obs_source_mark_dirty"))
+		render_dirty(source);
+}
+
+static inline bool filter_render_cacheable(const obs_source_t *filter)
+{
+	return !filter->info.video_render ||
+	       (filter->info.output_flags & OBS_SOURCE_CACHEABLE_RENDER) != 0;
+}
+
+bool obs_source_render_cache_key(obs_source_t *source, uint64_t *key)
+{
+	const uint32_t flags = source->info.output_flags;
+	bool cacheable = true;
+
+	if (source->info.type == OBS_SOURCE_TYPE_SCENE) {
+		if (!obs_scene_render_cache_key(source->context.data, key))
+			return false;
+	} else if ((flags & OBS_SOURCE_ASYNC_VIDEO) == OBS_SOURCE_ASYNC_VIDEO &&
+		   (flags & OBS_SOURCE_CUSTOM_DRAW) == 0) {
+		/* deinterlacing alternates fields without new frames */
+		if (deinterlacing_enabled(source))
+			return false;
+	} else if ((flags & OBS_SOURCE_CACHEABLE_RENDER) == 0) {
+		return false;
+	}
+
+	*key = render_cache_key_mix(*key, (uintptr_t)source);
+	*key = render_cache_key_mix(
+		*key, (uint64_t)os_atomic_load_long(&source->render_serial));
+
+	pthread_mutex_lock(&source->filter_mutex);
+	for (size_t i = 0; i < source->filters.num && cacheable; i++) {
+		obs_source_t *filter = source->filters.array[i];
+
+		cacheable = !filter->enabled || filter_render_cacheable(filter);
+		*key = render_cache_key_mix(*key, (uintptr_t)filter);
+		*key = render_cache_key_mix(
+			*key,
+			(uint64_t)os_atomic_load_long(&filter->render_serial));
+	}
+	pthread_mutex_unlock(&source->filter_mutex);
+
+	return cacheable;
+}
+static inline bool format_has_alpha(enum video_format format)
+{
+	switch (format) {
+	case VIDEO_FORMAT_RGBA:
+	case VIDEO_FORMAT_BGRA:
+	case VIDEO_FORMAT_I40A:
+	case VIDEO_FORMAT_I42A:
+	case VIDEO_FORMAT_YUVA:
+	case VIDEO_FORMAT_YA2L:
+	case VIDEO_FORMAT_AYUV:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool rendering_filters_enabled(obs_source_t *source)
+{
+	bool rendering = false;
+
+	pthread_mutex_lock(&source->filter_mutex);
+	for (size_t i = 0; i < source->filters.num && !rendering; i++) {
+		obs_source_t *filter = source->filters.array[i];
+		rendering = filter->enabled && filter->info.video_render;
+	}
+	pthread_mutex_unlock(&source->filter_mutex);
+
+	return rendering;
+}
+
+bool obs_source_render_opaque(obs_source_t *source)
+{
+	const uint32_t flags = source->info.output_flags;
+	bool opaque;
+
+	if (!source->context.data || !source->enabled)
+		return false;
+
+	if (source->info.video_is_opaque) {
+		opaque = source->info.video_is_opaque(source->context.data);
+	} else if ((flags & OBS_SOURCE_ASYNC_VIDEO) == OBS_SOURCE_ASYNC_VIDEO &&
+		   (flags & OBS_SOURCE_CUSTOM_DRAW) == 0) {
+		opaque = source->async_active && source->async_textures[0] &&
+			 !format_has_alpha(source->async_format);
+	} else {
+		return false;
+	}
+
+	/* any filter that renders may bring transparency back */
+	return opaque && !rendering_filters_enabled(source);
+}
+
 ///====
 void obs_source_update_properties(obs_source_t *source)
 {
@@ -1204,11 +1350,13 @@ static void filter_frame(obs_source_t *source, struct obs_source_frame **ref_fra
 
 	*ref_frame = frame;
 }
-///==== tick 只处理（获取相应的帧、纹理、及纹理渲染器）
-static void async_tick(obs_source_t *source)
+/* caller holds async_mutex */
+static void async_select_frame(obs_source_t *source)
 {
 	uint64_t sys_time = obs->video.video_time;
-	pthread_mutex_lock(&source->async_mutex);
+
+	drain_async_ring(source);
+
     // 获取帧 （每一次tick 获取相应的frame）
 	if (deinterlacing_enabled(source)) {
 		deinterlace_process_last_frame(source, sys_time);
@@ -1225,7 +1373,31 @@ static void async_tick(obs_source_t *source)
 	if (deinterlacing_enabled(source))
 		filter_frame(source, &source->prev_async_frame);
 	filter_frame(source, &source->cur_async_frame);
-    
+
+	if (source->cur_async_frame)
+		render_dirty(source);
+}
+
+/* deinterlacing resizes its textures while picking frames, so only the
+ * plain path can run away from the graphics thread */
+static void async_tick_prepare(obs_source_t *source)
+{
+	pthread_mutex_lock(&source->async_mutex);
+	if (!deinterlacing_enabled(source)) {
+		async_select_frame(source);
+		source->async_frame_selected = true;
+	}
+	pthread_mutex_unlock(&source->async_mutex);
+}
+
+///==== tick 只处理（获取相应的帧、纹理、及纹理渲染器）
+static void async_tick(obs_source_t *source)
+{
+	pthread_mutex_lock(&source->async_mutex);
+	if (!source->async_frame_selected)
+		async_select_frame(source);
+	source->async_frame_selected = false;
+
     ///根据frame准备好相应的纹理 及纹理渲染器
 	if (source->cur_async_frame)
 		source->async_update_texture =
@@ -1237,11 +1409,35 @@ static void async_tick(obs_source_t *source)
 ///显示隐藏source 以及更新source的重新绘制的标志 激活标志  以及调用infp->video_tick
 void obs_source_video_tick(obs_source_t *source, float seconds)
 {
-	bool now_showing, now_active;
-
 	if (!obs_source_valid(source, "obs_source_video_tick"))
 		return;
 
+	obs_source_video_tick_main(source, seconds, false);
+}
+
+void obs_source_video_tick_prepare(obs_source_t *source)
+{
+	if ((source->info.output_flags & OBS_SOURCE_ASYNC) != 0)
+		async_tick_prepare(source);
+}
+
+static inline bool parallel_tick(const obs_source_t *source)
+{
+	return (source->info.output_flags & OBS_SOURCE_PARALLEL_TICK) != 0;
+}
+
+void obs_source_video_tick_deferred(obs_source_t *source, float seconds)
+{
+	if (parallel_tick(source) && source->context.data &&
+	    source->info.video_tick)
+		source->info.video_tick(source->context.data, seconds);
+}
+
+void obs_source_video_tick_main(obs_source_t *source, float seconds,
+				bool defer_parallel)
+{
+	bool now_showing, now_active;
+
 	if (source->info.type == OBS_SOURCE_TYPE_TRANSITION)
 		obs_transition_tick(source, seconds);
     //获取相应的帧、纹理、及纹理渲染器
@@ -1281,6 +1477,7 @@ void obs_source_video_tick(obs_source_t *source, float seconds)
 		}
 
 		source->showing = now_showing;
+		render_dirty(source);
 	}
 
 	/* call activate/deactivate if the reference changed 
@@ -1307,9 +1504,11 @@ void obs_source_video_tick(obs_source_t *source, float seconds)
 		}
 
 		source->active = now_active;
+		render_dirty(source);
 	}
 
-	if (source->context.data && source->info.video_tick)
+	if (source->context.data && source->info.video_tick &&
+	    !(defer_parallel && parallel_tick(source)))
 		source->info.video_tick(source->context.data, seconds);
 
 	source->async_rendered = false;
@@ -1347,7 +1546,8 @@ static inline void reset_audio_timing(obs_source_t *source, uint64_t timestamp,
 	source->timing_adjust = os_time - timestamp;
 }
 ///====清空音频的输入缓冲区
-static void reset_audio_data(obs_source_t *source, uint64_t os_time)
+/* caller holds audio_buf_mutex */
+static void reset_audio_input(obs_source_t *source, uint64_t os_time)
 {
 	for (size_t i = 0; i < MAX_AUDIO_CHANNELS; i++) {
 		if (source->audio_input_buf[i].size)
@@ -1357,6 +1557,14 @@ static void reset_audio_data(obs_source_t *source, uint64_t os_time)
 
 	source->last_audio_input_buf_size = 0;
 	source->audio_ts = os_time;
+}
+
+/* caller holds audio_buf_mutex.  audio still in the ring is older than the
+ * reset, apply it first so it is cleared along with the rest */
+static void reset_audio_data(obs_source_t *source, uint64_t os_time)
+{
+	drain_audio_ring(source);
+	reset_audio_input(source, os_time);
 	source->next_audio_sys_ts_min = os_time;
 }
 ///====音频跳帧
@@ -1407,7 +1615,7 @@ static void source_output_audio_place(obs_source_t *source,
 	size_t size = in->frames * sizeof(float);
 
 	if (!source->audio_ts || in->timestamp < source->audio_ts)
-		reset_audio_data(source, in->timestamp);
+		reset_audio_input(source, in->timestamp);
     ///数据要存放的位置
 	buf_placement =
 		get_buf_placement(audio, in->timestamp - source->audio_ts) *
@@ -1458,6 +1666,96 @@ static inline void source_output_audio_push_back(obs_source_t *source,
 	source->last_audio_input_buf_size = 0;
 }
 
+static void audio_packet_destroy(struct audio_packet *packet)
+{
+	bfree(packet->data[0]);
+	bfree(packet);
+}
+
+/* a packet handed back by the audio thread, or a new one */
+static struct audio_packet *audio_packet_get(obs_source_t *source,
+					     size_t channels, uint32_t frames)
+{
+	struct audio_packet *packet = audio_ring_pop(&source->audio_free_ring);
+	if (!packet)
+		packet = bzalloc(sizeof(*packet));
+
+	if (packet->capacity < frames || packet->channels != channels) {
+		bfree(packet->data[0]);
+		packet->data[0] = bmalloc(frames * channels * sizeof(float));
+		for (size_t ch = 1; ch < channels; ch++)
+			packet->data[ch] = packet->data[0] + frames * ch;
+		packet->channels = channels;
+		packet->capacity = frames;
+	}
+
+	return packet;
+}
+
+/* caller holds audio_buf_mutex */
+static void apply_audio_packet(obs_source_t *source,
+			       struct audio_packet *packet)
+{
+	struct audio_data in = {.frames = packet->frames,
+				.timestamp = packet->timestamp};
+
+	for (size_t ch = 0; ch < packet->channels; ch++)
+		in.data[ch] = (uint8_t *)packet->data[ch];
+
+	if (packet->push_back && source->audio_ts)
+		source_output_audio_push_back(source, &in);
+	else
+		source_output_audio_place(source, &in);
+
+	if (!audio_ring_push(&source->audio_free_ring, packet))
+		audio_packet_destroy(packet);
+}
+
+/* caller holds audio_buf_mutex */
+static void drain_audio_ring(obs_source_t *source)
+{
+	struct audio_packet *packet;
+
+	while ((packet = audio_ring_pop(&source->audio_ready_ring)) != NULL)
+		apply_audio_packet(source, packet);
+}
+
+static void free_audio_rings(obs_source_t *source)
+{
+	struct audio_packet *packet;
+
+	while ((packet = audio_ring_pop(&source->audio_ready_ring)) != NULL)
+		audio_packet_destroy(packet);
+	while ((packet = audio_ring_pop(&source->audio_free_ring)) != NULL)
+		audio_packet_destroy(packet);
+}
+
+/* hands the audio to the audio thread, which places it in audio_input_buf
+ * when it next renders the source, without touching audio_buf_mutex */
+static void queue_audio_data(obs_source_t *source, const struct audio_data *in,
+			     bool push_back)
+{
+	size_t channels = audio_output_get_channels(obs->audio.audio);
+	struct audio_packet *packet =
+		audio_packet_get(source, channels, in->frames);
+
+	for (size_t ch = 0; ch < channels; ch++)
+		memcpy(packet->data[ch], in->data[ch],
+		       in->frames * sizeof(float));
+
+	packet->frames = in->frames;
+	packet->timestamp = in->timestamp;
+	packet->push_back = push_back;
+
+	if (!audio_ring_push(&source->audio_ready_ring, packet)) {
+		/* audio thread has fallen a whole ring behind */
+		pthread_mutex_lock(&source->audio_buf_mutex);
+		drain_audio_ring(source);
+		apply_audio_packet(source, packet);
+		pthread_mutex_unlock(&source->audio_buf_mutex);
+	}
+}
+
 static inline bool source_muted(obs_source_t *source, uint64_t os_time)
 {
 	if (source->push_to_mute_enabled && source->user_push_to_mute_pressed)
@@ -1527,9 +1825,7 @@ static void source_output_audio_data(obs_source_t *source,
 		in.timestamp + conv_frames_to_time(sample_rate, in.frames);
     ///此处对当前音频帧时间做调整
 	in.timestamp += source->timing_adjust;
-	pthread_mutex_lock(&source->audio_buf_mutex);
-    
-    
+
 	if (source->next_audio_sys_ts_min == in.timestamp) {
 		push_back = true;
 
@@ -1564,14 +1860,8 @@ static void source_output_audio_data(obs_source_t *source,
 		source->last_sync_offset = sync_offset;
 	}
 
-	if (source->monitoring_type != OBS_MONITORING_TYPE_MONITOR_ONLY) {
-		if (push_back && source->audio_ts)
-			source_output_audio_push_back(source, &in);
-		else
-			source_output_audio_place(source, &in);
-	}
-
-	pthread_mutex_unlock(&source->audio_buf_mutex);
+	if (source->monitoring_type != OBS_MONITORING_TYPE_MONITOR_ONLY)
+		queue_audio_data(source, &in, push_back);
 
 	source_signal_audio_data(source, data, source_muted(source, os_time));
 }
@@ -2633,6 +2923,47 @@ static inline void obs_source_render_async_video(obs_source_t *source)
 		gs_set_linear_srgb(previous);
 	}
 }
+/* the texture an async source draws as-is, for scene items that sample it
+ * with their own crop and scale filter instead of going through a
+ * texrender; NULL when the source draws more than an opaque SDR frame */
+gs_texture_t *obs_source_get_async_draw_texture(obs_source_t *source,
+						bool *flip)
+{
+	const uint32_t flags = source->info.output_flags;
+
+	if (source->info.type != OBS_SOURCE_TYPE_INPUT ||
+	    (flags & OBS_SOURCE_ASYNC_VIDEO) != OBS_SOURCE_ASYNC_VIDEO ||
+	    (flags & OBS_SOURCE_CUSTOM_DRAW) != 0 || !source->context.data ||
+	    !source->enabled || deinterlacing_enabled(source) ||
+	    source->async_rotation || rendering_filters_enabled(source))
+		return NULL;
+
+	obs_source_update_async_video(source);
+
+	if (!source->async_active || !source->async_textures[0] ||
+	    format_has_alpha(source->async_format) ||
+	    convert_video_space(source->async_format, source->async_trc) !=
+		    GS_CS_SRGB)
+		return NULL;
+
+	*flip = source->async_flip;
+	return source->async_texrender
+		       ? gs_texrender_get_texture(source->async_texrender)
+		       : source->async_textures[0];
+}
+/* what an input source without rendering filters draws, for scene items to
+ * batch it instead of calling video_render */
+bool obs_source_get_draw_sprite(obs_source_t *source,
+				struct obs_source_sprite *sprite)
+{
+	if (source->info.type != OBS_SOURCE_TYPE_INPUT ||
+	    !source->info.video_get_sprite || !source->context.data ||
+	    !source->enabled || rendering_filters_enabled(source))
+		return false;
+
+	return source->info.video_get_sprite(source->context.data, sprite);
+}
+
 ///===== 绘制有一个或多个滤镜的source （obs_source_process_filter_begin_with_color_space 会寻找下一个滤镜链中的下一个）
 static inline void obs_source_render_filters(obs_source_t *source)
 {
@@ -2850,6 +3181,7 @@ static inline void obs_source_main_render(obs_source_t *source)
 }
 
 static bool ready_async_frame(obs_source_t *source, uint64_t sys_time);
+static bool render_filter_color_ops(obs_source_t *filter);
 
 #if GS_USE_DEBUG_MARKERS
 static const char *get_type_format(enum obs_source_type type)
@@ -2899,8 +3231,10 @@ static inline void render_video(obs_source_t *source)
 	if (source->filters.num && !source->rendering_filter)
 		obs_source_render_filters(source);
     /// image scene filter transition
-	else if (source->info.video_render)
-		obs_source_main_render(source);
+	else if (source->info.video_render) {
+		if (!render_filter_color_ops(source))
+			obs_source_main_render(source);
+	}
 
     ///filter_source ???
 	else if (source->filter_target)
@@ -2924,6 +3258,21 @@ void obs_source_video_render(obs_source_t *source){
 		obs_source_release(source);
 	}
 }
+
+/* async textures are only uploaded when the source renders, so a culled
+ * source still takes its new frame to not show a stale one once uncovered */
+void obs_source_video_render_culled(obs_source_t *source)
+{
+	if (source->info.type == OBS_SOURCE_TYPE_SCENE) {
+		obs_scene_video_render_culled(source->context.data);
+	} else if (source->info.type == OBS_SOURCE_TYPE_INPUT &&
+		   (source->info.output_flags & OBS_SOURCE_ASYNC) != 0 &&
+		   source->context.data && source->enabled) {
+		if (deinterlacing_enabled(source))
+			deinterlace_update_async_video(source);
+		obs_source_update_async_video(source);
+	}
+}
 ///===
 static uint32_t get_recurse_width(obs_source_t *source)
 {
@@ -3092,6 +3441,7 @@ void obs_source_filter_add(obs_source_t *source, obs_source_t *filter)
 						     : source->filters.array[0];
 
 	da_insert(source->filters, 0, &filter);
+	render_dirty(source);
 
 	pthread_mutex_unlock(&source->filter_mutex);
 
@@ -3126,6 +3476,7 @@ static bool obs_source_filter_remove_refless(obs_source_t *source,
 	}
 
 	da_erase(source->filters, idx);
+	render_dirty(source);
 
 	pthread_mutex_unlock(&source->filter_mutex);
 
@@ -3256,8 +3607,10 @@ void obs_source_filter_set_order(obs_source_t *source, obs_source_t *filter,
 	success = move_filter_dir(source, filter, movement);
 	pthread_mutex_unlock(&source->filter_mutex);
 
-	if (success)
+	if (success) {
+		render_dirty(source);
 		obs_source_dosignal(source, NULL, "reorder_filters");
+	}
 }
 ///===
 obs_data_t *obs_source_get_settings(const obs_source_t *source)
@@ -3293,36 +3646,31 @@ struct obs_source_frame *filter_async_video(obs_source_t *source, struct obs_sou
 
 	return in;
 }
-///===
-static inline void copy_frame_data_line(struct obs_source_frame *dst,
-					const struct obs_source_frame *src,
-					uint32_t plane, uint32_t y)
-{
-	uint32_t pos_src = y * src->linesize[plane];
-	uint32_t pos_dst = y * dst->linesize[plane];
-	uint32_t bytes = dst->linesize[plane] < src->linesize[plane]
-				 ? dst->linesize[plane]
-				 : src->linesize[plane];
+struct frame_copy {
+	struct video_plane_copy planes[MAX_AV_PLANES];
+	size_t num;
+};
 
-	memcpy(dst->data[plane] + pos_dst, src->data[plane] + pos_src, bytes);
-}
 ///===
-static inline void copy_frame_data_plane(struct obs_source_frame *dst,
+static inline void copy_frame_data_plane(struct frame_copy *copy,
+					 struct obs_source_frame *dst,
 					 const struct obs_source_frame *src,
 					 uint32_t plane, uint32_t lines)
 {
-	if (dst->linesize[plane] != src->linesize[plane]) {
-		for (uint32_t y = 0; y < lines; y++)
-			copy_frame_data_line(dst, src, plane, y);
-	} else {
-		memcpy(dst->data[plane], src->data[plane],
-		       (size_t)dst->linesize[plane] * (size_t)lines);
-	}
+	struct video_plane_copy *p = &copy->planes[copy->num++];
+
+	p->dst = dst->data[plane];
+	p->src = src->data[plane];
+	p->dst_linesize = dst->linesize[plane];
+	p->src_linesize = src->linesize[plane];
+	p->lines = lines;
 }
 ///===
 static void copy_frame_data(struct obs_source_frame *dst,
 			    const struct obs_source_frame *src)
 {
+	struct frame_copy copy = {0};
+
 	dst->flip = src->flip;
 	dst->flags = src->flags;
 	dst->trc = src->trc;
@@ -3341,9 +3689,9 @@ static void copy_frame_data(struct obs_source_frame *dst,
 	case VIDEO_FORMAT_I010: {
 		const uint32_t height = dst->height;
 		const uint32_t half_height = (height + 1) / 2;
-		copy_frame_data_plane(dst, src, 0, height);
-		copy_frame_data_plane(dst, src, 1, half_height);
-		copy_frame_data_plane(dst, src, 2, half_height);
+		copy_frame_data_plane(&copy, dst, src, 0, height);
+		copy_frame_data_plane(&copy, dst, src, 1, half_height);
+		copy_frame_data_plane(&copy, dst, src, 2, half_height);
 		break;
 	}
 
@@ -3351,8 +3699,8 @@ static void copy_frame_data(struct obs_source_frame *dst,
 	case VIDEO_FORMAT_P010: {
 		const uint32_t height = dst->height;
 		const uint32_t half_height = (height + 1) / 2;
-		copy_frame_data_plane(dst, src, 0, height);
-		copy_frame_data_plane(dst, src, 1, half_height);
+		copy_frame_data_plane(&copy, dst, src, 0, height);
+		copy_frame_data_plane(&copy, dst, src, 1, half_height);
 		break;
 	}
 
@@ -3360,9 +3708,9 @@ static void copy_frame_data(struct obs_source_frame *dst,
 	case VIDEO_FORMAT_I422:
 	case VIDEO_FORMAT_I210:
 	case VIDEO_FORMAT_I412:
-		copy_frame_data_plane(dst, src, 0, dst->height);
-		copy_frame_data_plane(dst, src, 1, dst->height);
-		copy_frame_data_plane(dst, src, 2, dst->height);
+		copy_frame_data_plane(&copy, dst, src, 0, dst->height);
+		copy_frame_data_plane(&copy, dst, src, 1, dst->height);
+		copy_frame_data_plane(&copy, dst, src, 2, dst->height);
 		break;
 
 	case VIDEO_FORMAT_YVYU:
@@ -3376,26 +3724,26 @@ static void copy_frame_data(struct obs_source_frame *dst,
 	case VIDEO_FORMAT_BGR3:
 	case VIDEO_FORMAT_AYUV:
 	case VIDEO_FORMAT_V210:
-		copy_frame_data_plane(dst, src, 0, dst->height);
+		copy_frame_data_plane(&copy, dst, src, 0, dst->height);
 		break;
 
 	case VIDEO_FORMAT_I40A: {
 		const uint32_t height = dst->height;
 		const uint32_t half_height = (height + 1) / 2;
-		copy_frame_data_plane(dst, src, 0, height);
-		copy_frame_data_plane(dst, src, 1, half_height);
-		copy_frame_data_plane(dst, src, 2, half_height);
-		copy_frame_data_plane(dst, src, 3, height);
+		copy_frame_data_plane(&copy, dst, src, 0, height);
+		copy_frame_data_plane(&copy, dst, src, 1, half_height);
+		copy_frame_data_plane(&copy, dst, src, 2, half_height);
+		copy_frame_data_plane(&copy, dst, src, 3, height);
 		break;
 	}
 
 	case VIDEO_FORMAT_I42A:
 	case VIDEO_FORMAT_YUVA:
 	case VIDEO_FORMAT_YA2L:
-		copy_frame_data_plane(dst, src, 0, dst->height);
-		copy_frame_data_plane(dst, src, 1, dst->height);
-		copy_frame_data_plane(dst, src, 2, dst->height);
-		copy_frame_data_plane(dst, src, 3, dst->height);
+		copy_frame_data_plane(&copy, dst, src, 0, dst->height);
+		copy_frame_data_plane(&copy, dst, src, 1, dst->height);
+		copy_frame_data_plane(&copy, dst, src, 2, dst->height);
+		copy_frame_data_plane(&copy, dst, src, 3, dst->height);
 		break;
 
 	case VIDEO_FORMAT_P216:
@@ -3403,6 +3751,8 @@ static void copy_frame_data(struct obs_source_frame *dst,
 		/* Unimplemented */
 		break;
 	}
+
+	video_frame_copy_planes(copy.planes, copy.num);
 }
 ///===
 void obs_source_frame_copy(struct obs_source_frame *dst,
@@ -3453,20 +3803,24 @@ static void clean_cache(obs_source_t *source)
 }
 
 #define MAX_ASYNC_FRAMES 30
-//if return value is not null then do (os_atomic_dec_long(&output->refs) == 0) && obs_source_frame_destroy(output)
-///====缓存当前frame 并返回缓存后的newframe
-static inline struct obs_source_frame *
-cache_video(struct obs_source *source, const struct obs_source_frame *frame)
-{
-	struct obs_source_frame *new_frame = NULL;
 
-	pthread_mutex_lock(&source->async_mutex);
+static inline size_t async_queue_depth(const struct obs_source *source)
+{
+	return source->async_queue_depth ? source->async_queue_depth
+					 : MAX_ASYNC_FRAMES;
+}
 
-	if (source->async_frames.num >= MAX_ASYNC_FRAMES) {
-		free_async_cache(source);
-		source->last_frame_ts = 0;
-		pthread_mutex_unlock(&source->async_mutex);
-		return NULL;
+/* caller holds async_mutex.  a full queue drops its oldest frames, whose
+ * cache entries are then reused for the incoming one */
+static void update_async_cache(struct obs_source *source,
+			       const struct obs_source_frame *frame)
+{
+	while (source->async_frames.num &&
+	       source->async_frames.num >= async_queue_depth(source)) {
+		struct obs_source_frame *oldest = source->async_frames.array[0];
+		da_erase(source->async_frames, 0);
+		remove_async_frame(source, oldest);
+		source->async_stats.dropped++;
 	}
 
 	if (async_texture_changed(source, frame)) {
@@ -3475,10 +3829,23 @@ cache_video(struct obs_source *source, const struct obs_source_frame *frame)
 		source->async_cache_height = frame->height;
 	}
 
-	const enum video_format format = frame->format;
-	source->async_cache_format = format;
+	source->async_cache_format = frame->format;
 	source->async_cache_full_range = frame->full_range;
 	source->async_cache_trc = frame->trc;
+}
+
+//if return value is not null then do (os_atomic_dec_long(&output->refs) == 0) && obs_source_frame_destroy(output)
+///====缓存当前frame 并返回缓存后的newframe
+static inline struct obs_source_frame *
+cache_video(struct obs_source *source, const struct obs_source_frame *frame)
+{
+	struct obs_source_frame *new_frame = NULL;
+
+	pthread_mutex_lock(&source->async_mutex);
+
+	update_async_cache(source, frame);
+
+	const enum video_format format = frame->format;
 
 	for (size_t i = 0; i < source->async_cache.num; i++) {
 		struct async_frame *af = &source->async_cache.array[i];
@@ -3487,6 +3854,7 @@ cache_video(struct obs_source *source, const struct obs_source_frame *frame)
 			new_frame->format = format;
 			af->used = true;
 			af->unused_count = 0;
+			source->async_stats.reused++;
 			break;
 		}
 	}
@@ -3501,6 +3869,7 @@ cache_video(struct obs_source *source, const struct obs_source_frame *frame)
 		new_af.frame = new_frame;
 		new_af.used = true;
 		new_af.unused_count = 0;
+		new_af.ring = false;
 		new_frame->refs = 1;
 
 		da_push_back(source->async_cache, &new_af);
@@ -3514,6 +3883,134 @@ cache_video(struct obs_source *source, const struct obs_source_frame *frame)
 
 	return new_frame;
 }
+/* caller holds async_mutex, takes over the frame's reference */
+static void queue_async_frame(struct obs_source *source,
+			      struct obs_source_frame *frame, bool ring)
+{
+	struct async_frame af = {.frame = frame, .used = true, .ring = ring};
+
+	update_async_cache(source, frame);
+	da_push_back(source->async_cache, &af);
+	da_push_back(source->async_frames, &frame);
+	source->async_active = true;
+}
+
+/* caller holds async_mutex */
+static void drain_async_ring(struct obs_source *source)
+{
+	struct obs_source_frame *frame;
+	bool drained = false;
+
+	while ((frame = async_ring_pop(&source->async_ready_ring)) != NULL) {
+		queue_async_frame(source, frame, true);
+		drained = true;
+	}
+
+	/* ring frames the producer didn't take back are left unused in the
+	 * cache, let them age out */
+	if (drained)
+		clean_cache(source);
+}
+
+static void free_async_rings(struct obs_source *source)
+{
+	struct obs_source_frame *frame;
+
+	while ((frame = async_ring_pop(&source->async_ready_ring)) != NULL)
+		obs_source_frame_destroy(frame);
+	while ((frame = async_ring_pop(&source->async_free_ring)) != NULL)
+		obs_source_frame_destroy(frame);
+}
+
+static volatile long next_async_producer = 0;
+static THREAD_LOCAL long async_producer_id = 0;
+
+/* caller holds async_mutex.  only the producer itself gives the rings up;
+ * any other thread asks it to, and it does so on its next frame.  until
+ * then other threads keep to the locked path.  once released, the next
+ * thread to output video becomes the producer, e.g. a media source's new
+ * decode thread after a restart */
+static void release_async_producer(struct obs_source *source)
+{
+	long producer = os_atomic_load_long(&source->async_producer);
+
+	/* draining is the consumer's side, any thread holding the mutex can */
+	drain_async_ring(source);
+
+	if (!producer)
+		return;
+
+	if (producer == async_producer_id) {
+		os_atomic_set_bool(&source->async_producer_release, false);
+		os_atomic_set_long(&source->async_producer, 0);
+	} else {
+		os_atomic_set_bool(&source->async_producer_release, true);
+	}
+}
+
+static inline bool is_async_ring_producer(struct obs_source *source)
+{
+	if (!async_producer_id)
+		async_producer_id = os_atomic_inc_long(&next_async_producer);
+
+	long producer = os_atomic_load_long(&source->async_producer);
+	if (producer == async_producer_id) {
+		if (!os_atomic_load_bool(&source->async_producer_release))
+			return true;
+
+		pthread_mutex_lock(&source->async_mutex);
+		release_async_producer(source);
+		pthread_mutex_unlock(&source->async_mutex);
+		producer = 0;
+	}
+
+	/* on failure the compare-exchange loads the current producer */
+	return !producer &&
+	       os_atomic_compare_exchange_long(&source->async_producer,
+					       &producer, async_producer_id);
+}
+
+static void reset_async_producer(struct obs_source *source)
+{
+	if ((source->info.output_flags & OBS_SOURCE_ASYNC) == 0)
+		return;
+
+	pthread_mutex_lock(&source->async_mutex);
+	release_async_producer(source);
+	pthread_mutex_unlock(&source->async_mutex);
+}
+
+/* single-producer path: copy into a frame handed back by the consumer, or
+ * a new one, and publish it without touching async_mutex */
+static void output_video_ring(struct obs_source *source,
+			      const struct obs_source_frame *frame)
+{
+	struct obs_source_frame *output;
+
+	while ((output = async_ring_pop(&source->async_free_ring)) != NULL) {
+		if (output->format == frame->format &&
+		    output->width == frame->width &&
+		    output->height == frame->height)
+			break;
+		obs_source_frame_destroy(output);
+	}
+
+	if (!output)
+		output = obs_source_frame_create(frame->format, frame->width,
+						 frame->height);
+
+	output->refs = 1;
+	output->prev_frame = false;
+	copy_frame_data(output, frame);
+
+	if (!async_ring_push(&source->async_ready_ring, output)) {
+		/* graphics thread has fallen a whole ring behind */
+		pthread_mutex_lock(&source->async_mutex);
+		drain_async_ring(source);
+		queue_async_frame(source, output, true);
+		pthread_mutex_unlock(&source->async_mutex);
+	}
+}
 ///====
 static void obs_source_output_video_internal(obs_source_t *source,
 				 const struct obs_source_frame *frame)
@@ -3523,12 +4020,19 @@ static void obs_source_output_video_internal(obs_source_t *source,
 
 	if (!frame) {
 		pthread_mutex_lock(&source->async_mutex);
+		release_async_producer(source);
 		source->async_active = false;
+		render_dirty(source);
 		source->last_frame_ts = 0;
 		free_async_cache(source);
 		pthread_mutex_unlock(&source->async_mutex);
 		return;
 	}
+
+	if (is_async_ring_producer(source)) {
+		output_video_ring(source, frame);
+		return;
+	}
     
 	struct obs_source_frame *output = cache_video(source, frame);
 
@@ -3563,6 +4067,45 @@ void obs_source_output_video(obs_source_t *source,
 	obs_source_output_video_internal(source, &new_frame);
 }
 ///====
+void obs_source_output_video_ref(obs_source_t *source,
+				 const struct obs_source_frame *frame,
+				 void (*release)(void *param), void *param)
+{
+	struct obs_source_frame *output;
+
+	if (!release) {
+		obs_source_output_video(source, frame);
+		return;
+	}
+	if (!frame) {
+		release(param);
+		return;
+	}
+	if (destroying(source) ||
+	    !obs_source_valid(source, "obs_source_output_video_ref")) {
+		release(param);
+		return;
+	}
+
+	output = bmalloc(sizeof(*output));
+	*output = *frame;
+	output->full_range =
+		format_is_yuv(frame->format) ? frame->full_range : true;
+	output->refs = 1;
+	output->prev_frame = false;
+	output->release = release;
+	output->release_param = param;
+
+	pthread_mutex_lock(&source->async_mutex);
+
+	/* the cache entry holds the frame's only libobs reference, and is
+	 * dropped rather than recycled by remove_async_frame */
+	drain_async_ring(source);
+	queue_async_frame(source, output, false);
+
+	pthread_mutex_unlock(&source->async_mutex);
+}
+///====
 void obs_source_output_video2(obs_source_t *source,
 			      const struct obs_source_frame2 *frame)
 {
@@ -3604,8 +4147,10 @@ void obs_source_output_video2(obs_source_t *source,
 ///===
 void obs_source_set_async_rotation(obs_source_t *source, long rotation)
 {
-	if (source)
+	if (source) {
 		source->async_rotation = rotation;
+		render_dirty(source);
+	}
 }
 ///===
 void obs_source_output_cea708(obs_source_t *source,
@@ -4081,7 +4626,19 @@ void remove_async_frame(obs_source_t *source, struct obs_source_frame *frame)
 		struct async_frame *f = &source->async_cache.array[i];
 
 		if (f->frame == frame) {
-			f->used = false;
+			/* producer-owned frames go back to the producer as
+			 * soon as libobs is done with them */
+			if (frame->release) {
+				da_erase(source->async_cache, i);
+				obs_source_frame_decref(frame);
+			} else if (f->ring &&
+				   os_atomic_load_long(&frame->refs) == 1 &&
+				   async_ring_push(&source->async_free_ring,
+						   frame)) {
+				da_erase(source->async_cache, i);
+			} else {
+				f->used = false;
+			}
 			break;
 		}
 	}
@@ -4101,6 +4658,7 @@ static bool ready_async_frame(obs_source_t *source, uint64_t sys_time)
 		while (source->async_frames.num > 1) {
 			da_erase(source->async_frames, 0);
 			remove_async_frame(source, next_frame);
+			source->async_stats.late++;
 			next_frame = source->async_frames.array[0];
 		}
 
@@ -4139,8 +4697,10 @@ static bool ready_async_frame(obs_source_t *source, uint64_t sys_time)
 		if ((source->last_frame_ts - next_frame->timestamp) < 2000000)
 			break;
 
-		if (frame)
+		if (frame) {
 			da_erase(source->async_frames, 0);
+			source->async_stats.late++;
+		}
 
 #if DEBUG_ASYNC_FRAMES
 		blog(LOG_DEBUG,
@@ -4378,34 +4938,15 @@ bool obs_source_process_filter_begin(obs_source_t *filter,
 		filter, format, GS_CS_SRGB, allow_direct);
 }
 ///===
-bool obs_source_process_filter_begin_with_color_space(
-	obs_source_t *filter, enum gs_color_format format,
-	enum gs_color_space space, enum obs_allow_direct_render allow_direct)
+static bool process_filter_begin(obs_source_t *filter, obs_source_t *target,
+				 obs_source_t *parent,
+				 enum gs_color_format format,
+				 enum gs_color_space space,
+				 enum obs_allow_direct_render allow_direct)
 {
-	obs_source_t *target, *parent;
 	uint32_t filter_flags, parent_flags;
 	int cx, cy;
 
-	if (!obs_ptr_valid(filter,
-			   "obs_source_process_filter_begin_with_color_space"))
-		return false;
-
-	filter->filter_bypass_active = false;
-
-	target = obs_filter_get_target(filter);
-	parent = obs_filter_get_parent(filter);
-
-	if (!target) {
-		blog(LOG_INFO, "filter '%s' being processed with no target!",
-		     filter->context.name);
-		return false;
-	}
-	if (!parent) {
-		blog(LOG_INFO, "filter '%s' being processed with no parent!",
-		     filter->context.name);
-		return false;
-	}
-
 	filter_flags = filter->info.output_flags;
 	parent_flags = parent->info.output_flags;
 	cx = get_base_width(target);
@@ -4426,10 +4967,8 @@ bool obs_source_process_filter_begin_with_color_space(
 		return true;
 	}
 
-	if (!cx || !cy) {
-		obs_source_skip_video_filter(filter);
+	if (!cx || !cy)
 		return false;
-	}
 
 	if (filter->filter_texrender &&
 	    (gs_texrender_get_format(filter->filter_texrender) != format)) {
@@ -4468,38 +5007,56 @@ bool obs_source_process_filter_begin_with_color_space(
 	}
 	return true;
 }
-///===
-void obs_source_process_filter_tech_end(obs_source_t *filter,
-					gs_effect_t *effect, uint32_t width,
-					uint32_t height, const char *tech_name)
+
+bool obs_source_process_filter_begin_with_color_space(
+	obs_source_t *filter, enum gs_color_format format,
+	enum gs_color_space space, enum obs_allow_direct_render allow_direct)
 {
 	obs_source_t *target, *parent;
-	gs_texture_t *texture;
-	uint32_t filter_flags;
 
-	if (!filter)
-		return;
+	if (!obs_ptr_valid(filter,
+			   "obs_source_process_filter_begin_with_color_space"))
+		return false;
 
-	const bool filter_bypass_active = filter->filter_bypass_active;
 	filter->filter_bypass_active = false;
 
 	target = obs_filter_get_target(filter);
 	parent = obs_filter_get_parent(filter);
 
-	if (!target || !parent)
-		return;
-
-	filter_flags = filter->info.output_flags;
+	if (!target) {
+		blog(LOG_INFO, "filter '%s' being processed with no target!",
+		     filter->context.name);
+		return false;
+	}
+	if (!parent) {
+		blog(LOG_INFO, "filter '%s' being processed with no parent!",
+		     filter->context.name);
+		return false;
+	}
 
-	const bool previous =
-		gs_set_linear_srgb((filter_flags & OBS_SOURCE_SRGB) != 0);
+	if (!process_filter_begin(filter, target, parent, format, space,
+				  allow_direct)) {
+		obs_source_skip_video_filter(filter);
+		return false;
+	}
+	return true;
+}
+///===
+static void process_filter_end(obs_source_t *filter, obs_source_t *target,
+			       gs_effect_t *effect, uint32_t width,
+			       uint32_t height, const char *tech)
+{
+	const bool filter_bypass_active = filter->filter_bypass_active;
+	filter->filter_bypass_active = false;
 
-	const char *tech = tech_name ? tech_name : "Draw";
+	const bool previous = gs_set_linear_srgb(
+		(filter->info.output_flags & OBS_SOURCE_SRGB) != 0);
 
 	if (filter_bypass_active) {
 		render_filter_bypass(target, effect, tech);
 	} else {
-		texture = gs_texrender_get_texture(filter->filter_texrender);
+		gs_texture_t *texture =
+			gs_texrender_get_texture(filter->filter_texrender);
 		if (texture) {
 			render_filter_tex(texture, effect, width, height, tech);
 		}
@@ -4507,6 +5064,27 @@ void obs_source_process_filter_tech_end(obs_source_t *filter,
 
 	gs_set_linear_srgb(previous);
 }
+
+void obs_source_process_filter_tech_end(obs_source_t *filter,
+					gs_effect_t *effect, uint32_t width,
+					uint32_t height, const char *tech_name)
+{
+	obs_source_t *target, *parent;
+
+	if (!filter)
+		return;
+
+	target = obs_filter_get_target(filter);
+	parent = obs_filter_get_parent(filter);
+
+	if (!target || !parent) {
+		filter->filter_bypass_active = false;
+		return;
+	}
+
+	process_filter_end(filter, target, effect, width, height,
+			   tech_name ? tech_name : "Draw");
+}
 ///===
 void obs_source_process_filter_end(obs_source_t *filter, gs_effect_t *effect,
 				   uint32_t width, uint32_t height)
@@ -4517,21 +5095,11 @@ void obs_source_process_filter_end(obs_source_t *filter, gs_effect_t *effect,
 	obs_source_process_filter_tech_end(filter, effect, width, height,
 					   "Draw");
 }
-///=== 当前source不符合   选择跳过继续他的target
-void obs_source_skip_video_filter(obs_source_t *filter)
+static void render_filter_target(obs_source_t *target, obs_source_t *parent)
 {
-	obs_source_t *target, *parent;
-	bool custom_draw, async;
-	uint32_t parent_flags;
-
-	if (!obs_ptr_valid(filter, "obs_source_skip_video_filter"))
-		return;
-
-	target = obs_filter_get_target(filter);
-	parent = obs_filter_get_parent(filter);
-	parent_flags = parent->info.output_flags;
-	custom_draw = (parent_flags & OBS_SOURCE_CUSTOM_DRAW) != 0;
-	async = (parent_flags & OBS_SOURCE_ASYNC) != 0;
+	uint32_t parent_flags = parent->info.output_flags;
+	bool custom_draw = (parent_flags & OBS_SOURCE_CUSTOM_DRAW) != 0;
+	bool async = (parent_flags & OBS_SOURCE_ASYNC) != 0;
 
 	if (target == parent) {
 		if (!custom_draw && !async)
@@ -4547,6 +5115,167 @@ void obs_source_skip_video_filter(obs_source_t *filter)
 		obs_source_video_render(target);
 	}
 }
+///=== 当前source不符合   选择跳过继续他的target
+void obs_source_skip_video_filter(obs_source_t *filter)
+{
+	if (!obs_ptr_valid(filter, "obs_source_skip_video_filter"))
+		return;
+
+	render_filter_target(obs_filter_get_target(filter),
+			     obs_filter_get_parent(filter));
+}
+
+static inline bool get_filter_color_op(obs_source_t *filter, uint32_t srgb,
+				       struct obs_filter_color_op *op)
+{
+	return filter->info.filter_get_color_op && filter->context.data &&
+	       (filter->info.output_flags & OBS_SOURCE_SRGB) == srgb &&
+	       filter->info.filter_get_color_op(filter->context.data, op);
+}
+
+/* op becomes "first, then op" */
+static inline void prepend_color_op(struct obs_filter_color_op *op,
+				    const struct obs_filter_color_op *first)
+{
+	struct vec4 offset;
+
+	vec4_transform(&offset, &first->offset, &op->matrix);
+	vec4_add(&op->offset, &offset, &op->offset);
+	matrix4_mul(&op->matrix, &first->matrix, &op->matrix);
+}
+
+static inline bool color_op_is_identity(const struct obs_filter_color_op *op)
+{
+	struct matrix4 identity;
+	const float *m1 = (const float *)&op->matrix;
+	const float *m2 = (const float *)&identity;
+
+	matrix4_identity(&identity);
+
+	for (size_t i = 0; i < 16; i++) {
+		if (fabsf(m1[i] - m2[i]) > EPSILON)
+			return false;
+	}
+	for (size_t i = 0; i < 4; i++) {
+		if (fabsf(op->offset.ptr[i]) > EPSILON)
+			return false;
+	}
+	return true;
+}
+
+/* the pass after op would clamp whatever op takes out of [0, 1], which a
+ * combined transform wouldn't, so only ops that stay in range are merged
+ * into the one drawn above them */
+static inline bool color_op_in_range(const struct obs_filter_color_op *op)
+{
+	const struct vec4 *rows = &op->matrix.x;
+
+	for (size_t j = 0; j < 4; j++) {
+		float lo = op->offset.ptr[j];
+		float hi = op->offset.ptr[j];
+
+		for (size_t i = 0; i < 4; i++) {
+			float val = rows[i].ptr[j];
+			if (val < 0.0f)
+				lo += val;
+			else
+				hi += val;
+		}
+
+		if (lo < -EPSILON || hi > 1.0f + EPSILON)
+			return false;
+	}
+	return true;
+}
+
+static inline bool filter_passes_through(obs_source_t *filter)
+{
+	return !filter->context.data || !filter->enabled ||
+	       !filter->info.video_render;
+}
+
+/* Draws a run of adjacent color op filters as a single pass, or skips them
+ * outright when together they leave pixels unchanged.  Returns false if the
+ * filter has to render itself. */
+static bool render_filter_color_ops(obs_source_t *filter)
+{
+	struct obs_filter_color_op op, next_op;
+	obs_source_t *parent = filter->filter_parent;
+	obs_source_t *target = filter->filter_target;
+	uint32_t srgb = filter->info.output_flags & OBS_SOURCE_SRGB;
+	size_t count = 1;
+	uint32_t cx, cy;
+
+	if (!parent || !target || !get_filter_color_op(filter, srgb, &op))
+		return false;
+
+	while (target != parent) {
+		if (filter_passes_through(target)) {
+			target = target->filter_target;
+		} else if (get_filter_color_op(target, srgb, &next_op) &&
+			   color_op_in_range(&next_op)) {
+			prepend_color_op(&op, &next_op);
+			target = target->filter_target;
+			count++;
+		} else {
+			break;
+		}
+
+		if (!target)
+			return false;
+	}
+
+	if (color_op_is_identity(&op)) {
+		render_filter_target(target, parent);
+
+		pthread_mutex_lock(&parent->filter_mutex);
+		parent->filter_stats.bypassed += count;
+		pthread_mutex_unlock(&parent->filter_mutex);
+		return true;
+	}
+
+	/* a lone filter draws better with its own shader */
+	if (count == 1)
+		return false;
+
+	const enum gs_color_space preferred_spaces[] = {
+		GS_CS_SRGB,
+		GS_CS_SRGB_16F,
+		GS_CS_709_EXTENDED,
+	};
+	const enum gs_color_space space = obs_source_get_color_space(
+		target, OBS_COUNTOF(preferred_spaces), preferred_spaces);
+
+	/* DrawColorMatrix saturates, which would clip anything brighter
+	 * than SDR white; HDR targets go through each filter instead */
+	if (space != GS_CS_SRGB)
+		return false;
+
+	cx = get_base_width(target);
+	cy = get_base_height(target);
+
+	filter->filter_bypass_active = false;
+	if (process_filter_begin(filter, target, parent,
+				 gs_get_format_from_space(space), space,
+				 OBS_ALLOW_DIRECT_RENDERING)) {
+		gs_effect_t *effect = obs->video.default_effect;
+
+		gs_effect_set_matrix4(
+			gs_effect_get_param_by_name(effect, "color_matrix"),
+			&op.matrix);
+		gs_effect_set_vec4(
+			gs_effect_get_param_by_name(effect, "color_offset"),
+			&op.offset);
+
+		process_filter_end(filter, target, effect, cx, cy,
+				   "DrawColorMatrix");
+
+		pthread_mutex_lock(&parent->filter_mutex);
+		parent->filter_stats.fused += count - 1;
+		pthread_mutex_unlock(&parent->filter_mutex);
+	}
+	return true;
+}
 ///====
 signal_handler_t *obs_source_get_signal_handler(const obs_source_t *source)
 {
@@ -4800,6 +5529,7 @@ bool obs_source_add_active_child(obs_source_t *parent, obs_source_t *child)
 		obs_source_activate(child, type);
 	}
 
+	obs_invalidate_audio_graph();
 	return true;
 }
 ///===? 隐藏当前child
@@ -4815,6 +5545,8 @@ void obs_source_remove_active_child(obs_source_t *parent, obs_source_t *child)
 		type = (i < parent->activate_refs) ? MAIN_VIEW : AUX_VIEW;
 		obs_source_deactivate(child, type);
 	}
+
+	obs_invalidate_audio_graph();
 }
 ///====
 void obs_source_save(obs_source_t *source)
@@ -4927,6 +5659,7 @@ void obs_source_set_audio_mixers(obs_source_t *source, uint32_t mixers)
 	mixers = (uint32_t)calldata_int(&data, "mixers");
 
 	source->audio_mixers = mixers;
+	obs_invalidate_audio_graph();
 }
 ///====
 uint32_t obs_source_get_audio_mixers(const obs_source_t *source)
@@ -5114,6 +5847,7 @@ void obs_source_set_enabled(obs_source_t *source, bool enabled)
 		return;
 
 	source->enabled = enabled;
+	render_dirty(source);
 
 	calldata_init_fixed(&data, stack, sizeof(stack));
 	calldata_set_ptr(&data, "source", source);
@@ -5331,11 +6065,8 @@ static float get_source_volume(obs_source_t *source, uint64_t os_time)
 static inline void multiply_output_audio(obs_source_t *source, size_t mix,
 					 size_t channels, float vol)
 {
-	register float *out = source->audio_output_buf[mix][0];
-	register float *end = out + AUDIO_OUTPUT_FRAMES * channels;
-
-	while (out < end)
-		*(out++) *= vol;
+	audio_mix_scale(source->audio_output_buf[mix][0], vol,
+			AUDIO_OUTPUT_FRAMES * channels);
 }
 ///====实际调整音量大小
 static inline void multiply_vol_data(obs_source_t *source, size_t mix,
@@ -5411,7 +6142,8 @@ static void apply_audio_actions(obs_source_t *source, size_t channels,
 	pthread_mutex_unlock(&source->audio_actions_mutex);
     ///把音量应用到每个轨道中
 	for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
-		if ((source->audio_mixers & (1 << mix)) != 0)
+		if ((source->audio_mixers & (1 << mix)) != 0 &&
+		    audio_output_allocated(source, mix))
 			multiply_vol_data(source, mix, channels, vol_data);
 	}
 }
@@ -5446,9 +6178,12 @@ static void apply_audio_volume(obs_source_t *source, uint32_t mixers,
 		return;
 
 	if (vol == 0.0f || mixers == 0) {
-		memset(source->audio_output_buf[0][0], 0,
-		       AUDIO_OUTPUT_FRAMES * sizeof(float) *
-			       MAX_AUDIO_CHANNELS * MAX_AUDIO_MIXES);
+		for (size_t mix = 0; mix < MAX_AUDIO_MIXES; mix++) {
+			if (audio_output_allocated(source, mix))
+				memset(source->audio_output_buf[mix][0], 0,
+				       AUDIO_OUTPUT_FRAMES * sizeof(float) *
+					       MAX_AUDIO_CHANNELS);
+		}
 		return;
 	}
 
@@ -5473,7 +6208,9 @@ static void custom_audio_render(obs_source_t *source, uint32_t mixers,
 				source->audio_output_buf[mix][ch];
 		}
 
-		if ((source->audio_mixers & mixers & (1 << mix)) != 0) {
+		/* mixes outside mixers are cleared too, so nothing reads a
+		 * previous tick from them */
+		if (audio_output_allocated(source, mix)) {
 			memset(source->audio_output_buf[mix][0], 0,
 			       sizeof(float) * AUDIO_OUTPUT_FRAMES * channels);
 		}
@@ -5569,11 +6306,15 @@ static inline void process_audio_source_tick(obs_source_t *source,
         ///如果当前source不在轨道mix上 则置空当前轨数据
 		if ((source->audio_mixers & mix_and_val) == 0 ||
 		    (mixers & mix_and_val) == 0) {
-			memset(source->audio_output_buf[mix][0], 0,
-			       size * channels);
+			if (audio_output_allocated(source, mix))
+				memset(source->audio_output_buf[mix][0], 0,
+				       size * channels);
 			continue;
 		}
         ///source在当前mix轨道上  则拷贝数据到当前的mix轨道上
+		if (!audio_output_allocated(source, mix))
+			continue;
+
 		for (size_t ch = 0; ch < channels; ch++)
 			memcpy(source->audio_output_buf[mix][ch],
 			       source->audio_output_buf[0][ch], size);
@@ -5600,6 +6341,9 @@ void obs_source_audio_render(obs_source_t *source, uint32_t mixers,
 		return;
 	}
 
+	allocate_audio_output_mixes(source, mixers);
+	source->audio_render_mixers = mixers;
+
 	if (source->info.audio_render) {
 		if (!source->context.data) {
 			source->audio_pending = true;
@@ -5613,6 +6357,12 @@ void obs_source_audio_render(obs_source_t *source, uint32_t mixers,
 		audio_submix(source, channels, sample_rate);
 	}
 
+	if (!audio_ring_empty(&source->audio_ready_ring)) {
+		pthread_mutex_lock(&source->audio_buf_mutex);
+		drain_audio_ring(source);
+		pthread_mutex_unlock(&source->audio_buf_mutex);
+	}
+
 	if (!source->audio_ts) {
 		source->audio_pending = true;
 		return;
@@ -5740,6 +6490,42 @@ bool obs_source_async_unbuffered(const obs_source_t *source)
 		       : false;
 }
 ///====
+void obs_source_set_async_queue_depth(obs_source_t *source, uint32_t depth)
+{
+	if (!obs_source_valid(source, "obs_source_set_async_queue_depth"))
+		return;
+
+	pthread_mutex_lock(&source->async_mutex);
+	source->async_queue_depth = depth;
+	pthread_mutex_unlock(&source->async_mutex);
+}
+///====
+bool obs_source_get_async_stats(obs_source_t *source,
+				struct obs_source_async_stats *stats)
+{
+	if (!obs_source_valid(source, "obs_source_get_async_stats") ||
+	    !obs_ptr_valid(stats, "obs_source_get_async_stats"))
+		return false;
+
+	pthread_mutex_lock(&source->async_mutex);
+	*stats = source->async_stats;
+	pthread_mutex_unlock(&source->async_mutex);
+	return true;
+}
+
+bool obs_source_get_filter_stats(obs_source_t *source,
+				 struct obs_source_filter_stats *stats)
+{
+	if (!obs_source_valid(source, "obs_source_get_filter_stats") ||
+	    !obs_ptr_valid(stats, "obs_source_get_filter_stats"))
+		return false;
+
+	pthread_mutex_lock(&source->filter_mutex);
+	*stats = source->filter_stats;
+	pthread_mutex_unlock(&source->filter_mutex);
+	return true;
+}
+///====
 obs_data_t *obs_source_get_private_settings(obs_source_t *source)
 {
 	if (!obs_ptr_valid(source, "obs_source_get_private_settings"))
@@ -5877,6 +6663,7 @@ void obs_source_media_restart(obs_source_t *source)
 		return;
 
 	source->info.media_restart(source->context.data);
+	reset_async_producer(source);
 
 	obs_source_dosignal(source, NULL, "media_restart");
 }
@@ -5890,6 +6677,7 @@ void obs_source_media_stop(obs_source_t *source)
 		return;
 
 	source->info.media_stop(source->context.data);
+	reset_async_producer(source);
 
 	obs_source_dosignal(source, NULL, "media_stopped");
 }
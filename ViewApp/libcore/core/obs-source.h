@@ -211,6 +211,19 @@ enum obs_media_state {
  */
 #define OBS_SOURCE_CAP_DONT_SHOW_PROPERTIES (1 << 16)
 
+/**
+ * Source's video_tick does not use the graphics subsystem, so it may be
+ * called from a worker thread at the same time as other sources' ticks
+ */
+#define OBS_SOURCE_PARALLEL_TICK (1 << 17)
+
+/**
+ * Source's video_render output only changes after its settings are updated
+ * or after it calls obs_source_mark_dirty, so scenes may reuse a cached
+ * render of it
+ */
+#define OBS_SOURCE_CACHEABLE_RENDER (1 << 18)
+
 /** @} */
 
 typedef void (*obs_source_enum_proc_t)(obs_source_t *parent,
@@ -220,6 +233,27 @@ struct obs_source_audio_mix {
 	struct audio_output_data output[MAX_AUDIO_MIXES];
 };
 
+/**
+ * Per-pixel color transform of a filter, applied to each sampled texel:
+ *
+ *   rgba' = saturate(rgba * matrix + offset)
+ */
+struct obs_filter_color_op {
+	struct matrix4 matrix;
+	struct vec4 offset;
+};
+
+/**
+ * What a source draws when it is a single texture or a solid color, for
+ * scenes to batch it with other items.  The texture is drawn at its own
+ * size, the color is 0xAABBGGRR sRGB and multiplies the texture, or fills
+ * the source's size when there is no texture.
+ */
+struct obs_source_sprite {
+	gs_texture_t *texture;
+	uint32_t color;
+};
+
 /**
  * Source definition structure
  */
@@ -567,6 +601,40 @@ struct obs_source_info {
 	enum gs_color_space (*video_get_color_space)(
 		void *data, size_t count,
 		const enum gs_color_space *preferred_spaces);
+
+	/**
+	 * Describes what the filter currently does to each pixel as a color
+	 * transform.  Adjacent filters that can do this are drawn together
+	 * in one pass, and a filter whose transform is the identity is
+	 * skipped.  video_render is still used when this returns false.
+	 *
+	 * @param       data  Filter data
+	 * @param[out]  op    Color transform of the current settings
+	 * @return            true if the filter can be drawn as op
+	 */
+	bool (*filter_get_color_op)(void *data,
+				    struct obs_filter_color_op *op);
+
+	/**
+	 * Whether video_render currently fills the source's whole width and
+	 * height with opaque pixels, so scene items beneath it do not need
+	 * to be drawn.  Called from the graphics thread.
+	 *
+	 * @param   data  Source data
+	 * @return        true if the current output is fully opaque
+	 */
+	bool (*video_is_opaque)(void *data);
+
+	/**
+	 * Gets what video_render would draw as a texture or a solid color,
+	 * with SRGB color space and premultiplied alpha.  Called from the
+	 * graphics thread in place of video_render.
+	 *
+	 * @param       data    Source data
+	 * @param[out]  sprite  Texture and color of the current frame
+	 * @return              true if video_render draws exactly sprite
+	 */
+	bool (*video_get_sprite)(void *data, struct obs_source_sprite *sprite);
 };
 
 EXPORT void obs_register_source_s(const struct obs_source_info *info,
@@ -29,13 +29,36 @@
 #include <windows.h>
 #endif
 
+/* below this the worker wakeups cost more than ticking serially */
+#define MIN_PARALLEL_TICK_SOURCES 16
+
+struct tick_pass {
+	obs_source_t **sources;
+	float seconds;
+};
+
+static void tick_prepare_task(void *param, size_t idx)
+{
+	struct tick_pass *pass = param;
+	obs_source_video_tick_prepare(pass->sources[idx]);
+}
+
+static void tick_deferred_task(void *param, size_t idx)
+{
+	struct tick_pass *pass = param;
+	obs_source_video_tick_deferred(pass->sources[idx], pass->seconds);
+}
+
 ///==== tick  1:全局的tick_callback  2:source_tick()
-static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
+static uint64_t tick_sources(os_task_pool_t *pool, uint64_t cur_time,
+			     uint64_t last_time)
 {
 	struct obs_core_data *data = &obs->data;
 	struct obs_source *source;
+	struct tick_pass pass;
 	uint64_t delta_time;
 	float seconds;
+	bool parallel;
 
 	if (!last_time)
 		last_time = cur_time - obs->video.video_frame_interval_ns;
@@ -76,11 +99,25 @@ static uint64_t tick_sources(uint64_t cur_time, uint64_t last_time)
 	/* ------------------------------------- */
 	/* call the tick function of each source */
 
-	for (size_t i = 0; i < data->sources_to_tick.num; i++) {
-		obs_source_t *s = data->sources_to_tick.array[i];
-		obs_source_video_tick(s, seconds);
-		obs_source_release(s);
-	}
+	pass.sources = data->sources_to_tick.array;
+	pass.seconds = seconds;
+	parallel = pool &&
+		   data->sources_to_tick.num >= MIN_PARALLEL_TICK_SOURCES;
+
+	if (parallel)
+		os_task_pool_run(pool, tick_prepare_task, &pass,
+				 data->sources_to_tick.num);
+
+	for (size_t i = 0; i < data->sources_to_tick.num; i++)
+		obs_source_video_tick_main(data->sources_to_tick.array[i],
+					   seconds, parallel);
+
+	if (parallel)
+		os_task_pool_run(pool, tick_deferred_task, &pass,
+				 data->sources_to_tick.num);
+
+	for (size_t i = 0; i < data->sources_to_tick.num; i++)
+		obs_source_release(data->sources_to_tick.array[i]);
 
 	return cur_time;
 }
@@ -120,12 +157,20 @@ static inline void set_render_size(uint32_t width, uint32_t height)
 	gs_set_viewport(0, 0, width, height);
 }
 
-static inline void unmap_last_surface(struct obs_core_video_mix *video)
+/* unmaps every staging slot that is neither being read by video-io nor
+ * waiting to be handed to it */
+static inline void unmap_released_surfaces(struct obs_core_video_mix *video)
 {
-	for (int c = 0; c < NUM_CHANNELS; ++c) {
-		if (video->mapped_surfaces[c]) {
-			gs_stagesurface_unmap(video->mapped_surfaces[c]);
-			video->mapped_surfaces[c] = NULL;
+	for (int i = 0; i < video->num_textures; i++) {
+		if (os_atomic_load_long(&video->raw_refs[i].refs))
+			continue;
+
+		for (int c = 0; c < NUM_CHANNELS; ++c) {
+			if (video->mapped_surfaces[i][c]) {
+				gs_stagesurface_unmap(
+					video->mapped_surfaces[i][c]);
+				video->mapped_surfaces[i][c] = NULL;
+			}
 		}
 	}
 }
@@ -409,7 +454,7 @@ stage_output_texture(struct obs_core_video_mix *video, int cur_texture,
 {
 	profile_start(stage_output_texture_name);
 
-	unmap_last_surface(video);
+	unmap_released_surfaces(video);
 
 	if (!video->gpu_conversion) {
 		gs_stagesurf_t *copy = copy_surfaces[0];
@@ -586,7 +631,7 @@ static inline void render_video(struct obs_core_video_mix *video,
 static inline bool download_frame(struct obs_core_video_mix *video,
 				  int prev_texture, struct video_data *frame)
 {
-	if (!video->textures_copied[prev_texture])
+	if (prev_texture < 0 || !video->textures_copied[prev_texture])
 		return false;
 
 	for (int channel = 0; channel < NUM_CHANNELS; ++channel) {
@@ -597,7 +642,7 @@ static inline bool download_frame(struct obs_core_video_mix *video,
 						 &frame->linesize[channel]))
 				return false;
 
-			video->mapped_surfaces[channel] = surface;
+			video->mapped_surfaces[prev_texture][channel] = surface;
 		}
 	}
 	return true;
@@ -814,9 +859,81 @@ static inline void copy_rgbx_frame(struct video_frame *output,
 		}
 	}
 }
+/* builds the view video-io inputs get of a mapped frame, false if the
+ * format has to go through a copy */
+static bool make_raw_frame_view(struct obs_core_video_mix *video,
+				const struct video_data *input,
+				const struct video_output_info *info,
+				struct video_data *view)
+{
+	*view = *input;
+
+	if (!video->gpu_conversion)
+		return true;
+
+	switch (info->format) {
+	case VIDEO_FORMAT_NV12:
+	case VIDEO_FORMAT_P010:
+		/* luma and chroma can share one surface */
+		if (!input->linesize[1]) {
+			view->data[1] = input->data[0] +
+					(size_t)input->linesize[0] *
+						(size_t)info->height;
+			view->linesize[1] = input->linesize[0];
+		}
+		return true;
+	case VIDEO_FORMAT_I420:
+	case VIDEO_FORMAT_I444:
+	case VIDEO_FORMAT_I010:
+	case VIDEO_FORMAT_P216:
+	case VIDEO_FORMAT_P416:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static void release_raw_frame(void *param)
+{
+	struct obs_raw_frame_ref *ref = param;
+
+	os_atomic_dec_long(&ref->refs);
+	os_atomic_dec_long(&ref->video->raw_frames_held);
+}
+
+/* hands the mapped surfaces of the slot to video-io without copying.  they
+ * stay mapped until video-io releases them */
+static bool output_video_data_ref(struct obs_core_video_mix *video,
+				  struct video_data *input_frame, int count,
+				  int slot, const struct video_output_info *info)
+{
+	struct obs_raw_frame_ref *ref = &video->raw_refs[slot];
+	struct video_data view;
+
+	if (!video->zero_copy_raw)
+		return false;
+	if (os_atomic_load_long(&video->raw_frames_held) + 2 >=
+	    video->num_textures)
+		return false;
+	if (!make_raw_frame_view(video, input_frame, info, &view))
+		return false;
+
+	os_atomic_inc_long(&ref->refs);
+	os_atomic_inc_long(&video->raw_frames_held);
+
+	/* if video-io is full it repeats its newest frame instead, same as
+	 * a failed video_output_lock_frame */
+	if (!video_output_push_frame_ref(video->video, &view, count,
+					 release_raw_frame, ref))
+		release_raw_frame(ref);
+
+	return true;
+}
+
 ///===输出视频到当前画布下的video_output(video-io)
 static inline void output_video_data(struct obs_core_video_mix *video,
-                                     struct video_data *input_frame, int count)
+                                     struct video_data *input_frame, int count,
+                                     int slot)
 {
 	const struct video_output_info *info;
 	struct video_frame output_frame;
@@ -824,6 +941,9 @@ static inline void output_video_data(struct obs_core_video_mix *video,
 
 	info = video_output_get_info(video->video);
 
+	if (output_video_data_ref(video, input_frame, count, slot, info))
+		return;
+
 	locked = video_output_lock_frame(video->video, &output_frame, count,
 					 input_frame->timestamp);
 	if (locked) {
@@ -837,8 +957,52 @@ static inline void output_video_data(struct obs_core_video_mix *video,
 		video_output_unlock_frame(video->video);
 	}
 }
+static inline void record_frame_time(struct obs_frame_histogram *hist,
+				     uint64_t ns)
+{
+	uint64_t us = ns / 1000;
+	size_t idx = frame_hist_bucket(us);
+
+	if (us > LONG_MAX)
+		us = LONG_MAX;
+
+	os_atomic_inc_long(&hist->counts[idx]);
+	if ((long)us > os_atomic_load_long(&hist->max_us))
+		os_atomic_set_long(&hist->max_us, (long)us);
+}
+
+static inline void reset_frame_times(struct obs_video_frame_times *times)
+{
+	struct obs_frame_histogram *hists[] = {
+		&times->loop, &times->sleep_overshoot, &times->tick_sources,
+		&times->output_frames, &times->render_displays};
+
+	if (!os_atomic_exchange_bool(&times->reset, false))
+		return;
+
+	for (size_t i = 0; i < sizeof(hists) / sizeof(hists[0]); i++) {
+		for (size_t j = 0; j < FRAME_HIST_BUCKETS; j++)
+			os_atomic_set_long(&hists[i]->counts[j], 0);
+		os_atomic_set_long(&hists[i]->max_us, 0);
+	}
+	os_atomic_set_long(&times->missed_deadlines, 0);
+	os_atomic_set_long(&times->last_culled_items, 0);
+	os_atomic_set_long(&times->max_culled_items, 0);
+}
+
+static inline void record_culled_items(struct obs_video_frame_times *times)
+{
+	long culled = times->frame_culled_items;
+
+	times->frame_culled_items = 0;
+	os_atomic_set_long(&times->last_culled_items, culled);
+	if (culled > os_atomic_load_long(&times->max_culled_items))
+		os_atomic_set_long(&times->max_culled_items, culled);
+}
+
 ///====绘制线程pts休眠 以及从画布输出每一帧
-static inline void video_sleep(struct obs_core_video *video, uint64_t *p_time,
+static inline void video_sleep(struct obs_core_video *video,
+			       os_frame_clock_t *clock, uint64_t *p_time,
 			       uint64_t interval_ns)
 {
 	struct obs_vframe_info vframe_info;
@@ -847,9 +1011,11 @@ static inline void video_sleep(struct obs_core_video *video, uint64_t *p_time,
 	uint64_t t = cur_time + interval_ns;
 	int count;
     ///正常情况下 下一次时间t > 当前时钟时间
-	if (os_sleepto_ns(t)) {
+	if (os_frame_clock_sleepto_ns(clock, t)) {
 		*p_time = t;
 		count = 1;
+		record_frame_time(&video->frame_times.sleep_overshoot,
+				  os_gettime_ns() - t);
 	} else {
         ///ex t:10 interval_ns = 2   cur_time = 16  count = (16-10)/2
 		const uint64_t udiff = os_gettime_ns() - cur_time;
@@ -860,6 +1026,7 @@ static inline void video_sleep(struct obs_core_video *video, uint64_t *p_time,
 						      : interval_ns;
 		count = (int)(clamped_diff / interval_ns);
 		*p_time = cur_time + interval_ns * count;
+		os_atomic_inc_long(&video->frame_times.missed_deadlines);
 	}
 
 	video->total_frames += count;
@@ -884,79 +1051,129 @@ static inline void video_sleep(struct obs_core_video *video, uint64_t *p_time,
 	pthread_mutex_unlock(&obs->video.mixes_mutex);
 }
 
+/* the staging slot after cur that video-io is not holding on to */
+static int next_texture(struct obs_core_video_mix *video, int cur_texture)
+{
+	int next = cur_texture;
+
+	for (int i = 0; i < video->num_textures; i++) {
+		if (++next == video->num_textures)
+			next = 0;
+		if (next != cur_texture &&
+		    !os_atomic_load_long(&video->raw_refs[next].refs))
+			break;
+	}
+
+	return next;
+}
+
 static const char *output_frame_gs_context_name = "gs_context(video->graphics)";
 static const char *output_frame_render_video_name = "render_video";
 static const char *output_frame_download_frame_name = "download_frame";
 static const char *output_frame_gs_flush_name = "gs_flush";
 static const char *output_frame_output_video_data_name = "output_video_data";
-static inline void output_frame(struct obs_core_video_mix *video)
+static inline void render_frame(struct obs_core_video_mix *video)
 {
-	const bool raw_active = video->raw_was_active;
-	const bool gpu_active = video->gpu_was_active;
+	render_video(video, video->raw_was_active, video->gpu_was_active,
+		     video->cur_texture);
+}
 
-	int cur_texture = video->cur_texture;
-	int prev_texture = cur_texture == 0 ? NUM_TEXTURES - 1
-					    : cur_texture - 1;
-	struct video_data frame;
-	bool frame_ready = 0;
+///从GPU中读取每一帧  并记录等待GPU的时间
+static inline void readback_frame(struct obs_core_video_mix *video)
+{
+	struct obs_video_readback_stats *stats = &video->readback_stats;
+	uint64_t start, wait;
 
-	memset(&frame, 0, sizeof(struct video_data));
+	memset(&video->readback_frame, 0, sizeof(video->readback_frame));
+	video->readback_ready = false;
 
-	profile_start(output_frame_gs_context_name);
-	gs_enter_context(obs->video.graphics);
+	if (!video->raw_was_active)
+		return;
 
-	profile_start(output_frame_render_video_name);
-	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_RENDER_VIDEO,
-			      output_frame_render_video_name);
-	render_video(video, raw_active, gpu_active, cur_texture);
-	GS_DEBUG_MARKER_END();
-	profile_end(output_frame_render_video_name);
-    
-    ///从GPU中读取每一帧
-	if (raw_active) {
-		profile_start(output_frame_download_frame_name);
-		frame_ready = download_frame(video, prev_texture, &frame);
-		profile_end(output_frame_download_frame_name);
+	profile_start(output_frame_download_frame_name);
+	start = os_gettime_ns();
+	video->readback_ready = download_frame(video, video->prev_texture,
+					       &video->readback_frame);
+	wait = os_gettime_ns() - start;
+	profile_end(output_frame_download_frame_name);
+
+	if (video->readback_ready) {
+		stats->frames++;
+		stats->total_wait_ns += wait;
+		stats->last_wait_ns = wait;
+		if (wait > stats->max_wait_ns)
+			stats->max_wait_ns = wait;
 	}
+}
 
-	profile_start(output_frame_gs_flush_name);
-	gs_flush();
-	profile_end(output_frame_gs_flush_name);
-
-	gs_leave_context();
-	profile_end(output_frame_gs_context_name);
+static inline void output_frame(struct obs_core_video_mix *video)
+{
+	int cur_texture = video->cur_texture;
+	int prev_texture = video->prev_texture;
 
     ///视频输出
-	if (raw_active && frame_ready) {
+	if (video->raw_was_active && video->readback_ready) {
+		struct video_data *frame = &video->readback_frame;
 		struct obs_vframe_info vframe_info;
 		circlebuf_pop_front(&video->vframe_info_buffer, &vframe_info,
 				    sizeof(vframe_info));
 
-		frame.timestamp = vframe_info.timestamp;
+		frame->timestamp = vframe_info.timestamp;
 		profile_start(output_frame_output_video_data_name);
-		output_video_data(video, &frame, vframe_info.count);
+		output_video_data(video, frame, vframe_info.count,
+				  prev_texture);
 		profile_end(output_frame_output_video_data_name);
 	}
 
-	if (++video->cur_texture == NUM_TEXTURES)
-		video->cur_texture = 0;
+	video->prev_texture = cur_texture;
+	video->cur_texture = next_texture(video, cur_texture);
 }
 
 static inline void output_frames(void)
 {
+	struct obs_core_video_mix **mixes;
+	size_t num;
+
 	pthread_mutex_lock(&obs->video.mixes_mutex);
-	for (size_t i = 0, num = obs->video.mixes.num; i < num; i++) {
+	for (size_t i = 0; i < obs->video.mixes.num; i++) {
 		struct obs_core_video_mix *mix = obs->video.mixes.array[i];
-		if (mix->view) {
-			output_frame(mix);
-		} else {
+		if (!mix->view) {
 			obs->video.mixes.array[i] = NULL;
 			obs_free_video_mix(mix);
 			da_erase(obs->video.mixes, i);
 			i--;
-			num--;
 		}
 	}
+
+	mixes = obs->video.mixes.array;
+	num = obs->video.mixes.num;
+
+	profile_start(output_frame_gs_context_name);
+	gs_enter_context(obs->video.graphics);
+
+	/* submit every mix before mapping any staging surface, so mapping
+	 * one mix's previous frame doesn't wait on the rendering of the
+	 * mixes after it */
+	profile_start(output_frame_render_video_name);
+	GS_DEBUG_MARKER_BEGIN(GS_DEBUG_COLOR_RENDER_VIDEO,
+			      output_frame_render_video_name);
+	for (size_t i = 0; i < num; i++)
+		render_frame(mixes[i]);
+	GS_DEBUG_MARKER_END();
+	profile_end(output_frame_render_video_name);
+
+	for (size_t i = 0; i < num; i++)
+		readback_frame(mixes[i]);
+
+	profile_start(output_frame_gs_flush_name);
+	gs_flush();
+	profile_end(output_frame_gs_flush_name);
+
+	gs_leave_context();
+	profile_end(output_frame_gs_context_name);
+
+	for (size_t i = 0; i < num; i++)
+		output_frame(mixes[i]);
 	pthread_mutex_unlock(&obs->video.mixes_mutex);
 }
 
@@ -967,7 +1184,8 @@ static void clear_base_frame_data(struct obs_core_video_mix *video)
 	video->texture_rendered = false;
 	video->texture_converted = false;
 	circlebuf_free(&video->vframe_info_buffer);
-	video->cur_texture = 0;
+	video->cur_texture = next_texture(video, video->num_textures - 1);
+	video->prev_texture = -1;
 }
 
 static void clear_raw_frame_data(struct obs_core_video_mix *video)
@@ -1142,9 +1360,12 @@ static inline bool stop_requested(void)
 
 bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 {
+	struct obs_video_frame_times *times = &obs->video.frame_times;
 	uint64_t frame_start = os_gettime_ns();
 	uint64_t frame_time_ns;
+	uint64_t stage_start;
 
+	reset_frame_times(times);
 	update_active_states();
 
 	profile_start(context->video_thread_name);
@@ -1155,7 +1376,11 @@ bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 
     //每个输入源tick
 	profile_start(tick_sources_name);
-	context->last_time = tick_sources(obs->video.video_time, context->last_time);
+	stage_start = os_gettime_ns();
+	context->last_time = tick_sources(context->tick_pool,
+					  obs->video.video_time,
+					  context->last_time);
+	record_frame_time(&times->tick_sources, os_gettime_ns() - stage_start);
 	profile_end(tick_sources_name);
 
 #ifdef _WIN32
@@ -1167,24 +1392,32 @@ bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 #endif
     ///将数据渲染到缓冲区
 	profile_start(output_frame_name);
+	stage_start = os_gettime_ns();
 	output_frames();
+	record_frame_time(&times->output_frames, os_gettime_ns() - stage_start);
 	profile_end(output_frame_name);
 
     
     ///将渲染缓冲区的数据绘制到屏幕上
 	profile_start(render_displays_name);
+	stage_start = os_gettime_ns();
 	render_displays();
+	record_frame_time(&times->render_displays,
+			  os_gettime_ns() - stage_start);
 	profile_end(render_displays_name);
 
 	execute_graphics_tasks();
 
 	frame_time_ns = os_gettime_ns() - frame_start;
+	record_frame_time(&times->loop, frame_time_ns);
+	record_culled_items(times);
 
 	profile_end(context->video_thread_name);
 
 	profile_reenable_thread();
 
-	video_sleep(&obs->video, &obs->video.video_time, context->interval);
+	video_sleep(&obs->video, context->frame_clock, &obs->video.video_time,
+		    context->interval);
 
 	context->frame_time_total_ns += frame_time_ns;
 	context->fps_total_ns += (obs->video.video_time - context->last_time);
@@ -1205,6 +1438,47 @@ bool obs_graphics_thread_loop(struct obs_graphics_context *context)
 
 	return !stop_requested();
 }
+#define DEFAULT_FRAME_CLOCK_SPIN_NS 1000000ULL
+
+static os_frame_clock_t *create_frame_clock(void)
+{
+	static const char *mode_names[] = {"sleep", "hybrid", "timerfd"};
+	enum os_frame_clock_mode mode;
+	uint64_t spin_ns = obs->video.frame_clock_spin_ns;
+	os_frame_clock_t *clock;
+
+	switch (obs->video.frame_clock) {
+	case OBS_FRAME_CLOCK_HYBRID:
+		mode = OS_FRAME_CLOCK_HYBRID;
+		break;
+	case OBS_FRAME_CLOCK_TIMERFD:
+		mode = OS_FRAME_CLOCK_TIMERFD;
+		break;
+	default:
+		mode = OS_FRAME_CLOCK_SLEEP;
+	}
+
+	if (!spin_ns)
+		spin_ns = DEFAULT_FRAME_CLOCK_SPIN_NS;
+
+	clock = os_frame_clock_create(mode, spin_ns);
+	if (mode != OS_FRAME_CLOCK_SLEEP)
+		blog(LOG_INFO, "Graphics thread frame clock: %s, spin %g ms",
+		     mode_names[os_frame_clock_get_mode(clock)],
+		     (double)spin_ns / 1000000.0);
+	return clock;
+}
+
+static os_task_pool_t *create_tick_pool(void)
+{
+	int cores = os_get_logical_cores();
+	if (cores <= 2)
+		return NULL;
+
+	return os_task_pool_create(cores > 5 ? 4 : (size_t)cores - 1,
+				   "libobs: source tick");
+}
+
 ///====所有source 画布绘制 以及画布的输出 (输出到每个画布对应的video_output中)
 void *obs_graphics_thread(void *param){
 #ifdef _WIN32
@@ -1234,6 +1508,8 @@ void *obs_graphics_thread(void *param){
 	context.fps_total_frames = 0;
 	context.last_time = 0;
 	context.video_thread_name = video_thread_name;
+	context.frame_clock = create_frame_clock();
+	context.tick_pool = create_tick_pool();
 
 #ifdef __APPLE__
 	while (obs_graphics_thread_loop_autorelease(&context))
@@ -1242,6 +1518,9 @@ void *obs_graphics_thread(void *param){
 #endif
 		;
 
+	os_frame_clock_destroy(context.frame_clock);
+	os_task_pool_destroy(context.tick_pool);
+
 #ifdef _WIN32
 	uninit_winrt_state(&winrt);
 #endif
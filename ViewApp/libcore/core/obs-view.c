@@ -172,7 +172,7 @@ video_t *obs_view_add2(obs_view_t *view, struct obs_video_info *ovi)
 	if (!view || !ovi)
 		return NULL;
 
-	struct obs_core_video_mix *mix = obs_create_video_mix(ovi);
+	struct obs_core_video_mix *mix = obs_create_video_mix(view, ovi);
 	if (!mix) {
 		return NULL;
 	}
@@ -186,6 +186,31 @@ video_t *obs_view_add2(obs_view_t *view, struct obs_video_info *ovi)
 	return mix->video;
 }
 
+void obs_view_set_readback_depth(obs_view_t *view, uint32_t depth)
+{
+	if (!view)
+		return;
+
+	if (depth > MAX_TEXTURES)
+		depth = MAX_TEXTURES;
+	view->readback_depth = depth;
+}
+
+bool obs_view_get_readback_stats(obs_view_t *view,
+				 struct obs_video_readback_stats *stats)
+{
+	if (!view || !stats)
+		return false;
+
+	pthread_mutex_lock(&obs->video.mixes_mutex);
+	size_t idx = find_mix_for_view(view);
+	if (idx != DARRAY_INVALID)
+		*stats = obs->video.mixes.array[idx]->readback_stats;
+	pthread_mutex_unlock(&obs->video.mixes_mutex);
+
+	return idx != DARRAY_INVALID;
+}
+
 void obs_view_remove(obs_view_t *view)
 {
 	if (!view)
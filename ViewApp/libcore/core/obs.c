@@ -45,6 +45,7 @@ static inline void make_video_info(struct video_output_info *vi,
 	vi->range = ovi->range;
 	vi->colorspace = ovi->colorspace;
 	vi->cache_size = 6;
+	vi->input_threads = os_get_logical_cores() > 2 ? 2 : 0;
 }
 ///======gpu层面图像转换配置
 static inline void calc_gpu_conversion_sizes(struct obs_core_video_mix *video)
@@ -430,7 +431,7 @@ static bool obs_init_textures(struct obs_core_video_mix *video)
 		break;
 	}
 
-	for (size_t i = 0; i < NUM_TEXTURES; i++) {
+	for (int i = 0; i < video->num_textures; i++) {
 #ifdef _WIN32
 		if (video->using_nv12_tex) {
 			video->copy_surfaces_encode[i] =
@@ -501,7 +502,7 @@ static bool obs_init_textures(struct obs_core_video_mix *video)
 	if (success) {
 		video->render_space = space;
 	} else {
-		for (size_t i = 0; i < NUM_TEXTURES; i++) {
+		for (int i = 0; i < video->num_textures; i++) {
 			for (size_t c = 0; c < NUM_CHANNELS; c++) {
 				if (video->copy_surfaces[i][c]) {
 					gs_stagesurface_destroy(
@@ -689,6 +690,17 @@ static int obs_init_video_mix(struct obs_video_info *ovi,
 	}
 	pthread_mutex_unlock(&obs->video.mixes_mutex);
 
+	uint32_t depth = video->view && video->view->readback_depth
+				 ? video->view->readback_depth
+				 : obs->video.readback_depth;
+	video->num_textures = depth >= NUM_TEXTURES ? (int)depth
+						    : NUM_TEXTURES;
+	video->zero_copy_raw = obs->video.readback_zero_copy &&
+			       video->num_textures > 2;
+	video->prev_texture = -1;
+	for (int i = 0; i < video->num_textures; i++)
+		video->raw_refs[i].video = video;
+
 	video->gpu_conversion = ovi->gpu_conversion;
 	video->gpu_was_active = false;
 	video->raw_was_active = false;
@@ -722,10 +734,12 @@ static int obs_init_video_mix(struct obs_video_info *ovi,
 	return OBS_VIDEO_SUCCESS;
 }
 
-struct obs_core_video_mix *obs_create_video_mix(struct obs_video_info *ovi)
+struct obs_core_video_mix *obs_create_video_mix(struct obs_view *view,
+						struct obs_video_info *ovi)
 {
 	struct obs_core_video_mix *video =
 		bzalloc(sizeof(struct obs_core_video_mix));
+	video->view = view;
 	if (obs_init_video_mix(ovi, video) != OBS_VIDEO_SUCCESS) {
 		bfree(video);
 		video = NULL;
@@ -792,14 +806,17 @@ static void obs_free_render_textures(struct obs_core_video_mix *video)
 
 	gs_enter_context(obs->video.graphics);
 
-	for (size_t c = 0; c < NUM_CHANNELS; c++) {
-		if (video->mapped_surfaces[c]) {
-			gs_stagesurface_unmap(video->mapped_surfaces[c]);
-			video->mapped_surfaces[c] = NULL;
+	for (int i = 0; i < video->num_textures; i++) {
+		for (size_t c = 0; c < NUM_CHANNELS; c++) {
+			if (video->mapped_surfaces[i][c]) {
+				gs_stagesurface_unmap(
+					video->mapped_surfaces[i][c]);
+				video->mapped_surfaces[i][c] = NULL;
+			}
 		}
 	}
 
-	for (size_t i = 0; i < NUM_TEXTURES; i++) {
+	for (int i = 0; i < video->num_textures; i++) {
 		for (size_t c = 0; c < NUM_CHANNELS; c++) {
 			if (video->copy_surfaces[i][c]) {
 				gs_stagesurface_destroy(
@@ -839,9 +856,27 @@ static void obs_free_render_textures(struct obs_core_video_mix *video)
 	gs_leave_context();
 }
 ///======
+static void log_readback_stats(struct obs_core_video_mix *video)
+{
+	const struct obs_video_readback_stats *stats = &video->readback_stats;
+
+	if (!stats->frames)
+		return;
+
+	blog(LOG_INFO,
+	     "Video readback (%dx%d, depth %d): %" PRIu64 " frames, "
+	     "average wait %.3f ms, max wait %.3f ms",
+	     video->ovi.output_width, video->ovi.output_height,
+	     video->num_textures, stats->frames,
+	     (double)stats->total_wait_ns / (double)stats->frames / 1e6,
+	     (double)stats->max_wait_ns / 1e6);
+}
+///======
 void obs_free_video_mix(struct obs_core_video_mix *video)
 {
 	if (video->video) {
+		log_readback_stats(video);
+
 		video_output_close(video->video);
 		video->video = NULL;
 
@@ -861,6 +896,7 @@ void obs_free_video_mix(struct obs_core_video_mix *video)
 
 		video->gpu_encoder_active = 0;
 		video->cur_texture = 0;
+		video->prev_texture = -1;
 	}
 	bfree(video);
 }
@@ -920,6 +956,17 @@ static void obs_free_graphics(void)
 }
 
 static void set_audio_thread(void *unused);
+
+static os_task_pool_t *create_audio_render_pool(void)
+{
+	int cores = os_get_logical_cores();
+	if (cores <= 2)
+		return NULL;
+
+	return os_task_pool_create(cores > 5 ? 4 : (size_t)cores - 1,
+				   "libobs: audio render");
+}
+
 ///=====初始化音频输出
 static bool obs_init_audio(struct audio_output_info *ai)
 {
@@ -938,6 +985,7 @@ static bool obs_init_audio(struct audio_output_info *ai)
 
 	audio->monitoring_device_name = bstrdup("Default");
 	audio->monitoring_device_id = bstrdup("default");
+	audio->render_pool = create_audio_render_pool();
     /// 开启音频线程
 	errorcode = audio_output_open(&audio->audio, ai);
 	if (errorcode == AUDIO_OUTPUT_SUCCESS)
@@ -958,6 +1006,8 @@ static void stop_audio(void)
 		audio_output_close(audio->audio);
 		audio->audio = NULL;
 	}
+
+	release_audio_graph(audio);
 }
 ///======
 static void obs_free_audio(void)
@@ -966,9 +1016,13 @@ static void obs_free_audio(void)
 	if (audio->audio)
 		audio_output_close(audio->audio);
 
+	release_audio_graph(audio);
+	os_task_pool_destroy(audio->render_pool);
+
 	circlebuf_free(&audio->buffered_timestamps);
 	da_free(audio->render_order);
 	da_free(audio->root_nodes);
+	da_free(audio->render_stage);
 
 	da_free(audio->monitors);
 	bfree(audio->monitoring_device_name);
@@ -1256,6 +1310,11 @@ static bool obs_init(const char *locale, const char *module_config_path,
 	if (!obs->destruction_task_thread)
 		return false;
 
+	/* helpers for copying 4K+ async frames, sources' own threads do the
+	 * rest */
+	int cores = os_get_logical_cores();
+	video_frame_copy_set_threads(cores > 4 ? 2 : (cores > 2 ? 1 : 0));
+
 	if (module_config_path)
 		obs->module_config_path = bstrdup(module_config_path);
 	obs->locale = bstrdup(locale);
@@ -1456,6 +1515,8 @@ void obs_shutdown(void)
 	bfree(obs->locale);
 	bfree(obs);
 	obs = NULL;
+	video_frame_copy_set_threads(0);
+	video_frame_pool_trim();
 	bfree(cmdline_args.argv);
 
 #ifdef _WIN32
@@ -1672,6 +1733,23 @@ void obs_set_video_levels(float sdr_white_level, float hdr_nominal_peak_level)
 	video->hdr_nominal_peak_level = hdr_nominal_peak_level;
 }
 ///=======
+void obs_set_video_readback(uint32_t depth, bool zero_copy)
+{
+	struct obs_core_video *video = &obs->video;
+
+	if (depth > MAX_TEXTURES)
+		depth = MAX_TEXTURES;
+
+	video->readback_depth = depth;
+	video->readback_zero_copy = zero_copy;
+}
+///=======
+void obs_set_video_frame_clock(enum obs_frame_clock clock, uint64_t spin_ns)
+{
+	obs->video.frame_clock = clock;
+	obs->video.frame_clock_spin_ns = spin_ns;
+}
+///=======
 bool obs_get_audio_info(struct obs_audio_info *oai)
 {
 	struct obs_core_audio *audio = &obs->audio;
@@ -1888,6 +1966,7 @@ void obs_set_output_source(uint32_t channel, obs_source_t *source)
 
 	view->channels[channel] = source;
 	pthread_mutex_unlock(&view->channels_mutex);
+	obs_invalidate_audio_graph();
 	if (source)
 		obs_source_activate(source, MAIN_VIEW);
 	if (prev_source) {
@@ -3116,6 +3195,71 @@ uint32_t obs_get_lagged_frames(void)
 {
 	return obs->video.lagged_frames;
 }
+///======
+static void get_frame_time_stats(struct obs_frame_histogram *hist,
+				 struct obs_frame_time_stats *stats)
+{
+	long counts[FRAME_HIST_BUCKETS];
+	uint64_t p50, p95, p99;
+	uint64_t seen = 0;
+
+	memset(stats, 0, sizeof(*stats));
+
+	for (size_t i = 0; i < FRAME_HIST_BUCKETS; i++) {
+		counts[i] = os_atomic_load_long(&hist->counts[i]);
+		stats->samples += (uint64_t)counts[i];
+	}
+	if (!stats->samples)
+		return;
+
+	p50 = (stats->samples * 50 + 99) / 100;
+	p95 = (stats->samples * 95 + 99) / 100;
+	p99 = (stats->samples * 99 + 99) / 100;
+
+	for (size_t i = 0; i < FRAME_HIST_BUCKETS; i++) {
+		uint64_t prev = seen;
+		uint64_t ns = frame_hist_value(i) * 1000;
+
+		seen += (uint64_t)counts[i];
+		if (prev < p50 && seen >= p50)
+			stats->p50_ns = ns;
+		if (prev < p95 && seen >= p95)
+			stats->p95_ns = ns;
+		if (prev < p99 && seen >= p99)
+			stats->p99_ns = ns;
+	}
+
+	stats->max_ns = (uint64_t)os_atomic_load_long(&hist->max_us) * 1000;
+}
+
+bool obs_get_video_frame_stats(struct obs_video_frame_stats *stats)
+{
+	struct obs_video_frame_times *times;
+
+	if (!obs || !stats)
+		return false;
+
+	times = &obs->video.frame_times;
+	stats->missed_deadlines =
+		(uint64_t)os_atomic_load_long(&times->missed_deadlines);
+	get_frame_time_stats(&times->loop, &stats->loop);
+	get_frame_time_stats(&times->sleep_overshoot, &stats->sleep_overshoot);
+	get_frame_time_stats(&times->tick_sources, &stats->tick_sources);
+	get_frame_time_stats(&times->output_frames, &stats->output_frames);
+	get_frame_time_stats(&times->render_displays, &stats->render_displays);
+	stats->culled_items =
+		(uint64_t)os_atomic_load_long(&times->last_culled_items);
+	stats->max_culled_items =
+		(uint64_t)os_atomic_load_long(&times->max_culled_items);
+	return true;
+}
+
+void obs_reset_video_frame_stats(void)
+{
+	/* cleared by the graphics thread at the start of its next frame */
+	if (obs)
+		os_atomic_set_bool(&obs->video.frame_times.reset, true);
+}
 ///=====当前的视频画布输出
 struct obs_core_video_mix *get_mix_for_video(video_t *v)
 {
@@ -24,8 +24,10 @@
 #include "graphics/graphics.h"
 #include "graphics/vec2.h"
 #include "graphics/vec3.h"
+#include "graphics/matrix4.h"
 #include "media-io/audio-io.h"
 #include "media-io/video-io.h"
+#include "media-io/video-frame.h"
 #include "callback/osignal.h"
 #include "callback/proc.h"
 
@@ -282,6 +284,10 @@ struct obs_source_frame {
 	volatile long refs;
     ///隔行扫描的上半场的帧
 	bool prev_frame;
+	/* set for frames queued by obs_source_output_video_ref, whose plane
+	 * data belongs to the producer */
+	void (*release)(void *param);
+	void *release_param;
 };
 
 struct obs_source_frame2 {
@@ -374,6 +380,45 @@ EXPORT float obs_get_video_hdr_nominal_peak_level(void);
 EXPORT void obs_set_video_levels(float sdr_white_level,
 				 float hdr_nominal_peak_level);
 
+/** Raw frame readback timings of a view's video mix */
+struct obs_video_readback_stats {
+	uint64_t frames;
+	uint64_t total_wait_ns;
+	uint64_t max_wait_ns;
+	uint64_t last_wait_ns;
+};
+
+/**
+ * Sets up raw frame readback for video mixes created after this call.
+ *
+ * @param  depth      Number of staging surfaces per mix (2 to 8, 0 for the
+ *                    default of 2).  Deeper rings add latency but keep the
+ *                    GPU from stalling on readback.
+ * @param  zero_copy  Raw outputs read the mapped staging surfaces in place
+ *                    instead of a copy.  Only used with a depth of 3 or
+ *                    more.
+ */
+EXPORT void obs_set_video_readback(uint32_t depth, bool zero_copy);
+
+enum obs_frame_clock {
+	/** Plain sleep to each frame deadline */
+	OBS_FRAME_CLOCK_SLEEP,
+	/** Absolute sleep to just before the deadline, then spin */
+	OBS_FRAME_CLOCK_HYBRID,
+	/** Hybrid, waiting on a timerfd (Linux only, hybrid elsewhere) */
+	OBS_FRAME_CLOCK_TIMERFD,
+};
+
+/**
+ * Sets how the graphics thread waits for the next frame.  Applies to the
+ * graphics thread started by the next obs_reset_video call.
+ *
+ * @param  spin_ns  How long before the deadline to start spinning, 0 for
+ *                  the default of 1ms.  Unused with OBS_FRAME_CLOCK_SLEEP.
+ */
+EXPORT void obs_set_video_frame_clock(enum obs_frame_clock clock,
+				      uint64_t spin_ns);
+
 /** Gets the current audio settings, returns false if no audio */
 EXPORT bool obs_get_audio_info(struct obs_audio_info *oai);
 
@@ -822,6 +867,38 @@ EXPORT uint64_t obs_get_frame_interval_ns(void);
 EXPORT uint32_t obs_get_total_frames(void);
 EXPORT uint32_t obs_get_lagged_frames(void);
 
+/** Distribution of one stage of the graphics loop, in nanoseconds */
+struct obs_frame_time_stats {
+	uint64_t samples;
+	uint64_t p50_ns;
+	uint64_t p95_ns;
+	uint64_t p99_ns;
+	uint64_t max_ns;
+};
+
+struct obs_video_frame_stats {
+	/** Frames where the loop finished after the next frame was due */
+	uint64_t missed_deadlines;
+
+	struct obs_frame_time_stats loop;
+	/** How late the graphics thread woke up from its frame sleep */
+	struct obs_frame_time_stats sleep_overshoot;
+	struct obs_frame_time_stats tick_sources;
+	struct obs_frame_time_stats output_frames;
+	struct obs_frame_time_stats render_displays;
+
+	/** Scene items skipped as off-canvas or covered in the last frame */
+	uint64_t culled_items;
+	uint64_t max_culled_items;
+};
+
+/**
+ * Gets graphics loop timings collected since startup or the last
+ * obs_reset_video_frame_stats call.  Percentiles are accurate to 12.5%.
+ */
+EXPORT bool obs_get_video_frame_stats(struct obs_video_frame_stats *stats);
+EXPORT void obs_reset_video_frame_stats(void);
+
 EXPORT bool obs_nv12_tex_active(void);
 EXPORT bool obs_p010_tex_active(void);
 
@@ -895,6 +972,16 @@ EXPORT void obs_view_remove(obs_view_t *view);
 EXPORT bool obs_view_get_video_info(obs_view_t *view,
 				    struct obs_video_info *ovi);
 
+/**
+ * Sets the staging ring depth of mixes added for this view afterwards,
+ * 0 to use the obs_set_video_readback depth
+ */
+EXPORT void obs_view_set_readback_depth(obs_view_t *view, uint32_t depth);
+
+/** Gets the time spent waiting on raw frame readback for this view's mix */
+EXPORT bool obs_view_get_readback_stats(obs_view_t *view,
+					struct obs_video_readback_stats *stats);
+
 /* ------------------------------------------------------------------------- */
 /* Display context */
 
@@ -1356,6 +1443,20 @@ EXPORT void obs_source_draw(gs_texture_t *image, int x, int y, uint32_t cx,
 EXPORT void obs_source_output_video(obs_source_t *source,
 				    const struct obs_source_frame *frame);
 
+/**
+ * Outputs asynchronous video data without copying it.  The planes of the
+ * frame must stay valid until release(param) is called, which happens once
+ * libobs is done with the frame, or right away if it can't be queued.
+ *
+ * release can be called from any thread, with source locks held, so it
+ * must not call back into the source.  A NULL release copies the frame
+ * like obs_source_output_video.
+ */
+EXPORT void obs_source_output_video_ref(obs_source_t *source,
+					const struct obs_source_frame *frame,
+					void (*release)(void *param),
+					void *param);
+
 EXPORT void obs_source_output_video2(obs_source_t *source,
 				     const struct obs_source_frame2 *frame);
 
@@ -1401,6 +1502,13 @@ EXPORT void obs_source_output_audio(obs_source_t *source,
 /** Signal an update to any currently used properties via 'update_properties' */
 EXPORT void obs_source_update_properties(obs_source_t *source);
 
+/**
+ * Tells scenes that the source's video output changed outside of a settings
+ * update, so any cached render of it must be redrawn.  Sources flagged with
+ * OBS_SOURCE_CACHEABLE_RENDER call this whenever their output changes.
+ */
+EXPORT void obs_source_mark_dirty(obs_source_t *source);
+
 /** Gets the current async video frame */
 EXPORT struct obs_source_frame *obs_source_get_frame(obs_source_t *source);
 
@@ -1530,6 +1638,36 @@ EXPORT void obs_source_set_async_unbuffered(obs_source_t *source,
 					    bool unbuffered);
 EXPORT bool obs_source_async_unbuffered(const obs_source_t *source);
 
+/**
+ * Sets how many async frames the source queues before dropping the oldest
+ * one, 0 for the default of 30
+ */
+EXPORT void obs_source_set_async_queue_depth(obs_source_t *source,
+					     uint32_t depth);
+
+struct obs_source_async_stats {
+	/** Frames dropped from a full queue before they were shown */
+	uint64_t dropped;
+	/** Frames skipped because a newer one was already due */
+	uint64_t late;
+	/** Frames copied into a recycled cache buffer */
+	uint64_t reused;
+};
+
+EXPORT bool obs_source_get_async_stats(obs_source_t *source,
+				       struct obs_source_async_stats *stats);
+
+struct obs_source_filter_stats {
+	/** Filter passes drawn as part of a neighbouring filter's pass */
+	uint64_t fused;
+	/** Filter passes skipped because the filter was an identity */
+	uint64_t bypassed;
+};
+
+/** Gets how many render passes this source's filter chain has saved */
+EXPORT bool obs_source_get_filter_stats(obs_source_t *source,
+					struct obs_source_filter_stats *stats);
+
 /** Used to decouple audio from video so that audio doesn't attempt to sync up
  * with video.  I.E. Audio acts independently.  Only works when in unbuffered
  * mode.
@@ -2565,7 +2703,7 @@ EXPORT void obs_source_frame_init(struct obs_source_frame *frame,
 static inline void obs_source_frame_free(struct obs_source_frame *frame)
 {
 	if (frame) {
-		bfree(frame->data[0]);
+		video_frame_pool_free(frame->data[0]);
 		memset(frame, 0, sizeof(*frame));
 	}
 }
@@ -2584,7 +2722,10 @@ obs_source_frame_create(enum video_format format, uint32_t width,
 static inline void obs_source_frame_destroy(struct obs_source_frame *frame)
 {
 	if (frame) {
-		bfree(frame->data[0]);
+		if (frame->release)
+			frame->release(frame->release_param);
+		else
+			video_frame_pool_free(frame->data[0]);
 		bfree(frame);
 	}
 }
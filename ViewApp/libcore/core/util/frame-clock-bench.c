@@ -0,0 +1,141 @@
+/*
+ * Wakeup error benchmark for the frame clocks in platform-nix.c.
+ *
+ * Sleeps to FRAMES consecutive 60 fps deadlines with plain
+ * os_sleepto_ns, the hybrid sleep-and-spin clock and the timerfd clock,
+ * and reports how late each wakeup was along with the CPU time the waits
+ * cost.  Pass a thread count to run with that many busy threads competing
+ * for the CPU, like a loaded host:
+ *   frame-clock-bench 8
+ *
+ * Standalone program, not part of any target.  Build it against the
+ * libcore framework, which exports the os_frame_clock functions:
+ *   cc -O2 -I<libcore/core> -F<build dir> -framework libcore \
+ *      frame-clock-bench.c -o frame-clock-bench -lpthread
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <util/platform.h>
+#include <util/threading.h>
+
+#define CHECK(condition)                                                    \
+	do {                                                                \
+		if (!(condition)) {                                         \
+			fprintf(stderr, "%s:%d: error: check failed: %s\n", \
+				__FILE__, __LINE__, #condition);            \
+			exit(1);                                            \
+		}                                                           \
+	} while (0)
+
+#define FRAMES 300
+#define FRAME_NS 16666667ULL
+#define SPIN_NS 1000000ULL
+
+static uint64_t late_ns[FRAMES];
+static volatile bool loading;
+
+static int compare_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+	return (x > y) - (x < y);
+}
+
+static uint64_t thread_cpu_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void *load_thread(void *param)
+{
+	volatile uint64_t sink = 0;
+
+	while (os_atomic_load_bool(&loading))
+		sink++;
+
+	UNUSED_PARAMETER(param);
+	return NULL;
+}
+
+static void bench(const char *name, enum os_frame_clock_mode mode)
+{
+	os_frame_clock_t *clock = os_frame_clock_create(mode, SPIN_NS);
+	uint64_t total_late = 0;
+	size_t missed = 0;
+
+	CHECK(clock != NULL);
+	CHECK(os_frame_clock_get_mode(clock) == mode);
+
+	uint64_t cpu_start = thread_cpu_ns();
+	uint64_t target = os_gettime_ns() + FRAME_NS;
+
+	for (size_t i = 0; i < FRAMES; i++) {
+		if (!os_frame_clock_sleepto_ns(clock, target))
+			missed++;
+
+		uint64_t now = os_gettime_ns();
+		CHECK(now >= target);
+		late_ns[i] = now - target;
+		total_late += late_ns[i];
+
+		/* a late wakeup pushes the next deadline the way video_sleep
+		 * does, by skipping the frames it overran */
+		do {
+			target += FRAME_NS;
+		} while (target <= now);
+	}
+
+	uint64_t cpu_ns = thread_cpu_ns() - cpu_start;
+	os_frame_clock_destroy(clock);
+
+	qsort(late_ns, FRAMES, sizeof(late_ns[0]), compare_u64);
+	printf("%-8s late us: mean %8.1f  p50 %8.1f  p99 %8.1f  max %8.1f"
+	       "  missed %3zu  cpu %5.1f%%\n",
+	       name, (double)total_late / FRAMES / 1000.0,
+	       (double)late_ns[FRAMES / 2] / 1000.0,
+	       (double)late_ns[FRAMES * 99 / 100] / 1000.0,
+	       (double)late_ns[FRAMES - 1] / 1000.0, missed,
+	       (double)cpu_ns * 100.0 / ((double)FRAMES * FRAME_NS));
+}
+
+int main(int argc, char *argv[])
+{
+	int load_threads = argc > 1 ? atoi(argv[1]) : 0;
+	pthread_t *threads = NULL;
+
+	CHECK(load_threads >= 0);
+
+	if (load_threads) {
+		threads = calloc((size_t)load_threads, sizeof(*threads));
+		CHECK(threads != NULL);
+
+		os_atomic_set_bool(&loading, true);
+		for (int i = 0; i < load_threads; i++)
+			CHECK(pthread_create(&threads[i], NULL, load_thread,
+					     NULL) == 0);
+	}
+
+	printf("%d frames at 60 fps, %d busy threads, %.1f ms spin\n", FRAMES,
+	       load_threads, (double)SPIN_NS / 1000000.0);
+
+	bench("sleep", OS_FRAME_CLOCK_SLEEP);
+	bench("hybrid", OS_FRAME_CLOCK_HYBRID);
+#if defined(__linux__)
+	bench("timerfd", OS_FRAME_CLOCK_TIMERFD);
+#endif
+
+	if (load_threads) {
+		os_atomic_set_bool(&loading, false);
+		for (int i = 0; i < load_threads; i++)
+			pthread_join(threads[i], NULL);
+		free(threads);
+	}
+
+	return 0;
+}
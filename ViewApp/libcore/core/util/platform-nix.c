@@ -57,6 +57,9 @@
 #if !defined(__OpenBSD__)
 #include <sys/sysinfo.h>
 #endif
+#if defined(__linux__)
+#include <sys/timerfd.h>
+#endif
 #include <spawn.h>
 #endif
 
@@ -255,6 +258,122 @@ bool os_sleepto_ns_fast(uint64_t time_target)
 	return true;
 }
 
+struct os_frame_clock {
+	enum os_frame_clock_mode mode;
+	uint64_t spin_ns;
+	int timer_fd;
+};
+
+os_frame_clock_t *os_frame_clock_create(enum os_frame_clock_mode mode,
+					uint64_t spin_ns)
+{
+	struct os_frame_clock *clock = bzalloc(sizeof(struct os_frame_clock));
+	clock->mode = mode;
+	clock->spin_ns = spin_ns;
+	clock->timer_fd = -1;
+
+#if defined(__linux__)
+	if (mode == OS_FRAME_CLOCK_TIMERFD) {
+		clock->timer_fd =
+			timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+		if (clock->timer_fd == -1) {
+			blog(LOG_WARNING, "os_frame_clock_create: timerfd_create "
+					  "failed (%d), using hybrid sleep",
+			     errno);
+			clock->mode = OS_FRAME_CLOCK_HYBRID;
+		}
+	}
+#else
+	if (mode == OS_FRAME_CLOCK_TIMERFD)
+		clock->mode = OS_FRAME_CLOCK_HYBRID;
+#endif
+
+	return clock;
+}
+
+void os_frame_clock_destroy(os_frame_clock_t *clock)
+{
+	if (!clock)
+		return;
+
+	if (clock->timer_fd != -1)
+		close(clock->timer_fd);
+	bfree(clock);
+}
+
+enum os_frame_clock_mode os_frame_clock_get_mode(const os_frame_clock_t *clock)
+{
+	return clock ? clock->mode : OS_FRAME_CLOCK_SLEEP;
+}
+
+#if defined(__linux__)
+/* os_gettime_ns is CLOCK_MONOTONIC here, so targets can be used as absolute
+ * timer deadlines directly */
+static inline void frame_clock_wait(struct os_frame_clock *clock,
+				    uint64_t wake)
+{
+	struct timespec ts;
+	ts.tv_sec = (time_t)(wake / 1000000000);
+	ts.tv_nsec = (long)(wake % 1000000000);
+
+	if (clock->mode == OS_FRAME_CLOCK_TIMERFD) {
+		struct itimerspec its;
+		uint64_t expirations;
+
+		memset(&its, 0, sizeof(its));
+		its.it_value = ts;
+		if (timerfd_settime(clock->timer_fd, TFD_TIMER_ABSTIME, &its,
+				    NULL) == 0) {
+			while (read(clock->timer_fd, &expirations,
+				    sizeof(expirations)) == -1 &&
+			       errno == EINTR)
+				;
+			return;
+		}
+	}
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) ==
+	       EINTR)
+		;
+}
+#else
+static inline void frame_clock_wait(struct os_frame_clock *clock,
+				    uint64_t wake)
+{
+	UNUSED_PARAMETER(clock);
+	os_sleepto_ns(wake);
+}
+#endif
+
+static inline void cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	__asm__ volatile("yield");
+#endif
+}
+
+bool os_frame_clock_sleepto_ns(os_frame_clock_t *clock, uint64_t time_target)
+{
+	if (!clock || clock->mode == OS_FRAME_CLOCK_SLEEP)
+		return os_sleepto_ns(time_target);
+
+	uint64_t current = os_gettime_ns();
+	if (time_target < current)
+		return false;
+
+	/* sleep until just short of the target, then spin off the rest so
+	 * scheduler wakeup latency doesn't land on the frame */
+	if (time_target - current > clock->spin_ns)
+		frame_clock_wait(clock, time_target - clock->spin_ns);
+
+	while (os_gettime_ns() < time_target)
+		cpu_relax();
+
+	return true;
+}
+
 void os_sleep_ms(uint32_t duration)
 {
 	usleep(duration * 1000);
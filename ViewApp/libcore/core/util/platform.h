@@ -106,6 +106,32 @@ EXPORT bool os_sleepto_ns(uint64_t time_target);
 EXPORT bool os_sleepto_ns_fast(uint64_t time_target);
 EXPORT void os_sleep_ms(uint32_t duration);
 
+enum os_frame_clock_mode {
+	/** Plain os_sleepto_ns */
+	OS_FRAME_CLOCK_SLEEP,
+	/** Absolute sleep to shortly before the target, then spin */
+	OS_FRAME_CLOCK_HYBRID,
+	/** Like hybrid, but waits on a timerfd (Linux only, else hybrid) */
+	OS_FRAME_CLOCK_TIMERFD,
+};
+
+struct os_frame_clock;
+typedef struct os_frame_clock os_frame_clock_t;
+
+/**
+ * Creates a clock for sleeping to frame deadlines.  spin_ns is how long
+ * before the target the sleep ends and busy waiting takes over.
+ */
+EXPORT os_frame_clock_t *os_frame_clock_create(enum os_frame_clock_mode mode,
+					       uint64_t spin_ns);
+EXPORT void os_frame_clock_destroy(os_frame_clock_t *clock);
+EXPORT enum os_frame_clock_mode
+os_frame_clock_get_mode(const os_frame_clock_t *clock);
+
+/** Same as os_sleepto_ns, using the clock's sleep mode */
+EXPORT bool os_frame_clock_sleepto_ns(os_frame_clock_t *clock,
+				      uint64_t time_target);
+
 EXPORT uint64_t os_gettime_ns(void);
 
 EXPORT int os_get_config_path(char *dst, size_t size, const char *name);
@@ -2,6 +2,8 @@
 #include "bmem.h"
 #include "threading.h"
 #include "circlebuf.h"
+#include "darray.h"
+#include "platform.h"
 
 struct os_task_queue {
 	pthread_t thread;
@@ -165,3 +167,156 @@ static void *tiny_tubular_task_thread(void *param)
 
 	return NULL;
 }
+
+/* ------------------------------------------------------------------------- */
+
+struct os_task_pool {
+	DARRAY(pthread_t) threads;
+	char *name;
+
+	os_sem_t *sem;
+	os_event_t *done_event;
+	pthread_mutex_t run_mutex;
+	volatile bool exit;
+
+	os_task_range_t task;
+	void *param;
+	long count;
+	volatile long next;
+	volatile long active;
+};
+
+static THREAD_LOCAL os_task_pool_t *cur_task_pool = NULL;
+
+static void task_pool_run_items(os_task_pool_t *tp)
+{
+	for (;;) {
+		long idx = os_atomic_inc_long(&tp->next) - 1;
+		if (idx >= tp->count)
+			break;
+
+		tp->task(tp->param, (size_t)idx);
+	}
+
+	if (os_atomic_dec_long(&tp->active) == 0)
+		os_event_signal(tp->done_event);
+}
+
+static void *task_pool_thread(void *param)
+{
+	os_task_pool_t *tp = param;
+	cur_task_pool = tp;
+
+	os_set_thread_name(tp->name);
+
+	while (os_sem_wait(tp->sem) == 0) {
+		if (os_atomic_load_bool(&tp->exit))
+			break;
+
+		task_pool_run_items(tp);
+	}
+
+	return NULL;
+}
+
+os_task_pool_t *os_task_pool_create(size_t threads, const char *name)
+{
+	struct os_task_pool *tp = bzalloc(sizeof(*tp));
+
+	if (!threads) {
+		int cores = os_get_logical_cores();
+		threads = cores > 1 ? (size_t)cores - 1 : 1;
+	}
+
+	tp->name = bstrdup(name ? name : "task pool");
+
+	if (pthread_mutex_init(&tp->run_mutex, NULL) != 0)
+		goto fail1;
+	if (os_sem_init(&tp->sem, 0) != 0)
+		goto fail2;
+	if (os_event_init(&tp->done_event, OS_EVENT_TYPE_AUTO) != 0)
+		goto fail3;
+
+	for (size_t i = 0; i < threads; i++) {
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, task_pool_thread, tp) != 0)
+			break;
+		da_push_back(tp->threads, &thread);
+	}
+
+	if (!tp->threads.num)
+		goto fail4;
+
+	return tp;
+
+fail4:
+	os_event_destroy(tp->done_event);
+fail3:
+	os_sem_destroy(tp->sem);
+fail2:
+	pthread_mutex_destroy(&tp->run_mutex);
+fail1:
+	bfree(tp->name);
+	bfree(tp);
+	return NULL;
+}
+
+void os_task_pool_destroy(os_task_pool_t *tp)
+{
+	if (!tp)
+		return;
+
+	os_atomic_set_bool(&tp->exit, true);
+	for (size_t i = 0; i < tp->threads.num; i++)
+		os_sem_post(tp->sem);
+	for (size_t i = 0; i < tp->threads.num; i++)
+		pthread_join(tp->threads.array[i], NULL);
+
+	os_event_destroy(tp->done_event);
+	os_sem_destroy(tp->sem);
+	pthread_mutex_destroy(&tp->run_mutex);
+	da_free(tp->threads);
+	bfree(tp->name);
+	bfree(tp);
+}
+
+size_t os_task_pool_get_threads(const os_task_pool_t *tp)
+{
+	return tp ? tp->threads.num : 0;
+}
+
+void os_task_pool_run(os_task_pool_t *tp, os_task_range_t task, void *param,
+		      size_t count)
+{
+	if (!count)
+		return;
+
+	if (!tp || count == 1 || cur_task_pool == tp) {
+		for (size_t i = 0; i < count; i++)
+			task(param, i);
+		return;
+	}
+
+	size_t workers = count - 1;
+	if (workers > tp->threads.num)
+		workers = tp->threads.num;
+
+	pthread_mutex_lock(&tp->run_mutex);
+
+	tp->task = task;
+	tp->param = param;
+	tp->count = (long)count;
+	os_atomic_set_long(&tp->next, 0);
+	os_atomic_set_long(&tp->active, (long)workers + 1);
+
+	for (size_t i = 0; i < workers; i++)
+		os_sem_post(tp->sem);
+
+	/* every woken worker has to check out before the job slot can be
+	 * reused, otherwise a late wakeup could pick up the next job half
+	 * written */
+	task_pool_run_items(tp);
+	os_event_wait(tp->done_event);
+
+	pthread_mutex_unlock(&tp->run_mutex);
+}
@@ -18,6 +18,26 @@ EXPORT void os_task_queue_destroy(os_task_queue_t *tt);
 EXPORT bool os_task_queue_wait(os_task_queue_t *tt);
 EXPORT bool os_task_queue_inside(os_task_queue_t *tt);
 
+/*
+ * Task pool
+ *
+ *   Fixed set of worker threads for data-parallel work.  os_task_pool_run
+ * calls task(param, idx) for every idx in [0, count) spread across the
+ * workers and the calling thread, and returns once all of them are done.
+ * Calls made from inside one of the pool's own workers run inline.
+ */
+
+struct os_task_pool;
+typedef struct os_task_pool os_task_pool_t;
+
+typedef void (*os_task_range_t)(void *param, size_t idx);
+
+EXPORT os_task_pool_t *os_task_pool_create(size_t threads, const char *name);
+EXPORT void os_task_pool_destroy(os_task_pool_t *tp);
+EXPORT size_t os_task_pool_get_threads(const os_task_pool_t *tp);
+EXPORT void os_task_pool_run(os_task_pool_t *tp, os_task_range_t task,
+			     void *param, size_t count);
+
 #ifdef __cplusplus
 }
 #endif